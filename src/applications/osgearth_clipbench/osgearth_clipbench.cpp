@@ -0,0 +1,205 @@
+/* -*-c++-*- */
+/* osgEarth - Dynamic map generation toolkit for OpenSceneGraph
+* Copyright 2016 Pelican Mapping
+* http://osgearth.org
+*
+* osgEarth is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+
+/**
+ * Headless benchmark for cropping features to tiles. Builds one large,
+ * noisy "coastline" polygon and crops it to every tile of a small
+ * quadtree three ways: with GEOS (Geometry::crop with a polygon), with a
+ * GeometryClipper from the original each time, and through a ClipCache
+ * that starts each tile from its parent's result, as FeatureModelGraph
+ * does for non-tiled sources. Reports the time and output size of each.
+ *
+ * The GEOS pass is skipped when osgEarth was built without GEOS.
+ */
+
+#include <osgEarth/GeometryClipper>
+#include <osgEarth/Geometry>
+#include <osgEarth/Profile>
+#include <osgEarth/TileKey>
+#include <osgEarth/Notify>
+#include <osg/ArgumentParser>
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <vector>
+#include <iostream>
+#include <iomanip>
+
+using namespace osgEarth;
+
+#define LC "[clipbench] "
+
+int
+usage(const char* name)
+{
+    OE_NOTICE
+        << "\nUsage: " << name
+        << "\n    [--points n]      : vertices in the test polygon (default = 200000)"
+        << "\n    [--levels n]      : quadtree levels to crop to (default = 5)"
+        << std::endl;
+    return 0;
+}
+
+// A ragged, star-shaped polygon about the unit circle, so that most
+// tiles cut through it many times
+Polygon*
+makeCoastline(unsigned numPoints)
+{
+    std::mt19937 gen(numPoints);
+    std::uniform_real_distribution<double> noise(-0.02, 0.02);
+
+    Polygon* poly = new Polygon(numPoints);
+    double r = 0.8;
+    for (unsigned i = 0; i < numPoints; ++i)
+    {
+        double a = 2.0 * osg::PI * (double)i / (double)numPoints;
+        r = osg::clampBetween(r + noise(gen), 0.5, 0.95);
+        double wave = 0.05 * sin(a * 40.0);
+        poly->push_back(osg::Vec3d((r + wave) * cos(a), (r + wave) * sin(a), 0.0));
+    }
+    return poly;
+}
+
+// All keys of the quadtree, parents before children
+void
+collectKeys(const TileKey& key, unsigned levels, std::vector<TileKey>& keys)
+{
+    keys.push_back(key);
+    if (key.getLOD() + 1 < levels)
+    {
+        for (unsigned q = 0; q < 4; ++q)
+            collectKeys(key.createChildKey(q), levels, keys);
+    }
+}
+
+struct Result
+{
+    double seconds;
+    unsigned tiles;
+    std::size_t points;
+};
+
+template<typename CROP>
+Result
+run(const std::vector<TileKey>& keys, CROP crop)
+{
+    Result result = { 0.0, 0u, 0u };
+    auto start = std::chrono::steady_clock::now();
+    for (auto& key : keys)
+    {
+        osg::ref_ptr<Geometry> output;
+        if (crop(key, key.getExtent().bounds(), output) && output.valid())
+        {
+            ++result.tiles;
+            result.points += output->getTotalPointCount();
+        }
+    }
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return result;
+}
+
+void
+report(const char* name, const Result& r, double baseline)
+{
+    std::cout << "  " << std::left << std::setw(10) << name << std::right
+        << std::fixed << std::setprecision(3) << (1000.0 * r.seconds) << " ms, "
+        << r.tiles << " tiles, " << r.points << " points";
+    if (baseline > 0.0 && r.seconds > 0.0)
+        std::cout << " (" << std::setprecision(2) << (baseline / r.seconds) << "x)";
+    std::cout << std::endl;
+}
+
+int
+main(int argc, char** argv)
+{
+    osg::ArgumentParser arguments(&argc, argv);
+    if (arguments.read("--help"))
+        return usage(argv[0]);
+
+    unsigned numPoints = 200000u;
+    unsigned levels = 5u;
+    arguments.read("--points", numPoints);
+    arguments.read("--levels", levels);
+    levels = osg::clampBetween(levels, 1u, 10u);
+
+    osg::ref_ptr<const Profile> profile = Profile::create(
+        SpatialReference::get("spherical-mercator"), -1.0, -1.0, 1.0, 1.0, 1u, 1u);
+    if (!profile.valid())
+    {
+        OE_WARN << LC << "Failed to create the tiling profile" << std::endl;
+        return -1;
+    }
+
+    osg::ref_ptr<Polygon> coastline = makeCoastline(numPoints);
+
+    std::vector<TileKey> keys;
+    collectKeys(TileKey(0, 0, 0, profile.get()), levels, keys);
+
+    std::cout << numPoints << " points, " << keys.size() << " tiles in "
+        << levels << " levels" << std::endl;
+
+    // GEOS, from the original each time. Probe first, since crop()
+    // always fails without GEOS.
+    double baseline = 0.0;
+    osg::ref_ptr<Geometry> probe;
+    osg::ref_ptr<Polygon> probeRect = new Polygon(4);
+    probeRect->push_back(-1.0, -1.0);
+    probeRect->push_back(1.0, -1.0);
+    probeRect->push_back(1.0, 1.0);
+    probeRect->push_back(-1.0, 1.0);
+    if (coastline->crop(probeRect.get(), probe))
+    {
+        Result geos = run(keys, [&](const TileKey&, const Bounds& b, osg::ref_ptr<Geometry>& out)
+        {
+            osg::ref_ptr<Polygon> rect = new Polygon(4);
+            rect->push_back(b.xMin(), b.yMin());
+            rect->push_back(b.xMax(), b.yMin());
+            rect->push_back(b.xMax(), b.yMax());
+            rect->push_back(b.xMin(), b.yMax());
+            return coastline->crop(rect.get(), out);
+        });
+        report("GEOS", geos, 0.0);
+        baseline = geos.seconds;
+    }
+    else
+    {
+        std::cout << "  GEOS      not available, skipped" << std::endl;
+    }
+
+    // Rectangle clipper, from the original each time
+    Result clipper = run(keys, [&](const TileKey&, const Bounds& b, osg::ref_ptr<Geometry>& out)
+    {
+        return GeometryClipper(b).clip(coastline.get(), out);
+    });
+    report("clipper", clipper, baseline);
+
+    // Rectangle clipper, starting from the parent tile's result
+    osg::ref_ptr<ClipCache> cache = new ClipCache((unsigned)keys.size());
+    Result cached = run(keys, [&](const TileKey& key, const Bounds& b, osg::ref_ptr<Geometry>& out)
+    {
+        return cache->clip(1, coastline.get(), key, b, out);
+    });
+    report("cached", cached, baseline > 0.0 ? baseline : clipper.seconds);
+
+    return 0;
+}
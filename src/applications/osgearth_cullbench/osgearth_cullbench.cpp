@@ -0,0 +1,490 @@
+/* -*-c++-*- */
+/* osgEarth - Dynamic map generation toolkit for OpenSceneGraph
+* Copyright 2016 Pelican Mapping
+* http://osgearth.org
+*
+* osgEarth is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+
+/**
+ * Headless, CPU-only benchmark for how the REX terrain culler stores its
+ * output. Simulates the culler emitting one draw command per visible tile
+ * and layer, sorting them, and a renderer walking them a frame later. It
+ * runs once the way the culler used to work (new drawables and a new
+ * matrix per tile every frame, ref-counted command members, sorting whole
+ * commands), then the way it works now (drawables and matrices recycled
+ * from a pool once the renderer releases them, raw command members, and
+ * sorting compact keys). Finally it runs a struct-of-arrays layout whose
+ * per-tile state lives with the tile and is rebuilt only when the tile's
+ * data revision changes.
+ */
+
+#include <osgEarth/Notify>
+#include <osg/ArgumentParser>
+#include <osg/Referenced>
+#include <osg/Matrix>
+#include <algorithm>
+#include <cmath>
+#include <chrono>
+#include <deque>
+#include <random>
+#include <vector>
+#include <iostream>
+#include <iomanip>
+
+#define LC "[cullbench] "
+
+int
+usage(const char* name)
+{
+    OE_NOTICE
+        << "\nUsage: " << name
+        << "\n    [--tiles n]       : visible tiles per frame (default = 2000)"
+        << "\n    [--layers n]      : layers drawn per tile (default = 4)"
+        << "\n    [--frames n]      : frames to cull (default = 500)"
+        << "\n    [--latency n]     : frames the renderer holds cull output (default = 2)"
+        << "\n    [--changes n]     : tiles whose data changes each frame (default = 20)"
+        << std::endl;
+    return 0;
+}
+
+// Stand-in for the geometry pool's shared tile geometry
+struct Geometry : public osg::Referenced
+{
+};
+
+// Stand-in for a visible tile
+struct Tile
+{
+    osg::Matrix _local;
+    Geometry* _geom;
+};
+
+//...........................................................................
+// How the culler used to work
+
+struct OldCommand
+{
+    osg::ref_ptr<const osg::RefMatrix> _modelViewMatrix;
+    osg::ref_ptr<Geometry> _geom;
+    const void* _samplers[2];
+    osg::Vec4f _keyValue;
+    osg::Vec2f _morphConstants;
+    float _range;
+    int _layerOrder;
+
+    bool operator < (const OldCommand& rhs) const {
+        if (_range > rhs._range) return false;
+        if (_range < rhs._range) return true;
+        return _geom < rhs._geom;
+    }
+};
+
+struct OldDrawable : public osg::Referenced
+{
+    OldDrawable() { _tiles.reserve(128); }
+    std::vector<OldCommand> _tiles;
+};
+
+//...........................................................................
+// How it works now
+
+struct Arena : public osg::Referenced
+{
+    Arena() : _numMatrices(0u) { }
+
+    osg::RefMatrix* createMatrix(const osg::Matrix& m) {
+        if (_numMatrices == _matrices.size())
+            _matrices.push_back(new osg::RefMatrix());
+        osg::RefMatrix* matrix = _matrices[_numMatrices++].get();
+        matrix->set(m);
+        return matrix;
+    }
+
+    std::vector<osg::ref_ptr<osg::RefMatrix>> _matrices;
+    std::size_t _numMatrices;
+};
+
+struct NewCommand
+{
+    const osg::Matrix* _modelViewMatrix;
+    Geometry* _geom;
+    const void* _samplers[2];
+    osg::Vec4f _keyValue;
+    osg::Vec2f _morphConstants;
+    float _range;
+    int _layerOrder;
+};
+
+struct SortKey
+{
+    float _range;
+    unsigned _index;
+    const Geometry* _geom;
+
+    bool operator < (const SortKey& rhs) const {
+        if (_range > rhs._range) return false;
+        if (_range < rhs._range) return true;
+        return _geom < rhs._geom;
+    }
+};
+
+struct NewDrawable : public osg::Referenced
+{
+    NewDrawable() { _tiles.reserve(128); }
+    std::vector<NewCommand> _tiles;
+    std::vector<SortKey> _order;
+    osg::ref_ptr<Arena> _arena;
+};
+
+struct Pool
+{
+    Pool() : _created(0u) { }
+
+    template<typename T>
+    osg::ref_ptr<T> acquire(std::vector<osg::ref_ptr<T>>& pool) {
+        for (auto& object : pool)
+            if (object->referenceCount() == 1)
+                return object;
+        pool.push_back(new T());
+        ++_created;
+        return pool.back();
+    }
+
+    std::vector<osg::ref_ptr<Arena>> _arenas;
+    std::vector<osg::ref_ptr<NewDrawable>> _drawables;
+    std::vector<osg::ref_ptr<struct SoADrawable>> _soaDrawables;
+    unsigned _created;
+};
+
+//...........................................................................
+// The alternative: struct-of-arrays output, with the per-tile part of each
+// command kept by the tile and rebuilt only when its data revision changes
+
+struct TileLayerState
+{
+    Geometry* _geom;
+    const void* _samplers[2];
+    osg::Vec4f _keyValue;
+    osg::Vec2f _morphConstants;
+    int _layerOrder;
+    int _revision;
+};
+
+struct SoADrawable : public osg::Referenced
+{
+    std::vector<const osg::Matrix*> _modelViewMatrices;
+    std::vector<float> _ranges;
+    std::vector<const TileLayerState*> _states;
+    std::vector<SortKey> _order;
+    osg::ref_ptr<Arena> _arena;
+};
+
+//...........................................................................
+
+struct Settings
+{
+    unsigned tiles, layers, frames, latency, changes;
+};
+
+// stand-in for the renderer reading the commands
+template<typename COMMAND>
+inline void draw(const COMMAND& cmd, double& sink)
+{
+    sink += (*cmd._modelViewMatrix)(3, 0) + cmd._range;
+}
+
+double
+runOld(const std::vector<Tile>& tiles, const std::vector<float>& ranges, const Settings& s, double& sink)
+{
+    // cull output the renderer still holds, oldest first
+    std::deque<std::vector<osg::ref_ptr<OldDrawable>>> inFlight;
+
+    auto start = std::chrono::steady_clock::now();
+
+    for (unsigned frame = 0; frame < s.frames; ++frame)
+    {
+        std::vector<osg::ref_ptr<OldDrawable>> layers;
+        for (unsigned l = 0; l < s.layers; ++l)
+            layers.push_back(new OldDrawable());
+
+        osg::Matrix view = osg::Matrix::translate(0, 0, -(double)frame);
+
+        for (unsigned t = 0; t < tiles.size(); ++t)
+        {
+            // a fresh culler allocates a new matrix per tile
+            osg::ref_ptr<osg::RefMatrix> mvm = new osg::RefMatrix(tiles[t]._local * view);
+            float range = ranges[(t + frame) % ranges.size()];
+
+            for (auto& layer : layers)
+            {
+                layer->_tiles.push_back(OldCommand());
+                OldCommand& cmd = layer->_tiles.back();
+                cmd._modelViewMatrix = mvm.get();
+                cmd._geom = tiles[t]._geom;
+                cmd._range = range;
+                cmd._layerOrder = 0;
+            }
+        }
+
+        for (auto& layer : layers)
+            std::sort(layer->_tiles.begin(), layer->_tiles.end());
+
+        inFlight.push_back(std::move(layers));
+
+        if (inFlight.size() > s.latency)
+        {
+            for (auto& layer : inFlight.front())
+                for (auto& cmd : layer->_tiles)
+                    draw(cmd, sink);
+            inFlight.pop_front();
+        }
+    }
+    inFlight.clear();
+
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+double
+runNew(const std::vector<Tile>& tiles, const std::vector<float>& ranges, const Settings& s, double& sink, unsigned& created)
+{
+    Pool pool;
+    std::deque<std::vector<osg::ref_ptr<NewDrawable>>> inFlight;
+
+    auto start = std::chrono::steady_clock::now();
+
+    for (unsigned frame = 0; frame < s.frames; ++frame)
+    {
+        // idle drawables still hold the arena they last used
+        for (auto& d : pool._drawables)
+            if (d->referenceCount() == 1)
+                d->_arena = nullptr;
+
+        osg::ref_ptr<Arena> arena = pool.acquire(pool._arenas);
+        arena->_numMatrices = 0u;
+
+        std::vector<osg::ref_ptr<NewDrawable>> layers;
+        for (unsigned l = 0; l < s.layers; ++l)
+        {
+            layers.push_back(pool.acquire(pool._drawables));
+            NewDrawable* d = layers.back().get();
+            d->_tiles.clear();
+            d->_order.clear();
+            d->_arena = arena;
+        }
+
+        osg::Matrix view = osg::Matrix::translate(0, 0, -(double)frame);
+
+        for (unsigned t = 0; t < tiles.size(); ++t)
+        {
+            const osg::RefMatrix* mvm = arena->createMatrix(tiles[t]._local * view);
+            float range = ranges[(t + frame) % ranges.size()];
+
+            for (auto& layer : layers)
+            {
+                layer->_tiles.push_back(NewCommand());
+                NewCommand& cmd = layer->_tiles.back();
+                cmd._modelViewMatrix = mvm;
+                cmd._geom = tiles[t]._geom;
+                cmd._range = range;
+                cmd._layerOrder = 0;
+            }
+        }
+
+        for (auto& layer : layers)
+        {
+            layer->_order.resize(layer->_tiles.size());
+            for (unsigned i = 0; i < layer->_tiles.size(); ++i)
+                layer->_order[i] = SortKey{ layer->_tiles[i]._range, i, layer->_tiles[i]._geom };
+            std::sort(layer->_order.begin(), layer->_order.end());
+        }
+
+        // drop our own references; the "renderer" keeps the drawables
+        arena = nullptr;
+        inFlight.push_back(std::move(layers));
+
+        if (inFlight.size() > s.latency)
+        {
+            for (auto& layer : inFlight.front())
+                for (auto& key : layer->_order)
+                    draw(layer->_tiles[key._index], sink);
+            inFlight.pop_front();
+        }
+    }
+    inFlight.clear();
+
+    created = pool._created;
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+double
+runSoA(const std::vector<Tile>& tiles, const std::vector<float>& ranges, const Settings& s, double& sink, unsigned& rebuilt)
+{
+    Pool pool;
+    std::deque<std::vector<osg::ref_ptr<SoADrawable>>> inFlight;
+
+    // what each tile would own: its per-layer state and data revision
+    std::vector<TileLayerState> states(tiles.size() * s.layers);
+    std::vector<int> revisions(tiles.size(), 0);
+    for (auto& state : states)
+        state._revision = -1;
+
+    rebuilt = 0u;
+
+    auto start = std::chrono::steady_clock::now();
+
+    for (unsigned frame = 0; frame < s.frames; ++frame)
+    {
+        for (auto& d : pool._soaDrawables)
+            if (d->referenceCount() == 1)
+                d->_arena = nullptr;
+
+        osg::ref_ptr<Arena> arena = pool.acquire(pool._arenas);
+        arena->_numMatrices = 0u;
+
+        std::vector<osg::ref_ptr<SoADrawable>> layers;
+        for (unsigned l = 0; l < s.layers; ++l)
+        {
+            layers.push_back(pool.acquire(pool._soaDrawables));
+            SoADrawable* d = layers.back().get();
+            d->_modelViewMatrices.clear();
+            d->_ranges.clear();
+            d->_states.clear();
+            d->_order.clear();
+            d->_arena = arena;
+        }
+
+        // some tiles get new data
+        for (unsigned c = 0; c < s.changes && c < tiles.size(); ++c)
+            ++revisions[(frame * s.changes + c) % tiles.size()];
+
+        osg::Matrix view = osg::Matrix::translate(0, 0, -(double)frame);
+
+        for (unsigned t = 0; t < tiles.size(); ++t)
+        {
+            const osg::RefMatrix* mvm = arena->createMatrix(tiles[t]._local * view);
+            float range = ranges[(t + frame) % ranges.size()];
+
+            for (unsigned l = 0; l < s.layers; ++l)
+            {
+                // dirty check against the tile's data revision
+                TileLayerState& state = states[t * s.layers + l];
+                if (state._revision != revisions[t])
+                {
+                    state._geom = tiles[t]._geom;
+                    state._layerOrder = 0;
+                    state._revision = revisions[t];
+                    ++rebuilt;
+                }
+
+                SoADrawable* layer = layers[l].get();
+                layer->_modelViewMatrices.push_back(mvm);
+                layer->_ranges.push_back(range);
+                layer->_states.push_back(&state);
+            }
+        }
+
+        for (auto& layer : layers)
+        {
+            layer->_order.resize(layer->_states.size());
+            for (unsigned i = 0; i < layer->_states.size(); ++i)
+                layer->_order[i] = SortKey{ layer->_ranges[i], i, layer->_states[i]->_geom };
+            std::sort(layer->_order.begin(), layer->_order.end());
+        }
+
+        arena = nullptr;
+        inFlight.push_back(std::move(layers));
+
+        if (inFlight.size() > s.latency)
+        {
+            for (auto& layer : inFlight.front())
+                for (auto& key : layer->_order)
+                    sink += (*layer->_modelViewMatrices[key._index])(3, 0) + layer->_ranges[key._index];
+            inFlight.pop_front();
+        }
+    }
+    inFlight.clear();
+
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int
+main(int argc, char** argv)
+{
+    osg::ArgumentParser arguments(&argc, argv);
+    if (arguments.read("--help"))
+        return usage(argv[0]);
+
+    Settings s = { 2000u, 4u, 500u, 2u, 20u };
+    arguments.read("--tiles", s.tiles);
+    arguments.read("--layers", s.layers);
+    arguments.read("--frames", s.frames);
+    arguments.read("--latency", s.latency);
+    arguments.read("--changes", s.changes);
+
+    // all tiles share a few geometries, as with the geometry pool
+    std::vector<osg::ref_ptr<Geometry>> geoms;
+    for (unsigned i = 0; i < 4; ++i)
+        geoms.push_back(new Geometry());
+
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<float> random(0.0f, 1e5f);
+
+    std::vector<Tile> tiles(s.tiles);
+    for (unsigned t = 0; t < tiles.size(); ++t)
+    {
+        tiles[t]._local = osg::Matrix::translate(random(rng), random(rng), 0.0);
+        tiles[t]._geom = geoms[t % geoms.size()].get();
+    }
+
+    std::vector<float> ranges(s.tiles * 2u);
+    for (auto& range : ranges)
+        range = random(rng);
+
+    std::cout
+        << s.tiles << " tiles x " << s.layers << " layers, "
+        << s.frames << " frames, renderer " << s.latency << " frames behind" << std::endl;
+
+    double oldSink = 0.0, newSink = 0.0, soaSink = 0.0;
+    unsigned created = 0u, rebuilt = 0u;
+
+    double oldTime = runOld(tiles, ranges, s, oldSink);
+    double newTime = runNew(tiles, ranges, s, newSink, created);
+    double soaTime = runSoA(tiles, ranges, s, soaSink, rebuilt);
+
+    if (std::abs(oldSink - newSink) > 1e-9 * std::abs(oldSink) ||
+        std::abs(oldSink - soaSink) > 1e-9 * std::abs(oldSink))
+    {
+        OE_WARN << LC << "Renderers saw different commands" << std::endl;
+    }
+
+    std::cout << std::fixed << std::setprecision(3)
+        << "per-frame: " << oldTime << " s (" << (1000.0 * oldTime / s.frames) << " ms/frame), "
+        << (s.layers + s.tiles) * s.frames << " objects allocated" << std::endl
+        << "pooled:    " << newTime << " s (" << (1000.0 * newTime / s.frames) << " ms/frame), "
+        << created << " pooled objects allocated" << std::endl
+        << "SoA+reuse: " << soaTime << " s (" << (1000.0 * soaTime / s.frames) << " ms/frame), "
+        << rebuilt << " tile states rebuilt" << std::endl;
+
+    if (newTime > 0.0)
+    {
+        std::cout << "speedup:   " << std::setprecision(2) << (oldTime / newTime) << "x" << std::endl;
+    }
+
+    return 0;
+}
@@ -0,0 +1,247 @@
+/* -*-c++-*- */
+/* osgEarth - Dynamic map generation toolkit for OpenSceneGraph
+* Copyright 2016 Pelican Mapping
+* http://osgearth.org
+*
+* osgEarth is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+
+/**
+ * Headless benchmark for loading a large earth file. Parses the document
+ * into a Config twice -- through the XmlDocument DOM, and straight into a
+ * Config with XmlDocument::readConfig -- and checks that both agree. With
+ * --open it then creates the map layers and times Map::addLayers with
+ * serial layer opening (the default) and with parallel opening enabled.
+ *
+ * With no --file, a synthetic map is generated: feature sources with
+ * inline geometry, each followed by a model layer that refers to it by
+ * name and carries a large style sheet.
+ */
+
+#include <osgEarth/XmlUtils>
+#include <osgEarth/Config>
+#include <osgEarth/Map>
+#include <osgEarth/Layer>
+#include <osgEarth/Notify>
+#include <osg/ArgumentParser>
+#include <osg/Math>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <iostream>
+#include <iomanip>
+
+using namespace osgEarth;
+
+#define LC "[earthloadbench] "
+
+int
+usage(const char* name)
+{
+    OE_NOTICE
+        << "\nUsage: " << name
+        << "\n    [--file path]     : earth file to load (default = synthetic)"
+        << "\n    [--layers n]      : layer pairs in the synthetic map (default = 250)"
+        << "\n    [--repeat n]      : parse passes to average (default = 5)"
+        << "\n    [--open]          : also create and open the map layers"
+        << std::endl;
+    return 0;
+}
+
+std::string
+makeEarthFile(unsigned numPairs)
+{
+    std::stringstream buf;
+    buf << "<?xml version=\"1.0\"?>\n"
+        << "<!-- synthetic benchmark map -->\n"
+        << "<map name=\"earthloadbench\" type=\"geocentric\">\n";
+
+    for (unsigned i = 0; i < numPairs; ++i)
+    {
+        buf << "  <OGRFeatures name=\"features_" << i << "\">\n"
+            << "    <geometry>POLYGON((";
+        for (unsigned p = 0; p <= 64; ++p)
+        {
+            double a = 2.0 * osg::PI * (double)(p % 64) / 64.0;
+            buf << (p > 0 ? ", " : "")
+                << (-120.0 + (i % 60) + cos(a)) << " " << (30.0 + (i / 60) + sin(a));
+        }
+        buf << "))</geometry>\n"
+            << "  </OGRFeatures>\n";
+
+        buf << "  <FeatureModel name=\"model_" << i << "\" features=\"features_" << i << "\">\n"
+            << "    <layout tile_size=\"500\" crop_features=\"true\">\n"
+            << "      <level max_range=\"20000\" style=\"s0\"/>\n"
+            << "      <level max_range=\"100000\" style=\"s1\"/>\n"
+            << "    </layout>\n"
+            << "    <styles>\n"
+            << "      <style type=\"text/css\"><![CDATA[\n";
+        for (unsigned s = 0; s < 16; ++s)
+        {
+            buf << "        s" << s << " {\n"
+                << "          fill: #" << std::hex << std::setw(6) << std::setfill('0') << ((i * 7919u + s * 104729u) & 0xffffffu)
+                << std::dec << std::setfill(' ') << ";\n"
+                << "          stroke: #ffffff; stroke-width: " << (1 + s % 4) << "px;\n"
+                << "          extrusion-height: " << (10 * s) << ";\n"
+                << "          altitude-clamping: terrain; render-depth-offset: true;\n"
+                << "        }\n";
+        }
+        buf << "      ]]></style>\n"
+            << "    </styles>\n"
+            << "  </FeatureModel>\n";
+    }
+
+    buf << "</map>\n";
+    return buf.str();
+}
+
+double
+seconds(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+void
+report(const char* name, double s, double baseline)
+{
+    std::cout << "  " << std::left << std::setw(10) << name << std::right
+        << std::fixed << std::setprecision(3) << (1000.0 * s) << " ms";
+    if (baseline > 0.0 && s > 0.0)
+        std::cout << " (" << std::setprecision(2) << (baseline / s) << "x)";
+    std::cout << std::endl;
+}
+
+double
+openLayers(const Config& mapConf, bool parallel)
+{
+    LayerVector layers;
+    for (const auto& child : mapConf.children())
+    {
+        Layer* layer = Layer::create(ConfigOptions(child));
+        if (layer)
+            layers.push_back(layer);
+    }
+
+    osg::ref_ptr<Map> map = new Map();
+    map->setParallelLayerOpen(parallel);
+    auto start = std::chrono::steady_clock::now();
+    map->addLayers(layers);
+    double s = seconds(start);
+
+    unsigned numOpen = 0u;
+    for (auto& layer : layers)
+        if (layer->isOpen())
+            ++numOpen;
+
+    std::cout << "  " << numOpen << " of " << layers.size() << " layers opened "
+        << (parallel ? "in parallel" : "serially") << std::endl;
+    return s;
+}
+
+int
+main(int argc, char** argv)
+{
+    osg::ArgumentParser arguments(&argc, argv);
+    if (arguments.read("--help"))
+        return usage(argv[0]);
+
+    std::string file;
+    unsigned numPairs = 250u;
+    unsigned repeat = 5u;
+    arguments.read("--file", file);
+    arguments.read("--layers", numPairs);
+    arguments.read("--repeat", repeat);
+    bool open = arguments.read("--open");
+    repeat = std::max(repeat, 1u);
+
+    std::string text;
+    URIContext context;
+    if (!file.empty())
+    {
+        std::ifstream in(file.c_str());
+        if (!in.is_open())
+        {
+            OE_WARN << LC << "Failed to open " << file << std::endl;
+            return -1;
+        }
+        std::stringstream buf;
+        buf << in.rdbuf();
+        text = buf.str();
+        context = URIContext(file);
+    }
+    else
+    {
+        text = makeEarthFile(numPairs);
+    }
+
+    std::cout << text.size() << " bytes" << std::endl;
+
+    // Through the DOM
+    Config viaDOM;
+    auto start = std::chrono::steady_clock::now();
+    for (unsigned r = 0; r < repeat; ++r)
+    {
+        std::istringstream in(text);
+        osg::ref_ptr<XmlDocument> doc = XmlDocument::load(in, context);
+        viaDOM = doc.valid() ? doc->getConfig() : Config();
+    }
+    double dom = seconds(start) / (double)repeat;
+    report("DOM", dom, 0.0);
+
+    // Straight into a Config
+    Config direct;
+    start = std::chrono::steady_clock::now();
+    for (unsigned r = 0; r < repeat; ++r)
+    {
+        std::istringstream in(text);
+        if (!XmlDocument::readConfig(in, context, direct))
+        {
+            OE_WARN << LC << "readConfig failed" << std::endl;
+            return -1;
+        }
+    }
+    report("direct", seconds(start) / (double)repeat, dom);
+
+    if (viaDOM.toJSON() != direct.toJSON())
+    {
+        OE_WARN << LC << "The two parses disagree" << std::endl;
+        return -1;
+    }
+
+    if (open)
+    {
+        const Config* mapConf = direct.child_ptr("map");
+        if (!mapConf)
+            mapConf = direct.child_ptr("earth");
+        if (!mapConf)
+        {
+            OE_WARN << LC << "No <map> element" << std::endl;
+            return -1;
+        }
+
+        double serial = openLayers(*mapConf, false);
+        double parallel = openLayers(*mapConf, true);
+        report("serial", serial, 0.0);
+        report("parallel", parallel, serial);
+    }
+
+    return 0;
+}
@@ -0,0 +1,202 @@
+/* -*-c++-*- */
+/* osgEarth - Dynamic map generation toolkit for OpenSceneGraph
+* Copyright 2016 Pelican Mapping
+* http://osgearth.org
+*
+* osgEarth is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+
+/**
+ * Headless, CPU-only benchmark for positioning many entities. Moves a
+ * population of entities a little each frame, then positions them two
+ * ways: one GeoPoint and MatrixTransform per entity (what a GeoTransform
+ * does for each one), and one EntityTable update for all of them, which
+ * produces instance matrices for a single instanced draw. Reports entity
+ * updates per second for each.
+ *
+ * There is no map, so entities use absolute altitudes; terrain clamping
+ * is not part of the measurement.
+ */
+
+#include <osgEarth/EntityTable>
+#include <osgEarth/GeoData>
+#include <osgEarth/Notify>
+#include <osg/ArgumentParser>
+#include <osg/MatrixTransform>
+#include <chrono>
+#include <random>
+#include <vector>
+#include <iostream>
+#include <iomanip>
+
+using namespace osgEarth;
+
+#define LC "[entitybench] "
+
+int
+usage(const char* name)
+{
+    OE_NOTICE
+        << "\nUsage: " << name
+        << "\n    [--entities n]    : number of entities (default = runs 10000 and 100000)"
+        << "\n    [--frames n]      : frames to update (default = 50)"
+        << std::endl;
+    return 0;
+}
+
+struct Track
+{
+    double lon, lat, alt;
+    float heading;
+};
+
+// Moves every track a little, the way a track feed would
+void
+advance(std::vector<Track>& tracks, unsigned frame)
+{
+    double step = frame & 1 ? 0.0001 : -0.0001;
+    for (auto& t : tracks)
+    {
+        t.lon += step;
+        t.lat += step;
+        t.heading += 1.0f;
+    }
+}
+
+double
+runPerEntity(std::vector<Track> tracks, unsigned frames, const SpatialReference* srs)
+{
+    std::vector<osg::ref_ptr<osg::MatrixTransform>> xforms(tracks.size());
+    for (auto& xform : xforms)
+        xform = new osg::MatrixTransform();
+
+    auto start = std::chrono::steady_clock::now();
+
+    for (unsigned f = 0; f < frames; ++f)
+    {
+        advance(tracks, f);
+
+        for (std::size_t i = 0; i < tracks.size(); ++i)
+        {
+            const Track& t = tracks[i];
+            GeoPoint p(srs, t.lon, t.lat, t.alt, ALTMODE_ABSOLUTE);
+            osg::Matrixd local2world;
+            p.createLocalToWorld(local2world);
+            osg::Matrixd rotation;
+            rotation.makeRotate(osg::DegreesToRadians(-(double)t.heading), osg::Z_AXIS);
+            xforms[i]->setMatrix(rotation * local2world);
+        }
+    }
+
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+double
+runTable(std::vector<Track> tracks, unsigned frames, const SpatialReference* srs)
+{
+    osg::ref_ptr<EntityTable> table = new EntityTable(srs);
+    table->resize(tracks.size());
+
+    auto start = std::chrono::steady_clock::now();
+
+    for (unsigned f = 0; f < frames; ++f)
+    {
+        advance(tracks, f);
+
+        double* x = table->x();
+        double* y = table->y();
+        double* z = table->z();
+        float* heading = table->heading();
+
+        for (std::size_t i = 0; i < tracks.size(); ++i)
+        {
+            x[i] = tracks[i].lon;
+            y[i] = tracks[i].lat;
+            z[i] = tracks[i].alt;
+            heading[i] = tracks[i].heading;
+        }
+
+        table->update();
+    }
+
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+void
+run(unsigned count, unsigned frames, const SpatialReference* srs)
+{
+    std::mt19937 gen(count);
+    std::uniform_real_distribution<double> lon(-80.0, -70.0);
+    std::uniform_real_distribution<double> lat(35.0, 45.0);
+    std::uniform_real_distribution<double> alt(0.0, 12000.0);
+    std::uniform_real_distribution<float> heading(0.0f, 360.0f);
+
+    std::vector<Track> tracks(count);
+    for (auto& t : tracks)
+        t = { lon(gen), lat(gen), alt(gen), heading(gen) };
+
+    double perEntity = runPerEntity(tracks, frames, srs);
+    double table = runTable(tracks, frames, srs);
+
+    double updates = (double)count * (double)frames;
+
+    std::cout << count << " entities, " << frames << " frames" << std::endl
+        << std::fixed << std::setprecision(0)
+        << "  per-entity: " << (updates / perEntity) << " updates/s ("
+        << std::setprecision(3) << (1000.0 * perEntity / frames) << " ms/frame)" << std::endl
+        << std::setprecision(0)
+        << "  table:      " << (updates / table) << " updates/s ("
+        << std::setprecision(3) << (1000.0 * table / frames) << " ms/frame)" << std::endl;
+
+    if (table > 0.0)
+    {
+        std::cout << "  speedup:    " << std::setprecision(2) << (perEntity / table) << "x" << std::endl;
+    }
+}
+
+int
+main(int argc, char** argv)
+{
+    osg::ArgumentParser arguments(&argc, argv);
+    if (arguments.read("--help"))
+        return usage(argv[0]);
+
+    unsigned entities = 0u;
+    unsigned frames = 50u;
+    arguments.read("--entities", entities);
+    arguments.read("--frames", frames);
+
+    osg::ref_ptr<const SpatialReference> srs = SpatialReference::get("wgs84");
+    if (!srs.valid())
+    {
+        OE_WARN << LC << "Failed to create the WGS84 SRS" << std::endl;
+        return -1;
+    }
+
+    if (entities > 0u)
+    {
+        run(entities, frames, srs.get());
+    }
+    else
+    {
+        run(10000u, frames, srs.get());
+        run(100000u, frames, srs.get());
+    }
+
+    return 0;
+}
@@ -0,0 +1,388 @@
+/* -*-c++-*- */
+/* osgEarth - Dynamic map generation toolkit for OpenSceneGraph
+* Copyright 2016 Pelican Mapping
+* http://osgearth.org
+*
+* osgEarth is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+
+
+/**
+ * Headless, CPU-only benchmark for culling the terrain for several cameras
+ * at once. Simulates REX's tile quadtree over a flat world, with a primary
+ * view and a number of secondary views fanned out around it from the same
+ * eye. Visiting a tile costs what it does in REX: a frustum test, a range
+ * test against each child and a touch of the (locked) tile registry,
+ * except under a subtree the primary view culls, which it leaves alone.
+ * It runs once with every camera selecting its own tiles from the
+ * quadtree, then once with only the primary view selecting tiles
+ * (recording a cover of the whole terrain as it goes) and the secondary
+ * views filtering that selection by their own frustums.
+ */
+
+#include <osgEarth/Containers>
+#include <osgEarth/Notify>
+#include <osg/ArgumentParser>
+#include <osg/Math>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <iostream>
+#include <iomanip>
+
+using namespace osgEarth::Util;
+
+#define LC "[multiviewcullbench] "
+
+int
+usage(const char* name)
+{
+    OE_NOTICE
+        << "\nUsage: " << name
+        << "\n    [--cameras n]     : secondary cameras (default = 3)"
+        << "\n    [--spread n]      : degrees between camera headings (default = 30)"
+        << "\n    [--frames n]      : frames to cull (default = 500)"
+        << "\n    [--maxlod n]      : deepest tile level (default = 16)"
+        << "\n    [--factor n]      : subdivide within this many tile widths (default = 4)"
+        << "\n    [--altitude n]    : eye altitude in meters (default = 1000)"
+        << std::endl;
+    return 0;
+}
+
+const double WORLD_SIZE = 1e7;
+
+// Stand-in for a TileNode; children are created on demand and kept
+struct Tile : public IntrusiveListNode
+{
+    double _x, _y, _size;
+    unsigned _lod;
+    std::unique_ptr<Tile> _children[4];
+
+    double radius() const { return _size * 0.7071; }
+
+    bool hasChildren() const { return _children[0] != nullptr; }
+
+    void createChildren() {
+        double half = _size * 0.5;
+        for (unsigned q = 0; q < 4; ++q) {
+            _children[q].reset(new Tile());
+            Tile* child = _children[q].get();
+            child->_x = _x + ((q & 1) ? half : -half) * 0.5;
+            child->_y = _y + ((q & 2) ? half : -half) * 0.5;
+            child->_size = half;
+            child->_lod = _lod + 1;
+        }
+    }
+};
+
+// Stand-in for the TileNodeRegistry's LRU
+struct Registry
+{
+    void touch(Tile* tile) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (tile->linked())
+            _tracker.move_to_front(tile);
+        else
+            _tracker.push_front(tile);
+    }
+
+    void clear() {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _tracker.clear();
+    }
+
+    std::mutex _mutex;
+    IntrusiveList _tracker;
+};
+
+// A camera on the ground plane: eye, altitude and frustum side planes
+struct Camera
+{
+    double _x, _y, _altitude;
+    double _planes[3][3]; // a, b, c with a*x + b*y + c >= 0 inside
+
+    void set(double x, double y, double altitude, double heading, double fov, double far) {
+        _x = x, _y = y, _altitude = altitude;
+        double dx = cos(heading), dy = sin(heading);
+        double h = fov * 0.5;
+        // left and right sides, normals pointing inward
+        double lx = cos(heading + h), ly = sin(heading + h);
+        double rx = cos(heading - h), ry = sin(heading - h);
+        setPlane(0, ly, -lx);
+        setPlane(1, -ry, rx);
+        // far plane
+        _planes[2][0] = -dx, _planes[2][1] = -dy;
+        _planes[2][2] = far + dx * x + dy * y;
+    }
+
+    void setPlane(int i, double a, double b) {
+        _planes[i][0] = a, _planes[i][1] = b;
+        _planes[i][2] = -(a * _x + b * _y);
+    }
+
+    bool isCulled(const Tile& tile) const {
+        for (auto& p : _planes)
+            if (p[0] * tile._x + p[1] * tile._y + p[2] < -tile.radius())
+                return true;
+        return false;
+    }
+
+    double distance(double x, double y) const {
+        double dx = x - _x, dy = y - _y;
+        return sqrt(dx * dx + dy * dy + _altitude * _altitude);
+    }
+};
+
+struct Settings
+{
+    unsigned cameras, frames, maxLOD;
+    double spread, factor, altitude;
+};
+
+using Tiles = std::vector<Tile*>;
+
+// like SurfaceNode::anyChildBoxWithinRange
+inline bool
+shouldSubdivide(const Tile& tile, const Camera& camera, const Settings& s)
+{
+    if (tile._lod >= s.maxLOD)
+        return false;
+
+    double quarter = tile._size * 0.25;
+    double range = tile._size * 0.5 * s.factor;
+    for (unsigned q = 0; q < 4; ++q)
+    {
+        double x = tile._x + ((q & 1) ? quarter : -quarter);
+        double y = tile._y + ((q & 2) ? quarter : -quarter);
+        if (camera.distance(x, y) - quarter * 1.4142 < range)
+            return true;
+    }
+    return false;
+}
+
+// What every camera does on its own: LOD selection over the quadtree
+void
+select(Tile& tile, const Camera& camera, const Settings& s, Registry& registry, Tiles& drawn, unsigned& visited)
+{
+    ++visited;
+    registry.touch(&tile);
+
+    if (camera.isCulled(tile))
+        return;
+
+    if (shouldSubdivide(tile, camera, s))
+    {
+        if (!tile.hasChildren())
+            tile.createChildren();
+        for (auto& child : tile._children)
+            select(*child, camera, s, registry, drawn, visited);
+    }
+    else
+    {
+        drawn.push_back(&tile);
+    }
+}
+
+// What the primary view adds for the parts of the terrain it can't see
+void
+selectHidden(Tile& tile, const Camera& camera, const Settings& s, Registry& registry, Tiles& selection, unsigned& visited)
+{
+    // no touch: hidden tiles are left to go dormant
+    ++visited;
+
+    if (tile.hasChildren() && shouldSubdivide(tile, camera, s))
+    {
+        for (auto& child : tile._children)
+            selectHidden(*child, camera, s, registry, selection, visited);
+    }
+    else
+    {
+        selection.push_back(&tile);
+    }
+}
+
+// The primary view's selection, recording the cover as it goes
+void
+selectPrimary(Tile& tile, const Camera& camera, const Settings& s, Registry& registry, Tiles& drawn, Tiles& selection, unsigned& visited)
+{
+    registry.touch(&tile);
+
+    if (camera.isCulled(tile))
+    {
+        selectHidden(tile, camera, s, registry, selection, visited);
+        return;
+    }
+
+    ++visited;
+
+    if (shouldSubdivide(tile, camera, s))
+    {
+        if (!tile.hasChildren())
+            tile.createChildren();
+        for (auto& child : tile._children)
+            selectPrimary(*child, camera, s, registry, drawn, selection, visited);
+    }
+    else
+    {
+        drawn.push_back(&tile);
+        selection.push_back(&tile);
+    }
+}
+
+void
+setCameras(std::vector<Camera>& cameras, unsigned frame, const Settings& s)
+{
+    // fly across the world, turning slowly; secondaries fan
+    // out to alternating sides of the primary view
+    double x = -0.25 * WORLD_SIZE + 100.0 * frame;
+    double y = 0.1 * WORLD_SIZE;
+    double heading = 0.002 * frame;
+    for (unsigned c = 0; c < cameras.size(); ++c)
+    {
+        double side = (c & 1) ? 1.0 : -1.0;
+        double offset = side * osg::DegreesToRadians(s.spread) * (double)((c + 1) / 2);
+        cameras[c].set(x, y, s.altitude, heading + offset, osg::DegreesToRadians(60.0), 0.25 * WORLD_SIZE);
+    }
+}
+
+struct Result
+{
+    double time;
+    double primaryDrawn, secondaryDrawn, visited;
+};
+
+Result
+runIndependent(Tile& root, Registry& registry, const Settings& s)
+{
+    std::vector<Camera> cameras(1u + s.cameras);
+    Tiles drawn;
+    Result result = { 0.0, 0.0, 0.0, 0.0 };
+    unsigned visited = 0u;
+
+    auto start = std::chrono::steady_clock::now();
+
+    for (unsigned frame = 0; frame < s.frames; ++frame)
+    {
+        setCameras(cameras, frame, s);
+
+        for (unsigned c = 0; c < cameras.size(); ++c)
+        {
+            drawn.clear();
+            select(root, cameras[c], s, registry, drawn, visited);
+            (c == 0 ? result.primaryDrawn : result.secondaryDrawn) += drawn.size();
+        }
+    }
+
+    result.time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    result.visited = visited;
+    return result;
+}
+
+Result
+runShared(Tile& root, Registry& registry, const Settings& s)
+{
+    std::vector<Camera> cameras(1u + s.cameras);
+    Tiles drawn, selection;
+    Result result = { 0.0, 0.0, 0.0, 0.0 };
+    unsigned visited = 0u;
+
+    auto start = std::chrono::steady_clock::now();
+
+    for (unsigned frame = 0; frame < s.frames; ++frame)
+    {
+        setCameras(cameras, frame, s);
+
+        drawn.clear();
+        selection.clear();
+        selectPrimary(root, cameras[0], s, registry, drawn, selection, visited);
+        result.primaryDrawn += drawn.size();
+
+        for (unsigned c = 1; c < cameras.size(); ++c)
+        {
+            drawn.clear();
+            for (auto tile : selection)
+            {
+                ++visited;
+                if (!cameras[c].isCulled(*tile))
+                    drawn.push_back(tile);
+            }
+            result.secondaryDrawn += drawn.size();
+        }
+    }
+
+    result.time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    result.visited = visited;
+    return result;
+}
+
+int
+main(int argc, char** argv)
+{
+    osg::ArgumentParser arguments(&argc, argv);
+    if (arguments.read("--help"))
+        return usage(argv[0]);
+
+    Settings s = { 3u, 500u, 16u, 30.0, 4.0, 1000.0 };
+    arguments.read("--cameras", s.cameras);
+    arguments.read("--spread", s.spread);
+    arguments.read("--frames", s.frames);
+    arguments.read("--maxlod", s.maxLOD);
+    arguments.read("--factor", s.factor);
+    arguments.read("--altitude", s.altitude);
+
+    Tile root;
+    root._x = 0.0, root._y = 0.0, root._size = WORLD_SIZE, root._lod = 0u;
+
+    std::cout
+        << "1 primary + " << s.cameras << " secondary cameras, "
+        << s.frames << " frames, max LOD " << s.maxLOD << std::endl;
+
+    // independent selection runs first, so both runs find
+    // every tile they need already created
+    Registry registry;
+    Result own = runIndependent(root, registry, s);
+    Result shared = runShared(root, registry, s);
+    registry.clear();
+
+    if (own.primaryDrawn != shared.primaryDrawn)
+    {
+        OE_WARN << LC << "Primary view drew different tiles" << std::endl;
+    }
+
+    double frames = (double)s.frames;
+    double secondaries = std::max(1.0, frames * s.cameras);
+
+    std::cout << std::fixed << std::setprecision(3)
+        << "independent: " << own.time << " s (" << (1000.0 * own.time / frames) << " ms/frame), "
+        << std::setprecision(0) << (own.visited / frames) << " tests/frame, "
+        << (own.secondaryDrawn / secondaries) << " tiles per secondary" << std::endl
+        << std::setprecision(3)
+        << "shared:      " << shared.time << " s (" << (1000.0 * shared.time / frames) << " ms/frame), "
+        << std::setprecision(0) << (shared.visited / frames) << " tests/frame, "
+        << (shared.secondaryDrawn / secondaries) << " tiles per secondary" << std::endl;
+
+    if (shared.time > 0.0)
+    {
+        std::cout << "speedup:     " << std::setprecision(2) << (own.time / shared.time) << "x" << std::endl;
+    }
+
+    return 0;
+}
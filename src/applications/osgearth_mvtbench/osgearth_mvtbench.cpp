@@ -0,0 +1,154 @@
+/* -*-c++-*- */
+/* osgEarth - Geospatial SDK for OpenSceneGraph
+* Copyright 2020 Pelican Mapping
+* http://osgearth.org
+*
+* osgEarth is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+/**
+ * Measures MVT decoding throughput over the tiles of an MBTiles file,
+ * first decoding everything and then only the requested layers and
+ * attributes.
+ */
+
+// TODO:  Reconfigure CMake to not require this.....
+#define OSGEARTH_HAVE_MVT 1
+#define OSGEARTH_HAVE_SQLITE3 1
+
+#include <osgEarth/MVT>
+#include <osgEarth/Notify>
+#include <osg/ArgumentParser>
+#include <osg/Timer>
+#include <iostream>
+#include <iomanip>
+
+using namespace osgEarth;
+
+int
+usage(const char* name)
+{
+    OE_NOTICE
+        << "\nUsage: " << name << " file.mbtiles"
+        << "\n    [--zoom n]             : zoom level of the tiles to decode (default = 14)"
+        << "\n    [--limit n]            : most tiles to decode (default = all)"
+        << "\n    [--layer name]         : MVT layer to read in the filtered pass (repeatable)"
+        << "\n    [--attribute name]     : attribute to read in the filtered pass (repeatable)"
+        << std::endl;
+    return -1;
+}
+
+struct Totals
+{
+    unsigned tiles = 0u;
+    unsigned features = 0u;
+    unsigned attributes = 0u;
+};
+
+void countTile(const TileKey& key, const FeatureList& features, void* context)
+{
+    Totals* totals = static_cast<Totals*>(context);
+    ++totals->tiles;
+    totals->features += features.size();
+    for (auto& f : features)
+        totals->attributes += f->getAttrs().size();
+}
+
+void run(const char* label, MVTFeatureSource* source, int zoom, int limit)
+{
+    Totals totals;
+    osg::Timer_t start = osg::Timer::instance()->tick();
+    source->iterateTiles(zoom, limit, 0, GeoExtent::INVALID, countTile, &totals);
+    double seconds = osg::Timer::instance()->delta_s(start, osg::Timer::instance()->tick());
+
+    std::cout
+        << std::left << std::setw(10) << label << std::right << std::fixed << std::setprecision(3)
+        << " tiles=" << totals.tiles
+        << " features=" << totals.features
+        << " attributes=" << totals.attributes
+        << " time=" << seconds << "s"
+        << std::setprecision(0)
+        << " features/sec=" << (seconds > 0.0 ? (double)totals.features / seconds : 0.0)
+        << " tiles/sec=" << (seconds > 0.0 ? (double)totals.tiles / seconds : 0.0)
+        << std::endl;
+}
+
+int
+main(int argc, char** argv)
+{
+    osg::ArgumentParser args(&argc, argv);
+
+    if (args.read("--help"))
+        return usage(argv[0]);
+
+    int zoom = 14;
+    args.read("--zoom", zoom);
+
+    int limit = 0;
+    args.read("--limit", limit);
+
+    std::vector<std::string> layers, attributes;
+    std::string value;
+    while (args.read("--layer", value))
+        layers.push_back(value);
+    while (args.read("--attribute", value))
+        attributes.push_back(value);
+
+    std::string database;
+    for (int pos = 1; pos < args.argc(); ++pos)
+    {
+        if (!args.isOption(pos))
+        {
+            database = args[pos];
+            break;
+        }
+    }
+
+    if (database.empty())
+        return usage(argv[0]);
+
+    osg::ref_ptr<MVTFeatureSource> all = new MVTFeatureSource();
+    all->setURL(database);
+    if (all->open().isError())
+    {
+        std::cout << "Failed to open database " << database << ": " << all->getStatus().toString() << std::endl;
+        return -1;
+    }
+
+    // warm up the file cache so both passes pay the same I/O cost
+    Totals warmup;
+    all->iterateTiles(zoom, limit, 0, GeoExtent::INVALID, countTile, &warmup);
+
+    run("all", all.get(), zoom, limit);
+
+    if (!layers.empty() || !attributes.empty())
+    {
+        osg::ref_ptr<MVTFeatureSource> filtered = new MVTFeatureSource();
+        filtered->setURL(database);
+        filtered->setLayers(layers);
+        filtered->setAttributes(attributes);
+        if (filtered->open().isError())
+        {
+            std::cout << "Failed to open database " << database << ": " << filtered->getStatus().toString() << std::endl;
+            return -1;
+        }
+
+        run("filtered", filtered.get(), zoom, limit);
+    }
+
+    return 0;
+}
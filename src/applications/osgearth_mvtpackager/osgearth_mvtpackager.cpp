@@ -0,0 +1,175 @@
+/* -*-c++-*- */
+/* osgEarth - Geospatial SDK for OpenSceneGraph
+* Copyright 2020 Pelican Mapping
+* http://osgearth.org
+*
+* osgEarth is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+/**
+ * Writes a feature file (e.g. a shapefile) to an MBTiles file of Mapbox
+ * vector tiles, building the tiles of each zoom level in parallel.
+ */
+
+// TODO:  Reconfigure CMake to not require this.....
+#define OSGEARTH_HAVE_MVT 1
+#define OSGEARTH_HAVE_SQLITE3 1
+
+#include <osgEarth/MVT>
+#include <osgEarth/OGRFeatureSource>
+#include <osgEarth/StringUtils>
+#include <osgEarth/Notify>
+#include <osg/ArgumentParser>
+#include <osg/Timer>
+#include <iostream>
+
+using namespace osgEarth;
+
+int
+usage(const std::string& msg)
+{
+    if (!msg.empty())
+    {
+        std::cout << msg << std::endl;
+    }
+
+    std::cout
+        << std::endl
+        << "USAGE: osgearth_mvtpackager [options] filename" << std::endl
+        << std::endl
+        << "    filename           ; Shapefile (or other feature source data file)" << std::endl
+        << "    --out              ; The MBTiles file to write (default = out.mbtiles)" << std::endl
+        << "    --layer            ; The name of the MVT layer (default = layer)" << std::endl
+        << "    --first-level      ; The first zoom level to write (default = 0)" << std::endl
+        << "    --max-level        ; The last zoom level to write (default = 14)" << std::endl
+        << "    --expression       ; The expression to run on the feature source, specific to the feature source" << std::endl
+        << "    --attributes       ; Comma-delimited attributes to write (default = all)" << std::endl
+        << "    --extent           ; Tile grid size (default = 4096)" << std::endl
+        << "    --buffer           ; Clipping margin around each tile, in grid units (default = 64)" << std::endl
+        << "    --tolerance        ; Simplification tolerance, in grid units (default = 1; 0 = none)" << std::endl
+        << "    --threads          ; Number of tiles to build at once (default = number of cores)" << std::endl
+        << std::endl;
+
+    return -1;
+}
+
+int main(int argc, char** argv)
+{
+    osg::ArgumentParser arguments(&argc, argv);
+
+    if (argc < 2 || arguments.read("--help"))
+    {
+        return usage("");
+    }
+
+    MVTPackager packager;
+    MVT::EncodeOptions encodeOptions;
+
+    unsigned firstLevel = packager.getFirstLevel();
+    while (arguments.read("--first-level", firstLevel));
+
+    unsigned maxLevel = packager.getMaxLevel();
+    while (arguments.read("--max-level", maxLevel));
+
+    std::string destination = "out.mbtiles";
+    while (arguments.read("--out", destination));
+
+    std::string layer = "layer";
+    while (arguments.read("--layer", layer));
+
+    std::string queryExpression;
+    while (arguments.read("--expression", queryExpression));
+
+    std::string attributes;
+    while (arguments.read("--attributes", attributes));
+    if (!attributes.empty())
+    {
+        StringTokenizer(",").tokenize(attributes, encodeOptions.attributes);
+    }
+
+    while (arguments.read("--extent", encodeOptions.extent));
+    while (arguments.read("--buffer", encodeOptions.buffer));
+    while (arguments.read("--tolerance", encodeOptions.tolerance));
+
+    unsigned threads = packager.getNumThreads();
+    while (arguments.read("--threads", threads));
+
+    std::string filename;
+
+    //Get the first argument that is not an option
+    for (int pos = 1; pos < arguments.argc(); ++pos)
+    {
+        if (!arguments.isOption(pos))
+        {
+            filename = arguments[pos];
+            break;
+        }
+    }
+
+    if (filename.empty())
+    {
+        return usage("Please provide a filename");
+    }
+
+    // Open the feature source
+    osg::ref_ptr<OGRFeatureSource> features = new OGRFeatureSource();
+    features->setURL(filename);
+    if (features->open().isError())
+    {
+        OE_NOTICE << "Failed to open " << filename << " : " << features->getStatus().message() << std::endl;
+        return 1;
+    }
+
+    Query query;
+    if (!queryExpression.empty())
+    {
+        query.expression() = queryExpression;
+    }
+
+    OE_NOTICE << "Processing " << filename << std::endl
+        << "  FirstLevel=" << firstLevel << std::endl
+        << "  MaxLevel=" << maxLevel << std::endl
+        << "  Destination=" << destination << std::endl
+        << "  Layer=" << layer << std::endl
+        << "  Expression=" << queryExpression << std::endl
+        << "  Attributes=" << (attributes.empty() ? "all" : attributes) << std::endl
+        << "  Extent=" << encodeOptions.extent << std::endl
+        << "  Buffer=" << encodeOptions.buffer << std::endl
+        << "  Tolerance=" << encodeOptions.tolerance << std::endl
+        << "  Threads=" << threads << std::endl
+        << std::endl;
+
+    packager.setFirstLevel(firstLevel);
+    packager.setMaxLevel(maxLevel);
+    packager.setQuery(query);
+    packager.setEncodeOptions(encodeOptions);
+    packager.setNumThreads(threads);
+
+    osg::Timer_t startTime = osg::Timer::instance()->tick();
+
+    Status status = packager.package(features.get(), destination, layer);
+    if (status.isError())
+    {
+        OE_NOTICE << "Failed: " << status.message() << std::endl;
+        return 1;
+    }
+
+    osg::Timer_t endTime = osg::Timer::instance()->tick();
+    OE_NOTICE << "Completed in " << osg::Timer::instance()->delta_s(startTime, endTime) << " s " << std::endl;
+
+    return 0;
+}
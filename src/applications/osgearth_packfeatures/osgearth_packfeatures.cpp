@@ -0,0 +1,133 @@
+/* -*-c++-*- */
+/* osgEarth - Geospatial SDK for OpenSceneGraph
+* Copyright 2020 Pelican Mapping
+* http://osgearth.org
+*
+* osgEarth is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#include <osgEarth/Notify>
+#include <osgEarth/OGRFeatureSource>
+#include <osgEarth/PackedFeatureSource>
+#include <osg/ArgumentParser>
+#include <osg/Timer>
+#include <iostream>
+
+#define LC "[packfeatures] "
+
+using namespace osgEarth;
+
+int
+usage(const char* name, const std::string& error)
+{
+    OE_NOTICE
+        << "Converts any OGR feature source into a packed feature file"
+        << "\n(Hilbert-sorted, R-tree indexed) for use with PackedFeatureSource."
+        << "\nError: " << error
+        << "\nUsage:"
+        << "\n" << name
+        << "\n  --in in.shp          ; input features (any OGR format)"
+        << "\n  --out out.packed     ; output packed feature file"
+        << "\n  [--layer <name>]     ; layer to read from a multi-layer source"
+        << "\n  [--node-size <n>]    ; R-tree node size (default = 16)"
+        << "\n  [--quiet]            ; suppress console output"
+        << std::endl;
+
+    return -1;
+}
+
+int
+main(int argc, char** argv)
+{
+    osg::ArgumentParser arguments(&argc, argv);
+
+    bool verbose = !arguments.read("--quiet");
+
+    std::string infile;
+    if (!arguments.read("--in", infile))
+        return usage(argv[0], "Missing --in");
+
+    std::string outfile;
+    if (!arguments.read("--out", outfile))
+        return usage(argv[0], "Missing --out");
+
+    std::string layer;
+    arguments.read("--layer", layer);
+
+    unsigned nodeSize = 16u;
+    arguments.read("--node-size", nodeSize);
+    if (nodeSize < 2u)
+        return usage(argv[0], "--node-size must be at least 2");
+
+    osg::ref_ptr<OGRFeatureSource> input = new OGRFeatureSource();
+    input->setURL(infile);
+    if (!layer.empty())
+        input->setLayer(layer);
+    if (input->open().isError())
+        return usage(argv[0], input->getStatus().message());
+
+    const FeatureProfile* profile = input->getFeatureProfile();
+
+    PackedFeatures::Writer writer(
+        outfile,
+        profile->getSRS(),
+        input->getSchema(),
+        input->getGeometryType());
+
+    writer.setNodeSize(nodeSize);
+
+    osg::Timer_t start = osg::Timer::instance()->tick();
+
+    int total = input->getFeatureCount();
+    unsigned skipped = 0u;
+
+    osg::ref_ptr<FeatureCursor> cursor = input->createFeatureCursor(Query(), nullptr);
+    while (cursor.valid() && cursor->hasMore())
+    {
+        Feature* f = cursor->nextFeature();
+        if (!writer.add(f))
+            ++skipped;
+
+        if (verbose)
+        {
+            std::size_t count = writer.size() + skipped;
+            if (count == 1 || count % 10000 == 0 || (int)count == total)
+                std::cout << "\rRead " << count << "/" << total << std::flush;
+        }
+    }
+
+    if (verbose)
+        std::cout << "\nPacking..." << std::flush;
+
+    Status status = writer.finish();
+    if (status.isError())
+    {
+        OE_WARN << LC << status.message() << std::endl;
+        return -1;
+    }
+
+    if (verbose)
+    {
+        std::cout
+            << "\nWrote " << writer.size() << " features"
+            << " (" << skipped << " skipped, no geometry) in "
+            << osg::Timer::instance()->delta_s(start, osg::Timer::instance()->tick()) << "s"
+            << std::endl;
+    }
+
+    return 0;
+}
@@ -91,6 +91,7 @@ int usage( const std::string& msg )
         << "        [--mp]                          ; Use multiprocessing to process the tiles.  Useful for GDAL sources as this avoids the global GDAL lock" << std::endl
         << "        [--mt]                          ; Use multithreading to process the tiles." << std::endl
         << "        [--concurrency]                 ; The number of threads or processes to use if --mp or --mt are provided." << std::endl
+        << "        [--journal dir]                 ; Keep a resumable journal in dir. Run several processes with the same dir to share the work (works with --mt, not --mp)" << std::endl
         << "        [--verbose]                     ; Displays progress of the seed operation" << std::endl
         << std::endl
         << "    --purge file.earth                  ; Purges a layer cache in a .earth file (interactive)" << std::endl
@@ -140,6 +141,9 @@ int seed( osg::ArgumentParser& args )
 
     bool verbose = args.read("--verbose");
 
+    std::string journal;
+    args.read("--journal", journal);
+
     unsigned int batchSize = 0;
     args.read("--batchsize", batchSize);
 
@@ -151,6 +155,11 @@ int seed( osg::ArgumentParser& args )
     int imageLayerIndex = -1;
     args.read("--image", imageLayerIndex);
 
+    // the journal splits the work itself, over --mt threads if asked to;
+    // more processes means running this again on the same journal
+    if (!journal.empty() && (args.find("--mp") > 0 || !tileList.empty()))
+        return usage("--journal cannot be combined with --mp or --tiles. Run several processes with the same --journal instead.");
+
     int elevationLayerIndex = -1;
     args.read("--elevation", elevationLayerIndex);
 
@@ -305,6 +314,7 @@ int seed( osg::ArgumentParser& args )
     // Initialize the seeder
     osgEarth::Contrib::CacheSeed seeder;
     seeder.setVisitor(visitor.get());
+    seeder.setJournalPath(journal);
 
     osgEarth::Map* map = mapNode->getMap();
 
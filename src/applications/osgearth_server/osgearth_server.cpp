@@ -27,6 +27,17 @@
 #include <osgEarth/TerrainEngineNode>
 #include <osgEarth/ExampleResources>
 #include <osgEarth/Threading>
+#include <osgEarth/ImageLayer>
+#include <osgEarth/ImageUtils>
+#include <osgEarth/ElevationLayer>
+#include <osgEarth/FeatureSource>
+#include <osgEarth/FeatureCursor>
+#include <osgEarth/FeatureModelLayer>
+#include <osgEarth/OGRFeatureSource>
+#include <osgEarth/ImageToHeightFieldConverter>
+#ifdef OSGEARTH_HAVE_MVT
+#include <osgEarth/MVT>
+#endif
 #include <osgDB/ReaderWriter>
 #include <osgDB/ReadFile>
 #include <osgDB/Registry>
@@ -40,6 +51,11 @@
 #include <Poco/Net/HTTPServerResponse.h>
 #include <Poco/Net/HTTPServerParams.h>
 #include <Poco/Net/ServerSocket.h>
+#include <Poco/Net/HTTPClientSession.h>
+#include <Poco/Net/HTTPRequest.h>
+#include <Poco/Net/HTTPResponse.h>
+#include <Poco/URI.h>
+#include <Poco/StreamCopier.h>
 #include <Poco/Timestamp.h>
 #include <Poco/DateTimeFormatter.h>
 #include <Poco/DateTimeFormat.h>
@@ -50,6 +66,13 @@
 #include <Poco/Util/OptionSet.h>
 #include <Poco/Util/HelpFormatter.h>
 #include <iostream>
+#include <sstream>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <unordered_map>
 
 using Poco::Net::ServerSocket;
 using Poco::Net::HTTPRequestHandler;
@@ -74,6 +97,7 @@ using Poco::Util::HelpFormatter;
 
 using namespace osgEarth;
 using namespace osgEarth::Util;
+using namespace osgEarth::Threading;
 using namespace osgViewer;
 
 class WindowCaptureCallback : public osg::Camera::DrawCallback
@@ -297,6 +321,22 @@ usage(const char* name)
 {
     OE_NOTICE
         << "\nUsage: " << name << " file.earth" << std::endl
+        << "\n    [--port n]          : port to listen on (default = 8000)"
+        << "\n    [--threads n]       : request handling threads (default = 16)"
+        << "\n    [--headless]        : build tiles from the map layers without a graphics context:"
+        << "\n                            /image/z/x/y.png|jpg        composited image layers"
+        << "\n                            /elevation/z/x/y.png|lerc   elevation as terrain-RGB or LERC"
+        << "\n                            /features/layer/z/x/y.json  features as GeoJSON"
+#ifdef OSGEARTH_HAVE_MVT
+        << "\n                            /features/layer/z/x/y.pbf   features as a Mapbox vector tile"
+#endif
+        << "\n                            /metrics                    server counters"
+        << "\n    [--xyz]             : in headless mode, row 0 is the northernmost (default is TMS)"
+        << "\n    [--per-layer n]     : in headless mode, max concurrent reads per layer (default = 4)"
+        << "\n    [--client url]      : instead of serving, request url from many threads at once and"
+        << "\n                          report the results (use with --clients n, default = 16)"
+        << "\n    [--test folder]     : run the scripted headless test against the data in folder"
+        << std::endl
         << MapNodeHelper().usage() << std::endl;
 
     return 0;
@@ -550,11 +590,762 @@ class TileRequestHandlerFactory : public HTTPRequestHandlerFactory
     }
 };
 
+//........................................................................
+// Headless mode: builds tiles straight from the map's layers, with no
+// graphics context, and shares each build among identical requests.
+
+// One encoded response, shared by every request that asked for it
+struct EncodedTile
+{
+    EncodedTile() : status(Poco::Net::HTTPResponse::HTTP_NOT_FOUND) { }
+    Poco::Net::HTTPResponse::HTTPStatus status;
+    std::string contentType;
+    std::string data;
+};
+typedef std::shared_ptr<const EncodedTile> EncodedTilePtr;
+
+// Runs one build per key at a time. A request for a key that is already
+// being built waits for that build and shares its result.
+class RequestCoalescer
+{
+public:
+    EncodedTilePtr get(const std::string& key, const std::function<EncodedTilePtr()>& build, bool& out_shared)
+    {
+        Promise<EncodedTilePtr> promise;
+        Future<EncodedTilePtr> future;
+        {
+            ScopedMutexLock lock(_mutex);
+            auto i = _inflight.find(key);
+            out_shared = (i != _inflight.end());
+            if (out_shared)
+                future = i->second;
+            else
+                _inflight[key] = promise.getFuture();
+        }
+
+        if (out_shared)
+        {
+            // null if the build failed and abandoned its promise
+            EncodedTilePtr result = future.join();
+            return result ? result : std::make_shared<EncodedTile>();
+        }
+
+        EncodedTilePtr result;
+        try
+        {
+            result = build();
+        }
+        catch (...)
+        {
+            finish(key);
+            throw;
+        }
+        finish(key);
+        promise.resolve(result);
+        return result;
+    }
+
+private:
+    Mutex _mutex;
+    std::unordered_map<std::string, Future<EncodedTilePtr> > _inflight;
+
+    void finish(const std::string& key)
+    {
+        ScopedMutexLock lock(_mutex);
+        _inflight.erase(key);
+    }
+};
+
+// Counting limit on the concurrent reads from each layer
+class LayerLimits
+{
+public:
+    LayerLimits(unsigned max) : _max(osg::maximum(max, 1u)) { }
+
+    void acquire(UID uid)
+    {
+        std::unique_lock<Mutex> lock(_mutex);
+        while (_counts[uid] >= _max)
+            _available.wait(lock);
+        ++_counts[uid];
+    }
+
+    void release(UID uid)
+    {
+        ScopedMutexLock lock(_mutex);
+        --_counts[uid];
+        _available.notify_all();
+    }
+
+    struct Scope
+    {
+        Scope(LayerLimits& limits, UID uid) : _limits(limits), _uid(uid) { _limits.acquire(_uid); }
+        ~Scope() { _limits.release(_uid); }
+        LayerLimits& _limits;
+        UID _uid;
+    };
+
+private:
+    Mutex _mutex;
+    std::condition_variable_any _available;
+    std::unordered_map<UID, unsigned> _counts;
+    unsigned _max;
+};
+
+struct ServerMetrics
+{
+    std::atomic<unsigned> requests{ 0u };
+    std::atomic<unsigned> builds{ 0u };
+    std::atomic<unsigned> coalesced{ 0u };
+    std::atomic<unsigned> notModified{ 0u };
+    std::atomic<unsigned> notFound{ 0u };
+    std::atomic<unsigned> badRequests{ 0u };
+    std::atomic<int> inProgress{ 0 };
+    std::atomic<unsigned long long> bytesSent{ 0u };
+    std::atomic<unsigned long long> buildMicros{ 0u };
+};
+
+class HeadlessTileServer
+{
+public:
+    HeadlessTileServer(const Map* map, unsigned perLayer, bool tms) :
+        _map(map),
+        _limits(perLayer),
+        _tms(tms),
+        _tileSize(256u)
+    {
+        //nop
+    }
+
+    void handle(HTTPServerRequest& request, HTTPServerResponse& response)
+    {
+        ++_metrics.requests;
+
+        std::string path = request.getURI();
+        path = path.substr(0, path.find('?'));
+
+        StringTokenizer tok("/");
+        tok.keepEmpties() = false;
+        StringVector parts;
+        tok.tokenize(path, parts);
+
+        if (parts.size() == 1 && parts[0] == "metrics")
+        {
+            send(response, writeMetrics());
+            return;
+        }
+
+        // [endpoint] [layer] z x y.ext
+        bool hasLayer = !parts.empty() && parts[0] == "features";
+        TileKey key;
+        std::string ext;
+        if (parts.size() != (hasLayer ? 5u : 4u) || !parseKey(parts, ext, key))
+        {
+            ++_metrics.badRequests;
+            response.setStatus(Poco::Net::HTTPResponse::HTTP_BAD_REQUEST);
+            response.send();
+            return;
+        }
+
+        const std::string& endpoint = parts[0];
+        std::function<EncodedTilePtr()> build;
+        std::vector<const Layer*> sources;
+
+        if (endpoint == "image" && (ext == "png" || ext == "jpg" || ext == "jpeg"))
+        {
+            ImageLayerVector layers;
+            getImageLayers(key, layers);
+            for (auto& layer : layers)
+                sources.push_back(layer.get());
+            build = [this, key, ext, layers]() { return buildImage(key, ext, layers); };
+        }
+        else if (endpoint == "elevation" && (ext == "png" || ext == "lerc"))
+        {
+            ElevationLayerVector layers;
+            getElevationLayers(key, layers);
+            for (auto& layer : layers)
+                sources.push_back(layer.get());
+            build = [this, key, ext, layers]() { return buildElevation(key, ext, layers); };
+        }
+        else if (endpoint == "features" && (ext == "json" || ext == "geojson" || ext == "pbf"))
+        {
+            osg::ref_ptr<FeatureSource> fs = findFeatureSource(parts[1]);
+            if (fs.valid())
+            {
+                std::string layerName = parts[1];
+                sources.push_back(fs.get());
+                build = [this, key, ext, layerName, fs]() { return buildFeatures(key, ext, layerName, fs.get()); };
+            }
+        }
+
+        if (!build)
+        {
+            ++_metrics.notFound;
+            response.setStatus(Poco::Net::HTTPResponse::HTTP_NOT_FOUND);
+            response.send();
+            return;
+        }
+
+        // The tag changes whenever one of the contributing layers changes
+        std::string revision = getRevisionKey(path, sources);
+        std::string etag = getETag(revision);
+        response.set("ETag", etag);
+
+        if (request.has("If-None-Match") && request.get("If-None-Match") == etag)
+        {
+            ++_metrics.notModified;
+            response.setStatus(Poco::Net::HTTPResponse::HTTP_NOT_MODIFIED);
+            response.send();
+            return;
+        }
+
+        bool shared = false;
+        // coalesce on the whole key, not the hashed tag, so two different
+        // tiles can never share a build
+        EncodedTilePtr tile = _coalescer.get(revision, [this, &build]()
+        {
+            ++_metrics.builds;
+            ++_metrics.inProgress;
+            auto start = std::chrono::steady_clock::now();
+            EncodedTilePtr result = build();
+            _metrics.buildMicros += std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - start).count();
+            --_metrics.inProgress;
+            return result;
+        }, shared);
+
+        if (shared)
+            ++_metrics.coalesced;
+
+        send(response, tile);
+    }
+
+private:
+    osg::ref_ptr<const Map> _map;
+    LayerLimits _limits;
+    RequestCoalescer _coalescer;
+    ServerMetrics _metrics;
+    bool _tms;
+    unsigned _tileSize;
+
+    bool parseKey(const StringVector& parts, std::string& ext, TileKey& key) const
+    {
+        std::size_t n = parts.size();
+        const std::string& last = parts[n - 1];
+        ext = osgDB::convertToLowerCase(osgDB::getFileExtension(last));
+
+        unsigned z = as<unsigned>(parts[n - 3], 0u);
+        unsigned x = as<unsigned>(parts[n - 2], 0u);
+        unsigned y = as<unsigned>(osgDB::getNameLessExtension(last), 0u);
+
+        const Profile* profile = _map->getProfile();
+        unsigned cols = 0, rows = 0;
+        profile->getNumTiles(z, cols, rows);
+        if (x >= cols || y >= rows)
+            return false;
+
+        if (_tms)
+            y = rows - y - 1;
+
+        key = TileKey(z, x, y, profile);
+        return key.valid();
+    }
+
+    void getImageLayers(const TileKey& key, ImageLayerVector& output) const
+    {
+        ImageLayerVector layers;
+        _map->getOpenLayers(layers);
+        for (auto& layer : layers)
+        {
+            if (layer->getVisible() && layer->isKeyInLegalRange(key))
+                output.push_back(layer);
+        }
+    }
+
+    void getElevationLayers(const TileKey& key, ElevationLayerVector& output) const
+    {
+        ElevationLayerVector layers;
+        _map->getOpenLayers(layers);
+        for (auto& layer : layers)
+        {
+            if (layer->getVisible() && layer->isKeyInLegalRange(key))
+                output.push_back(layer);
+        }
+    }
+
+    FeatureSource* findFeatureSource(const std::string& name) const
+    {
+        Layer* layer = _map->getLayerByName(name);
+        if (!layer || !layer->isOpen())
+            return 0L;
+
+        FeatureSource* fs = dynamic_cast<FeatureSource*>(layer);
+        if (!fs)
+        {
+            FeatureModelLayer* fml = dynamic_cast<FeatureModelLayer*>(layer);
+            if (fml)
+                fs = fml->getFeatureSource();
+        }
+        return fs && fs->isOpen() ? fs : 0L;
+    }
+
+    // The request path plus the revision of everything that goes into it
+    std::string getRevisionKey(const std::string& path, const std::vector<const Layer*>& sources) const
+    {
+        std::ostringstream buf;
+        buf << path << ':' << _map->getDataModelRevision();
+        for (auto layer : sources)
+            buf << ':' << layer->getUID() << '.' << layer->getRevision();
+        return buf.str();
+    }
+
+    std::string getETag(const std::string& revisionKey) const
+    {
+        std::ostringstream etag;
+        etag << '"' << std::hex << std::hash<std::string>()(revisionKey) << '"';
+        return etag.str();
+    }
+
+    EncodedTilePtr encodeImage(const osg::Image* image, const std::string& ext, const std::string& contentType) const
+    {
+        std::shared_ptr<EncodedTile> tile = std::make_shared<EncodedTile>();
+
+        osgDB::ReaderWriter* rw = osgDB::Registry::instance()->getReaderWriterForExtension(ext);
+        if (image && rw)
+        {
+            std::ostringstream buf;
+            if (rw->writeImage(*image, buf).success())
+            {
+                tile->status = Poco::Net::HTTPResponse::HTTP_OK;
+                tile->contentType = contentType;
+                tile->data = buf.str();
+            }
+        }
+        return tile;
+    }
+
+    EncodedTilePtr buildImage(const TileKey& key, const std::string& ext, const ImageLayerVector& layers)
+    {
+        osg::ref_ptr<osg::Image> result;
+
+        // composite from the bottom up, as the terrain would
+        for (auto& layer : layers)
+        {
+            GeoImage geoImage;
+            {
+                LayerLimits::Scope limit(_limits, layer->getUID());
+                geoImage = layer->createImage(key);
+            }
+
+            if (!geoImage.valid())
+                continue;
+
+            osg::ref_ptr<osg::Image> image = ImageUtils::convertToRGBA8(geoImage.getImage());
+            if (!image.valid())
+                continue;
+
+            if (image->s() != (int)_tileSize || image->t() != (int)_tileSize)
+            {
+                osg::ref_ptr<osg::Image> resized;
+                if (!ImageUtils::resizeImage(image.get(), _tileSize, _tileSize, resized))
+                    continue;
+                image = resized.get();
+            }
+
+            if (!result.valid())
+            {
+                result = image.get();
+                if (layer->getOpacity() < 1.0f)
+                {
+                    unsigned char* p = result->data();
+                    for (unsigned i = 0; i < _tileSize * _tileSize; ++i, p += 4)
+                        p[3] = (unsigned char)(p[3] * layer->getOpacity());
+                }
+            }
+            else
+            {
+                ImageUtils::mix(result.get(), image.get(), layer->getOpacity());
+            }
+        }
+
+        if (!result.valid())
+            return std::make_shared<EncodedTile>();
+
+        bool jpeg = (ext != "png");
+        if (jpeg)
+            result = ImageUtils::convertToRGB8(result.get());
+
+        return encodeImage(result.get(), jpeg ? "jpg" : "png", jpeg ? "image/jpeg" : "image/png");
+    }
+
+    EncodedTilePtr buildElevation(const TileKey& key, const std::string& ext, const ElevationLayerVector& layers)
+    {
+        if (layers.empty())
+            return std::make_shared<EncodedTile>();
+
+        osg::ref_ptr<osg::HeightField> hf = new osg::HeightField();
+        hf->allocate(_tileSize, _tileSize);
+        hf->getFloatArray()->assign(_tileSize * _tileSize, NO_DATA_VALUE);
+
+        bool ok;
+        {
+            // same order every time, so concurrent builds can't deadlock
+            std::vector<std::unique_ptr<LayerLimits::Scope> > limits;
+            for (auto& layer : layers)
+                limits.emplace_back(new LayerLimits::Scope(_limits, layer->getUID()));
+
+            ok = layers.populateHeightField(hf.get(), 0L, key, 0L, INTERP_BILINEAR, 0L);
+        }
+
+        if (!ok)
+            return std::make_shared<EncodedTile>();
+
+        if (ext == "lerc")
+        {
+            osg::ref_ptr<osg::Image> image = ImageToHeightFieldConverter().convertToR32F(hf.get());
+            return encodeImage(image.get(), "lerc", "application/octet-stream");
+        }
+
+        // terrain-RGB: height = -10000 + (R*65536 + G*256 + B) * 0.1
+        osg::ref_ptr<osg::Image> image = new osg::Image();
+        image->allocateImage(_tileSize, _tileSize, 1, GL_RGB, GL_UNSIGNED_BYTE);
+        for (unsigned row = 0; row < _tileSize; ++row)
+        {
+            unsigned char* p = image->data(0, row);
+            for (unsigned col = 0; col < _tileSize; ++col, p += 3)
+            {
+                float h = hf->getHeight(col, row);
+                if (h == NO_DATA_VALUE)
+                    h = 0.0f;
+                unsigned v = (unsigned)osg::clampBetween((h + 10000.0) * 10.0, 0.0, 16777215.0);
+                p[0] = (unsigned char)(v >> 16);
+                p[1] = (unsigned char)(v >> 8);
+                p[2] = (unsigned char)(v);
+            }
+        }
+        return encodeImage(image.get(), "png", "image/png");
+    }
+
+    EncodedTilePtr buildFeatures(const TileKey& key, const std::string& ext, const std::string& layerName, FeatureSource* fs)
+    {
+        FeatureList features;
+        {
+            LayerLimits::Scope limit(_limits, fs->getUID());
+            osg::ref_ptr<FeatureCursor> cursor = fs->createFeatureCursor(key, 0L);
+            if (cursor.valid())
+                cursor->fill(features);
+        }
+
+        std::shared_ptr<EncodedTile> tile = std::make_shared<EncodedTile>();
+
+        if (ext == "pbf")
+        {
+#ifdef OSGEARTH_HAVE_MVT
+            // an empty tile is still a valid answer
+            MVT::writeTile(features, key, layerName, tile->data);
+            tile->status = Poco::Net::HTTPResponse::HTTP_OK;
+            tile->contentType = "application/vnd.mapbox-vector-tile";
+#endif
+            return tile;
+        }
+
+        // the cursor may hand out features the source keeps (in a cache,
+        // say), so transform copies
+        const SpatialReference* wgs84 = SpatialReference::get("wgs84");
+        for (auto& feature : features)
+        {
+            feature = new Feature(*feature.get(), osg::CopyOp::DEEP_COPY_ALL);
+            feature->transform(wgs84);
+        }
+
+        tile->status = Poco::Net::HTTPResponse::HTTP_OK;
+        tile->contentType = "application/geo+json";
+        tile->data = Feature::featuresToGeoJSON(features);
+        return tile;
+    }
+
+    EncodedTilePtr writeMetrics() const
+    {
+        unsigned builds = _metrics.builds;
+        std::ostringstream buf;
+        buf << "requests " << _metrics.requests << "\n"
+            << "builds " << builds << "\n"
+            << "coalesced " << _metrics.coalesced << "\n"
+            << "not_modified " << _metrics.notModified << "\n"
+            << "not_found " << _metrics.notFound << "\n"
+            << "bad_requests " << _metrics.badRequests << "\n"
+            << "builds_in_progress " << _metrics.inProgress << "\n"
+            << "bytes_sent " << _metrics.bytesSent << "\n"
+            << "build_ms_avg " << (builds > 0 ? (double)_metrics.buildMicros / 1000.0 / (double)builds : 0.0) << "\n";
+
+        std::shared_ptr<EncodedTile> tile = std::make_shared<EncodedTile>();
+        tile->status = Poco::Net::HTTPResponse::HTTP_OK;
+        tile->contentType = "text/plain";
+        tile->data = buf.str();
+        return tile;
+    }
+
+    void send(HTTPServerResponse& response, EncodedTilePtr tile)
+    {
+        response.setStatus(tile->status);
+        if (tile->status != Poco::Net::HTTPResponse::HTTP_OK)
+        {
+            ++_metrics.notFound;
+            response.send();
+            return;
+        }
+
+        response.setContentType(tile->contentType);
+        response.setContentLength(tile->data.size());
+        response.send().write(tile->data.data(), tile->data.size());
+        _metrics.bytesSent += tile->data.size();
+    }
+};
+
+static HeadlessTileServer* _headless = 0L;
+
+class HeadlessRequestHandler : public HTTPRequestHandler
+{
+public:
+    void handleRequest(HTTPServerRequest& request, HTTPServerResponse& response)
+    {
+        _headless->handle(request, response);
+    }
+};
+
+class HeadlessRequestHandlerFactory : public HTTPRequestHandlerFactory
+{
+public:
+    HTTPRequestHandler* createRequestHandler(const HTTPServerRequest& request)
+    {
+        return new HeadlessRequestHandler();
+    }
+};
+
+// One GET, optionally revalidating a tag
+Poco::Net::HTTPResponse::HTTPStatus
+httpGet(const Poco::URI& server, const std::string& path, const std::string& etag, std::string& out_etag, std::string& out_body)
+{
+    Poco::Net::HTTPClientSession session(server.getHost(), server.getPort());
+    Poco::Net::HTTPRequest request(Poco::Net::HTTPRequest::HTTP_GET, path, Poco::Net::HTTPMessage::HTTP_1_1);
+    if (!etag.empty())
+        request.set("If-None-Match", etag);
+    session.sendRequest(request);
+    Poco::Net::HTTPResponse response;
+    std::istream& in = session.receiveResponse(response);
+    out_body.clear();
+    Poco::StreamCopier::copyToString(in, out_body);
+    out_etag = response.has("ETag") ? response.get("ETag") : std::string();
+    return response.getStatus();
+}
+
+// Scripted client: many threads request the same URL at once, then each
+// repeats the request with the ETag it got back; finishes by printing
+// the server's metrics.
+int
+runClient(const std::string& url, unsigned clients)
+{
+    Poco::URI uri(url);
+
+    std::atomic<unsigned> ok{ 0u }, notModified{ 0u }, failed{ 0u };
+    std::atomic<unsigned long long> micros{ 0u };
+
+    auto get = [&uri](const std::string& path, const std::string& etag, std::string& out_etag, std::string& out_body)
+    {
+        return httpGet(uri, path, etag, out_etag, out_body);
+    };
+
+    std::vector<std::thread> threads;
+    for (unsigned i = 0; i < clients; ++i)
+    {
+        threads.emplace_back([&]()
+        {
+            try
+            {
+                std::string etag, body;
+                auto start = std::chrono::steady_clock::now();
+                auto status = get(uri.getPathAndQuery(), "", etag, body);
+                micros += std::chrono::duration_cast<std::chrono::microseconds>(
+                    std::chrono::steady_clock::now() - start).count();
+
+                if (status != Poco::Net::HTTPResponse::HTTP_OK)
+                {
+                    ++failed;
+                    return;
+                }
+                ++ok;
+
+                std::string etag2;
+                if (get(uri.getPathAndQuery(), etag, etag2, body) == Poco::Net::HTTPResponse::HTTP_NOT_MODIFIED)
+                    ++notModified;
+                else
+                    ++failed;
+            }
+            catch (Poco::Exception& ex)
+            {
+                OE_WARN << LC << ex.displayText() << std::endl;
+                ++failed;
+            }
+        });
+    }
+
+    for (auto& thread : threads)
+        thread.join();
+
+    std::cout
+        << "clients=" << clients
+        << " ok=" << ok
+        << " not_modified=" << notModified
+        << " failed=" << failed
+        << " avg_ms=" << (ok > 0 ? (double)micros / 1000.0 / (double)ok : 0.0)
+        << std::endl;
+
+    try
+    {
+        std::string etag, body;
+        get("/metrics", "", etag, body);
+        std::cout << body << std::flush;
+    }
+    catch (Poco::Exception& ex)
+    {
+        OE_WARN << LC << ex.displayText() << std::endl;
+    }
+
+    return failed > 0 ? -1 : 0;
+}
+
+// Scripted test of headless mode: serves a small map from the data folder
+// on a free port and checks the answers to a fixed set of requests,
+// including bursts of identical and of distinct requests at once.
+int
+runTest(const std::string& dataPath, unsigned clients)
+{
+    osg::ref_ptr<Map> map = new Map();
+    map->setProfile(Profile::create(Profile::GLOBAL_GEODETIC));
+
+    osg::ref_ptr<OGRFeatureSource> world = new OGRFeatureSource();
+    world->setName("world");
+    world->setURL(dataPath + "/world.shp");
+    map->addLayer(world.get());
+
+    if (!world->isOpen())
+    {
+        OE_WARN << LC << "test: " << world->getStatus().message() << std::endl;
+        return -1;
+    }
+
+    _headless = new HeadlessTileServer(map.get(), 4u, true);
+
+    int threads = osg::maximum((int)clients, 2);
+    ServerSocket socket(0);
+    HTTPServerParams* params = new HTTPServerParams();
+    params->setMaxThreads(threads);
+    ThreadPool pool(2, threads);
+    HTTPServer server(new HeadlessRequestHandlerFactory(), pool, socket, params);
+    server.start();
+
+    Poco::URI uri;
+    uri.setScheme("http");
+    uri.setHost("localhost");
+    uri.setPort(socket.address().port());
+
+    unsigned failures = 0u;
+    auto check = [&failures](bool condition, const std::string& what)
+    {
+        if (!condition)
+        {
+            OE_WARN << LC << "test failed: " << what << std::endl;
+            ++failures;
+        }
+    };
+
+    // fires every path from its own thread at once
+    auto burst = [&uri](const std::vector<std::string>& paths, std::vector<std::string>& tags, std::vector<std::string>& bodies)
+    {
+        std::vector<Poco::Net::HTTPResponse::HTTPStatus> statuses(paths.size(), Poco::Net::HTTPResponse::HTTP_INTERNAL_SERVER_ERROR);
+        tags.assign(paths.size(), std::string());
+        bodies.assign(paths.size(), std::string());
+        std::vector<std::thread> threads;
+        for (unsigned i = 0; i < paths.size(); ++i)
+        {
+            threads.emplace_back([&, i]()
+            {
+                try {
+                    statuses[i] = httpGet(uri, paths[i], "", tags[i], bodies[i]);
+                }
+                catch (Poco::Exception& ex) {
+                    OE_WARN << LC << ex.displayText() << std::endl;
+                }
+            });
+        }
+        for (auto& thread : threads)
+            thread.join();
+        return statuses;
+    };
+
+    try
+    {
+        std::string tag, body;
+
+        check(httpGet(uri, "/features/world/0/0", "", tag, body) == Poco::Net::HTTPResponse::HTTP_BAD_REQUEST, "short path is a bad request");
+        check(httpGet(uri, "/features/nowhere/0/0/0.json", "", tag, body) == Poco::Net::HTTPResponse::HTTP_NOT_FOUND, "unknown layer is not found");
+        check(httpGet(uri, "/features/world/1/9/0.json", "", tag, body) == Poco::Net::HTTPResponse::HTTP_BAD_REQUEST, "key outside the profile is a bad request");
+
+        // identical requests get one answer, and the tag revalidates it
+        std::vector<std::string> same(clients, "/features/world/1/0/0.json");
+        std::vector<std::string> tags, bodies;
+        auto statuses = burst(same, tags, bodies);
+        for (unsigned i = 0; i < clients; ++i)
+        {
+            check(statuses[i] == Poco::Net::HTTPResponse::HTTP_OK, "identical request succeeds");
+            check(tags[i] == tags[0] && bodies[i] == bodies[0], "identical requests get the same tile");
+        }
+        check(bodies[0].find("\"Feature\"") != std::string::npos, "tile has features");
+        check(httpGet(uri, same[0], tags[0], tag, body) == Poco::Net::HTTPResponse::HTTP_NOT_MODIFIED, "tag revalidates");
+
+        // distinct requests at once each get their own tile, and the
+        // same tile as when asked for alone
+        std::vector<std::string> distinct;
+        for (unsigned x = 0; x < 4u; ++x)
+            for (unsigned y = 0; y < 2u; ++y)
+                distinct.push_back(Stringify() << "/features/world/1/" << x << "/" << y << ".json");
+        statuses = burst(distinct, tags, bodies);
+        for (unsigned i = 0; i < distinct.size(); ++i)
+        {
+            check(statuses[i] == Poco::Net::HTTPResponse::HTTP_OK, distinct[i] + " succeeds");
+            for (unsigned j = 0; j < i; ++j)
+                check(tags[i] != tags[j], distinct[i] + " has its own tag");
+
+            check(httpGet(uri, distinct[i], "", tag, body) == Poco::Net::HTTPResponse::HTTP_OK && body == bodies[i],
+                distinct[i] + " is the same when asked for alone");
+        }
+
+        check(httpGet(uri, "/metrics", "", tag, body) == Poco::Net::HTTPResponse::HTTP_OK, "metrics");
+        std::cout << body << std::flush;
+    }
+    catch (Poco::Exception& ex)
+    {
+        OE_WARN << LC << ex.displayText() << std::endl;
+        ++failures;
+    }
+
+    server.stop();
+    delete _headless;
+    _headless = 0L;
+
+    std::cout << (failures == 0u ? "passed" : "FAILED") << std::endl;
+    return failures == 0u ? 0 : -1;
+}
+
+//........................................................................
+
 class TileHTTPServer: public Poco::Util::ServerApplication
 {
 public:
-    TileHTTPServer(int port):
-      _port(port)
+    TileHTTPServer(int port, HTTPRequestHandlerFactory* factory, int threads):
+      _port(port),
+      _factory(factory),
+      _threads(threads)
     {
     }
 
@@ -577,7 +1368,10 @@ protected:
     int main(const std::vector<std::string>& args)
     {
         ServerSocket svs(_port);
-        HTTPServer srv(new TileRequestHandlerFactory(), svs, new HTTPServerParams);
+        HTTPServerParams* params = new HTTPServerParams();
+        params->setMaxThreads(_threads);
+        ThreadPool pool(2, _threads);
+        HTTPServer srv(_factory, pool, svs, params);
         srv.start();
         waitForTerminationRequest();
         srv.stop();
@@ -586,6 +1380,8 @@ protected:
 
 private:
     int _port;
+    HTTPRequestHandlerFactory* _factory;
+    int _threads;
 };
 
 
@@ -601,8 +1397,29 @@ main(int argc, char** argv)
     if ( arguments.read("--help") )
         return usage(argv[0]);
 
+    unsigned clients = 16u;
+    arguments.read("--clients", clients);
+
+    std::string clientURL;
+    if (arguments.read("--client", clientURL))
+        return runClient(clientURL, clients);
+
+    std::string testData;
+    if (arguments.read("--test", testData))
+        return runTest(testData, clients);
+
     int port = 8000;
     arguments.read("--port", port);
+
+    int threads = 16;
+    arguments.read("--threads", threads);
+
+    bool headless = arguments.read("--headless");
+    bool tms = !arguments.read("--xyz");
+
+    unsigned perLayer = 4u;
+    arguments.read("--per-layer", perLayer);
+
     OE_NOTICE << "Listening on port " << port << std::endl;
 
     // thread-safe initialization of the OSG wrapper manager. Calling this here
@@ -619,8 +1436,21 @@ main(int argc, char** argv)
         OE_NOTICE << "Found map node" << std::endl;
     }
 
-    _server = new TileImageServer( mapNode.get() );
+    if (!mapNode.valid())
+        return usage(argv[0]);
+
+    HTTPRequestHandlerFactory* factory;
+    if (headless)
+    {
+        _headless = new HeadlessTileServer(mapNode->getMap(), perLayer, tms);
+        factory = new HeadlessRequestHandlerFactory();
+    }
+    else
+    {
+        _server = new TileImageServer( mapNode.get() );
+        factory = new TileRequestHandlerFactory();
+    }
 
-    TileHTTPServer app(port);
+    TileHTTPServer app(port, factory, threads);
     return app.run(argc, argv);
 }
@@ -0,0 +1,222 @@
+/* -*-c++-*- */
+/* osgEarth - Dynamic map generation toolkit for OpenSceneGraph
+* Copyright 2016 Pelican Mapping
+* http://osgearth.org
+*
+* osgEarth is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+
+/**
+ * Headless benchmark for terrain tile data loading. Builds a synthetic map
+ * of image layers that each take a fixed time to produce a tile, then times
+ * TerrainTileModelFactory::createTileModel over a set of tile keys, first
+ * fetching each tile's layers one after the other and then concurrently.
+ */
+
+#include <osgEarth/Map>
+#include <osgEarth/ImageLayer>
+#include <osgEarth/ImageUtils>
+#include <osgEarth/TerrainTileModelFactory>
+#include <osgEarth/TerrainOptions>
+#include <osgEarth/Threading>
+#include <osgEarth/Notify>
+#include <osg/ArgumentParser>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <iostream>
+#include <iomanip>
+
+using namespace osgEarth;
+using namespace osgEarth::Threading;
+
+#define LC "[tileloadbench] "
+
+int
+usage(const char* name)
+{
+    OE_NOTICE
+        << "\nUsage: " << name
+        << "\n    [--layers n]      : number of synthetic image layers (default = 8)"
+        << "\n    [--latency ms]    : time each layer takes to create a tile (default = 20)"
+        << "\n    [--lod n]         : tile LOD to load (default = 6)"
+        << "\n    [--tiles n]       : number of tiles to load (default = 64)"
+        << "\n    [--threads n]     : tile loading threads (default = 4)"
+        << "\n    [--fetch-threads n] : layer fetch threads in concurrent mode (default = 16)"
+        << "\n    [--per-layer n]   : max concurrent fetches per layer (default = 4)"
+        << std::endl;
+    return 0;
+}
+
+// Image layer that simulates a slow source (network, decoding...)
+class SlowImageLayer : public ImageLayer
+{
+public:
+    META_Layer(osgEarth, SlowImageLayer, Options, ImageLayer, slowimage);
+
+    void setLatency(unsigned ms) { _latency = ms; }
+
+    void setColor(const osg::Vec4& color) { _color = color; }
+
+    Status openImplementation() override
+    {
+        Status parent = ImageLayer::openImplementation();
+        if (parent.isError())
+            return parent;
+
+        setProfile(Profile::create(Profile::GLOBAL_GEODETIC));
+        return Status::NoError;
+    }
+
+    GeoImage createImageImplementation(const TileKey& key, ProgressCallback* progress) const override
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(_latency));
+
+        if (progress && progress->isCanceled())
+            return GeoImage::INVALID;
+
+        osg::ref_ptr<osg::Image> image = ImageUtils::createOnePixelImage(_color);
+        return GeoImage(image.get(), key.getExtent());
+    }
+
+protected:
+    void init() override
+    {
+        ImageLayer::init();
+        _latency = 20u;
+        // no caching; we want to measure the sources
+        options().cachePolicy() = CachePolicy::NO_CACHE;
+    }
+
+private:
+    unsigned _latency;
+    osg::Vec4 _color;
+};
+
+// Loads every key on "threads" threads and returns the elapsed seconds.
+double
+run(TerrainTileModelFactory* factory, const Map* map, const std::vector<TileKey>& keys, unsigned threads)
+{
+    CreateTileManifest manifest;
+    std::atomic<unsigned> next(0u);
+    std::atomic<unsigned> colorLayers(0u);
+
+    auto start = std::chrono::steady_clock::now();
+
+    std::vector<std::thread> workers;
+    for (unsigned t = 0; t < threads; ++t)
+    {
+        workers.emplace_back([&]()
+        {
+            for (unsigned i = next++; i < keys.size(); i = next++)
+            {
+                osg::ref_ptr<TerrainTileModel> model = factory->createTileModel(
+                    map, keys[i], manifest, nullptr, nullptr);
+
+                if (model.valid())
+                    colorLayers += (unsigned)model->colorLayers().size();
+            }
+        });
+    }
+
+    for (auto& worker : workers)
+        worker.join();
+
+    auto elapsed = std::chrono::steady_clock::now() - start;
+
+    if (colorLayers != keys.size() * map->getNumLayers())
+    {
+        OE_WARN << LC << "Expected " << keys.size() * map->getNumLayers()
+            << " color layers, got " << colorLayers << std::endl;
+    }
+
+    return std::chrono::duration<double>(elapsed).count();
+}
+
+int
+main(int argc, char** argv)
+{
+    osgEarth::initialize();
+
+    osg::ArgumentParser arguments(&argc, argv);
+    if (arguments.read("--help"))
+        return usage(argv[0]);
+
+    unsigned numLayers = 8u, latency = 20u, lod = 6u, numTiles = 64u;
+    unsigned threads = 4u, fetchThreads = 16u, perLayer = 4u;
+    arguments.read("--layers", numLayers);
+    arguments.read("--latency", latency);
+    arguments.read("--lod", lod);
+    arguments.read("--tiles", numTiles);
+    arguments.read("--threads", threads);
+    arguments.read("--fetch-threads", fetchThreads);
+    arguments.read("--per-layer", perLayer);
+
+    osg::ref_ptr<Map> map = new Map();
+
+    for (unsigned i = 0; i < numLayers; ++i)
+    {
+        SlowImageLayer* layer = new SlowImageLayer();
+        layer->setName(Stringify() << "layer" << i);
+        layer->setLatency(latency);
+        layer->setColor(osg::Vec4((float)i / (float)numLayers, 0.5f, 0.5f, 1.0f));
+        map->addLayer(layer);
+    }
+
+    // a row of keys at the requested LOD:
+    std::vector<TileKey> keys;
+    osg::ref_ptr<const Profile> profile = Profile::create(Profile::GLOBAL_GEODETIC);
+    unsigned tilesWide, tilesHigh;
+    profile->getNumTiles(lod, tilesWide, tilesHigh);
+    for (unsigned i = 0; i < numTiles && i < tilesWide * tilesHigh; ++i)
+    {
+        keys.push_back(TileKey(lod, i % tilesWide, i / tilesWide, profile.get()));
+    }
+
+    TerrainOptions serialOptions;
+    osg::ref_ptr<TerrainTileModelFactory> serial = new TerrainTileModelFactory(serialOptions);
+
+    TerrainOptions concurrentOptions;
+    concurrentOptions.layerFetchConcurrency() = fetchThreads;
+    concurrentOptions.maxFetchesPerLayer() = perLayer;
+    osg::ref_ptr<TerrainTileModelFactory> concurrent = new TerrainTileModelFactory(concurrentOptions);
+
+    std::cout
+        << numLayers << " layers x " << latency << " ms, "
+        << keys.size() << " tiles at LOD " << lod << ", "
+        << threads << " tile threads" << std::endl;
+
+    double serialTime = run(serial.get(), map.get(), keys, threads);
+    std::cout << std::fixed << std::setprecision(3)
+        << "serial:     " << serialTime << " s, "
+        << (1000.0 * serialTime / keys.size()) << " ms/tile" << std::endl;
+
+    double concurrentTime = run(concurrent.get(), map.get(), keys, threads);
+    std::cout
+        << "concurrent: " << concurrentTime << " s, "
+        << (1000.0 * concurrentTime / keys.size()) << " ms/tile"
+        << " (" << fetchThreads << " fetch threads, " << perLayer << " per layer)" << std::endl;
+
+    if (concurrentTime > 0.0)
+    {
+        std::cout << "speedup:    " << std::setprecision(2) << (serialTime / concurrentTime) << "x" << std::endl;
+    }
+
+    return 0;
+}
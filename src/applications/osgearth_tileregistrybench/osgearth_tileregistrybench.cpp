@@ -0,0 +1,341 @@
+/* -*-c++-*- */
+/* osgEarth - Dynamic map generation toolkit for OpenSceneGraph
+* Copyright 2016 Pelican Mapping
+* http://osgearth.org
+*
+* osgEarth is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+
+/**
+ * Headless benchmark for the terrain tile registry's bookkeeping. Simulates
+ * the cull "touch" and unloader "collect" cycles of the REX TileNodeRegistry
+ * over a large set of tiles, once with the node-based layout the registry
+ * used to have (std::unordered_map on TileKey plus a std::list of allocated
+ * tracker entries) and once with its current layout (an open-addressing
+ * table on packed keys plus an intrusive LRU list embedded in each tile).
+ */
+
+#include <osgEarth/TileKey>
+#include <osgEarth/Profile>
+#include <osgEarth/Containers>
+#include <osgEarth/Notify>
+#include <osg/ArgumentParser>
+#include <algorithm>
+#include <chrono>
+#include <list>
+#include <random>
+#include <unordered_map>
+#include <vector>
+#include <iostream>
+#include <iomanip>
+
+using namespace osgEarth;
+using namespace osgEarth::Util;
+
+#define LC "[tileregistrybench] "
+
+int
+usage(const char* name)
+{
+    OE_NOTICE
+        << "\nUsage: " << name
+        << "\n    [--tiles n]       : number of live tiles (default = 50000)"
+        << "\n    [--frames n]      : number of touch/collect cycles (default = 1000)"
+        << "\n    [--visible n]     : tiles touched per frame (default = 10000)"
+        << "\n    [--step n]        : how far the visible set moves per frame (default = 200)"
+        << "\n    [--age n]         : frames before an untouched tile is dormant (default = 30)"
+        << "\n    [--collect n]     : max tiles collected per frame (default = 500)"
+        << std::endl;
+    return 0;
+}
+
+struct SimTile;
+
+// Tracker entry embedded in the tile, as REX's TileTrackerEntry
+struct EmbeddedEntry : public IntrusiveListNode
+{
+    SimTile* _tile;
+    unsigned _lastFrame;
+};
+
+struct SimTile
+{
+    TileKey _key;
+    EmbeddedEntry _entry;
+};
+
+// The registry's previous layout
+class NodeRegistry
+{
+public:
+    NodeRegistry() {
+        _tracker.push_front(nullptr);
+        _sentryptr = _tracker.begin();
+    }
+
+    ~NodeRegistry() {
+        for (auto e : _tracker)
+            delete e;
+    }
+
+    void add(SimTile* tile) {
+        TableEntry& te = _tiles[tile->_key];
+        TrackerEntry* se = new TrackerEntry();
+        se->_tile = tile;
+        se->_lastFrame = ~0u;
+        _tracker.push_front(se);
+        te._tile = tile;
+        te._trackerptr = _tracker.begin();
+    }
+
+    void touch(SimTile* tile, unsigned frame) {
+        auto i = _tiles.find(tile->_key);
+        if (i != _tiles.end()) {
+            TrackerEntry* se = *i->second._trackerptr;
+            se->_lastFrame = frame;
+            _tracker.erase(i->second._trackerptr);
+            _tracker.push_front(se);
+            i->second._trackerptr = _tracker.begin();
+        }
+    }
+
+    void collect(unsigned olderThanFrame, unsigned maxCount, std::vector<SimTile*>& output) {
+        unsigned count = 0u;
+        Tracker::iterator i = _sentryptr;
+        for (++i; i != _tracker.end() && count < maxCount; ++i) {
+            TrackerEntry* se = *i;
+            if (se->_lastFrame < olderThanFrame) {
+                auto entry = _tiles.find(se->_tile->_key);
+                --i;
+                output.push_back(se->_tile);
+                _tracker.erase(entry->second._trackerptr);
+                _tiles.erase(entry);
+                delete se;
+                ++count;
+            }
+        }
+        _tracker.erase(_sentryptr);
+        _tracker.push_front(nullptr);
+        _sentryptr = _tracker.begin();
+    }
+
+    std::size_t size() const { return _tiles.size(); }
+
+private:
+    struct TrackerEntry {
+        SimTile* _tile;
+        unsigned _lastFrame;
+    };
+    using Tracker = std::list<TrackerEntry*>;
+    struct TableEntry {
+        SimTile* _tile;
+        Tracker::iterator _trackerptr;
+    };
+    std::unordered_map<TileKey, TableEntry> _tiles;
+    Tracker _tracker;
+    Tracker::iterator _sentryptr;
+};
+
+// The registry's current layout
+class FlatRegistry
+{
+public:
+    FlatRegistry() {
+        _sentry._tile = nullptr;
+        _tracker.push_front(&_sentry);
+    }
+
+    void add(SimTile* tile) {
+        _tiles[pack(tile->_key)] = tile;
+        tile->_entry._tile = tile;
+        tile->_entry._lastFrame = ~0u;
+        _tracker.push_front(&tile->_entry);
+    }
+
+    void touch(SimTile* tile, unsigned frame) {
+        EmbeddedEntry& se = tile->_entry;
+        if (se.linked()) {
+            se._lastFrame = frame;
+            _tracker.move_to_front(&se);
+        }
+    }
+
+    void collect(unsigned olderThanFrame, unsigned maxCount, std::vector<SimTile*>& output) {
+        unsigned count = 0u;
+        IntrusiveListNode* next;
+        for (IntrusiveListNode* i = _tracker.next(&_sentry); i != nullptr && count < maxCount; i = next) {
+            next = _tracker.next(i);
+            EmbeddedEntry* se = static_cast<EmbeddedEntry*>(i);
+            if (se->_lastFrame < olderThanFrame) {
+                output.push_back(se->_tile);
+                _tracker.remove(se);
+                _tiles.erase(pack(se->_tile->_key));
+                ++count;
+            }
+        }
+        _tracker.move_to_front(&_sentry);
+    }
+
+    std::size_t size() const { return _tiles.size(); }
+
+private:
+    OpenHashMap<SimTile*> _tiles;
+    IntrusiveList _tracker;
+    EmbeddedEntry _sentry;
+
+    // same keys as the REX registry
+    static std::uint64_t pack(const TileKey& key) {
+        unsigned w, h;
+        key.getProfile()->getNumTiles(0u, w, h);
+        const unsigned lod = key.getLOD();
+        const std::uint64_t mask = (1ull << lod) - 1ull;
+        const std::uint64_t root = (std::uint64_t)(key.getTileY() >> lod) * w + (key.getTileX() >> lod);
+        return
+            (((std::uint64_t)w * h + root) << (2u * lod)) |
+            (((std::uint64_t)key.getTileX() & mask) << lod) |
+            ((std::uint64_t)key.getTileY() & mask);
+    }
+};
+
+struct Settings
+{
+    unsigned frames, visible, step, age, collect;
+};
+
+struct Result
+{
+    double touchTime, collectTime;
+    std::size_t collected;
+};
+
+// Runs the simulation: each frame touches a window of tiles that slides
+// along "order", then collects dormant tiles and immediately re-adds them,
+// as if the camera had come back for them.
+template<typename REGISTRY>
+Result
+run(std::vector<SimTile>& tiles, const std::vector<unsigned>& order, const Settings& s)
+{
+    REGISTRY registry;
+    for (auto& tile : tiles)
+        registry.add(&tile);
+
+    Result result = { 0.0, 0.0, 0u };
+    std::vector<SimTile*> output;
+
+    for (unsigned frame = 0; frame < s.frames; ++frame)
+    {
+        auto t0 = std::chrono::steady_clock::now();
+
+        std::size_t first = ((std::size_t)frame * s.step) % order.size();
+        for (unsigned v = 0; v < s.visible; ++v)
+        {
+            registry.touch(&tiles[order[(first + v) % order.size()]], frame);
+        }
+
+        auto t1 = std::chrono::steady_clock::now();
+
+        output.clear();
+        registry.collect(frame > s.age ? frame - s.age : 0u, s.collect, output);
+        for (auto tile : output)
+            registry.add(tile);
+
+        auto t2 = std::chrono::steady_clock::now();
+
+        result.touchTime += std::chrono::duration<double>(t1 - t0).count();
+        result.collectTime += std::chrono::duration<double>(t2 - t1).count();
+        result.collected += output.size();
+    }
+
+    if (registry.size() != tiles.size())
+    {
+        OE_WARN << LC << "Expected " << tiles.size() << " tiles, got " << registry.size() << std::endl;
+    }
+
+    return result;
+}
+
+int
+main(int argc, char** argv)
+{
+    osg::ArgumentParser arguments(&argc, argv);
+    if (arguments.read("--help"))
+        return usage(argv[0]);
+
+    unsigned numTiles = 50000u;
+    Settings s = { 1000u, 10000u, 200u, 30u, 500u };
+    arguments.read("--tiles", numTiles);
+    arguments.read("--frames", s.frames);
+    arguments.read("--visible", s.visible);
+    arguments.read("--step", s.step);
+    arguments.read("--age", s.age);
+    arguments.read("--collect", s.collect);
+
+    // a quadtree of keys, breadth first from the roots:
+    osg::ref_ptr<const Profile> profile = Profile::create(Profile::GLOBAL_GEODETIC);
+    std::vector<TileKey> keys;
+    profile->getRootKeys(keys);
+    for (std::size_t i = 0; keys.size() < numTiles; ++i)
+    {
+        for (unsigned q = 0; q < 4 && keys.size() < numTiles; ++q)
+            keys.push_back(keys[i].createChildKey(q));
+    }
+
+    std::vector<SimTile> tiles(keys.size());
+    for (std::size_t i = 0; i < keys.size(); ++i)
+        tiles[i]._key = keys[i];
+
+    // visit tiles in a scattered order, the way they sit in memory
+    // relative to what the camera sees:
+    std::vector<unsigned> order(tiles.size());
+    for (unsigned i = 0; i < order.size(); ++i)
+        order[i] = i;
+    std::shuffle(order.begin(), order.end(), std::mt19937(1234));
+
+    std::cout
+        << tiles.size() << " tiles, " << s.frames << " frames, "
+        << s.visible << " touched per frame" << std::endl;
+
+    Result node = run<NodeRegistry>(tiles, order, s);
+    Result flat = run<FlatRegistry>(tiles, order, s);
+
+    if (node.collected != flat.collected)
+    {
+        OE_WARN << LC << "Layouts disagree: " << node.collected << " vs "
+            << flat.collected << " tiles collected" << std::endl;
+    }
+
+    double touches = (double)s.frames * s.visible;
+
+    std::cout << std::fixed << std::setprecision(3)
+        << "node-based: touch " << node.touchTime << " s ("
+        << (1e9 * node.touchTime / touches) << " ns/touch), collect "
+        << node.collectTime << " s" << std::endl
+        << "flat:       touch " << flat.touchTime << " s ("
+        << (1e9 * flat.touchTime / touches) << " ns/touch), collect "
+        << flat.collectTime << " s" << std::endl
+        << node.collected << " tiles collected" << std::endl;
+
+    if (flat.touchTime + flat.collectTime > 0.0)
+    {
+        std::cout << "speedup:    " << std::setprecision(2)
+            << ((node.touchTime + node.collectTime) / (flat.touchTime + flat.collectTime))
+            << "x" << std::endl;
+    }
+
+    return 0;
+}
@@ -22,6 +22,8 @@
 
 #include <osgEarth/CacheSeed>
 #include <osgEarth/ImageLayer>
+#include <osgEarth/FileUtils>
+#include <osgEarth/StringUtils>
 
 #define LC "[CacheSeed] "
 
@@ -40,6 +42,13 @@ bool CacheTileHandler::handleTile(const TileKey& key, const TileVisitor& tv)
     ImageLayer* imageLayer = dynamic_cast< ImageLayer* >( _layer.get() );
     ElevationLayer* elevationLayer = dynamic_cast< ElevationLayer* >( _layer.get() );    
 
+    // Nothing under a key known to be an empty subtree can have data; prune the branch.
+    DataAvailability* availability = _layer->getDataAvailability(key.getProfile());
+    if (availability && availability->get(key) == DataAvailability::EMPTY_SUBTREE)
+    {
+        return false;
+    }
+
     // Just call createImage or createHeightField on the layer and the it will be cached!
     if (imageLayer)
     {                
@@ -116,6 +125,34 @@ void CacheSeed::setVisitor(TileVisitor* visitor)
 
 void CacheSeed::run( TileLayer* layer, const Map* map )
 {
+    if (!_journalPath.empty())
+    {
+        std::string name = layer->getName();
+        if (name.empty())
+            name = Stringify() << "layer" << map->getIndexOfLayer(layer);
+        replaceIn(name, " ", "_");
+        replaceIn(name, "/", "_");
+        replaceIn(name, "\\", "_");
+
+        osg::ref_ptr<JournaledTileVisitor> v = new JournaledTileVisitor(
+            _journalPath + "/" + name,
+            new CacheTileHandler(layer, map));
+
+        v->setMinLevel(_visitor->getMinLevel());
+        v->setMaxLevel(_visitor->getMaxLevel());
+        v->setProgressCallback(_visitor->getProgressCallback());
+        MultithreadedTileVisitor* mt = dynamic_cast<MultithreadedTileVisitor*>(_visitor.get());
+        if (mt)
+            v->setNumThreads(mt->getNumThreads());
+        for (auto& extent : _visitor->getExtents())
+            v->addExtent(extent);
+
+        v->run(map->getProfile());
+
+        OE_NOTICE << LC << "Layer \"" << layer->getName() << "\"\n" << v->getJournal()->getReport() << std::endl;
+        return;
+    }
+
     _visitor->setTileHandler( new CacheTileHandler( layer, map ) );
     _visitor->run( map->getProfile() );
 }
\ No newline at end of file
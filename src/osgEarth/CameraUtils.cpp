@@ -21,6 +21,7 @@
 */
 #include <osgEarth/CameraUtils>
 #include <osg/Camera>
+#include <osg/ValueObject>
 
 #define LC "[CameraUtils] "
 
@@ -56,3 +57,29 @@ CameraUtils::isDepthCamera(const osg::Camera* camera)
     const osg::StateSet* ss = camera->getStateSet();
     return ss && ss->getDefinePair("OE_IS_DEPTH_CAMERA") != 0L;
 }
+
+void
+CameraUtils::setIsPrimaryTerrainView(osg::Camera* camera)
+{
+    camera->setUserValue("osgEarth.PrimaryTerrainView", true);
+}
+
+bool
+CameraUtils::isPrimaryTerrainView(const osg::Camera* camera)
+{
+    bool value = false;
+    return camera && camera->getUserValue("osgEarth.PrimaryTerrainView", value) && value;
+}
+
+void
+CameraUtils::setSharesTerrainSelection(osg::Camera* camera, bool value)
+{
+    camera->setUserValue("osgEarth.SharesTerrainSelection", value);
+}
+
+bool
+CameraUtils::sharesTerrainSelection(const osg::Camera* camera)
+{
+    bool value = false;
+    return camera && camera->getUserValue("osgEarth.SharesTerrainSelection", value) && value;
+}
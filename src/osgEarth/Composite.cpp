@@ -18,6 +18,8 @@
  */
 #include <osgEarth/Composite>
 #include <osgEarth/Progress>
+#include <osgEarth/ImageUtils>
+#include <algorithm>
 
 using namespace osgEarth;
 
@@ -77,6 +79,120 @@ namespace osgEarth { namespace Composite
 
     // some helper types.    
     typedef std::vector<ImageInfo> ImageMixVector;   
+
+    // Opaque coverage of an image as an 8x8 grid of blocks. A set bit means
+    // every pixel in that block is fully opaque.
+    typedef std::uint64_t CoverageMask;
+    const CoverageMask FULL_COVERAGE = ~(CoverageMask)0;
+
+    inline bool isRGBA8(const osg::Image* image)
+    {
+        return
+            image->getPixelFormat() == GL_RGBA &&
+            image->getDataType() == GL_UNSIGNED_BYTE;
+    }
+
+    CoverageMask computeCoverage(const osg::Image* image)
+    {
+        if (!ImageUtils::hasAlphaChannel(image))
+            return FULL_COVERAGE;
+
+        const int S = image->s(), T = image->t();
+
+        // pixel (s,t) falls in block (s*8/S, t*8/T); blocks that contain
+        // no pixels (tiny images) count as opaque
+        int colStart[9];
+        for (int bx = 0; bx <= 8; ++bx)
+            colStart[bx] = (bx*S + 7) / 8;
+
+        bool opaque[64];
+        for (int b = 0; b < 64; ++b)
+            opaque[b] = true;
+
+        const bool rgba8 = isRGBA8(image);
+        ImageUtils::PixelReader read(image);
+        osg::Vec4 value;
+
+        for (int r = 0; r < image->r(); ++r)
+        {
+            for (int t = 0; t < T; ++t)
+            {
+                bool* row = &opaque[(t * 8 / T) * 8];
+
+                for (int bx = 0; bx < 8; ++bx)
+                {
+                    if (!row[bx])
+                        continue;
+
+                    if (rgba8)
+                    {
+                        const unsigned char* p = image->data(colStart[bx], t, r) + 3;
+                        unsigned char a = 255;
+                        for (int s = colStart[bx]; s < colStart[bx + 1]; ++s, p += 4)
+                            a &= *p;
+                        row[bx] = (a == 255);
+                    }
+                    else
+                    {
+                        for (int s = colStart[bx]; s < colStart[bx + 1] && row[bx]; ++s)
+                        {
+                            read(value, s, t, r);
+                            row[bx] = (value.a() >= 1.0f);
+                        }
+                    }
+                }
+            }
+        }
+
+        CoverageMask mask = 0;
+        for (int b = 0; b < 64; ++b)
+        {
+            if (opaque[b])
+                mask |= (CoverageMask)1 << b;
+        }
+        return mask;
+    }
+
+    // Keeps the smaller red channel value of the two images in "dest".
+    void less(osg::Image* dest, const osg::Image* src)
+    {
+        if (isRGBA8(dest) && isRGBA8(src) &&
+            dest->s() == src->s() && dest->t() == src->t() && dest->r() == src->r())
+        {
+            for (int r = 0; r < dest->r(); ++r)
+            {
+                for (int t = 0; t < dest->t(); ++t)
+                {
+                    const unsigned char* sp = src->data(0, t, r);
+                    unsigned char* dp = dest->data(0, t, r);
+                    for (int s = 0; s < dest->s(); ++s, sp += 4, dp += 4)
+                    {
+                        dp[0] = std::min(dp[0], sp[0]);
+                    }
+                }
+            }
+            return;
+        }
+
+        ImageUtils::PixelReader readOne(dest);
+        ImageUtils::PixelReader readTwo(src);
+        ImageUtils::PixelWriter writeOne(dest);
+        osg::Vec4 pixelOne, pixelTwo;
+
+        for (int t = 0; t < dest->t(); ++t)
+        {
+            for (int s = 0; s < dest->s(); ++s)
+            {
+                readOne(pixelOne, s, t);
+                readTwo(pixelTwo, s, t);
+                if (pixelTwo.r() < pixelOne.r())
+                {
+                    pixelOne.r() = pixelTwo.r();
+                    writeOne(pixelOne, s, t);
+                }
+            }
+        }
+    }
 } }
 
 REGISTER_OSGEARTH_LAYER(compositeimage, CompositeImageLayer);
@@ -296,6 +412,8 @@ CompositeImageLayer::closeImplementation()
         _layerNodes->removeChildren(0, _layerNodes->getNumChildren());
     }
 
+    _coverageCache.clear();
+
     dataExtents().clear();
     return Status::OK();
 }
@@ -303,14 +421,49 @@ CompositeImageLayer::closeImplementation()
 GeoImage
 CompositeImageLayer::createImageImplementation(const TileKey& key, ProgressCallback* progress) const
 {
-    Composite::ImageMixVector images;
-    images.reserve(_layers.size());
+    const int numLayers = (int)_layers.size();
+
+    // Only a blend lets an opaque layer hide the layers below it;
+    // "less" has to look at every layer.
+    const bool topDown = (options().function() == options().FUNCTION_BLEND);
+
+    // Opaque coverage recorded the last time we built this tile, if the
+    // sub-layers have not changed since.
+    int revision = 0;
+    for (int i = 0; i < numLayers; ++i)
+        revision += _layers[i]->getRevision();
+
+    TileCoverage coverage;
+    bool coverageChanged = false;
+    LRUCache<TileKey, TileCoverage>::Record cached;
+    if (topDown &&
+        _coverageCache.get(key, cached) &&
+        cached.value().revision == revision &&
+        (int)cached.value().masks.size() == numLayers)
+    {
+        coverage = cached.value();
+    }
+    else
+    {
+        coverage.revision = revision;
+        coverage.masks.assign(numLayers, 0);
+        coverage.known.assign(numLayers, false);
+    }
 
-    // Try to get an image from each of the layers for the given key.
-    for (ImageLayerVector::const_iterator itr = _layers.begin(); itr != _layers.end(); ++itr)
+    Composite::ImageMixVector images(numLayers);
+    Composite::CoverageMask covered = 0;
+    osg::Vec2s coverageSize;
+
+    // lowest layer that can contribute to the output
+    int bottom = 0;
+
+    // Try to get an image from each of the layers for the given key, from
+    // the top down. Once the opaque parts of the layers fetched so far cover
+    // the whole tile, nothing below them can show through.
+    for (int i = numLayers - 1; i >= 0; --i)
     {
-        ImageLayer* layer = itr->get();
-        Composite::ImageInfo imageInfo;
+        ImageLayer* layer = _layers[i].get();
+        Composite::ImageInfo& imageInfo = images[i];
         imageInfo.opacity = layer->getOpacity();
         imageInfo.bestAvailableKey = layer->getBestAvailableTileKey(key);
         
@@ -331,13 +484,41 @@ CompositeImageLayer::createImageImplementation(const TileKey& key, ProgressCallb
             }
         }
 
-        images.push_back(imageInfo);
+        const osg::Image* image = imageInfo.image.get();
+        if (topDown && image && imageInfo.opacity >= 1.0f)
+        {
+            // images of another size won't blend, so they can't cover anything
+            if (covered == 0)
+                coverageSize.set(image->s(), image->t());
+
+            if (image->s() == coverageSize.x() && image->t() == coverageSize.y())
+            {
+                if (!coverage.known[i])
+                {
+                    coverage.masks[i] = Composite::computeCoverage(image);
+                    coverage.known[i] = true;
+                    coverageChanged = true;
+                }
+
+                covered |= coverage.masks[i];
+                if (covered == Composite::FULL_COVERAGE)
+                {
+                    bottom = i;
+                    break;
+                }
+            }
+        }
+    }
+
+    if (coverageChanged)
+    {
+        _coverageCache.insert(key, coverage);
     }
 
     // Determine the output texture size to use based on the image that were created.
     unsigned numValidImages = 0;
     osg::Vec2s textureSize;
-    for (unsigned int i = 0; i < images.size(); i++)
+    for (int i = bottom; i < numLayers; i++)
     {
         Composite::ImageInfo& info = images[i];
         if (info.image.valid())
@@ -351,9 +532,9 @@ CompositeImageLayer::createImageImplementation(const TileKey& key, ProgressCallb
     } 
 
     // Create fallback images if we have some valid data but not for all the layers
-    if (numValidImages > 0 && numValidImages < images.size())
+    if (numValidImages > 0 && numValidImages < (unsigned)(numLayers - bottom))
     {
-        for (unsigned int i = 0; i < images.size(); i++)
+        for (int i = bottom; i < numLayers; i++)
         {
             Composite::ImageInfo& info = images[i];
             ImageLayer* layer = _layers[i].get();
@@ -394,7 +575,7 @@ CompositeImageLayer::createImageImplementation(const TileKey& key, ProgressCallb
     // Now finally create the output image.
     //Recompute the number of valid images
     numValidImages = 0;
-    for (unsigned int i = 0; i < images.size(); i++)
+    for (int i = bottom; i < numLayers; i++)
     {
         Composite::ImageInfo& info = images[i];
         if (info.image.valid())
@@ -414,7 +595,7 @@ CompositeImageLayer::createImageImplementation(const TileKey& key, ProgressCallb
     else if ( numValidImages == 1 )
     {
         //We only have one valid image, so just return it and don't bother with compositing
-        for (unsigned int i = 0; i < images.size(); i++)
+        for (int i = bottom; i < numLayers; i++)
         {
             Composite::ImageInfo& info = images[i];
             if (info.image.valid())
@@ -428,7 +609,7 @@ CompositeImageLayer::createImageImplementation(const TileKey& key, ProgressCallb
     else
     {
         osg::Image* result = 0;
-        for (unsigned int i = 0; i < images.size(); i++)
+        for (int i = bottom; i < numLayers; i++)
         {
             Composite::ImageInfo& imageInfo = images[i];
             if (!result)
@@ -448,24 +629,7 @@ CompositeImageLayer::createImageImplementation(const TileKey& key, ProgressCallb
                     }
                     else if (options().function() == options().FUNCTION_LESS)
                     {
-                        ImageUtils::PixelReader readOne(result);
-                        ImageUtils::PixelReader readTwo(imageInfo.image.get());
-                        ImageUtils::PixelWriter writeOne(result);
-                        osg::Vec4 pixelOne, pixelTwo;
-
-                        for (int t = 0; t < result->t(); ++t)
-                        {
-                            for (int s = 0; s < result->s(); ++s)
-                            {
-                                readOne(pixelOne, s, t);
-                                readTwo(pixelTwo, s, t);
-                                if (pixelTwo.r() < pixelOne.r())
-                                {
-                                    pixelOne.r() = pixelTwo.r();
-                                    writeOne(pixelOne, s, t);
-                                }
-                            }
-                        }
+                        Composite::less(result, imageInfo.image.get());
                     }
                 }
             }            
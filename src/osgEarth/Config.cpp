@@ -70,10 +70,11 @@ Config::setReferrer( const std::string& referrer )
 bool
 Config::fromXML( std::istream& in )
 {
-    osg::ref_ptr<XmlDocument> xml = XmlDocument::load( in );
-    if ( xml.valid() )
-        *this = xml->getConfig();
-    return xml.valid();
+    Config conf;
+    if ( !XmlDocument::readConfig( in, URIContext(), conf ) )
+        return false;
+    *this = conf;
+    return true;
 }
 
 #if 1
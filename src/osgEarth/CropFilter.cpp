@@ -17,10 +17,33 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>
  */
 #include <osgEarth/CropFilter>
+#include <osgEarth/Threading>
+#include <algorithm>
+#include <thread>
 
 #define LC "[CropFilter] "
 
+// below this many input points, cropping runs on the calling thread
+#define PARALLEL_CROP_MIN_POINTS 65536u
+
+#define CROP_ARENA_NAME "oe.crop"
+
 using namespace osgEarth;
+using namespace osgEarth::Threading;
+
+namespace
+{
+    unsigned getCropConcurrency()
+    {
+        static unsigned concurrency = []()
+        {
+            unsigned value = std::max(2u, std::thread::hardware_concurrency());
+            JobArena::setConcurrency(CROP_ARENA_NAME, value);
+            return value;
+        }();
+        return concurrency;
+    }
+}
 
 CropFilter::CropFilter( CropFilter::Method method ) :
 _method( method )
@@ -72,72 +95,113 @@ CropFilter::push( FeatureList& input, FilterContext& context )
         }
     }
 
-    else // METHOD_CROPPING (requires GEOS)
+    else // METHOD_CROPPING
     {
-#ifdef OSGEARTH_HAVE_GEOS
-
-        // create the intersection polygon:
-        osg::ref_ptr<Polygon> poly;
-        
-        for( FeatureList::iterator i = input.begin(); i != input.end();  )
+        const Bounds bounds = extent.bounds();
+        const GeometryClipper clipper(bounds);
+        const bool useCache = _clipCache.valid() && _tileKey.isSet();
+
+        std::vector<Feature*> features;
+        features.reserve(input.size());
+        unsigned totalPoints = 0u;
+        for (auto& feature : input)
         {
-            bool keepFeature = false;
+            features.push_back(feature.get());
+            if (feature->getGeometry())
+                totalPoints += feature->getGeometry()->getTotalPointCount();
+        }
 
-            Feature* feature = i->get();
+        // 0 = discard, 1 = keep as-is, 2 = replace with the cropped geometry
+        std::vector<char> keep(features.size(), 0);
+        std::vector<osg::ref_ptr<Geometry>> cropped(features.size());
 
-            Geometry* featureGeom = feature->getGeometry();
-            if ( featureGeom && featureGeom->isValid() )
+        auto cropRange = [&](unsigned begin, unsigned end)
+        {
+            for (unsigned i = begin; i < end; ++i)
             {
+                Feature* feature = features[i];
+                Geometry* featureGeom = feature->getGeometry();
+                if (!featureGeom || !featureGeom->isValid())
+                    continue;
+
                 // test for trivial acceptance:
                 GeoExtent featureExtent = feature->getExtent();
                 if (featureExtent.isInvalid())
-                {
-                    //nop
-                }
+                    continue;
 
-                else if ( extent.contains(featureExtent) )
+                if (extent.contains(featureExtent))
                 {
-                    keepFeature = true;
-                    newExtent.expandToInclude(featureExtent);
+                    keep[i] = 1;
+                    continue;
                 }
 
                 // then move on to the cropping operation:
-                else
-                {
-                    if ( !poly.valid() )
-                    {
-                        poly = new Polygon();
-                        poly->push_back( osg::Vec3d( extent.xMin(), extent.yMin(), 0 ));
-                        poly->push_back( osg::Vec3d( extent.xMax(), extent.yMin(), 0 ));
-                        poly->push_back( osg::Vec3d( extent.xMax(), extent.yMax(), 0 ));
-                        poly->push_back( osg::Vec3d( extent.xMin(), extent.yMax(), 0 ));
-                    }
+                osg::ref_ptr<Geometry> result;
+                bool ok = useCache ?
+                    _clipCache->clip(feature->getFID(), featureGeom, _tileKey.get(), bounds, result) :
+                    clipper.clip(featureGeom, result);
 
-                    osg::ref_ptr<Geometry> croppedGeometry;
-                    if ( featureGeom->crop( poly.get(), croppedGeometry ) )
-                    {
-                        if ( croppedGeometry->isValid() )
-                        {
-                            feature->setGeometry( croppedGeometry.get() );
-                            keepFeature = true;
-                            newExtent.expandToInclude(GeoExtent(newExtent.getSRS(), croppedGeometry->getBounds()));
-                        }
-                    }
+                if (ok && result->isValid())
+                {
+                    cropped[i] = result;
+                    keep[i] = 2;
                 }
             }
+        };
 
-            if ( keepFeature )
-                ++i;
-            else
-                i = input.erase( i );
-        }  
+        if (features.size() > 1 && totalPoints >= PARALLEL_CROP_MIN_POINTS)
+        {
+            // Big polygons (coastlines etc.) dominate; split the work into
+            // batches of roughly equal point counts.
+            unsigned batchPoints = std::max(1u, totalPoints / (4u * getCropConcurrency()));
+            JobArena* arena = JobArena::get(CROP_ARENA_NAME);
+
+            JobGroup group;
+            unsigned begin = 0u, points = 0u;
+            for (unsigned i = 0; i < features.size(); ++i)
+            {
+                if (features[i]->getGeometry())
+                    points += features[i]->getGeometry()->getTotalPointCount();
 
-#else // OSGEARTH_HAVE_GEOS
+                if (points >= batchPoints || i + 1 == features.size())
+                {
+                    unsigned end = i + 1;
+                    Job job(arena, &group);
+                    job.dispatch([&cropRange, begin, end](Cancelable*) {
+                        cropRange(begin, end);
+                    });
+                    begin = end;
+                    points = 0u;
+                }
+            }
+            group.join();
+        }
+        else
+        {
+            cropRange(0u, features.size());
+        }
 
-        OE_WARN << "CropFilter - METHOD_CROPPING not available - please compile osgEarth with GEOS" << std::endl;
-        return context;
+        unsigned index = 0u;
+        for (FeatureList::iterator i = input.begin(); i != input.end(); ++index)
+        {
+            if (keep[index] == 0)
+            {
+                i = input.erase(i);
+                continue;
+            }
 
-#endif
+            Feature* feature = i->get();
+            if (keep[index] == 2)
+            {
+                feature->setGeometry(cropped[index].get());
+                newExtent.expandToInclude(GeoExtent(newExtent.getSRS(), cropped[index]->getBounds()));
+            }
+            else
+            {
+                newExtent.expandToInclude(feature->getExtent());
+            }
+            ++i;
+        }
     }
 
     FilterContext newContext = context;
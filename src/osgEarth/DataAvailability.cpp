@@ -0,0 +1,241 @@
+/* -*-c++-*- */
+/* osgEarth - Geospatial SDK for OpenSceneGraph
+ * Copyright 2020 Pelican Mapping
+ * http://osgearth.org
+ *
+ * osgEarth is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+#include <osgEarth/DataAvailability>
+#include <osgEarth/Profile>
+#include <osgEarth/Notify>
+#include <sstream>
+
+using namespace osgEarth;
+using namespace osgEarth::Threading;
+
+#define LC "[DataAvailability] "
+
+namespace
+{
+    const char* HEADER = "oe_availability";
+    const unsigned VERSION = 1u;
+}
+
+DataAvailability::DataAvailability(const Profile* profile) :
+    _profile(profile),
+    _changes(0u)
+{
+    //nop
+}
+
+std::uint64_t
+DataAvailability::pack(unsigned lod, unsigned x, unsigned y)
+{
+    // 6 bits of LOD, 29 bits each of X and Y
+    return
+        ((std::uint64_t)(lod & 0x3f) << 58) |
+        ((std::uint64_t)(x & 0x1fffffff) << 29) |
+        ((std::uint64_t)(y & 0x1fffffff));
+}
+
+DataAvailability::State
+DataAvailability::get(const TileKey& key) const
+{
+    if (!key.valid())
+        return UNKNOWN;
+
+    ScopedReadLock lock(_mutex);
+
+    if (_states.empty())
+        return UNKNOWN;
+
+    unsigned lod = key.getLOD();
+    unsigned x = key.getTileX();
+    unsigned y = key.getTileY();
+
+    auto i = _states.find(pack(lod, x, y));
+    if (i != _states.end())
+        return (State)i->second;
+
+    // an empty ancestor means an empty subtree
+    while (lod > 0u)
+    {
+        --lod, x >>= 1, y >>= 1;
+        i = _states.find(pack(lod, x, y));
+        if (i != _states.end() && i->second == EMPTY_SUBTREE)
+            return EMPTY_SUBTREE;
+    }
+
+    return UNKNOWN;
+}
+
+void
+DataAvailability::set(const TileKey& key, State state)
+{
+    if (!key.valid())
+        return;
+
+    std::uint64_t k = pack(key.getLOD(), key.getTileX(), key.getTileY());
+
+    ScopedWriteLock lock(_mutex);
+
+    if (state == UNKNOWN)
+    {
+        if (_states.erase(k) > 0)
+            ++_changes;
+    }
+    else
+    {
+        std::uint8_t& value = _states[k];
+        if (value != (std::uint8_t)state)
+        {
+            value = (std::uint8_t)state;
+            ++_changes;
+        }
+    }
+}
+
+void
+DataAvailability::addCoverage(const DataExtentList& extents, unsigned depth)
+{
+    if (!_profile.valid() || extents.empty())
+        return;
+
+    std::vector<GeoExtent> local;
+    local.reserve(extents.size());
+
+    for (auto& extent : extents)
+    {
+        GeoExtent e = extent.transform(_profile->getSRS());
+        if (!e.isValid())
+        {
+            // can't tell what's covered, so don't claim anything is empty
+            OE_DEBUG << LC << "Coverage extent does not transform to the index profile" << std::endl;
+            return;
+        }
+        local.push_back(e);
+    }
+
+    std::vector<TileKey> roots;
+    _profile->getRootKeys(roots);
+
+    for (auto& root : roots)
+    {
+        addCoverage(root, local, depth);
+    }
+}
+
+void
+DataAvailability::addCoverage(
+    const TileKey& key,
+    const std::vector<GeoExtent>& extents,
+    unsigned maxLOD)
+{
+    GeoExtent keyExtent = key.getExtent();
+    bool partial = false;
+
+    for (auto& extent : extents)
+    {
+        if (keyExtent.intersects(extent, false))
+        {
+            // fully covered; nothing to learn further down
+            if (extent.contains(keyExtent))
+                return;
+
+            partial = true;
+        }
+    }
+
+    if (partial)
+    {
+        if (key.getLOD() < maxLOD)
+        {
+            for (unsigned q = 0; q < 4; ++q)
+                addCoverage(key.createChildKey(q), extents, maxLOD);
+        }
+        return;
+    }
+
+    // nothing can exist here or below:
+    ScopedWriteLock lock(_mutex);
+    _states[pack(key.getLOD(), key.getTileX(), key.getTileY())] = EMPTY_SUBTREE;
+}
+
+void
+DataAvailability::clear()
+{
+    ScopedWriteLock lock(_mutex);
+    if (!_states.empty())
+    {
+        _states.clear();
+        ++_changes;
+    }
+}
+
+unsigned
+DataAvailability::size() const
+{
+    ScopedReadLock lock(_mutex);
+    return (unsigned)_states.size();
+}
+
+std::string
+DataAvailability::write()
+{
+    ScopedWriteLock lock(_mutex);
+
+    std::ostringstream buf;
+    buf << HEADER << ' ' << VERSION << ' ' << _states.size() << '\n' << std::hex;
+    for (auto& i : _states)
+    {
+        buf << i.first << ' ' << (unsigned)i.second << '\n';
+    }
+
+    _changes = 0u;
+    return buf.str();
+}
+
+bool
+DataAvailability::read(const std::string& data)
+{
+    std::istringstream in(data);
+
+    std::string header;
+    unsigned version = 0u;
+    std::size_t count = 0u;
+    in >> header >> version >> count;
+    if (in.fail() || header != HEADER || version != VERSION)
+        return false;
+
+    std::unordered_map<std::uint64_t, std::uint8_t> states;
+    states.reserve(count);
+
+    in >> std::hex;
+    std::uint64_t key;
+    unsigned state;
+    while (in >> key >> state)
+    {
+        if (state > EMPTY_SUBTREE)
+            return false;
+        states[key] = (std::uint8_t)state;
+    }
+
+    if (states.size() != count)
+        return false;
+
+    ScopedWriteLock lock(_mutex);
+    _states.swap(states);
+    _changes = 0u;
+    return true;
+}
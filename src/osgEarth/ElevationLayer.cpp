@@ -41,6 +41,7 @@ ElevationLayer::Options::getConfig() const
     conf.set("nodata_policy", "default",     _noDataPolicy, NODATA_INTERPOLATE );
     conf.set("nodata_policy", "interpolate", _noDataPolicy, NODATA_INTERPOLATE );
     conf.set("nodata_policy", "msl",         _noDataPolicy, NODATA_MSL );
+    conf.set("range_index", _rangeIndex);
     return conf;
 }
 
@@ -49,6 +50,7 @@ ElevationLayer::Options::fromConfig( const Config& conf )
 {
     _offset.init( false );
     _noDataPolicy.init( NODATA_INTERPOLATE );
+    _rangeIndex.init( true );
 
     conf.get("vdatum", verticalDatum() );
     conf.get("vsrs", verticalDatum() );    // back compat
@@ -56,6 +58,7 @@ ElevationLayer::Options::fromConfig( const Config& conf )
     conf.get("nodata_policy", "default",     _noDataPolicy, NODATA_INTERPOLATE );
     conf.get("nodata_policy", "interpolate", _noDataPolicy, NODATA_INTERPOLATE );
     conf.get("nodata_policy", "msl",         _noDataPolicy, NODATA_MSL );
+    conf.get("range_index", _rangeIndex);
 }
 
 //------------------------------------------------------------------------
@@ -84,6 +87,15 @@ namespace
 
         return true;
     }
+
+    // cache key for a serialized elevation range index
+    std::string getRangeIndexKey(const Profile* profile)
+    {
+        return Stringify() << std::hex << profile->getHorizSignature() << "_ranges";
+    }
+
+    // save an index once it has accumulated this many changes
+    const unsigned RANGE_INDEX_SAVE_THRESHOLD = 512u;
 }
 
 //------------------------------------------------------------------------
@@ -116,6 +128,18 @@ ElevationLayer::init()
     setRenderType(RENDERTYPE_NONE);
 }
 
+Status
+ElevationLayer::closeImplementation()
+{
+    saveElevationRanges(true);
+    {
+        Threading::ScopedMutexLock lock(layerMutex());
+        _rangeIndexes.clear();
+    }
+
+    return TileLayer::closeImplementation();
+}
+
 void
 ElevationLayer::setVisible(bool value)
 {
@@ -165,6 +189,101 @@ ElevationLayer::getNoDataPolicy() const
     return options().noDataPolicy().get();
 }
 
+void
+ElevationLayer::setRangeIndex(bool value)
+{
+    setOptionThatRequiresReopen(options().rangeIndex(), value);
+}
+
+bool
+ElevationLayer::getRangeIndex() const
+{
+    return options().rangeIndex().get();
+}
+
+ElevationRangeIndex*
+ElevationLayer::getElevationRangeIndex(const Profile* profile)
+{
+    if (!profile || options().rangeIndex() != true || isDynamic())
+        return nullptr;
+
+    std::string key = getRangeIndexKey(profile);
+
+    {
+        Threading::ScopedMutexLock lock(layerMutex());
+        RangeIndexMap::iterator i = _rangeIndexes.find(key);
+        if (i != _rangeIndexes.end())
+            return i->second.get();
+    }
+
+    osg::ref_ptr<ElevationRangeIndex> index = new ElevationRangeIndex(profile);
+
+    // resume the index stored with the cache bin if there is one:
+    CacheBin* bin = isOpen() ? getCacheBin(profile) : nullptr;
+    if (bin)
+    {
+        ReadResult rr = bin->readString(key, getReadOptions());
+        if (rr.succeeded() && !index->read(rr.getString()))
+        {
+            OE_WARN << LC << "Elevation range index appears to be corrupt; starting over" << std::endl;
+        }
+    }
+
+    Threading::ScopedMutexLock lock(layerMutex());
+    osg::ref_ptr<ElevationRangeIndex>& slot = _rangeIndexes[key];
+    if (!slot.valid())
+        slot = index.get();
+    return slot.get();
+}
+
+void
+ElevationLayer::recordElevationRange(const TileKey& key, const osg::HeightField* hf, bool fromCache)
+{
+    ElevationRangeIndex* index = getElevationRangeIndex(key.getProfile());
+    if (!index)
+        return;
+
+    // cached tiles were most likely indexed when they were created
+    if (fromCache && index->contains(key))
+        return;
+
+    index->add(key, hf);
+
+    if (index->getNumChanges() >= RANGE_INDEX_SAVE_THRESHOLD)
+    {
+        saveElevationRanges(false);
+    }
+}
+
+void
+ElevationLayer::saveElevationRanges(bool force)
+{
+    if (!getCacheSettings() || !getCacheSettings()->cachePolicy()->isCacheWriteable())
+        return;
+
+    std::vector<std::pair<std::string, osg::ref_ptr<ElevationRangeIndex>>> indexes;
+    {
+        Threading::ScopedMutexLock lock(layerMutex());
+        indexes.assign(_rangeIndexes.begin(), _rangeIndexes.end());
+    }
+
+    for (auto& i : indexes)
+    {
+        ElevationRangeIndex* index = i.second.get();
+        unsigned changes = index->getNumChanges();
+
+        if (changes >= RANGE_INDEX_SAVE_THRESHOLD || (force && changes > 0u))
+        {
+            CacheBin* bin = getCacheBin(index->getProfile());
+            if (bin)
+            {
+                osg::ref_ptr<StringObject> data = new StringObject(index->write());
+                bin->write(i.first, data.get(), getReadOptions());
+            }
+        }
+    }
+}
+
 void
 ElevationLayer::normalizeNoDataValues(osg::HeightField* hf) const
 {
@@ -474,6 +593,16 @@ ElevationLayer::createHeightFieldInKeyProfile(const TileKey& key, ProgressCallba
                 return GeoHeightField::INVALID;
             }
 
+            // Skip the source if we already know it has nothing for this key.
+            DataAvailability* availability = getDataAvailability(key.getProfile());
+            if (availability && availability->isEmpty(key))
+            {
+                if (cachedHF.valid())
+                    return GeoHeightField(cachedHF.get(), key.getExtent());
+                else
+                    return GeoHeightField::INVALID;
+            }
+
             if (key.getProfile()->isHorizEquivalentTo(profile.get()))
             {
                 result = createHeightFieldImplementation(key, progress);
@@ -492,6 +621,13 @@ ElevationLayer::createHeightFieldInKeyProfile(const TileKey& key, ProgressCallba
                 return GeoHeightField::INVALID;
             }
 
+            // Only a source that says it has nothing is remembered; errors
+            // (timeouts, server failures, a busy driver) may not recur.
+            if (availability && (result.valid() || result.getStatus().code() == Status::NoData))
+            {
+                recordDataAvailability(key, result.valid());
+            }
+
             // The const_cast is safe here because we just created the
             // heightfield from scratch...not from a cache.
             hf = const_cast<osg::HeightField*>(result.getHeightField());
@@ -518,7 +654,7 @@ ElevationLayer::createHeightFieldInKeyProfile(const TileKey& key, ProgressCallba
                 VerticalDatum::transform(
                     profile->getSRS()->getVerticalDatum(),    // from
                     key.getExtent().getSRS()->getVerticalDatum(),  // to
-                    key.getExtent(),
+                    key,
                     hf.get());
             }
 
@@ -556,6 +692,9 @@ ElevationLayer::createHeightFieldInKeyProfile(const TileKey& key, ProgressCallba
 
         if ( hf.valid() )
         {
+            // feed the min/max elevation index
+            recordElevationRange(key, hf.get(), fromCache);
+
             result = GeoHeightField( hf.get(), key.getExtent() );
         }
     }
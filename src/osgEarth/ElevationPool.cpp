@@ -1038,6 +1038,67 @@ ElevationPool::getTile(
     return out_tex.valid();
 }
 
+bool
+ElevationPool::getElevationRange(
+    const GeoExtent& extent,
+    unsigned lod,
+    float& out_min,
+    float& out_max,
+    bool* out_complete)
+{
+    if (out_complete)
+        *out_complete = false;
+
+    osg::ref_ptr<const Map> map;
+    if (!_map.lock(map) || !map->getProfile())
+        return false;
+
+    // ensure we are in sync with the map
+    sync(map.get(), nullptr);
+
+    ScopedAtomicCounter counter(_workers);
+
+    float baseMin = FLT_MAX, baseMax = -FLT_MAX;
+    float offsetMin = 0.0f, offsetMax = 0.0f;
+    bool complete = true;
+
+    for (auto& layer : _elevationLayers)
+    {
+        if (!layer->isOpen() || !layer->getEnabled())
+            continue;
+
+        ElevationRangeIndex* ranges = layer->getElevationRangeIndex(map->getProfile());
+
+        float layerMin, layerMax;
+        bool layerComplete = false;
+        if (ranges && ranges->getRange(extent, lod, layerMin, layerMax, &layerComplete))
+        {
+            if (layer->isOffset())
+            {
+                // offsets add to whatever is underneath
+                offsetMin += std::min(layerMin, 0.0f);
+                offsetMax += std::max(layerMax, 0.0f);
+            }
+            else
+            {
+                baseMin = std::min(baseMin, layerMin);
+                baseMax = std::max(baseMax, layerMax);
+            }
+        }
+
+        complete = complete && layerComplete;
+    }
+
+    if (baseMin > baseMax)
+        return false;
+
+    out_min = baseMin + offsetMin;
+    out_max = baseMax + offsetMax;
+    if (out_complete)
+        *out_complete = complete;
+    return true;
+}
+
 //...................................................................
 
 namespace osgEarth { namespace Internal
@@ -0,0 +1,297 @@
+/* -*-c++-*- */
+/* osgEarth - Geospatial SDK for OpenSceneGraph
+ * Copyright 2020 Pelican Mapping
+ * http://osgearth.org
+ *
+ * osgEarth is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+#include <osgEarth/ElevationRangeIndex>
+#include <osgEarth/Profile>
+#include <osgEarth/Notify>
+#include <sstream>
+#include <cmath>
+#include <cfloat>
+#include <algorithm>
+
+using namespace osgEarth;
+using namespace osgEarth::Threading;
+
+#define LC "[ElevationRangeIndex] "
+
+namespace
+{
+    const char* HEADER = "oe_elevation_ranges";
+    const unsigned VERSION = 1u;
+
+    // most keys to visit in one extent query
+    const double MAX_QUERY_KEYS = 256.0;
+}
+
+ElevationRangeIndex::ElevationRangeIndex(const Profile* profile) :
+    _profile(profile),
+    _changes(0u)
+{
+    //nop
+}
+
+std::uint64_t
+ElevationRangeIndex::pack(unsigned lod, unsigned x, unsigned y)
+{
+    // 6 bits of LOD, 29 bits each of X and Y
+    return
+        ((std::uint64_t)(lod & 0x3f) << 58) |
+        ((std::uint64_t)(x & 0x1fffffff) << 29) |
+        ((std::uint64_t)(y & 0x1fffffff));
+}
+
+const ElevationRangeIndex::Range*
+ElevationRangeIndex::find(unsigned lod, unsigned x, unsigned y, bool* out_exact) const
+{
+    if (out_exact)
+        *out_exact = true;
+
+    for(;;)
+    {
+        auto i = _ranges.find(pack(lod, x, y));
+        if (i != _ranges.end())
+            return &i->second;
+
+        if (out_exact)
+            *out_exact = false;
+
+        if (lod == 0u)
+            return nullptr;
+
+        --lod, x >>= 1, y >>= 1;
+    }
+}
+
+void
+ElevationRangeIndex::add(const TileKey& key, float minHeight, float maxHeight)
+{
+    if (!key.valid() || minHeight > maxHeight)
+        return;
+
+    unsigned lod = key.getLOD();
+    unsigned x = key.getTileX();
+    unsigned y = key.getTileY();
+
+    ScopedWriteLock lock(_mutex);
+
+    auto i = _ranges.find(pack(lod, x, y));
+    if (i == _ranges.end())
+    {
+        _ranges[pack(lod, x, y)] = Range{ minHeight, maxHeight };
+        ++_changes;
+    }
+    else if (minHeight < i->second._min || maxHeight > i->second._max)
+    {
+        i->second._min = std::min(i->second._min, minHeight);
+        i->second._max = std::max(i->second._max, maxHeight);
+        ++_changes;
+    }
+
+    // widen the recorded ancestors so they enclose this key
+    while (lod > 0u)
+    {
+        --lod, x >>= 1, y >>= 1;
+        i = _ranges.find(pack(lod, x, y));
+        if (i != _ranges.end())
+        {
+            if (minHeight < i->second._min || maxHeight > i->second._max)
+            {
+                i->second._min = std::min(i->second._min, minHeight);
+                i->second._max = std::max(i->second._max, maxHeight);
+                ++_changes;
+            }
+        }
+    }
+}
+
+bool
+ElevationRangeIndex::add(const TileKey& key, const osg::HeightField* hf)
+{
+    if (!hf)
+        return false;
+
+    float minHeight = FLT_MAX, maxHeight = -FLT_MAX;
+
+    const osg::HeightField::HeightList& heights = hf->getHeightList();
+    for (auto h : heights)
+    {
+        if (h != NO_DATA_VALUE)
+        {
+            minHeight = std::min(minHeight, h);
+            maxHeight = std::max(maxHeight, h);
+        }
+    }
+
+    if (minHeight > maxHeight)
+        return false;
+
+    add(key, minHeight, maxHeight);
+    return true;
+}
+
+bool
+ElevationRangeIndex::contains(const TileKey& key) const
+{
+    if (!key.valid())
+        return false;
+
+    ScopedReadLock lock(_mutex);
+    return _ranges.find(pack(key.getLOD(), key.getTileX(), key.getTileY())) != _ranges.end();
+}
+
+bool
+ElevationRangeIndex::getRange(const TileKey& key, float& out_min, float& out_max) const
+{
+    if (!key.valid())
+        return false;
+
+    ScopedReadLock lock(_mutex);
+
+    const Range* range = find(key.getLOD(), key.getTileX(), key.getTileY());
+    if (!range)
+        return false;
+
+    out_min = range->_min;
+    out_max = range->_max;
+    return true;
+}
+
+bool
+ElevationRangeIndex::getRange(
+    const GeoExtent& extent,
+    unsigned lod,
+    float& out_min,
+    float& out_max,
+    bool* out_complete) const
+{
+    if (out_complete)
+        *out_complete = false;
+
+    if (!_profile.valid() || !extent.isValid())
+        return false;
+
+    GeoExtent local = extent;
+    if (!_profile->getSRS()->isHorizEquivalentTo(extent.getSRS()))
+    {
+        local = _profile->clampAndTransformExtent(extent);
+        if (!local.isValid())
+            return false;
+    }
+
+    // coarsen the query until it touches a manageable number of keys;
+    // ancestors are widened by their children so this only loosens the answer
+    while (lod > 0u)
+    {
+        double tw, th;
+        _profile->getTileDimensions(lod, tw, th);
+        if ((local.width() / tw + 1.0) * (local.height() / th + 1.0) <= MAX_QUERY_KEYS)
+            break;
+        --lod;
+    }
+
+    std::vector<TileKey> keys;
+    _profile->getIntersectingTiles(local, lod, keys);
+
+    float minHeight = FLT_MAX, maxHeight = -FLT_MAX;
+    bool complete = true;
+    {
+        ScopedReadLock lock(_mutex);
+
+        for (auto& key : keys)
+        {
+            // an ancestor's range only covers what had loaded when it
+            // was recorded, so only a key's own range counts as complete
+            bool exact = false;
+            const Range* range = find(key.getLOD(), key.getTileX(), key.getTileY(), &exact);
+            if (range)
+            {
+                minHeight = std::min(minHeight, range->_min);
+                maxHeight = std::max(maxHeight, range->_max);
+            }
+            complete = complete && exact;
+        }
+    }
+
+    if (minHeight > maxHeight)
+        return false;
+
+    out_min = minHeight;
+    out_max = maxHeight;
+    if (out_complete)
+        *out_complete = complete;
+    return true;
+}
+
+unsigned
+ElevationRangeIndex::size() const
+{
+    ScopedReadLock lock(_mutex);
+    return (unsigned)_ranges.size();
+}
+
+std::string
+ElevationRangeIndex::write()
+{
+    ScopedWriteLock lock(_mutex);
+
+    // whole meters, rounded outward so the stored ranges stay conservative
+    std::ostringstream buf;
+    buf << HEADER << ' ' << VERSION << ' ' << _ranges.size() << '\n';
+    for (auto& i : _ranges)
+    {
+        buf << std::hex << i.first << std::dec << ' '
+            << (long)std::floor(i.second._min) << ' '
+            << (long)std::ceil(i.second._max) << '\n';
+    }
+
+    _changes = 0u;
+    return buf.str();
+}
+
+bool
+ElevationRangeIndex::read(const std::string& data)
+{
+    std::istringstream in(data);
+
+    std::string header;
+    unsigned version = 0u;
+    std::size_t count = 0u;
+    in >> header >> version >> count;
+    if (in.fail() || header != HEADER || version != VERSION)
+        return false;
+
+    std::unordered_map<std::uint64_t, Range> ranges;
+    ranges.reserve(count);
+
+    std::uint64_t key;
+    long minHeight, maxHeight;
+    while (in >> std::hex >> key >> std::dec >> minHeight >> maxHeight)
+    {
+        if (minHeight > maxHeight)
+            return false;
+        ranges[key] = Range{ (float)minHeight, (float)maxHeight };
+    }
+
+    if (ranges.size() != count)
+        return false;
+
+    ScopedWriteLock lock(_mutex);
+    _ranges.swap(ranges);
+    _changes = 0u;
+    return true;
+}
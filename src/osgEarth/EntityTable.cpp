@@ -0,0 +1,219 @@
+/* -*-c++-*- */
+/* osgEarth - Geospatial SDK for OpenSceneGraph
+ * Copyright 2020 Pelican Mapping
+ * http://osgearth.org
+ *
+ * osgEarth is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+#include <osgEarth/EntityTable>
+#include <osgEarth/Map>
+#include <osgEarth/ElevationPool>
+#include <osgEarth/Metrics>
+#include <cmath>
+
+#define LC "[EntityTable] "
+
+using namespace osgEarth;
+
+EntityTable::EntityTable(const SpatialReference* srs) :
+    _srs(srs),
+    _altitudeMode(ALTMODE_ABSOLUTE),
+    _clampingResolution(30.0, Units::METERS)
+{
+    //nop
+}
+
+void
+EntityTable::resize(std::size_t count)
+{
+    _x.resize(count, 0.0);
+    _y.resize(count, 0.0);
+    _z.resize(count, 0.0);
+    _heading.resize(count, 0.0f);
+}
+
+void
+EntityTable::setMap(const Map* map)
+{
+    _map = map;
+}
+
+bool
+EntityTable::clamp()
+{
+    OE_PROFILING_ZONE;
+
+    osg::ref_ptr<const Map> map;
+    if (_map.lock(map) == false || map->getSRS() == nullptr)
+        return false;
+
+    const std::size_t n = size();
+    _points.resize(n);
+    for (std::size_t i = 0; i < n; ++i)
+        _points[i].set(_x[i], _y[i], 0.0);
+
+    if (!_srs->isHorizEquivalentTo(map->getSRS()))
+    {
+        if (!_srs->transform(_points, map->getSRS()))
+            return false;
+    }
+
+    // one query for the whole table; the pool keeps its rasters
+    // cached from one point to the next
+    ElevationPool::WorkingSet ws;
+    if (map->getElevationPool()->sampleMapCoords(_points, _clampingResolution, &ws, nullptr) < 0)
+        return false;
+
+    for (std::size_t i = 0; i < n; ++i)
+    {
+        double h = _points[i].z();
+        _hae[i] += (h != NO_DATA_VALUE ? h : 0.0);
+    }
+    return true;
+}
+
+bool
+EntityTable::update()
+{
+    OE_PROFILING_ZONE;
+
+    if (!_srs.valid())
+        return false;
+
+    const std::size_t n = size();
+
+    _lon.resize(n);
+    _lat.resize(n);
+    _hae.resize(n);
+    _wx.resize(n);
+    _wy.resize(n);
+    _wz.resize(n);
+    _matrices.resize(n);
+
+    if (n == 0)
+        return true;
+
+    // Heights, clamped to the terrain if necessary. These stay in the
+    // table's vertical frame until the geodetic transform below.
+    _hae.assign(_z.begin(), _z.end());
+
+    if (_altitudeMode == ALTMODE_RELATIVE && !clamp())
+    {
+        OE_DEBUG << LC << "Failed to clamp entities to the terrain" << std::endl;
+    }
+
+    // Geodetic coordinates. A geodetic table needs no transform at all;
+    // anything else goes through a single bulk SRS transform.
+    const SpatialReference* geodetic = _srs->getGeodeticSRS();
+
+    if (_srs->isGeodetic())
+    {
+        for (std::size_t i = 0; i < n; ++i)
+        {
+            _lon[i] = osg::DegreesToRadians(_x[i]);
+            _lat[i] = osg::DegreesToRadians(_y[i]);
+        }
+    }
+    else
+    {
+        _points.resize(n);
+        for (std::size_t i = 0; i < n; ++i)
+            _points[i].set(_x[i], _y[i], _hae[i]);
+
+        if (!_srs->transform(_points, geodetic))
+        {
+            OE_WARN << LC << "Failed to transform entities to geodetic" << std::endl;
+            return false;
+        }
+
+        for (std::size_t i = 0; i < n; ++i)
+        {
+            _lon[i] = osg::DegreesToRadians(_points[i].x());
+            _lat[i] = osg::DegreesToRadians(_points[i].y());
+            _hae[i] = _points[i].z();
+        }
+    }
+
+    // Geodetic to geocentric. The loop is branch-free over the columns
+    // so the compiler can vectorize it.
+    const Ellipsoid& ellipsoid = geodetic->getEllipsoid();
+    const double a = ellipsoid.getSemiMajorAxis();
+    const double b = ellipsoid.getSemiMinorAxis();
+    const double e2 = 1.0 - (b*b) / (a*a);
+
+    double* lon = _lon.data();
+    double* lat = _lat.data();
+    const double* hae = _hae.data();
+    double* wx = _wx.data();
+    double* wy = _wy.data();
+    double* wz = _wz.data();
+
+    // reuse the lon/lat columns to hold the sines and cosines that
+    // the instance matrices need
+    _points.resize(n);
+    double sumx = 0.0, sumy = 0.0, sumz = 0.0;
+
+    for (std::size_t i = 0; i < n; ++i)
+    {
+        const double sinLat = std::sin(lat[i]);
+        const double cosLat = std::cos(lat[i]);
+        const double sinLon = std::sin(lon[i]);
+        const double cosLon = std::cos(lon[i]);
+        const double N = a / std::sqrt(1.0 - e2*sinLat*sinLat);
+
+        wx[i] = (N + hae[i]) * cosLat * cosLon;
+        wy[i] = (N + hae[i]) * cosLat * sinLon;
+        wz[i] = (N*(1.0 - e2) + hae[i]) * sinLat;
+
+        sumx += wx[i];
+        sumy += wy[i];
+        sumz += wz[i];
+
+        lon[i] = sinLon;
+        lat[i] = sinLat;
+        _points[i].set(cosLon, cosLat, 0.0);
+    }
+
+    _origin.set(sumx / (double)n, sumy / (double)n, sumz / (double)n);
+
+    // Instance matrices: rotate the local east/north/up frame by the
+    // heading and translate relative to the origin.
+    const float* heading = _heading.data();
+
+    for (std::size_t i = 0; i < n; ++i)
+    {
+        const double sinLon = lon[i], cosLon = _points[i].x();
+        const double sinLat = lat[i], cosLat = _points[i].y();
+
+        const double h = osg::DegreesToRadians((double)heading[i]);
+        const double sinH = std::sin(h);
+        const double cosH = std::cos(h);
+
+        const osg::Vec3d east(-sinLon, cosLon, 0.0);
+        const osg::Vec3d north(-sinLat*cosLon, -sinLat*sinLon, cosLat);
+        const osg::Vec3d up(cosLat*cosLon, cosLat*sinLon, sinLat);
+
+        // heading is clockwise from north
+        const osg::Vec3d right = east*cosH - north*sinH;
+        const osg::Vec3d forward = north*cosH + east*sinH;
+
+        _matrices[i].set(
+            right.x(), right.y(), right.z(), 0.0,
+            forward.x(), forward.y(), forward.z(), 0.0,
+            up.x(), up.y(), up.z(), 0.0,
+            wx[i] - _origin.x(), wy[i] - _origin.y(), wz[i] - _origin.z(), 1.0);
+    }
+
+    return true;
+}
@@ -50,6 +50,7 @@ FeatureLevel::fromConfig( const Config& conf )
     conf.get( "max_range", _maxRange );
     conf.get( "style",     _styleName ); 
     conf.get( "class",     _styleName ); // alias
+    conf.get( "resolution", _resolution );
 }
 
 Config
@@ -59,6 +60,7 @@ FeatureLevel::getConfig() const
     conf.set( "min_range", _minRange );
     conf.set( "max_range", _maxRange );
     conf.set( "style",     _styleName );
+    conf.set( "resolution", _resolution );
     return conf;
 }
 
@@ -69,6 +71,7 @@ _tileSizeFactor( 3.5f ),
 _minRange      ( 0.0f ),
 _maxRange      ( 0.0f ),
 _cropFeatures  ( false ),
+_simplify      ( false ),
 _priorityOffset( 0.0f ),
 _priorityScale ( 1.0f ),
 _minExpiryTime ( 0.0f ),
@@ -83,6 +86,7 @@ FeatureDisplayLayout::fromConfig( const Config& conf )
     conf.get( "tile_size",        _tileSize );
     conf.get( "tile_size_factor", _tileSizeFactor );
     conf.get( "crop_features",    _cropFeatures );
+    conf.get( "simplify",         _simplify );
     conf.get( "priority_offset",  _priorityOffset );
     conf.get( "priority_scale",   _priorityScale );
     conf.get( "min_expiry_time",  _minExpiryTime );
@@ -101,6 +105,7 @@ FeatureDisplayLayout::getConfig() const
     conf.set( "tile_size",        _tileSize );
     conf.set( "tile_size_factor", _tileSizeFactor );
     conf.set( "crop_features",    _cropFeatures );
+    conf.set( "simplify",         _simplify );
     conf.set( "priority_offset",  _priorityOffset );
     conf.set( "priority_scale",   _priorityScale );
     conf.set( "min_expiry_time",  _minExpiryTime );
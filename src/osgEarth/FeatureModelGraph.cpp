@@ -318,6 +318,11 @@ namespace
         p->setMaxRange(maxRange);
         p->setPriorityScale(layout.priorityScale().get());
         p->setSceneGraphCallbacks(sgCallbacks);
+
+        static unsigned s_residencySubsystem =
+            Registry::residencyManager()->addSubsystem("FeatureModelGraph");
+        p->setResidencySubsystem(s_residencySubsystem);
+
         return p;
 
 #else
@@ -453,6 +458,7 @@ FeatureModelGraph::FeatureModelGraph(const FeatureModelOptions& options) :
     _options(options),
     _featureExtentClamped(false),
     _useTiledSource(false),
+    _simplifyFeatures(false),
     _blacklistMutex("FMG BlackList(OE)"),
     _isActive(false)
 {
@@ -583,6 +589,53 @@ FeatureModelGraph::open()
     // A data source is either Tiled or Not Tiled. Set things up differently depending.
     _useTiledSource = featureProfile->isTiled();
 
+    // A non-tiled source returns the same geometry for a feature in every tile,
+    // so a tile can crop from its parent tile's cropped result. Cells are keyed
+    // on a quadtree over the usable extent (see getClipKey).
+    if (!featureProfile->isTiled() && _options.layout().isSet() && _options.layout()->cropFeatures() == true)
+    {
+        _clipProfile = Profile::create(
+            _usableFeatureExtent.getSRS(),
+            _usableFeatureExtent.xMin(), _usableFeatureExtent.yMin(),
+            _usableFeatureExtent.xMax(), _usableFeatureExtent.yMax(),
+            1u, 1u);
+
+        if (_clipProfile.valid())
+        {
+            _clipCache = new ClipCache();
+        }
+    }
+
+    // Per-level simplification ranks vertices over the whole source, so it
+    // needs a non-tiled source with explicit levels.
+    _simplifyFeatures =
+        !featureProfile->isTiled() &&
+        _options.layout().isSet() &&
+        _options.layout()->simplify() == true &&
+        _options.layout()->getNumLevels() > 0;
+
+    // Ranking reads the whole source, so start it now in the background
+    // rather than on the first pager thread to need it. Abandoning the
+    // future (see shutdown) cancels the build.
+    if (_simplifyFeatures)
+    {
+        osg::ref_ptr<FeatureSource> source = _session->getFeatureSource();
+        _simplificationIndex = Job(JobArena::get("oe.simplificationindex")).dispatch<osg::ref_ptr<SimplificationIndex>>(
+            [source](Cancelable* c)
+            {
+                osg::ref_ptr<SimplificationIndex> index = new SimplificationIndex();
+                osg::ref_ptr<ProgressCallback> progress = new ProgressCallback(c);
+                Status status = index->build(source.get(), progress.get());
+                if (status.isError())
+                {
+                    if (!progress->isCanceled())
+                        OE_WARN << LC << "Simplification disabled: " << status.message() << std::endl;
+                    return osg::ref_ptr<SimplificationIndex>();
+                }
+                return index;
+            });
+    }
+
     if (featureProfile->isTiled())
     {
         float maxRangeAtFirstLevel = FLT_MAX;
@@ -793,6 +846,9 @@ FeatureModelGraph::shutdown()
 {
     _isActive = false;
 
+    // cancels a simplification index build still in progress
+    _simplificationIndex.abandon();
+
     // Block until all active pager tasks have returned/canceled
     //ScopedWriteLock waiter(getSync());
 }
@@ -873,7 +929,19 @@ FeatureModelGraph::getBoundInWorldCoords(const GeoExtent& extent, const Profile*
         if (map.valid())
         {
             map->getLayers<ElevationLayer>(elevationLayers);
-            if (!elevationLayers.empty())
+            float measuredMin, measuredMax;
+            bool complete = false;
+
+            // Prefer the measured range of the map's own elevation data:
+            if (!elevationLayers.empty() &&
+                map->getElevationPool()->getElevationRange(workingExtent, lod, measuredMin, measuredMax, &complete) &&
+                complete)
+            {
+                minElevation = osg::maximum(measuredMin, -500.0f);
+                maxElevation = measuredMax + 100.0f;
+            }
+
+            else if (!elevationLayers.empty())
             {
                 // Get the approximate elevation range if we have elevation data in the map
                 lod = osg::clampBetween(lod, 0u, ElevationRanges::getMaxLevel());
@@ -1269,6 +1337,87 @@ namespace
     }
 }
 
+bool
+FeatureModelGraph::getCellKey(const Bounds& cellBounds, unsigned& lod, unsigned& x, unsigned& y) const
+{
+    // Non-tiled cells come from s_getTileExtent, which halves the usable extent
+    // at each LOD and numbers rows from the bottom. Recover the cell's LOD and
+    // indices from its bounds.
+    double fullWidth = _usableFeatureExtent.width();
+    double cellWidth = cellBounds.xMax() - cellBounds.xMin();
+    if (fullWidth <= 0.0 || cellWidth <= 0.0)
+        return false;
+
+    double lodf = log(fullWidth / cellWidth) / log(2.0);
+    lod = (unsigned)osg::round(lodf);
+    if (!osg::equivalent(lodf, (double)lod, 1e-3) || lod > 30u)
+        return false;
+
+    double w = fullWidth / (double)(1u << lod);
+    double h = _usableFeatureExtent.height() / (double)(1u << lod);
+    double xf = osg::round((cellBounds.xMin() - _usableFeatureExtent.xMin()) / w);
+    double yf = osg::round((cellBounds.yMin() - _usableFeatureExtent.yMin()) / h);
+    unsigned tiles = 1u << lod;
+    if (xf < 0.0 || yf < 0.0 || xf >= (double)tiles || yf >= (double)tiles)
+        return false;
+
+    x = (unsigned)xf;
+    y = (unsigned)yf;
+    return true;
+}
+
+SimplificationIndex*
+FeatureModelGraph::getSimplificationIndex(ProgressCallback* progress)
+{
+    // Cells that load before the build (started in open) finishes wait for
+    // it, unless their own load is canceled first.
+    return _simplificationIndex.join(progress).get();
+}
+
+void
+FeatureModelGraph::simplify(FeatureList& features, const Bounds& cellBounds)
+{
+    unsigned lod, x, y;
+    if (!getCellKey(cellBounds, lod, x, y) || lod >= _lodmap.size() || !_lodmap[lod])
+        return;
+
+    const FeatureLevel* level = _lodmap[lod];
+
+    // Smallest detail worth drawing, in meters: the level's resolution, or
+    // roughly one pixel of a full-screen view at the level's max range.
+    double resolution = 0.0;
+    if (level->resolution().isSet())
+        resolution = level->resolution().get();
+    else if (level->maxRange().isSet() && level->maxRange().get() < FLT_MAX)
+        resolution = level->maxRange().get() * 0.001;
+
+    if (resolution <= 0.0)
+        return;
+
+    osg::ref_ptr<ProgressCallback> progress = new MyProgressCallback(this, _session.get());
+    SimplificationIndex* index = getSimplificationIndex(progress.get());
+    if (!index || index->size() == 0u)
+        return;
+
+    // convert to feature units at the middle of the cell
+    const SpatialReference* srs = _usableFeatureExtent.getSRS();
+    GeoPoint center(srs, 0.5*(cellBounds.xMin() + cellBounds.xMax()), 0.5*(cellBounds.yMin() + cellBounds.yMax()), 0.0, ALTMODE_ABSOLUTE);
+    GeoPoint centerGeo = center.transform(srs->getGeographicSRS());
+    double tolerance = SpatialReference::transformUnits(
+        Distance(resolution, Units::METERS),
+        srs,
+        centerGeo.isValid() ? centerGeo.y() : 0.0);
+
+    // a vertex that moves the outline by less than the tolerance spans a
+    // triangle of about half the tolerance squared
+    double minArea = 0.5 * tolerance * tolerance;
+
+    for (auto& feature : features)
+    {
+        index->simplify(feature.get(), minArea);
+    }
+}
+
 osg::Group*
 FeatureModelGraph::readTileFromCache(const std::string&    cacheKey,
     const osgDB::Options* readOptions)
@@ -1856,6 +2005,13 @@ FeatureModelGraph::createStyleGroup(const Style&          style,
 
     FilterContext context(contextPrototype);
 
+    // Drop the vertices too small to see at this cell's level. This comes
+    // before cropping, which would change the geometry the ranks describe.
+    if (_simplifyFeatures && query.bounds().isSet())
+    {
+        simplify(workingSet, query.bounds().get());
+    }
+
     // First Crop the feature set to the working extent.
     // Note: There is an obscure edge case that can happen is a feature's centroid
     // falls exactly on the crop extent boundary. In that case the feature can
@@ -1865,6 +2021,14 @@ FeatureModelGraph::createStyleGroup(const Style&          style,
         _options.layout().isSet() && _options.layout()->cropFeatures() == true ?
         CropFilter::METHOD_CROPPING : CropFilter::METHOD_CENTROID);
 
+    unsigned lod, x, y;
+    if (_clipCache.valid() && query.bounds().isSet() && getCellKey(query.bounds().get(), lod, x, y))
+    {
+        // TileKeys number rows from the top
+        crop.setClipCache(_clipCache.get());
+        crop.tileKey() = TileKey(lod, x, (1u << lod) - y - 1u, _clipProfile.get());
+    }
+
     unsigned sizeBefore = workingSet.size();
 
     context = crop.push(workingSet, context);
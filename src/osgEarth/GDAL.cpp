@@ -37,6 +37,10 @@
 #include <sstream>
 #include <stdlib.h>
 #include <memory.h>
+#include <cmath>
+#include <algorithm>
+#include <mutex>
+#include <chrono>
 
 #include <gdal_priv.h>
 #include <gdalwarper.h>
@@ -442,11 +446,51 @@ namespace osgEarth
 
 //...................................................................
 
+namespace
+{
+    // Opens an http(s) raster through GDAL's /vsicurl/ file system, which
+    // fetches just the byte ranges it needs (a cloud-optimized GeoTIFF's
+    // header, then only the internal tiles and overviews that are read)
+    // instead of downloading the whole file. Returns NULL for local files
+    // or if the server can't be read that way.
+    GDALDataset* openRemote(const std::string& input)
+    {
+        if (!startsWith(input, "http://") && !startsWith(input, "https://"))
+            return NULL;
+
+        static std::once_flag s_configOnce;
+        std::call_once(s_configOnce, []()
+        {
+            // let GDAL combine adjacent tile requests, unless the user says otherwise
+            if (CPLGetConfigOption("GDAL_HTTP_MERGE_CONSECUTIVE_RANGES", NULL) == NULL)
+                CPLSetConfigOption("GDAL_HTTP_MERGE_CONSECUTIVE_RANGES", "YES");
+        });
+
+        // don't probe the server for sidecar files on open
+        bool setReadDir = CPLGetConfigOption("GDAL_DISABLE_READDIR_ON_OPEN", NULL) == NULL;
+        if (setReadDir)
+            CPLSetThreadLocalConfigOption("GDAL_DISABLE_READDIR_ON_OPEN", "EMPTY_DIR");
+
+        std::string path = "/vsicurl/" + input;
+        GDALDataset* ds = (GDALDataset*)GDALOpen(path.c_str(), GA_ReadOnly);
+
+        if (setReadDir)
+            CPLSetThreadLocalConfigOption("GDAL_DISABLE_READDIR_ON_OPEN", NULL);
+
+        if (ds)
+        {
+            OE_DEBUG << LC << "Opened " << input << " with range reads" << std::endl;
+        }
+        return ds;
+    }
+}
+
 GDAL::Driver::Driver() :
     _srcDS(NULL),
     _warpedDS(NULL),
     _maxDataLevel(30),
-    _linearUnits(1.0)
+    _linearUnits(1.0),
+    _useReadWindow(true)
 {
     _threadId = osgEarth::Threading::getCurrentThreadId();
 }
@@ -540,7 +584,9 @@ GDAL::Driver::open(
         }
 
         // Create the source dataset:
-        _srcDS = (GDALDataset*)GDALOpen(input.c_str(), GA_ReadOnly);
+        _srcDS = openRemote(input);
+        if (!_srcDS)
+            _srcDS = (GDALDataset*)GDALOpen(input.c_str(), GA_ReadOnly);
         if (_srcDS)
         {
             char **subDatasets = _srcDS->GetMetadata("SUBDATASETS");
@@ -692,6 +738,16 @@ GDAL::Driver::open(
         return Status::Error("Failed to create a final sampling dataset");
     }
 
+    // Drivers opened on the same source decode identical blocks, so they
+    // can share them. (An external dataset has no name to key them on.)
+    if (useExternalDataset == false)
+    {
+        _blockCacheKey = Stringify()
+            << source
+            << '#' << (gdalOptions().subDataSet().isSet() ? gdalOptions().subDataSet().get() : 0u)
+            << (_warpedDS != _srcDS ? "#warped" : "");
+    }
+
     // calcluate the inverse of the geotransform:
     GDALInvGeoTransform(_geotransform, _invtransform);
 
@@ -854,8 +910,8 @@ GDAL::Driver::geoToPixel(double geoX, double geoY, double &x, double &y)
 
 }
 
-bool
-GDAL::Driver::isValidValue(float v, GDALRasterBand* band)
+float
+GDAL::Driver::getBandNoDataValue(GDALRasterBand* band)
 {
     float bandNoData = -32767.0f;
     int success;
@@ -864,7 +920,18 @@ GDAL::Driver::isValidValue(float v, GDALRasterBand* band)
     {
         bandNoData = value;
     }
+    return bandNoData;
+}
 
+bool
+GDAL::Driver::isValidValue(float v, GDALRasterBand* band)
+{
+    return isValidValue(v, getBandNoDataValue(band));
+}
+
+bool
+GDAL::Driver::isValidValue(float v, float bandNoData) const
+{
     //Check to see if the value is equal to the bands specified no data
     if (bandNoData == v)
         return false;
@@ -883,11 +950,16 @@ GDAL::Driver::isValidValue(float v, GDALRasterBand* band)
     return true;
 }
 
+// Interpolates the value at a geo location. "fetch(col, row)" returns a pixel
+// of the given grid and "valid(value)" tells whether a pixel value is usable.
+template<typename FETCH, typename VALID>
 float
-GDAL::Driver::getInterpolatedValue(GDALRasterBand* band, double x, double y, bool applyOffset)
+GDAL::Driver::interpolate(double x, double y, bool applyOffset, const PixelGrid& grid, FETCH& fetch, VALID& valid)
 {
     double r, c;
     geoToPixel(x, y, c, r);
+    c *= grid._scaleX;
+    r *= grid._scaleY;
 
     if (applyOffset)
     {
@@ -902,31 +974,31 @@ GDAL::Driver::getInterpolatedValue(GDALRasterBand* band, double x, double y, boo
         {
             c = 0;
         }
-        else if (c > _warpedDS->GetRasterXSize() - 1 && c <= _warpedDS->GetRasterXSize() - 0.5)
+        else if (c > grid._width - 1 && c <= grid._width - 0.5)
         {
-            c = _warpedDS->GetRasterXSize() - 1;
+            c = grid._width - 1;
         }
 
         if (r < 0 && r >= -0.5)
         {
             r = 0;
         }
-        else if (r > _warpedDS->GetRasterYSize() - 1 && r <= _warpedDS->GetRasterYSize() - 0.5)
+        else if (r > grid._height - 1 && r <= grid._height - 0.5)
         {
-            r = _warpedDS->GetRasterYSize() - 1;
+            r = grid._height - 1;
         }
     }
 
     float result = 0.0f;
 
     //If the location is outside of the pixel values of the dataset, just return 0
-    if (c < 0 || r < 0 || c > _warpedDS->GetRasterXSize() - 1 || r > _warpedDS->GetRasterYSize() - 1)
+    if (c < 0 || r < 0 || c > grid._width - 1 || r > grid._height - 1)
         return NO_DATA_VALUE;
 
     if (gdalOptions().interpolation() == INTERP_NEAREST)
     {
-        rasterIO(band, GF_Read, (int)osg::round(c), (int)osg::round(r), 1, 1, &result, 1, 1, GDT_Float32, 0, 0);
-        if (!isValidValue(result, band))
+        result = fetch((int)osg::round(c), (int)osg::round(r));
+        if (!valid(result))
         {
             return NO_DATA_VALUE;
         }
@@ -934,21 +1006,21 @@ GDAL::Driver::getInterpolatedValue(GDALRasterBand* band, double x, double y, boo
     else
     {
         int rowMin = osg::maximum((int)floor(r), 0);
-        int rowMax = osg::maximum(osg::minimum((int)ceil(r), (int)(_warpedDS->GetRasterYSize() - 1)), 0);
+        int rowMax = osg::maximum(osg::minimum((int)ceil(r), (int)(grid._height - 1)), 0);
         int colMin = osg::maximum((int)floor(c), 0);
-        int colMax = osg::maximum(osg::minimum((int)ceil(c), (int)(_warpedDS->GetRasterXSize() - 1)), 0);
+        int colMax = osg::maximum(osg::minimum((int)ceil(c), (int)(grid._width - 1)), 0);
 
         if (rowMin > rowMax) rowMin = rowMax;
         if (colMin > colMax) colMin = colMax;
 
         float urHeight, llHeight, ulHeight, lrHeight;
 
-        rasterIO(band, GF_Read, colMin, rowMin, 1, 1, &llHeight, 1, 1, GDT_Float32, 0, 0);
-        rasterIO(band, GF_Read, colMin, rowMax, 1, 1, &ulHeight, 1, 1, GDT_Float32, 0, 0);
-        rasterIO(band, GF_Read, colMax, rowMin, 1, 1, &lrHeight, 1, 1, GDT_Float32, 0, 0);
-        rasterIO(band, GF_Read, colMax, rowMax, 1, 1, &urHeight, 1, 1, GDT_Float32, 0, 0);
+        llHeight = fetch(colMin, rowMin);
+        ulHeight = fetch(colMin, rowMax);
+        lrHeight = fetch(colMax, rowMin);
+        urHeight = fetch(colMax, rowMax);
 
-        if ((!isValidValue(urHeight, band)) || (!isValidValue(llHeight, band)) || (!isValidValue(ulHeight, band)) || (!isValidValue(lrHeight, band)))
+        if ((!valid(urHeight)) || (!valid(llHeight)) || (!valid(ulHeight)) || (!valid(lrHeight)))
         {
             return NO_DATA_VALUE;
         }
@@ -1001,6 +1073,177 @@ GDAL::Driver::getInterpolatedValue(GDALRasterBand* band, double x, double y, boo
     return result;
 }
 
+float
+GDAL::Driver::getInterpolatedValue(GDALRasterBand* band, double x, double y, bool applyOffset)
+{
+    auto fetch = [&](int col, int row)
+    {
+        float value;
+        rasterIO(band, GF_Read, col, row, 1, 1, &value, 1, 1, GDT_Float32, 0, 0);
+        return value;
+    };
+
+    auto valid = [&](float value)
+    {
+        return isValidValue(value, band);
+    };
+
+    PixelGrid grid;
+    grid._width = _warpedDS->GetRasterXSize();
+    grid._height = _warpedDS->GetRasterYSize();
+
+    return interpolate(x, y, applyOffset, grid, fetch, valid);
+}
+
+bool
+GDAL::Driver::readPixelWindow(
+    GDALRasterBand* band,
+    double xmin, double ymin, double xmax, double ymax,
+    unsigned tileSize,
+    PixelWindow& out)
+{
+    int width = _warpedDS->GetRasterXSize();
+    int height = _warpedDS->GetRasterYSize();
+
+    double c[4], r[4];
+    geoToPixel(xmin, ymin, c[0], r[0]);
+    geoToPixel(xmax, ymin, c[1], r[1]);
+    geoToPixel(xmin, ymax, c[2], r[2]);
+    geoToPixel(xmax, ymax, c[3], r[3]);
+
+    double cmin = std::min(std::min(c[0], c[1]), std::min(c[2], c[3]));
+    double cmax = std::max(std::max(c[0], c[1]), std::max(c[2], c[3]));
+    double rmin = std::min(std::min(r[0], r[1]), std::min(r[2], r[3]));
+    double rmax = std::max(std::max(r[0], r[1]), std::max(r[2], r[3]));
+
+    if (!std::isfinite(cmin) || !std::isfinite(cmax) || !std::isfinite(rmin) || !std::isfinite(rmax))
+        return false;
+
+    // Not worth it when the tile spans far more pixels than it has posts
+    // (low LODs over a large dataset); sampling per post is cheaper then.
+    double maxPixels = std::max(4.0 * (double)tileSize * (double)tileSize, 1048576.0);
+
+    out._band = band;
+    out._grid = PixelGrid();
+    out._grid._width = width;
+    out._grid._height = height;
+    int level = -1;
+
+    // When the full resolution window is too large, sample the coarsest
+    // overview that is still at least as fine as the post spacing. For a
+    // cloud-optimized GeoTIFF this reads just the overview's internal tiles.
+    if ((cmax - cmin + 3.0) * (rmax - rmin + 3.0) > maxPixels && tileSize > 1u)
+    {
+        double spacingX = (cmax - cmin) / (double)(tileSize - 1);
+        double spacingY = (rmax - rmin) / (double)(tileSize - 1);
+
+        for (int i = 0; i < band->GetOverviewCount(); ++i)
+        {
+            GDALRasterBand* overview = band->GetOverview(i);
+            if (overview == nullptr || overview->GetXSize() <= 0 || overview->GetYSize() <= 0)
+                continue;
+
+            double scaleX = (double)overview->GetXSize() / (double)width;
+            double scaleY = (double)overview->GetYSize() / (double)height;
+
+            if (spacingX * scaleX >= 1.0 && spacingY * scaleY >= 1.0 &&
+                scaleX < out._grid._scaleX)
+            {
+                out._band = overview;
+                out._grid._scaleX = scaleX;
+                out._grid._scaleY = scaleY;
+                out._grid._width = overview->GetXSize();
+                out._grid._height = overview->GetYSize();
+                level = i;
+            }
+        }
+
+        cmin *= out._grid._scaleX, cmax *= out._grid._scaleX;
+        rmin *= out._grid._scaleY, rmax *= out._grid._scaleY;
+    }
+
+    // pixels used by the posts, after the half-pixel offset, plus a one-pixel apron
+    double col0 = std::max(0.0, floor(cmin - 0.5) - 1.0);
+    double col1 = std::min((double)(out._grid._width - 1), ceil(cmax - 0.5) + 1.0);
+    double row0 = std::max(0.0, floor(rmin - 0.5) - 1.0);
+    double row1 = std::min((double)(out._grid._height - 1), ceil(rmax - 0.5) + 1.0);
+
+    if (col0 > col1 || row0 > row1)
+        return false;
+
+    double pixels = (col1 - col0 + 1.0) * (row1 - row0 + 1.0);
+    if (pixels > maxPixels)
+        return false;
+
+    out._col0 = (int)col0;
+    out._row0 = (int)row0;
+    out._cols = (int)(col1 - col0) + 1;
+    out._rows = (int)(row1 - row0) + 1;
+    out._data.resize(out._cols * out._rows);
+
+    return readBlocks(level, out);
+}
+
+bool
+GDAL::Driver::readBlocks(int level, PixelWindow& window)
+{
+    BlockCache* cache = Registry::gdalBlockCache();
+
+    if (_blockCacheKey.empty() || cache == nullptr || cache->getMaxBytes() == 0u)
+    {
+        return rasterIO(window._band, GF_Read,
+            window._col0, window._row0, window._cols, window._rows,
+            &window._data[0], window._cols, window._rows, GDT_Float32, 0, 0);
+    }
+
+    // Read whole internal blocks through the shared cache so that other
+    // Drivers on the same source (and neighboring tiles) can reuse them.
+    int blockW = 0, blockH = 0;
+    window._band->GetBlockSize(&blockW, &blockH);
+    if (blockW <= 0 || blockH <= 0)
+        return false;
+
+    int bx0 = window._col0 / blockW, bx1 = (window._col0 + window._cols - 1) / blockW;
+    int by0 = window._row0 / blockH, by1 = (window._row0 + window._rows - 1) / blockH;
+
+    for (int by = by0; by <= by1; ++by)
+    {
+        for (int bx = bx0; bx <= bx1; ++bx)
+        {
+            int x0 = bx * blockW, y0 = by * blockH;
+            int w = std::min(blockW, window._grid._width - x0);
+            int h = std::min(blockH, window._grid._height - y0);
+
+            std::string key = Stringify()
+                << _blockCacheKey << ':' << window._band->GetBand()
+                << ':' << level << ':' << bx << ':' << by;
+
+            BlockCache::Block block = cache->get(key);
+            if (!block)
+            {
+                auto data = std::make_shared<std::vector<float>>(w * h);
+                if (!rasterIO(window._band, GF_Read, x0, y0, w, h, &(*data)[0], w, h, GDT_Float32, 0, 0))
+                    return false;
+                cache->put(key, data);
+                block = data;
+            }
+
+            // copy the overlap into the window:
+            int c0 = std::max(x0, window._col0), c1 = std::min(x0 + w, window._col0 + window._cols);
+            int r0 = std::max(y0, window._row0), r1 = std::min(y0 + h, window._row0 + window._rows);
+            for (int row = r0; row < r1; ++row)
+            {
+                std::copy(
+                    block->begin() + (row - y0) * w + (c0 - x0),
+                    block->begin() + (row - y0) * w + (c1 - x0),
+                    window._data.begin() + (row - window._row0) * window._cols + (c0 - window._col0));
+            }
+        }
+    }
+
+    return true;
+}
+
 bool
 GDAL::Driver::intersects(const TileKey& key)
 {
@@ -1508,14 +1751,54 @@ GDAL::Driver::createHeightField(const TileKey& key,
         {
             double dx = (xmax - xmin) / (tileSize - 1);
             double dy = (ymax - ymin) / (tileSize - 1);
-            for (unsigned r = 0; r < tileSize; ++r)
+
+            // Read every source pixel the posts can touch with a single call
+            // instead of asking GDAL for up to four pixels per post.
+            PixelWindow window;
+            if (_useReadWindow && readPixelWindow(band, xmin, ymin, xmax, ymax, tileSize, window))
             {
-                double geoY = ymin + (dy * (double)r);
-                for (unsigned c = 0; c < tileSize; ++c)
+                float bandNoData = getBandNoDataValue(band);
+
+                auto fetch = [&](int col, int row)
+                {
+                    int i = col - window._col0;
+                    int j = row - window._row0;
+                    if (i >= 0 && i < window._cols && j >= 0 && j < window._rows)
+                        return window._data[j * window._cols + i];
+
+                    // outside the apron; should not happen
+                    float value;
+                    rasterIO(window._band, GF_Read, col, row, 1, 1, &value, 1, 1, GDT_Float32, 0, 0);
+                    return value;
+                };
+
+                auto valid = [&](float value)
+                {
+                    return isValidValue(value, bandNoData);
+                };
+
+                for (unsigned r = 0; r < tileSize; ++r)
                 {
-                    double geoX = xmin + (dx * (double)c);
-                    float h = getInterpolatedValue(band, geoX, geoY) * _linearUnits;
-                    hf->setHeight(c, r, h);
+                    double geoY = ymin + (dy * (double)r);
+                    for (unsigned c = 0; c < tileSize; ++c)
+                    {
+                        double geoX = xmin + (dx * (double)c);
+                        float h = interpolate(geoX, geoY, true, window._grid, fetch, valid) * _linearUnits;
+                        hf->setHeight(c, r, h);
+                    }
+                }
+            }
+            else
+            {
+                for (unsigned r = 0; r < tileSize; ++r)
+                {
+                    double geoY = ymin + (dy * (double)r);
+                    for (unsigned c = 0; c < tileSize; ++c)
+                    {
+                        double geoX = xmin + (dx * (double)c);
+                        float h = getInterpolatedValue(band, geoX, geoY) * _linearUnits;
+                        hf->setHeight(c, r, h);
+                    }
                 }
             }
         }
@@ -1664,6 +1947,244 @@ GDAL::Driver::createHeightFieldWithVRT(const TileKey& key,
 }
 //...................................................................
 
+GDAL::BlockCache::BlockCache() :
+    _mutex(OE_MUTEX_NAME),
+    _maxBytes(64u * 1024u * 1024u),
+    _totalBytes(0u)
+{
+    const char* c = ::getenv("OSGEARTH_GDAL_BLOCK_CACHE_MB");
+    if (c)
+    {
+        _maxBytes = (std::size_t)::atoi(c) * 1024u * 1024u;
+        OE_INFO << LC << "Block cache budget = " << (_maxBytes / 1048576u) << " MB" << std::endl;
+    }
+}
+
+void
+GDAL::BlockCache::setMaxBytes(std::size_t value)
+{
+    ScopedMutexLock lock(_mutex);
+    _maxBytes = value;
+    trim();
+}
+
+GDAL::BlockCache::Block
+GDAL::BlockCache::get(const std::string& key)
+{
+    ScopedMutexLock lock(_mutex);
+
+    auto i = _entries.find(key);
+    if (i == _entries.end())
+        return nullptr;
+
+    // most recently used goes to the front:
+    _lru.splice(_lru.begin(), _lru, i->second._lru);
+    return i->second._block;
+}
+
+void
+GDAL::BlockCache::put(const std::string& key, Block block)
+{
+    if (!block)
+        return;
+
+    ScopedMutexLock lock(_mutex);
+
+    if (_maxBytes == 0u)
+        return;
+
+    auto i = _entries.find(key);
+    if (i != _entries.end())
+    {
+        _totalBytes -= i->second._block->size() * sizeof(float);
+        _lru.erase(i->second._lru);
+        _entries.erase(i);
+    }
+
+    _lru.push_front(key);
+    Entry& entry = _entries[key];
+    entry._block = block;
+    entry._lru = _lru.begin();
+    _totalBytes += block->size() * sizeof(float);
+
+    trim();
+}
+
+void
+GDAL::BlockCache::clear()
+{
+    ScopedMutexLock lock(_mutex);
+    _entries.clear();
+    _lru.clear();
+    _totalBytes = 0u;
+}
+
+std::size_t
+GDAL::BlockCache::getTotalBytes() const
+{
+    ScopedMutexLock lock(_mutex);
+    return _totalBytes;
+}
+
+void
+GDAL::BlockCache::trim()
+{
+    // assumes lock held; blocks still in use by a reader stay alive
+    // until it lets go of them
+    while (_totalBytes > _maxBytes && !_lru.empty())
+    {
+        auto i = _entries.find(_lru.back());
+        _totalBytes -= i->second._block->size() * sizeof(float);
+        _entries.erase(i);
+        _lru.pop_back();
+    }
+}
+
+//...................................................................
+
+GDAL::DriverPool::DriverPool() :
+    _maxSize(4u),
+    _numOpen(0u),
+    _generation(0u),
+    _closed(false)
+{
+    //nop
+}
+
+void
+GDAL::DriverPool::setMaxSize(unsigned value)
+{
+    ScopedMutexLock lock(_mutex);
+    _maxSize = std::max(value, 1u);
+    _returned.notify_all();
+}
+
+unsigned
+GDAL::DriverPool::getMaxSize() const
+{
+    ScopedMutexLock lock(_mutex);
+    return _maxSize;
+}
+
+void
+GDAL::DriverPool::add(Driver::Ptr driver)
+{
+    if (driver == nullptr)
+        return;
+
+    ScopedMutexLock lock(_mutex);
+    _idle.push_back(driver);
+    ++_numOpen;
+    _returned.notify_one();
+}
+
+void
+GDAL::DriverPool::clear()
+{
+    ScopedMutexLock lock(_mutex);
+    _idle.clear();
+    ++_generation;
+    _numOpen = 0u;
+    _returned.notify_all();
+}
+
+void
+GDAL::DriverPool::close()
+{
+    ScopedMutexLock lock(_mutex);
+    _idle.clear();
+    ++_generation;
+    _numOpen = 0u;
+    _closed = true;
+    _returned.notify_all();
+}
+
+void
+GDAL::DriverPool::open()
+{
+    ScopedMutexLock lock(_mutex);
+    _closed = false;
+}
+
+unsigned
+GDAL::DriverPool::getNumOpen() const
+{
+    ScopedMutexLock lock(_mutex);
+    return _numOpen;
+}
+
+GDAL::DriverPool::Lease::Lease(DriverPool& pool, const Factory& factory, const Threading::Cancelable* cancel) :
+    _pool(pool),
+    _generation(0u)
+{
+    std::unique_lock<Threading::Mutex> lock(_pool._mutex);
+
+    while (!_pool._closed && _pool._idle.empty() && _pool._numOpen >= _pool._maxSize)
+    {
+        // wake up now and then to honor cancelation
+        _pool._returned.wait_for(lock, std::chrono::milliseconds(100));
+
+        if (cancel && cancel->isCanceled())
+            return;
+    }
+
+    if (_pool._closed)
+        return;
+
+    _generation = _pool._generation;
+
+    if (!_pool._idle.empty())
+    {
+        _driver = _pool._idle.back();
+        _pool._idle.pop_back();
+        return;
+    }
+
+    // open a new one outside the lock; it may take a while
+    ++_pool._numOpen;
+    lock.unlock();
+
+    _driver = factory();
+
+    lock.lock();
+
+    // the pool closed while we were opening; don't read from a closed layer
+    if (_pool._closed)
+        _driver = nullptr;
+
+    if (_driver == nullptr)
+    {
+        if (_generation == _pool._generation)
+            --_pool._numOpen;
+        _pool._returned.notify_one();
+    }
+}
+
+GDAL::DriverPool::Lease::~Lease()
+{
+    if (_driver == nullptr)
+        return;
+
+    ScopedMutexLock lock(_pool._mutex);
+
+    // the pool was cleared while we had the driver; let it close
+    if (_generation != _pool._generation)
+        return;
+
+    if (_pool._numOpen > _pool._maxSize)
+    {
+        // the pool shrank while we had the driver
+        --_pool._numOpen;
+    }
+    else
+    {
+        _pool._idle.push_back(_driver);
+    }
+    _pool._returned.notify_one();
+}
+
+//...................................................................
+
 GDAL::Options::Options(const ConfigOptions& input)
 {
     readFrom(input.getConfig());
@@ -1676,6 +2197,7 @@ GDAL::Options::readFrom(const Config& conf)
     _useVRT.init(false);
     coverageUsesPaletteIndex().setDefault(true);
     singleThreaded().setDefault(false);
+    maxDatasets().setDefault(4u);
 
     conf.get("url", _url);
     conf.get("connection", _connection);
@@ -1687,6 +2209,7 @@ GDAL::Options::readFrom(const Config& conf)
     conf.get("interpolation", "cubicspline", _interpolation, osgEarth::INTERP_CUBICSPLINE);
     conf.get("coverage_uses_palette_index", coverageUsesPaletteIndex());
     conf.get("single_threaded", singleThreaded());
+    conf.get("max_datasets", maxDatasets());
 
     // report on deprecated usage
     const std::string deprecated_keys[] = {
@@ -1711,6 +2234,7 @@ GDAL::Options::writeTo(Config& conf) const
     conf.set("interpolation", "cubicspline", _interpolation, osgEarth::INTERP_CUBICSPLINE);
     conf.set("coverage_uses_palette_index", coverageUsesPaletteIndex());
     conf.set("single_threaded", singleThreaded());
+    conf.set("max_datasets", maxDatasets());
 }
 
 //......................................................................
@@ -1721,7 +2245,7 @@ GDAL::Options::writeTo(Config& conf) const
 namespace
 {
     template<typename T>
-    Status openOnThisThread(
+    Status openDriver(
         const T* layer,
         GDAL::Driver::Ptr& driver,
         osg::ref_ptr<const Profile>* profile = nullptr,
@@ -1755,6 +2279,20 @@ namespace
 
         return Status::NoError;
     }
+
+    // Opens additional drivers for a layer's pool. Calling openDriver with
+    // NULL params limits the setup since openImplementation already did it.
+    template<typename T>
+    GDAL::DriverPool::Factory driverFactory(const T* layer)
+    {
+        return [layer]()
+        {
+            GDAL::Driver::Ptr driver;
+            if (openDriver(layer, driver).isError())
+                driver = nullptr;
+            return driver;
+        };
+    }
 }
 
 //......................................................................
@@ -1782,6 +2320,8 @@ OE_LAYER_PROPERTY_IMPL(GDALImageLayer, std::string, Connection, connection);
 OE_LAYER_PROPERTY_IMPL(GDALImageLayer, unsigned, SubDataSet, subDataSet);
 OE_LAYER_PROPERTY_IMPL(GDALImageLayer, RasterInterpolation, Interpolation, interpolation);
 
+OE_LAYER_PROPERTY_IMPL(GDALImageLayer, unsigned, MaxDatasets, maxDatasets);
+
 void GDALImageLayer::setSingleThreaded(bool value) { options().singleThreaded() = value; }
 bool GDALImageLayer::getSingleThreaded() const { return options().singleThreaded().get(); }
 
@@ -1791,8 +2331,7 @@ GDALImageLayer::init()
 {
     // Initialize the image layer (always first)
     ImageLayer::init();
-    _driversMutex.setName("OE.GDALImageLayer.drivers");
-    _singleThreadingMutex.setName("OE.GDALImageLayer.st");
+    _drivers.setName("OE.GDALImageLayer.drivers");
 }
 
 Status
@@ -1802,19 +2341,18 @@ GDALImageLayer::openImplementation()
     if (parent.isError())
         return parent;
 
-    unsigned id = getSingleThreaded() ? 0u : Threading::getCurrentThreadId();
-
     osg::ref_ptr<const Profile> profile;
 
-    // GDAL thread-safety requirement: each thread requires a separate GDALDataSet.
-    // So we just encapsulate the entire setup once per thread.
+    // GDAL thread-safety requirement: a GDALDataset may only be used by one
+    // thread at a time. The pool leases each driver to one thread at a time
+    // and bounds how many datasets (and block caches) are open at once.
     // https://trac.osgeo.org/gdal/wiki/FAQMiscellaneous#IstheGDALlibrarythread-safe
+    _drivers.close();
+    _drivers.setMaxSize(getSingleThreaded() ? 1u : options().maxDatasets().get());
 
-    ScopedMutexLock lock(_driversMutex);
-
-    GDAL::Driver::Ptr& driver = _drivers[id];
+    GDAL::Driver::Ptr driver;
 
-    Status s = openOnThisThread(
+    Status s = openDriver(
         this,
         driver,
         &profile,
@@ -1823,6 +2361,10 @@ GDALImageLayer::openImplementation()
     if (s.isError())
         return s;
 
+    // keep the first driver for reading
+    _drivers.add(driver);
+    _drivers.open();
+
     // if the driver generated a valid profile, set it.
     if (profile.valid())
     {
@@ -1835,9 +2377,9 @@ GDALImageLayer::openImplementation()
 Status
 GDALImageLayer::closeImplementation()
 {
-    // safely shut down all per-thread handles.
-    Threading::ScopedMutexLock lock(_driversMutex);
-    _drivers.clear();
+    // shut down the idle handles and stop leasing; leased ones close
+    // when they come back.
+    _drivers.close();
     dataExtents().clear();
     return ImageLayer::closeImplementation();
 }
@@ -1848,47 +2390,20 @@ GDALImageLayer::createImageImplementation(const TileKey& key, ProgressCallback*
     if (getStatus().isError())
         return GeoImage::INVALID;
 
-    unsigned id = getSingleThreaded() ? 0u : Threading::getCurrentThreadId();
-
-    GDAL::Driver::Ptr driver;
-
-    // lock while we look up and verify the per-thread driver:
-    {
-        ScopedMutexLock lock(_driversMutex);
-
-        // check while locked to ensure we may continue
-        if (isClosing() || !isOpen())
-            return GeoImage::INVALID;
-
-        GDAL::Driver::Ptr& test_driver = _drivers[id];
-
-        if (test_driver == nullptr)
-        {
-            // calling openImpl with NULL params limits the setup
-            // since we already called this during openImplementation
-            openOnThisThread(this, test_driver);
-        }
-
-        // assign to a ref_ptr to continue
-        driver = test_driver;
-    }
+    // exclusive use of a pooled driver until the lease goes out of scope.
+    // The lease is empty once the layer closes the pool.
+    GDAL::DriverPool::Lease driver(_drivers, driverFactory(this), progress);
 
-    if (driver != nullptr)
+    if (driver.valid())
     {
         OE_PROFILING_ZONE;
 
-        if (getSingleThreaded())
-            _singleThreadingMutex.lock();
-
         osg::ref_ptr<osg::Image> image = driver->createImage(
             key,
             options().tileSize().get(),
             options().coverage() == true,
             progress);
 
-        if (getSingleThreaded())
-            _singleThreadingMutex.unlock();
-
         return GeoImage(image.get(), key.getExtent());
     }
 
@@ -1920,6 +2435,8 @@ OE_LAYER_PROPERTY_IMPL(GDALElevationLayer, std::string, Connection, connection);
 OE_LAYER_PROPERTY_IMPL(GDALElevationLayer, unsigned, SubDataSet, subDataSet);
 OE_LAYER_PROPERTY_IMPL(GDALElevationLayer, RasterInterpolation, Interpolation, interpolation);
 
+OE_LAYER_PROPERTY_IMPL(GDALElevationLayer, unsigned, MaxDatasets, maxDatasets);
+
 void GDALElevationLayer::setSingleThreaded(bool value) { options().singleThreaded() = value; }
 bool GDALElevationLayer::getSingleThreaded() const { return options().singleThreaded().get(); }
 
@@ -1934,8 +2451,7 @@ void
 GDALElevationLayer::init()
 {
     ElevationLayer::init();
-    _driversMutex.setName("OE.GDALElevationLayer.drivers");
-    _singleThreadingMutex.setName("OE.GDALElevationLayer.st");
+    _drivers.setName("OE.GDALElevationLayer.drivers");
 }
 
 Status
@@ -1945,20 +2461,18 @@ GDALElevationLayer::openImplementation()
     if (parent.isError())
         return parent;
 
-    unsigned id = getSingleThreaded() ? 0u : Threading::getCurrentThreadId();
-
     osg::ref_ptr<const Profile> profile;
 
-    // GDAL thread-safety requirement: each thread requires a separate GDALDataSet.
-    // So we just encapsulate the entire setup once per thread.
+    // GDAL thread-safety requirement: a GDALDataset may only be used by one
+    // thread at a time. The pool leases each driver to one thread at a time
+    // and bounds how many datasets (and block caches) are open at once.
     // https://trac.osgeo.org/gdal/wiki/FAQMiscellaneous#IstheGDALlibrarythread-safe
+    _drivers.close();
+    _drivers.setMaxSize(getSingleThreaded() ? 1u : options().maxDatasets().get());
 
-    ScopedMutexLock lock(_driversMutex);
-
-    // Open the dataset temporarily to query the profile and extents.
     GDAL::Driver::Ptr driver;
 
-    Status s = openOnThisThread(
+    Status s = openDriver(
         this,
         driver,
         &profile,
@@ -1967,6 +2481,10 @@ GDALElevationLayer::openImplementation()
     if (s.isError())
         return s;
 
+    // keep the first driver for reading
+    _drivers.add(driver);
+    _drivers.open();
+
     if (profile.valid())
         setProfile(profile.get());
 
@@ -1976,9 +2494,9 @@ GDALElevationLayer::openImplementation()
 Status
 GDALElevationLayer::closeImplementation()
 {
-    // safely shut down all per-thread handles.
-    Threading::ScopedMutexLock lock(_driversMutex);
-    _drivers.clear();
+    // shut down the idle handles and stop leasing; leased ones close
+    // when they come back.
+    _drivers.close();
     dataExtents().clear();
     return ElevationLayer::closeImplementation();
 }
@@ -1989,42 +2507,14 @@ GDALElevationLayer::createHeightFieldImplementation(const TileKey& key, Progress
     if (getStatus().isError())
         return GeoHeightField(getStatus());
 
-    unsigned id = getSingleThreaded() ? 0u : Threading::getCurrentThreadId();
-
-    GDAL::Driver::Ptr driver;
-
-    // lock while we look up and verify the per-thread driver:
-    {
-        ScopedMutexLock lock(_driversMutex);
-
-        // check while locked to ensure we may continue
-        if (isClosing() || !isOpen())
-            return GeoHeightField::INVALID;
-
-        GDAL::Driver::Ptr& test_driver = _drivers[id];
+    // exclusive use of a pooled driver until the lease goes out of scope.
+    // The lease is empty once the layer closes the pool.
+    GDAL::DriverPool::Lease driver(_drivers, driverFactory(this), progress);
 
-        if (test_driver == nullptr)
-        {
-            // calling openImpl with NULL params limits the setup
-            // since we already called this during openImplementation
-            openOnThisThread(
-                this,
-                test_driver,
-                nullptr,
-                nullptr);
-        }
-
-        // assign to a ref_ptr to continue
-        driver = test_driver;
-    }
-
-    if (driver != nullptr)
+    if (driver.valid())
     {
         OE_PROFILING_ZONE;
 
-        if (getSingleThreaded())
-            _singleThreadingMutex.lock();
-
         osg::ref_ptr<osg::HeightField> heightfield;
 
         if (*_options->useVRT())
@@ -2042,9 +2532,6 @@ GDALElevationLayer::createHeightFieldImplementation(const TileKey& key, Progress
                 progress);
         }
 
-        if (getSingleThreaded())
-            _singleThreadingMutex.unlock();
-
         return GeoHeightField(heightfield.get(), key.getExtent());
     }
 
@@ -26,11 +26,44 @@
 
 using namespace osgEarth;
 
+namespace
+{
+    // Terrain callback that forwards to a GeoTransform for as long as
+    // the transform is alive, and removes itself after that.
+    class ClampCallback : public TerrainClampCallback
+    {
+    public:
+        ClampCallback(GeoTransform* xform) : _xform(xform) { }
+
+        void onTileUpdate(const TileKey& key, osg::Node* tile, TerrainCallbackContext& context) override
+        {
+            osg::ref_ptr<GeoTransform> xform;
+            if (_xform.lock(xform))
+                xform->onTileUpdate(key, tile, context);
+            else
+                context.remove();
+        }
+
+        void onElevationUpdate(const TileKey& key, double elevation, TerrainCallbackContext& context) override
+        {
+            osg::ref_ptr<GeoTransform> xform;
+            if (_xform.lock(xform))
+                xform->onElevationUpdate(key, elevation, context);
+            else
+                context.remove();
+        }
+
+    private:
+        osg::observer_ptr<GeoTransform> _xform;
+    };
+}
+
 GeoTransform::GeoTransform() :
 _findTerrainInUpdateTraversal(false),
-_terrainCallbackInstalled(false),
 _autoRecomputeHeights(true),
-_clampInUpdateTraversal(false)
+_clampInUpdateTraversal(false),
+_clampElevation(0.0),
+_clampElevationValid(false)
 {
    //nop
 }
@@ -41,15 +74,21 @@ osg::MatrixTransform(rhs, op)
     _position = rhs._position;
     _terrain = rhs._terrain.get();
     _autoRecomputeHeights = rhs._autoRecomputeHeights;
-    _terrainCallbackInstalled = false;
     _findTerrainInUpdateTraversal = false;
     _clampInUpdateTraversal = false;
+    _clampElevation = 0.0;
+    _clampElevationValid = false;
 }
 
 GeoTransform::~GeoTransform()
 {
     if (_terrain.valid())
+    {
         _terrain->removeObserver(this);
+
+        if (_terrainCallback.valid())
+            _terrain->removeTerrainCallback(_terrainCallback.get());
+    }
 }
 
 void
@@ -58,7 +97,12 @@ GeoTransform::setTerrain(Terrain* terrain)
     if (terrain)
     {
         if (_terrain.valid())
+        {
             _terrain->removeObserver(this);
+
+            if (_terrainCallback.valid() && _terrain.get() != terrain)
+                _terrain->removeTerrainCallback(_terrainCallback.get());
+        }
         _terrain = terrain;
         _terrain->addObserver(this);
         setPosition(_position);
@@ -107,6 +151,9 @@ GeoTransform::setPosition(const GeoPoint& position)
 
     _position = position;
 
+    // any elevation sampled for the old position no longer applies
+    _clampElevationValid = false;
+
     // relative Z or reprojection require a terrain:
     osg::ref_ptr<Terrain> terrain;
     _terrain.lock(terrain);
@@ -147,14 +194,26 @@ GeoTransform::setPosition(const GeoPoint& position)
 
     // Is this is a relative-Z position, we need to install a terrain callback
     // so we can recompute the altitude when new terrain tiles become available.
+    // Its footprint is our position, so the terrain only calls it for tiles
+    // under us; moving the footprint is cheap, so do it on every move.
     if (_position.altitudeMode() == ALTMODE_RELATIVE &&
         _autoRecomputeHeights &&
-        !_terrainCallbackInstalled &&
         terrain.valid())
     {
-        // The Adapter template auto-destructs, so we never need to remote it manually.
-        terrain->addTerrainCallback( new TerrainCallbackAdapter<GeoTransform>(this) );
-        _terrainCallbackInstalled = true;
+        if (!_terrainCallback.valid())
+            _terrainCallback = new ClampCallback(this);
+
+        terrain->addTerrainCallback(
+            _terrainCallback.get(),
+            GeoExtent(terrain->getSRS(), p.x(), p.y(), p.x(), p.y()));
+    }
+    else if (_terrainCallback.valid())
+    {
+        // no longer following the terrain (absolute position, or
+        // auto-recompute turned off), so stop hearing about its tiles
+        if (terrain.valid())
+            terrain->removeTerrainCallback(_terrainCallback.get());
+        _terrainCallback = nullptr;
     }
 
     // Finally, assemble the matrix from our position point.
@@ -170,22 +229,45 @@ GeoTransform::onTileUpdate(const TileKey&          key,
                           osg::Node*              node,
                           TerrainCallbackContext& context)
 {
+    if (!_position.isValid() || _position.altitudeMode() != ALTMODE_RELATIVE || !_autoRecomputeHeights)
+    {
+        OE_TEST << LC << "onTileUpdate fail condition 1\n";
+        return;
+    }
+
+    if (key.valid() && !key.getExtent().contains(_position))
+    {
+        OE_TEST << LC << "onTileUpdate fail condition 2\n";
+        return;
+    }
+
+    // re-clamp against the terrain itself
+    _clampElevationValid = false;
+
     if (!_clampInUpdateTraversal)
     {
-       if (!_position.isValid() || _position.altitudeMode() != ALTMODE_RELATIVE || !_autoRecomputeHeights)
-       {
-           OE_TEST << LC << "onTileUpdate fail condition 1\n";
-           return;
-       }
+        _clampInUpdateTraversal = true;
+        ADJUST_UPDATE_TRAV_COUNT(this, +1);
+    }
+}
 
-       if (key.valid() && !key.getExtent().contains(_position))
-       {
-           OE_TEST << LC << "onTileUpdate fail condition 2\n";
-           return;
-       }
+void
+GeoTransform::onElevationUpdate(const TileKey&          key,
+                                double                  elevation,
+                                TerrainCallbackContext& context)
+{
+    if (!_position.isValid() || _position.altitudeMode() != ALTMODE_RELATIVE || !_autoRecomputeHeights)
+    {
+        return;
+    }
+
+    _clampElevation = elevation;
+    _clampElevationValid = true;
 
-       _clampInUpdateTraversal = true;
-       ADJUST_UPDATE_TRAV_COUNT(this, +1);
+    if (!_clampInUpdateTraversal)
+    {
+        _clampInUpdateTraversal = true;
+        ADJUST_UPDATE_TRAV_COUNT(this, +1);
     }
 }
 
@@ -208,7 +290,25 @@ GeoTransform::traverse(osg::NodeVisitor& nv)
 
         if (_clampInUpdateTraversal)
         {
-            setPosition(_position);
+            osg::ref_ptr<Terrain> terrain;
+            if (_clampElevationValid && _terrain.lock(terrain))
+            {
+                // the terrain already sampled the elevation for us
+                GeoPoint p = _position.transform(terrain->getSRS());
+                if (p.isValid())
+                {
+                    p.z() += _clampElevation;
+                    p.altitudeMode() = ALTMODE_ABSOLUTE;
+                    osg::Matrixd local2world;
+                    p.createLocalToWorld(local2world);
+                    this->setMatrix(local2world);
+                }
+            }
+            else
+            {
+                setPosition(_position);
+            }
+            _clampElevationValid = false;
             _clampInUpdateTraversal = false;
             ADJUST_UPDATE_TRAV_COUNT(this, -1);
         }
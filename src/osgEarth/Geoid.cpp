@@ -19,6 +19,7 @@
 
 #include <osgEarth/Geoid>
 #include <osgEarth/HeightFieldUtils>
+#include <algorithm>
 
 #define LC "[Geoid] "
 
@@ -91,6 +92,47 @@ Geoid::getHeight(double lat_deg, double lon_deg, const RasterInterpolation& inte
     return result;
 }
 
+void
+Geoid::getHeights(const double* lat_deg, const double* lon_deg, unsigned count, float* out_heights) const
+{
+    if ( !_valid || _hf->getNumColumns() < 2 || _hf->getNumRows() < 2 )
+    {
+        std::fill(out_heights, out_heights + count, 0.0f);
+        return;
+    }
+
+    // Straight bilinear interpolation over the raw grid. No branches
+    // in the loop, so the compiler can vectorize it; points outside
+    // the geoid are clamped to the edge and then zeroed.
+    const int cols = _hf->getNumColumns();
+    const int rows = _hf->getNumRows();
+    const float* data = &_hf->getFloatArray()->front();
+
+    const double xmin = _bounds.xMin(), ymin = _bounds.yMin();
+    const double xmax = _bounds.xMax(), ymax = _bounds.yMax();
+    const double xscale = double(cols-1) / _bounds.width();
+    const double yscale = double(rows-1) / _bounds.height();
+
+    for(unsigned i=0; i<count; ++i)
+    {
+        double lon = lon_deg[i], lat = lat_deg[i];
+        float inside = (lon >= xmin && lon <= xmax && lat >= ymin && lat <= ymax) ? 1.0f : 0.0f;
+
+        double c = osg::clampBetween((lon-xmin)*xscale, 0.0, double(cols-1));
+        double r = osg::clampBetween((lat-ymin)*yscale, 0.0, double(rows-1));
+        int c0 = osg::minimum((int)c, cols-2);
+        int r0 = osg::minimum((int)r, rows-2);
+        double fc = c - double(c0);
+        double fr = r - double(r0);
+
+        const float* p = data + r0*cols + c0;
+        double south = p[0]    + (p[1]     -p[0])   *fc;
+        double north = p[cols] + (p[cols+1]-p[cols])*fc;
+
+        out_heights[i] = inside * (float)(south + (north-south)*fr);
+    }
+}
+
 bool
 Geoid::isEquivalentTo( const Geoid& rhs ) const
 {
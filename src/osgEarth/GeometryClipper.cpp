@@ -0,0 +1,345 @@
+/* -*-c++-*- */
+/* osgEarth - Geospatial SDK for OpenSceneGraph
+ * Copyright 2020 Pelican Mapping
+ * http://osgearth.org
+ *
+ * osgEarth is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+#include <osgEarth/GeometryClipper>
+
+#define LC "[GeometryClipper] "
+
+using namespace osgEarth;
+
+namespace
+{
+    // One Sutherland-Hodgman pass: keeps the part of a closed ring on
+    // the inside of the line axis == value.
+    template<int AXIS, bool MAX>
+    void clipEdge(const Vec3dVector& input, Vec3dVector& output, double value)
+    {
+        output.clear();
+        if (input.empty())
+            return;
+
+        osg::Vec3d prev = input.back();
+        bool prevInside = MAX ? prev[AXIS] <= value : prev[AXIS] >= value;
+
+        for (const osg::Vec3d& curr : input)
+        {
+            bool inside = MAX ? curr[AXIS] <= value : curr[AXIS] >= value;
+            if (inside != prevInside)
+            {
+                double t = (value - prev[AXIS]) / (curr[AXIS] - prev[AXIS]);
+                osg::Vec3d p = prev + (curr - prev) * t;
+                p[AXIS] = value;
+                output.push_back(p);
+            }
+            if (inside)
+            {
+                output.push_back(curr);
+            }
+            prev = curr;
+            prevInside = inside;
+        }
+    }
+}
+
+//........................................................................
+
+GeometryClipper::GeometryClipper(const Bounds& bounds) :
+    _xmin(bounds.xMin()),
+    _ymin(bounds.yMin()),
+    _xmax(bounds.xMax()),
+    _ymax(bounds.yMax())
+{
+    //nop
+}
+
+bool
+GeometryClipper::clip(const Geometry* input, osg::ref_ptr<Geometry>& output) const
+{
+    output = 0L;
+    if (!input)
+        return false;
+
+    GeometryCollection parts;
+    ConstGeometryIterator i(input, false);
+    while (i.hasMore())
+    {
+        clipPart(i.next(), parts);
+    }
+
+    if (parts.empty())
+        return false;
+
+    if (parts.size() == 1)
+        output = parts.front().get();
+    else
+        output = new MultiGeometry(parts);
+
+    return true;
+}
+
+void
+GeometryClipper::clipPart(const Geometry* part, GeometryCollection& output) const
+{
+    if (part->empty())
+        return;
+
+    Bounds b = part->getBounds();
+
+    // trivial reject:
+    if (b.xMin() > _xmax || b.xMax() < _xmin || b.yMin() > _ymax || b.yMax() < _ymin)
+        return;
+
+    // trivial accept:
+    if (b.xMin() >= _xmin && b.xMax() <= _xmax && b.yMin() >= _ymin && b.yMax() <= _ymax)
+    {
+        output.push_back(part->clone());
+        return;
+    }
+
+    switch (part->getType())
+    {
+    case Geometry::TYPE_POINT:
+    case Geometry::TYPE_POINTSET:
+    {
+        Vec3dVector points;
+        for (const osg::Vec3d& p : *part)
+        {
+            if (p.x() >= _xmin && p.x() <= _xmax && p.y() >= _ymin && p.y() <= _ymax)
+                points.push_back(p);
+        }
+        if (!points.empty())
+            output.push_back(Geometry::create(part->getType(), &points));
+        break;
+    }
+
+    case Geometry::TYPE_LINESTRING:
+        clipLine(part->asVector(), output);
+        break;
+
+    case Geometry::TYPE_RING:
+    {
+        Vec3dVector ring;
+        if (clipRing(part->asVector(), ring))
+            output.push_back(new Ring(&ring));
+        break;
+    }
+
+    case Geometry::TYPE_POLYGON:
+    {
+        Vec3dVector ring;
+        if (!clipRing(part->asVector(), ring))
+            break;
+
+        osg::ref_ptr<Polygon> poly = new Polygon(&ring);
+
+        for (auto& hole : static_cast<const Polygon*>(part)->getHoles())
+        {
+            GeometryCollection clippedHole;
+            clipPart(hole.get(), clippedHole);
+            if (!clippedHole.empty())
+            {
+                Ring* r = dynamic_cast<Ring*>(clippedHole.front().get());
+                if (r)
+                    poly->getHoles().push_back(r);
+            }
+        }
+        output.push_back(poly.get());
+        break;
+    }
+
+    default:
+        break;
+    }
+}
+
+bool
+GeometryClipper::clipRing(const Vec3dVector& ring, Vec3dVector& output) const
+{
+    Vec3dVector scratch;
+    scratch.reserve(ring.size() + 8);
+    output.reserve(ring.size() + 8);
+
+    clipEdge<0, false>(ring, output, _xmin);
+    clipEdge<0, true>(output, scratch, _xmax);
+    clipEdge<1, false>(scratch, output, _ymin);
+    clipEdge<1, true>(output, scratch, _ymax);
+
+    // drop repeated points (the clipper makes them at corners):
+    output.clear();
+    for (const osg::Vec3d& p : scratch)
+    {
+        if (output.empty() || p != output.back())
+            output.push_back(p);
+    }
+    while (output.size() > 1 && output.front() == output.back())
+    {
+        output.pop_back();
+    }
+
+    return output.size() >= 3;
+}
+
+void
+GeometryClipper::clipLine(const Vec3dVector& line, GeometryCollection& output) const
+{
+    osg::ref_ptr<LineString> current;
+
+    for (unsigned i = 0; i + 1 < line.size(); ++i)
+    {
+        const osg::Vec3d& a = line[i];
+        osg::Vec3d d = line[i + 1] - a;
+
+        // Liang-Barsky: narrow [t0, t1] against each of the four edges
+        double p[4] = { -d.x(), d.x(), -d.y(), d.y() };
+        double q[4] = { a.x() - _xmin, _xmax - a.x(), a.y() - _ymin, _ymax - a.y() };
+        double t0 = 0.0, t1 = 1.0;
+        bool visible = true;
+
+        for (unsigned k = 0; k < 4 && visible; ++k)
+        {
+            if (p[k] == 0.0)
+            {
+                visible = q[k] >= 0.0;
+            }
+            else
+            {
+                double r = q[k] / p[k];
+                if (p[k] < 0.0)
+                {
+                    if (r > t1) visible = false;
+                    else if (r > t0) t0 = r;
+                }
+                else
+                {
+                    if (r < t0) visible = false;
+                    else if (r < t1) t1 = r;
+                }
+            }
+        }
+
+        if (!visible)
+        {
+            current = 0L;
+            continue;
+        }
+
+        // start a new part whenever the segment enters the rectangle
+        if (!current.valid() || t0 > 0.0)
+        {
+            current = new LineString();
+            current->push_back(t0 > 0.0 ? a + d * t0 : a);
+            output.push_back(current.get());
+        }
+        current->push_back(t1 < 1.0 ? a + d * t1 : line[i + 1]);
+
+        // and end it whenever the segment leaves
+        if (t1 < 1.0)
+            current = 0L;
+    }
+}
+
+//........................................................................
+
+ClipCache::ClipCache(unsigned maxTiles) :
+    _tiles(maxTiles)
+{
+    //nop
+}
+
+bool
+ClipCache::clip(
+    FeatureID fid,
+    const Geometry* original,
+    const TileKey& key,
+    const Bounds& bounds,
+    osg::ref_ptr<Geometry>& output)
+{
+    output = 0L;
+    if (!original)
+        return false;
+
+    Clip clip;
+    clip.numPoints = original->getTotalPointCount();
+    clip.originalBounds = original->getBounds();
+
+    // Find the closest tile (this one or an ancestor) that already clipped
+    // this feature to bounds containing ours, and start from its result.
+    osg::ref_ptr<const Geometry> source = original;
+    std::shared_ptr<TileClips> entry;
+    {
+        Threading::ScopedMutexLock lock(_mutex);
+
+        for (TileKey k = key; k.valid(); k = k.createParentKey())
+        {
+            TileLRU::Record rec;
+            if (_tiles.get(k, rec) && rec.value()->bounds.contains(bounds))
+            {
+                std::shared_ptr<TileClips> tile = rec.value();
+                Threading::ScopedMutexLock tileLock(tile->mutex);
+                auto i = tile->clips.find(fid);
+                if (i != tile->clips.end() &&
+                    i->second.numPoints == clip.numPoints &&
+                    i->second.originalBounds._min == clip.originalBounds._min &&
+                    i->second.originalBounds._max == clip.originalBounds._max)
+                {
+                    // an empty result stays empty in every child
+                    if (!i->second.geom.valid())
+                        return false;
+
+                    source = i->second.geom;
+                    break;
+                }
+            }
+        }
+
+        TileLRU::Record rec;
+        if (_tiles.get(key, rec))
+        {
+            entry = rec.value();
+        }
+        else
+        {
+            entry = std::make_shared<TileClips>();
+            entry->bounds = bounds;
+            _tiles.insert(key, entry);
+        }
+    }
+
+    osg::ref_ptr<Geometry> clipped;
+    GeometryClipper(bounds).clip(source.get(), clipped);
+
+    clip.geom = clipped.get();
+    {
+        Threading::ScopedMutexLock lock(entry->mutex);
+        entry->clips[fid] = clip;
+    }
+
+    if (!clipped.valid())
+        return false;
+
+    // the cached copy must stay untouched by downstream filters
+    output = clipped->clone();
+    return true;
+}
+
+void
+ClipCache::clear()
+{
+    Threading::ScopedMutexLock lock(_mutex);
+    _tiles.clear();
+}
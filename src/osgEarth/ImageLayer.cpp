@@ -500,6 +500,16 @@ ImageLayer::createImageInKeyProfile(
         }
     }
 
+    // Skip the source if we already know it has nothing for this key.
+    DataAvailability* availability = getDataAvailability(key.getProfile());
+    if (availability && availability->isEmpty(key))
+    {
+        if (cachedImage.valid())
+            return GeoImage(cachedImage.get(), key.getExtent());
+        else
+            return GeoImage::INVALID;
+    }
+
     if (key.getProfile()->isHorizEquivalentTo(getProfile()))
     {
         result = createImageImplementation(key, progress);
@@ -516,6 +526,13 @@ ImageLayer::createImageInKeyProfile(
         return GeoImage::INVALID;
     }
 
+    // Only a source that says it has nothing is remembered; errors
+    // (timeouts, server failures, a busy driver) may not recur.
+    if (availability && (result.valid() || result.getStatus().code() == Status::NoData))
+    {
+        recordDataAvailability(key, result.valid());
+    }
+
     if (result.valid())
     {
         // invoke user callbacks
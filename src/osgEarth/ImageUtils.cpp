@@ -905,6 +905,16 @@ ImageUtils::makeTexture2DArray(osg::Image* image)
     return tex2dArray;
 }
 
+namespace
+{
+    // x/255 rounded to nearest, without a divide (exact for x <= 255*255)
+    inline unsigned div255(unsigned x)
+    {
+        x += 128u;
+        return (x + (x >> 8)) >> 8;
+    }
+}
+
 bool
 ImageUtils::mix(osg::Image* dest, const osg::Image* src, float a)
 {
@@ -916,6 +926,36 @@ ImageUtils::mix(osg::Image* dest, const osg::Image* src, float a)
     }
 
     a = osg::clampBetween( a, 0.0f, 1.0f );
+
+    // fast path for the common 8-bit RGBA case; plain integer loops over
+    // each row that the compiler can vectorize
+    if (src->getPixelFormat() == GL_RGBA && src->getDataType() == GL_UNSIGNED_BYTE &&
+        dest->getPixelFormat() == GL_RGBA && dest->getDataType() == GL_UNSIGNED_BYTE)
+    {
+        const unsigned a8 = (unsigned)(a * 255.0f + 0.5f);
+        const int n = src->s();
+
+        for (int r = 0; r < src->r(); ++r)
+        {
+            for (int t = 0; t < src->t(); ++t)
+            {
+                const unsigned char* sp = src->data(0, t, r);
+                unsigned char* dp = dest->data(0, t, r);
+
+                for (int i = 0; i < n; ++i, sp += 4, dp += 4)
+                {
+                    unsigned sa = div255(sp[3] * a8);
+                    unsigned ia = 255u - sa;
+                    dp[0] = (unsigned char)div255(dp[0] * ia + sp[0] * sa);
+                    dp[1] = (unsigned char)div255(dp[1] * ia + sp[1] * sa);
+                    dp[2] = (unsigned char)div255(dp[2] * ia + sp[2] * sa);
+                    dp[3] = (unsigned char)osg::maximum(sa, (unsigned)dp[3]);
+                }
+            }
+        }
+        return true;
+    }
+
     bool srcHasAlpha = hasAlphaChannel(src);
     bool destHasAlpha = hasAlphaChannel(dest);
 
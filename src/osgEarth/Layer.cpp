@@ -25,6 +25,7 @@
 #include <osgEarth/TerrainEngineNode>
 #include <osgEarth/TerrainResources>
 #include <osg/StateSet>
+#include <osg/Timer>
 
 using namespace osgEarth;
 
@@ -316,6 +317,7 @@ Layer::init()
     _renderType = RENDERTYPE_NONE;
     _status.set(Status::ResourceUnavailable, getEnabled() ? "Layer closed" : "Layer disabled");
     _isClosing = false;
+    _openDuration = 0.0;
 
     // For detecting scene graph changes at runtime
     _sceneGraphCallbacks = new SceneGraphCallbacks(this);
@@ -355,8 +357,12 @@ Layer::open()
         getOrCreateStateSet()->setDefine(options().shaderDefine().get());
     }
 
+    osg::Timer_t start = osg::Timer::instance()->tick();
+
     setStatus(openImplementation());
 
+    _openDuration = osg::Timer::instance()->delta_s(start, osg::Timer::instance()->tick());
+
     if (isOpen())
     {
         fireCallback(&LayerCallback::onOpen);
@@ -150,6 +150,17 @@ MBTilesImageLayer::setDataExtents(const DataExtentList& values)
     }
 }
 
+void
+MBTilesImageLayer::prepopulateDataAvailability(DataAvailability* index) const
+{
+    // the bounds metadata covers every tile in the database,
+    // unless we are still writing to it
+    if (!isWritingRequested())
+    {
+        index->addCoverage(getDataExtents());
+    }
+}
+
 GeoImage
 MBTilesImageLayer::createImageImplementation(const TileKey& key, ProgressCallback* progress) const
 {
@@ -160,6 +171,8 @@ MBTilesImageLayer::createImageImplementation(const TileKey& key, ProgressCallbac
 
     if (r.succeeded())
         return GeoImage(r.releaseImage(), key.getExtent());
+    else if (r.code() == ReadResult::RESULT_NOT_FOUND)
+        return GeoImage(Status(Status::NoData, r.errorDetail()));
     else
         return GeoImage(Status(r.errorDetail()));
 }
@@ -263,6 +276,17 @@ MBTilesElevationLayer::setDataExtents(const DataExtentList& values)
     }
 }
 
+void
+MBTilesElevationLayer::prepopulateDataAvailability(DataAvailability* index) const
+{
+    // the bounds metadata covers every tile in the database,
+    // unless we are still writing to it
+    if (!isWritingRequested())
+    {
+        index->addCoverage(getDataExtents());
+    }
+}
+
 GeoHeightField
 MBTilesElevationLayer::createHeightFieldImplementation(const TileKey& key, ProgressCallback* progress) const
 {
@@ -277,6 +301,10 @@ MBTilesElevationLayer::createHeightFieldImplementation(const TileKey& key, Progr
         osg::HeightField* hf = conv.convert( r.getImage() );
         return GeoHeightField(hf, key.getExtent());
     }
+    else if (r.code() == ReadResult::RESULT_NOT_FOUND)
+    {
+        return GeoHeightField(Status(Status::NoData, r.errorDetail()));
+    }
     else
     {
         return GeoHeightField(Status(r.errorDetail()));
@@ -694,7 +722,7 @@ MBTiles::Driver::read(
             }
         }
     }
-    else
+    else if (rc != SQLITE_DONE)
     {
         OE_DEBUG << LC << "SQL QUERY failed for " << query << ": " << std::endl;
         valid = false;
@@ -702,6 +730,12 @@ MBTiles::Driver::read(
 
     sqlite3_finalize( select );
 
+    if (rc == SQLITE_DONE)
+        return ReadResult::RESULT_NOT_FOUND; // no such tile
+
+    if (!valid || !result)
+        return ReadResult::RESULT_READER_ERROR;
+
     return ReadResult(result);
 }
 
@@ -24,11 +24,21 @@
 #include <osgEarth/FileUtils>
 #include <osgEarth/GeoData>
 #include <osgEarth/FeatureSource>
+#include <osgEarth/StringUtils>
+#include <osgEarth/Endian>
+#include <osgEarth/Threading>
+#include <osgEarth/JsonUtils>
 #include <osgDB/Registry>
-#include <list>
-#include <stdio.h>
-#include <stdlib.h>
-#include "vector_tile.pb.h"
+#include <osg/BoundingBox>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <cfloat>
+#include <cmath>
+#include <sstream>
+#include <streambuf>
+#include <thread>
+#include <unordered_map>
 
 #ifdef OSGEARTH_HAVE_SQLITE3
 #include <sqlite3.h>
@@ -39,21 +49,12 @@ using namespace osgEarth::MVT;
 
 #define LC "[MVT] "
 
-#define CMD_BITS 3
 #define CMD_MOVETO 1
 #define CMD_LINETO 2
 #define CMD_CLOSEPATH 7
 
 namespace osgEarth { namespace MVT
 {
-    // https://github.com/mapbox/mapnik-vector-tile/blob/master/examples/c%2B%2B/tileinfo.cpp
-    enum CommandType {
-        SEG_END    = 0,
-        SEG_MOVETO = 1,
-        SEG_LINETO = 2,
-        SEG_CLOSE = (0x40 | 0x0f)
-    };
-
     enum eGeomType {
         Unknown = 0,
         Point = 1,
@@ -61,403 +62,1183 @@ namespace osgEarth { namespace MVT
         Polygon = 3
     };
 
-    int zig_zag_decode(int n)
+    // Protocol buffer wire types
+    enum WireType {
+        WIRE_VARINT  = 0,
+        WIRE_FIXED64 = 1,
+        WIRE_BYTES   = 2,
+        WIRE_FIXED32 = 5
+    };
+
+    // Field numbers from vector_tile.proto
+    enum {
+        TILE_LAYERS = 3,
+
+        LAYER_NAME = 1,
+        LAYER_FEATURES = 2,
+        LAYER_KEYS = 3,
+        LAYER_VALUES = 4,
+        LAYER_EXTENT = 5,
+        LAYER_VERSION = 15,
+
+        FEATURE_ID = 1,
+        FEATURE_TAGS = 2,
+        FEATURE_TYPE = 3,
+        FEATURE_GEOMETRY = 4,
+
+        VALUE_STRING = 1,
+        VALUE_FLOAT = 2,
+        VALUE_DOUBLE = 3,
+        VALUE_INT = 4,
+        VALUE_UINT = 5,
+        VALUE_SINT = 6,
+        VALUE_BOOL = 7
+    };
+
+    // Forward-only reader over an encoded protocol buffer message.
+    // Strings and embedded messages come back as readers over the
+    // original bytes, so nothing is copied or allocated.
+    struct PBFReader
     {
-        return (n >> 1) ^ (-(n & 1));
+        const char* _pos;
+        const char* _end;
+        bool _error;
+
+        PBFReader() : _pos(nullptr), _end(nullptr), _error(false) { }
+
+        PBFReader(const char* data, std::size_t length) :
+            _pos(data), _end(data + length), _error(false) { }
+
+        bool empty() const { return _pos >= _end; }
+
+        std::size_t size() const { return _end - _pos; }
+
+        bool error() const { return _error; }
+
+        bool equals(const std::string& value) const {
+            return size() == value.size() && ::memcmp(_pos, value.data(), size()) == 0;
+        }
+
+        std::string str() const {
+            return std::string(_pos, size());
+        }
+
+        // next field tag in the message; false at the end or on error
+        bool next(unsigned& field, unsigned& wire) {
+            if (_error || empty())
+                return false;
+            std::uint64_t tag = varint();
+            field = (unsigned)(tag >> 3);
+            wire = (unsigned)(tag & 0x7);
+            return !_error;
+        }
+
+        std::uint64_t varint() {
+            std::uint64_t result = 0;
+            for (unsigned shift = 0; shift < 64 && _pos < _end; shift += 7) {
+                std::uint8_t b = (std::uint8_t)*_pos++;
+                result |= (std::uint64_t)(b & 0x7f) << shift;
+                if ((b & 0x80) == 0)
+                    return result;
+            }
+            _error = true;
+            return 0;
+        }
+
+        // length-delimited field (string, embedded message, packed array)
+        PBFReader bytes() {
+            std::uint64_t length = varint();
+            if (_error || length > (std::uint64_t)size()) {
+                _error = true;
+                return PBFReader();
+            }
+            PBFReader result(_pos, (std::size_t)length);
+            _pos += length;
+            return result;
+        }
+
+        std::uint32_t fixed32() {
+            std::uint32_t value = 0;
+            if (advance(4))
+                ::memcpy(&value, _pos - 4, 4);
+            return le32toh(value);
+        }
+
+        std::uint64_t fixed64() {
+            std::uint64_t value = 0;
+            if (advance(8))
+                ::memcpy(&value, _pos - 8, 8);
+            return le64toh(value);
+        }
+
+        bool advance(std::size_t n) {
+            if (size() < n) {
+                _error = true;
+                return false;
+            }
+            _pos += n;
+            return true;
+        }
+
+        void skip(unsigned wire) {
+            switch (wire) {
+            case WIRE_VARINT:  varint(); break;
+            case WIRE_FIXED64: advance(8); break;
+            case WIRE_BYTES:   bytes(); break;
+            case WIRE_FIXED32: advance(4); break;
+            default:           _error = true;
+            }
+        }
+    };
+
+    inline std::int32_t zig_zag_decode(std::uint32_t n)
+    {
+        return (std::int32_t)(n >> 1) ^ -(std::int32_t)(n & 1);
     }
 
-    Geometry* decodeLine(const mapnik::vector::tile_feature& feature, const TileKey& key, unsigned int tileres)
+    inline std::int64_t zig_zag_decode64(std::uint64_t n)
+    {
+        return (std::int64_t)(n >> 1) ^ -(std::int64_t)(n & 1);
+    }
+
+    inline bool contains(const std::vector<std::string>& list, const PBFReader& name)
+    {
+        for (auto& i : list)
+            if (name.equals(i))
+                return true;
+        return false;
+    }
+
+    // Per-thread scratch space reused from layer to layer, so decoding
+    // allocates nothing beyond the features it returns.
+    // What to do with the values of a key
+    enum ReadFlags {
+        READ_ATTRIBUTE = 1, // set the value as an attribute
+        READ_HEIGHT    = 2  // parse a "height" attribute out of it (other_tags)
+    };
+
+    struct Scratch
     {
-        unsigned int length = 0;
-        int cmd = -1;
-        const int cmd_bits = 3;
+        std::vector<PBFReader> features;
+        std::vector<PBFReader> keys;
+        std::vector<PBFReader> values;
+        std::vector<std::string> keyNames; // only for keys that are read
+        std::vector<char> readKey;         // READ_* flags per key
+        std::string inflated;
+    };
+
+    // Decodes a feature's geometry commands straight into the coordinate
+    // buffers of the output geometry.
+    Geometry* decodeGeometry(PBFReader geom, eGeomType type, const GeoExtent& extent, unsigned tileres)
+    {
+        const double x0 = extent.xMin();
+        const double y0 = extent.yMax();
+        const double sx = extent.width() / (double)tileres;
+        const double sy = extent.height() / (double)tileres;
+
+        std::int32_t x = 0, y = 0;
 
-        int x = 0;
-        int y = 0;
+        osg::ref_ptr<osgEarth::PointSet> points;
+        std::vector<osg::ref_ptr<osgEarth::Geometry> > parts;
+        osg::ref_ptr<osgEarth::Geometry> current; // line or ring under construction
+        osg::ref_ptr<osgEarth::Polygon> currentPolygon;
 
-        std::vector< osg::ref_ptr< osgEarth::LineString > > lines;
-        osg::ref_ptr< osgEarth::LineString > currentLine;
+        if (type == MVT::Point)
+            points = new osgEarth::PointSet();
 
-        for (int k = 0; k < feature.geometry_size();)
+        while (!geom.empty())
         {
-            if (!length)
-            {
-                unsigned int cmd_length = feature.geometry(k++);
-                cmd = cmd_length & ((1 << cmd_bits) - 1);
-                length = cmd_length >> cmd_bits;
-            }
-            if (length > 0)
+            std::uint32_t cmd_length = (std::uint32_t)geom.varint();
+            unsigned cmd = cmd_length & 0x7;
+            unsigned count = cmd_length >> 3;
+
+            if (cmd == CMD_MOVETO || cmd == CMD_LINETO)
             {
-                length--;
+                osgEarth::Geometry* target = points.get();
 
-                if (cmd == SEG_MOVETO || cmd == SEG_LINETO)
+                if (type == MVT::Polygon)
                 {
-                    if (cmd == SEG_MOVETO)
+                    if (!current.valid())
+                        current = new osgEarth::Ring();
+                    target = current.get();
+                }
+                else if (type == MVT::LineString)
+                {
+                    if (cmd == CMD_MOVETO)
                     {
-                        currentLine = new osgEarth::LineString;
-                        lines.push_back( currentLine.get() );
+                        current = new osgEarth::LineString();
+                        parts.push_back(current.get());
                     }
-                    int px = feature.geometry(k++);
-                    int py = feature.geometry(k++);
-                    px = zig_zag_decode(px);
-                    py = zig_zag_decode(py);
+                    target = current.get();
+                }
 
-                    x += px;
-                    y += py;
+                if (target)
+                    target->reserve(target->size() + count);
 
-                    double width = key.getExtent().width();
-                    double height = key.getExtent().height();
+                for (unsigned i = 0; i < count; ++i)
+                {
+                    x += zig_zag_decode((std::uint32_t)geom.varint());
+                    y += zig_zag_decode((std::uint32_t)geom.varint());
+                    if (target)
+                        target->push_back(x0 + sx * (double)x, y0 - sy * (double)y, 0.0);
+                }
+            }
 
-                    double geoX = key.getExtent().xMin() + (width/(double)tileres) * (double)x;
-                    double geoY = key.getExtent().yMax() - (height/(double)tileres) * (double)y;
+            else if (cmd == CMD_CLOSEPATH)
+            {
+                if (type == MVT::Polygon && current.valid())
+                {
+                    // https://github.com/mapbox/vector-tile-spec/tree/master/2.1
+                    // Each polygon has one exterior ring and zero or more interior rings,
+                    // in sequence; the orientation of a ring says which it is.
+                    // MVT orientations are the opposite of osgEarth's: clockwise means
+                    // exterior ring, counter clockwise means interior.
+                    osgEarth::Ring* ring = static_cast<osgEarth::Ring*>(current.get());
+                    Geometry::Orientation orientation = ring->getOrientation();
+                    ring->close();
 
-                    if (currentLine.valid())
+                    if (orientation == Geometry::ORIENTATION_CW)
+                    {
+                        // exterior ring starts a new polygon
+                        ring->rewind(Geometry::ORIENTATION_CCW);
+                        currentPolygon = new osgEarth::Polygon(&ring->asVector());
+                        parts.push_back(currentPolygon.get());
+                    }
+                    else if (orientation == Geometry::ORIENTATION_CCW)
                     {
-                        currentLine->push_back(geoX, geoY, 0);
+                        // interior ring is a hole in the current polygon
+                        if (currentPolygon.valid())
+                        {
+                            ring->rewind(Geometry::ORIENTATION_CW);
+                            currentPolygon->getHoles().push_back(ring);
+                        }
+                        else
+                        {
+                            // this means we encountered a "hole" without a parent outer ring,
+                            // discard for now -gw
+                            OE_INFO << LC << "Discarding improperly wound polygon (hole without an outer ring)\n";
+                        }
                     }
+
+                    // Start a new ring
+                    current = 0L;
                 }
             }
-        }
 
-        currentLine = 0;
+            else
+            {
+                // unknown command; the rest of the geometry can't be trusted
+                break;
+            }
+
+            if (geom.error())
+                return 0L;
+        }
 
-        if (lines.size() == 0)
+        if (points.valid())
         {
-            return 0;
+            return points.release();
+        }
+        else if (parts.empty())
+        {
+            return 0L;
         }
-        else if (lines.size() == 1)
+        else if (parts.size() == 1)
         {
-            // Just return a simple LineString
-            return lines[0].release();
+            return parts[0].release();
         }
         else
         {
-            // Return a multilinestring
             MultiGeometry* multi = new MultiGeometry;
-            for (unsigned int i = 0; i < lines.size(); i++)
+            for (auto& part : parts)
             {
-                multi->add(lines[i].get());
+                multi->add(part.get());
             }
             return multi;
         }
     }
 
-    Geometry* decodePoint(const mapnik::vector::tile_feature& feature, const TileKey& key, unsigned int tileres)
+    // Sets a feature attribute from an encoded tile value, as the
+    // READ_* flags say
+    void setValue(Feature* feature, const std::string& name, PBFReader value, char flags)
     {
-        unsigned int length = 0;
-        int cmd = -1;
-        const int cmd_bits = 3;
+        unsigned field, wire;
+        while (value.next(field, wire))
+        {
+            if (!(flags & READ_ATTRIBUTE) && !(field == VALUE_STRING && wire == WIRE_BYTES))
+            {
+                value.skip(wire);
+                continue;
+            }
 
-        int x = 0;
-        int y = 0;
+            if (field == VALUE_STRING && wire == WIRE_BYTES)
+            {
+                std::string str = value.bytes().str();
 
-        osgEarth::PointSet *geometry = new osgEarth::PointSet();
+                // Special path for getting heights from our test dataset.
+                if (flags & READ_HEIGHT)
+                {
+                    StringTokenizer tok("=>");
+                    StringVector tized;
+                    tok.tokenize(str, tized);
+                    if (tized.size() == 3 && tized[0] == "height")
+                    {
+                        // Remove quotes from the height
+                        float height = as<float>(tized[2], FLT_MAX);
+                        if (height != FLT_MAX)
+                        {
+                            feature->set("height", height);
+                        }
+                    }
+                }
+
+                if (flags & READ_ATTRIBUTE)
+                    feature->set(name, str);
+                return;
+            }
+            else if (field == VALUE_FLOAT && wire == WIRE_FIXED32)
+            {
+                std::uint32_t bits = value.fixed32();
+                float f;
+                ::memcpy(&f, &bits, 4);
+                feature->set(name, (double)f);
+                return;
+            }
+            else if (field == VALUE_DOUBLE && wire == WIRE_FIXED64)
+            {
+                std::uint64_t bits = value.fixed64();
+                double d;
+                ::memcpy(&d, &bits, 8);
+                feature->set(name, d);
+                return;
+            }
+            else if ((field == VALUE_INT || field == VALUE_UINT) && wire == WIRE_VARINT)
+            {
+                feature->set(name, (long long)value.varint());
+                return;
+            }
+            else if (field == VALUE_SINT && wire == WIRE_VARINT)
+            {
+                feature->set(name, (long long)zig_zag_decode64(value.varint()));
+                return;
+            }
+            else if (field == VALUE_BOOL && wire == WIRE_VARINT)
+            {
+                feature->set(name, value.varint() != 0);
+                return;
+            }
+
+            value.skip(wire);
+        }
+    }
+
+    bool readLayer(PBFReader layer, const TileKey& key, const DecodeOptions* options, Scratch& scratch, FeatureList& features)
+    {
+        PBFReader name;
+        unsigned extent = 4096;
 
-        for (int k = 0; k < feature.geometry_size();)
+        scratch.features.clear();
+        scratch.keys.clear();
+        scratch.values.clear();
+
+        // Collect the pieces first; features usually precede the
+        // keys and values they refer to.
+        unsigned field, wire;
+        while (layer.next(field, wire))
         {
-            if (!length)
+            if (field == LAYER_NAME && wire == WIRE_BYTES)
             {
-                unsigned int cmd_length = feature.geometry(k++);
-                cmd = cmd_length & ((1 << cmd_bits) - 1);
-                length = cmd_length >> cmd_bits;
+                name = layer.bytes();
+
+                if (options && !options->layers.empty() && !contains(options->layers, name))
+                    return true;
             }
-            if (length > 0)
+            else if (field == LAYER_FEATURES && wire == WIRE_BYTES)
+                scratch.features.push_back(layer.bytes());
+            else if (field == LAYER_KEYS && wire == WIRE_BYTES)
+                scratch.keys.push_back(layer.bytes());
+            else if (field == LAYER_VALUES && wire == WIRE_BYTES)
+                scratch.values.push_back(layer.bytes());
+            else if (field == LAYER_EXTENT && wire == WIRE_VARINT)
+                extent = (unsigned)layer.varint();
+            else
+                layer.skip(wire);
+        }
+
+        if (layer.error())
+            return false;
+
+        if (scratch.features.empty() || extent == 0)
+            return true;
+
+        // Work out once per layer which keys to read
+        const std::vector<std::string>* projection =
+            options && !options->attributes.empty() ? &options->attributes : nullptr;
+
+        bool readHeight = !projection || std::find(projection->begin(), projection->end(), "height") != projection->end();
+
+        scratch.readKey.assign(scratch.keys.size(), 0);
+        if (scratch.keyNames.size() < scratch.keys.size())
+            scratch.keyNames.resize(scratch.keys.size());
+
+        for (unsigned k = 0; k < scratch.keys.size(); ++k)
+        {
+            const PBFReader& keyName = scratch.keys[k];
+            char flags = 0;
+            if (!projection || contains(*projection, keyName))
+                flags |= READ_ATTRIBUTE;
+            if (readHeight && keyName.equals("other_tags"))
+                flags |= READ_HEIGHT;
+
+            if (flags)
             {
-                length--;
-                if (cmd == SEG_MOVETO || cmd == SEG_LINETO)
-                {
-                    int px = feature.geometry(k++);
-                    int py = feature.geometry(k++);
-                    px = zig_zag_decode(px);
-                    py = zig_zag_decode(py);
+                scratch.readKey[k] = flags;
+                scratch.keyNames[k].assign(keyName._pos, keyName.size());
+            }
+        }
+
+        bool setLayerName = !projection || contains(*projection, PBFReader("mvt_layer", 9));
+        std::string layerName = setLayerName ? name.str() : std::string();
+
+        const GeoExtent& tileExtent = key.getExtent();
+
+        for (auto& encoded : scratch.features)
+        {
+            PBFReader feature = encoded;
+            PBFReader tags, geom;
+            eGeomType geomType = MVT::Unknown;
+
+            while (feature.next(field, wire))
+            {
+                if (field == FEATURE_TAGS && wire == WIRE_BYTES)
+                    tags = feature.bytes();
+                else if (field == FEATURE_TYPE && wire == WIRE_VARINT)
+                    geomType = static_cast<eGeomType>(feature.varint());
+                else if (field == FEATURE_GEOMETRY && wire == WIRE_BYTES)
+                    geom = feature.bytes();
+                else
+                    feature.skip(wire);
+            }
+
+            if (feature.error())
+                return false;
+
+            // UNKNOWN (or any other) geometry type: nothing to decode it as
+            if (geomType != MVT::Point && geomType != MVT::LineString && geomType != MVT::Polygon)
+                continue;
 
-                    x += px;
-                    y += py;
+            osg::ref_ptr<osgEarth::Geometry> geometry = decodeGeometry(geom, geomType, tileExtent, extent);
+            if (!geometry.valid())
+                continue;
 
-                    double width = key.getExtent().width();
-                    double height = key.getExtent().height();
+            if (geomType == MVT::Point)
+            {
+                // This is a bit of a hack, but if a point is outside of the extents we remove it.
+                // Lines and Polygons that extend outside of the tileset we keep though b/c we assume that they are just slightly going outside of the
+                // extent.  Should probably make this an option somewhere.
+                if (!tileExtent.contains(geometry->getBounds().center()))
+                    continue;
+            }
 
-                    double geoX = key.getExtent().xMin() + (width/(double)tileres) * (double)x;
-                    double geoY = key.getExtent().yMax() - (height/(double)tileres) * (double)y;
-                    geometry->push_back(geoX, geoY, 0);
+            osg::ref_ptr<Feature> oeFeature = new Feature(geometry.get(), key.getProfile()->getSRS());
+
+            // Set the layer name as "mvt_layer" so we can filter it later
+            if (setLayerName)
+            {
+                oeFeature->set("mvt_layer", layerName);
+            }
+
+            // Read attributes
+            while (!tags.empty())
+            {
+                unsigned k = (unsigned)tags.varint();
+                unsigned v = (unsigned)tags.varint();
+                if (tags.error())
+                    break;
+
+                if (k < scratch.keys.size() && scratch.readKey[k] && v < scratch.values.size())
+                {
+                    setValue(oeFeature.get(), scratch.keyNames[k], scratch.values[v], scratch.readKey[k]);
                 }
             }
+
+            features.push_back(oeFeature.get());
         }
 
-        return geometry;
+        return true;
     }
 
-    Geometry* decodePolygon(const mapnik::vector::tile_feature& feature, const  TileKey& key, unsigned int tileres)
+    // std::streambuf over a block of memory, for handing tile bytes
+    // to the decompressor without copying them
+    struct MemoryBuffer : public std::streambuf
     {
-        /*
-         https://github.com/mapbox/vector-tile-spec/tree/master/2.1
-         Decoding polygons is a bit more difficult than lines or points.
-         A Polygon geometry is either a single polygon or a multipolygon.  Each polygon has one exterior ring and zero or more interior rings.
-         The rings are in sequence and you must check the orientation of the ring to know if it's an exterior ring (new polygon) or an
-         interior ring (inner polygon of the current polygon).
-         */
+        MemoryBuffer(const char* data, std::size_t length)
+        {
+            char* p = const_cast<char*>(data);
+            setg(p, p, p + length);
+        }
+    };
 
+    bool readTile(const char* data, std::size_t length, const TileKey& key, FeatureList& features, const DecodeOptions* options)
+    {
+        features.clear();
 
-        unsigned int length = 0;
-        int cmd = -1;
-        const int cmd_bits = 3;
+        if (!data || length == 0)
+            return false;
 
-        int x = 0;
-        int y = 0;
+        static thread_local Scratch scratch;
 
-        // The list of polygons we've collected
-        std::vector< osg::ref_ptr< osgEarth::Polygon > > polygons;
+        // gzip or zlib header?
+        const unsigned char* magic = (const unsigned char*)data;
+        bool compressed = length >= 2 && (
+            (magic[0] == 0x1f && magic[1] == 0x8b) ||
+            (magic[0] == 0x78 && ((magic[0] << 8) | magic[1]) % 31 == 0));
 
-        osg::ref_ptr< osgEarth::Polygon > currentPolygon;
+        if (compressed)
+        {
+            osg::ref_ptr<osgDB::BaseCompressor> compressor =
+                osgDB::Registry::instance()->getObjectWrapperManager()->findCompressor("zlib");
+            if (!compressor.valid())
+            {
+                return false;
+            }
+
+            MemoryBuffer buffer(data, length);
+            std::istream in(&buffer);
+            scratch.inflated.clear();
+            if (compressor->decompress(in, scratch.inflated))
+            {
+                data = scratch.inflated.data();
+                length = scratch.inflated.size();
+            }
+        }
 
-        osg::ref_ptr< osgEarth::Ring > currentRing;
+        PBFReader tile(data, length);
+        unsigned field, wire;
+        bool ok = true;
 
-        for (int k = 0; k < feature.geometry_size();)
+        while (ok && tile.next(field, wire))
         {
-            if (!length)
+            if (field == TILE_LAYERS && wire == WIRE_BYTES)
             {
-                unsigned int cmd_length = feature.geometry(k++);
-                cmd = cmd_length & ((1 << cmd_bits) - 1);
-                length = cmd_length >> cmd_bits;
+                ok = readLayer(tile.bytes(), key, options, scratch, features);
             }
-            if (length > 0)
+            else
             {
-                length--;
-                if (cmd == SEG_MOVETO || cmd == SEG_LINETO)
-                {
-                    if (!currentRing)
-                    {
-                        currentRing = new osgEarth::Ring();
-                    }
+                tile.skip(wire);
+            }
+        }
 
-                    int px = feature.geometry(k++);
-                    int py = feature.geometry(k++);
-                    px = zig_zag_decode(px);
-                    py = zig_zag_decode(py);
+        if (!ok || tile.error())
+        {
+            OE_WARN << LC << "Failed to parse mvt" << key.str() << std::endl;
+            features.clear();
+            return false;
+        }
 
-                    x += px;
-                    y += py;
+        return true;
+    }
 
-                    double width = key.getExtent().width();
-                    double height = key.getExtent().height();
+    bool readTile(std::istream& in, const TileKey& key, FeatureList& features)
+    {
+        std::string data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        return readTile(data.data(), data.size(), key, features, nullptr);
+    }
 
-                    double geoX = key.getExtent().xMin() + (width/(double)tileres) * (double)x;
-                    double geoY = key.getExtent().yMax() - (height/(double)tileres) * (double)y;
-                    currentRing->push_back(geoX, geoY, 0);
-                }
-                else if (cmd == (SEG_CLOSE & ((1 << cmd_bits) - 1)))
-                {
-                    // The orientation is the opposite of what we want for features.  clockwise means exterior ring, counter clockwise means interior
+    //....................................................................
+    // Encoding
 
-                    // Figure out what to do with the ring based on the orientation of the ring
-                    Geometry::Orientation orientation = currentRing->getOrientation();
-                    // Close the ring.
-                    currentRing->close();
+    // Protocol buffer writer that appends to a string
+    struct PBFWriter
+    {
+        std::string& _buf;
 
-                    // Clockwise means exterior ring.  Start a new polygon and add the ring.
-                    if (orientation == Geometry::ORIENTATION_CW)
-                    {
-                        // osgearth orientations are reversed from mvt
-                        currentRing->rewind(Geometry::ORIENTATION_CCW);
+        PBFWriter(std::string& buf) : _buf(buf) { }
 
-                        currentPolygon = new osgEarth::Polygon(&currentRing->asVector());
-                        polygons.push_back(currentPolygon.get());
-                    }
-                    else if (orientation == Geometry::ORIENTATION_CCW)
-                    // Counter clockwise means a hole, add it to the existing polygon.
-                    {
-                        if (currentPolygon.valid())
-                        {
-                            // osgearth orientations are reversed from mvt
-                            currentRing->rewind(Geometry::ORIENTATION_CW);
-                            currentPolygon->getHoles().push_back( currentRing );
-                        }
-                        else
-                        {
-                            // this means we encountered a "hole" without a parent outer ring,
-                            // discard for now -gw
-                            OE_INFO << LC << "Discarding improperly wound polygon (hole without an outer ring)\n";
-                        }
-                    }
+        static std::size_t varintSize(std::uint64_t value) {
+            std::size_t n = 1;
+            for (; value >= 0x80; value >>= 7)
+                ++n;
+            return n;
+        }
 
-                    // Start a new ring
-                    currentRing = 0;
-                }
-            }
+        void varint(std::uint64_t value) {
+            for (; value >= 0x80; value >>= 7)
+                _buf.push_back((char)((value & 0x7f) | 0x80));
+            _buf.push_back((char)value);
         }
 
-        currentRing = 0;
-        currentPolygon = 0;
+        void tag(unsigned field, unsigned wire) {
+            varint((field << 3) | wire);
+        }
 
-        if (polygons.size() == 0)
-        {
-            return 0;
+        void number(unsigned field, std::uint64_t value) {
+            tag(field, WIRE_VARINT);
+            varint(value);
+        }
+
+        void bytes(unsigned field, const std::string& value) {
+            tag(field, WIRE_BYTES);
+            varint(value.size());
+            _buf.append(value);
         }
-        else if (polygons.size() == 1)
+
+        void fixed64(unsigned field, std::uint64_t value) {
+            tag(field, WIRE_FIXED64);
+            for (unsigned i = 0; i < 8; ++i, value >>= 8)
+                _buf.push_back((char)(value & 0xff));
+        }
+
+        void packed(unsigned field, const std::vector<std::uint32_t>& values) {
+            std::size_t length = 0;
+            for (auto value : values)
+                length += varintSize(value);
+            tag(field, WIRE_BYTES);
+            varint(length);
+            for (auto value : values)
+                varint(value);
+        }
+    };
+
+    inline std::uint32_t zig_zag_encode(std::int32_t n)
+    {
+        return ((std::uint32_t)n << 1) ^ (std::uint32_t)(n >> 31);
+    }
+
+    inline std::uint64_t zig_zag_encode64(std::int64_t n)
+    {
+        return ((std::uint64_t)n << 1) ^ (std::uint64_t)(n >> 63);
+    }
+
+    // A path in tile grid units, Y down, before quantization
+    typedef std::vector<osg::Vec2d> Path;
+
+    struct GridPoint
+    {
+        std::int32_t x, y;
+        bool operator == (const GridPoint& rhs) const { return x == rhs.x && y == rhs.y; }
+    };
+    typedef std::vector<GridPoint> GridPath;
+
+    // Clips a ring (without a repeated end point) to the square [lo, hi]
+    // with Sutherland-Hodgman, one edge at a time.
+    void clipRing(Path& ring, double lo, double hi, Path& temp)
+    {
+        osg::BoundingBoxd box;
+        for (auto& p : ring)
+            box.expandBy(p.x(), p.y(), 0.0);
+
+        if (box.xMin() >= lo && box.xMax() <= hi && box.yMin() >= lo && box.yMax() <= hi)
+            return;
+
+        if (box.xMax() < lo || box.xMin() > hi || box.yMax() < lo || box.yMin() > hi)
         {
-            // Just return a simple polygon
-            return polygons[0].release();
+            ring.clear();
+            return;
         }
-        else
+
+        for (unsigned edge = 0; edge < 4 && !ring.empty(); ++edge)
         {
-            // Return a multipolygon
-            MultiGeometry* multi = new MultiGeometry;
-            for (unsigned int i = 0; i < polygons.size(); i++)
+            // edges: x >= lo, x <= hi, y >= lo, y <= hi
+            const unsigned axis = edge / 2;
+            const double bound = (edge & 1) ? hi : lo;
+            const double sign = (edge & 1) ? -1.0 : 1.0;
+
+            temp.clear();
+            const osg::Vec2d* prev = &ring.back();
+            bool prevInside = sign * ((*prev)[axis] - bound) >= 0.0;
+
+            for (auto& p : ring)
             {
-                multi->add(polygons[i].get());
+                bool inside = sign * (p[axis] - bound) >= 0.0;
+                if (inside != prevInside)
+                {
+                    double t = (bound - (*prev)[axis]) / (p[axis] - (*prev)[axis]);
+                    osg::Vec2d x = *prev + (p - *prev) * t;
+                    x[axis] = bound;
+                    temp.push_back(x);
+                }
+                if (inside)
+                    temp.push_back(p);
+
+                prev = &p;
+                prevInside = inside;
             }
-            return multi;
+            ring.swap(temp);
         }
     }
 
-    bool readTile(std::istream& in, const TileKey& key, FeatureList& features)
+    // Clips segment pq to the square [lo, hi] (Liang-Barsky), returning
+    // the parameters of the visible part.
+    bool clipSegment(const osg::Vec2d& p, const osg::Vec2d& q, double lo, double hi, double& t0, double& t1)
     {
-        features.clear();
+        const double dx = q.x() - p.x(), dy = q.y() - p.y();
+        const double num[4] = { p.x() - lo, hi - p.x(), p.y() - lo, hi - p.y() };
+        const double den[4] = { -dx, dx, -dy, dy };
 
-        // Get the compressor
-        osg::ref_ptr< osgDB::BaseCompressor> compressor = osgDB::Registry::instance()->getObjectWrapperManager()->findCompressor("zlib");
-        if (!compressor.valid())
+        t0 = 0.0, t1 = 1.0;
+        for (unsigned i = 0; i < 4; ++i)
         {
-            return false;
+            if (den[i] == 0.0)
+            {
+                if (num[i] < 0.0)
+                    return false;
+            }
+            else
+            {
+                double r = num[i] / den[i];
+                if (den[i] < 0.0)
+                {
+                    if (r > t1) return false;
+                    t0 = std::max(t0, r);
+                }
+                else
+                {
+                    if (r < t0) return false;
+                    t1 = std::min(t1, r);
+                }
+            }
         }
+        return true;
+    }
 
-        // Decompress the tile
-        std::string original((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
-        in.seekg (0, std::ios::beg);
-        std::string value;
-        if (!compressor->decompress(in, value))
+    // Clips a line to the square [lo, hi]; each visible run becomes a path.
+    void clipLine(const Path& line, double lo, double hi, std::vector<Path>& out)
+    {
+        Path run;
+        for (std::size_t i = 0; i + 1 < line.size(); ++i)
         {
-            value = original;
+            double t0, t1;
+            if (!clipSegment(line[i], line[i + 1], lo, hi, t0, t1))
+                continue;
+
+            osg::Vec2d d = line[i + 1] - line[i];
+            if (run.empty())
+                run.push_back(line[i] + d * t0);
+            run.push_back(line[i] + d * t1);
+
+            if (t1 < 1.0)
+            {
+                out.push_back(Path());
+                out.back().swap(run);
+            }
         }
+        if (run.size() > 1)
+            out.push_back(run);
+    }
+
+    double distance2ToSegment(const osg::Vec2d& p, const osg::Vec2d& a, const osg::Vec2d& b)
+    {
+        osg::Vec2d ab = b - a;
+        double len2 = ab.length2();
+        double t = len2 > 0.0 ? osg::clampBetween(((p - a) * ab) / len2, 0.0, 1.0) : 0.0;
+        return (a + ab * t - p).length2();
+    }
+
+    // Douglas-Peucker simplification in place. A ring (closed = true)
+    // keeps its first point and the point farthest from it.
+    void simplify(Path& path, double tolerance, bool closed, std::vector<std::pair<std::size_t, std::size_t> >& stack)
+    {
+        if (tolerance <= 0.0 || path.size() < 3)
+            return;
 
+        if (closed)
+            path.push_back(path.front());
 
-        mapnik::vector::tile tile;
+        const double tol2 = tolerance * tolerance;
+        std::vector<bool> keep(path.size(), false);
+        keep.front() = keep.back() = true;
 
-        if (tile.ParseFromString(value))
+        stack.clear();
+        stack.emplace_back(0, path.size() - 1);
+        while (!stack.empty())
         {
-            for (int i = 0; i < tile.layers().size(); i++)
+            std::size_t first = stack.back().first, last = stack.back().second;
+            stack.pop_back();
+
+            double max2 = -1.0;
+            std::size_t index = first;
+            for (std::size_t i = first + 1; i < last; ++i)
             {
-                const mapnik::vector::tile_layer &layer = tile.layers().Get(i);
+                double d2 = distance2ToSegment(path[i], path[first], path[last]);
+                if (d2 > max2)
+                    max2 = d2, index = i;
+            }
 
-                for (int j = 0; j < layer.features().size(); j++)
-                {
-                    const mapnik::vector::tile_feature &feature = layer.features().Get(j);
+            // a closed ring's first and last points coincide, so always split it
+            if (index > first && (max2 > tol2 || (first == 0 && last == path.size() - 1 && closed)))
+            {
+                keep[index] = true;
+                stack.emplace_back(first, index);
+                stack.emplace_back(index, last);
+            }
+        }
 
-                    osg::ref_ptr< Feature > oeFeature = new Feature(0, key.getProfile()->getSRS());
+        std::size_t n = 0;
+        for (std::size_t i = 0; i < path.size(); ++i)
+            if (keep[i])
+                path[n++] = path[i];
+        path.resize(closed ? n - 1 : n);
+    }
 
-                    // Set the layer name as "mvt_layer" so we can filter it later
-                    oeFeature->set("mvt_layer", layer.name());
+    void quantize(const Path& path, bool closed, GridPath& out)
+    {
+        out.clear();
+        for (auto& p : path)
+        {
+            GridPoint g = { (std::int32_t)std::floor(p.x() + 0.5), (std::int32_t)std::floor(p.y() + 0.5) };
+            if (out.empty() || !(g == out.back()))
+                out.push_back(g);
+        }
+        if (closed)
+        {
+            while (out.size() > 1 && out.back() == out.front())
+                out.pop_back();
+        }
+    }
 
-                    // Read attributes
-                    for (int k = 0; k < feature.tags().size(); k+=2)
-                    {
-                        std::string key = layer.keys().Get(feature.tags().Get(k));
-                        mapnik::vector::tile_value value = layer.values().Get(feature.tags().Get(k+1));
+    // Twice the signed area by the surveyor's formula, in grid units.
+    // Positive means clockwise on screen (Y down): an MVT exterior ring.
+    std::int64_t area2(const GridPath& ring)
+    {
+        std::int64_t sum = 0;
+        for (std::size_t i = 0, j = ring.size() - 1; i < ring.size(); j = i++)
+            sum += (std::int64_t)ring[j].x * ring[i].y - (std::int64_t)ring[i].x * ring[j].y;
+        return sum;
+    }
 
-                        if (value.has_bool_value())
-                        {
-                            oeFeature->set(key, value.bool_value());
-                        }
-                        else if (value.has_double_value())
-                        {
-                            oeFeature->set(key, value.double_value());
-                        }
-                        else if (value.has_float_value())
-                        {
-                            oeFeature->set(key, value.float_value());
-                        }
-                        else if (value.has_int_value())
-                        {
-                            oeFeature->set(key, (long long)value.int_value());
-                        }
-                        else if (value.has_sint_value())
-                        {
-                            oeFeature->set(key, (long long)value.sint_value());
-                        }
-                        else if (value.has_string_value())
-                        {
-                            oeFeature->set(key, value.string_value());
-                        }
-                        else if (value.has_uint_value())
-                        {
-                            oeFeature->set(key, (long long)value.uint_value());
-                        }
+    // Writes geometry commands, tracking the cursor across parts
+    struct CommandWriter
+    {
+        std::vector<std::uint32_t>& _cmds;
+        std::int32_t _x, _y;
 
-                        // Special path for getting heights from our test dataset.
-                        if (key == "other_tags")
-                        {
-                            std::string other_tags = value.string_value();
-
-                            StringTokenizer tok("=>");
-                            StringVector tized;
-                            tok.tokenize(other_tags, tized);
-                            if (tized.size() == 3)
-                            {
-                                if (tized[0] == "height")
-                                {
-                                    std::string value = tized[2];
-                                    // Remove quotes from the height
-                                    float height = as<float>(value, FLT_MAX);
-                                    if (height != FLT_MAX)
-                                    {
-                                        oeFeature->set("height", height);
-                                    }
-                                }
-                            }
-                        }
-                    }
+        CommandWriter(std::vector<std::uint32_t>& cmds) : _cmds(cmds), _x(0), _y(0) { }
 
+        void command(unsigned id, std::size_t count) {
+            _cmds.push_back((std::uint32_t)((id & 0x7) | (count << 3)));
+        }
 
+        void point(const GridPoint& p) {
+            _cmds.push_back(zig_zag_encode(p.x - _x));
+            _cmds.push_back(zig_zag_encode(p.y - _y));
+            _x = p.x, _y = p.y;
+        }
 
-                    osg::ref_ptr< osgEarth::Geometry > geometry;
+        void path(const GridPath& path, bool closed) {
+            command(CMD_MOVETO, 1);
+            point(path[0]);
+            command(CMD_LINETO, path.size() - 1);
+            for (std::size_t i = 1; i < path.size(); ++i)
+                point(path[i]);
+            if (closed)
+                command(CMD_CLOSEPATH, 1);
+        }
+    };
 
-                    eGeomType geomType = static_cast<eGeomType>(feature.type());
-                    if (geomType == MVT::Polygon)
-                    {
-                        geometry = decodePolygon(feature, key, layer.extent());
-                    }
-                    else if (geomType == MVT::LineString)
-                    {
-                        geometry = decodeLine(feature, key, layer.extent());
-                    }
-                    else if (geomType == MVT::Point)
-                    {
-                        geometry = decodePoint(feature, key, layer.extent());
+    // Per-thread scratch space reused from feature to feature
+    struct EncodeScratch
+    {
+        std::vector<osg::Vec3d> world;
+        Path path, temp;
+        std::vector<Path> runs;
+        GridPath grid;
+        GridPath points;
+        std::vector<std::uint32_t> cmds;
+        std::vector<std::uint32_t> tags;
+        std::vector<std::pair<std::size_t, std::size_t> > stack;
+    };
+
+    // Maps a feature's geometry onto the tile grid and writes its commands.
+    // Returns the feature's type, or Unknown if nothing is left.
+    class GeometryEncoder
+    {
+    public:
+        GeometryEncoder(const TileKey& key, const EncodeOptions& options, EncodeScratch& scratch) :
+            _srs(key.getProfile()->getSRS()),
+            _transform(nullptr),
+            _x0(key.getExtent().xMin()),
+            _y0(key.getExtent().yMax()),
+            _sx((double)options.extent / key.getExtent().width()),
+            _sy((double)options.extent / key.getExtent().height()),
+            _lo(-(double)options.buffer),
+            _hi((double)options.extent + (double)options.buffer),
+            _extent((double)options.extent),
+            _tolerance(options.tolerance),
+            _s(scratch)
+        {
+            //nop
+        }
+
+        eGeomType encode(const Feature* feature)
+        {
+            _s.cmds.clear();
+            _s.points.clear();
+
+            Geometry* geometry = const_cast<Feature*>(feature)->getGeometry();
+            if (!geometry)
+                return MVT::Unknown;
+
+            eGeomType type = MVT::Unknown;
+            switch (geometry->getComponentType())
+            {
+            case Geometry::TYPE_POINT:
+            case Geometry::TYPE_POINTSET:   type = MVT::Point; break;
+            case Geometry::TYPE_LINESTRING:
+            case Geometry::TYPE_RING:       type = MVT::LineString; break;
+            case Geometry::TYPE_POLYGON:    type = MVT::Polygon; break;
+            default:                        return MVT::Unknown;
+            }
+
+            const SpatialReference* srs = feature->getSRS();
+            _transform = srs && !srs->isHorizEquivalentTo(_srs.get()) ? srs : nullptr;
+
+            CommandWriter writer(_s.cmds);
+
+            GeometryIterator parts(geometry, false);
+            while (parts.hasMore())
+            {
+                Geometry* part = parts.next();
+                Geometry::Type partType = part->getType();
 
-                        // This is a bit of a hack, but if a point is outside of the extents we remove it.
-                        // Lines and Polygons that extend outside of the tileset we keep though b/c we assume that they are just slightly going outside of the
-                        // extent.  Should probably make this an option somewhere.
-                        if (geometry)
+                if (type == MVT::Point && (partType == Geometry::TYPE_POINT || partType == Geometry::TYPE_POINTSET))
+                {
+                    if (!project(part))
+                        continue;
+                    for (auto& p : _s.path)
+                    {
+                        // points belong to one tile only
+                        if (p.x() >= 0.0 && p.x() < _extent && p.y() >= 0.0 && p.y() < _extent)
                         {
-                            if (!key.getExtent().contains(geometry->getBounds().center()))
-                            {
-                                geometry = NULL;
-                            }
+                            GridPoint g = { (std::int32_t)p.x(), (std::int32_t)p.y() };
+                            _s.points.push_back(g);
                         }
                     }
-                    else
+                }
+
+                else if (type == MVT::LineString && (partType == Geometry::TYPE_LINESTRING || partType == Geometry::TYPE_RING))
+                {
+                    if (!project(part))
+                        continue;
+                    if (partType == Geometry::TYPE_RING && !_s.path.empty())
+                        _s.path.push_back(_s.path.front());
+
+                    _s.runs.clear();
+                    clipLine(_s.path, _lo, _hi, _s.runs);
+                    for (auto& run : _s.runs)
                     {
-                        geometry = decodeLine(feature, key, layer.extent());
+                        simplify(run, _tolerance, false, _s.stack);
+                        quantize(run, false, _s.grid);
+                        if (_s.grid.size() >= 2)
+                            writer.path(_s.grid, false);
                     }
+                }
+
+                else if (type == MVT::Polygon && partType == Geometry::TYPE_POLYGON)
+                {
+                    // exterior ring first, then its holes; a lost exterior loses them all
+                    if (!ring(part, true))
+                        continue;
+                    writer.path(_s.grid, true);
 
-                    if (geometry)
+                    for (auto& hole : static_cast<osgEarth::Polygon*>(part)->getHoles())
                     {
-                        oeFeature->setGeometry( geometry.get() );
-                        features.push_back(oeFeature.get());
+                        if (ring(hole.get(), false))
+                            writer.path(_s.grid, true);
                     }
-
                 }
             }
+
+            if (type == MVT::Point && !_s.points.empty())
+            {
+                writer.command(CMD_MOVETO, _s.points.size());
+                for (auto& p : _s.points)
+                    writer.point(p);
+            }
+
+            return _s.cmds.empty() ? MVT::Unknown : type;
         }
-        else
+
+    private:
+        osg::ref_ptr<const SpatialReference> _srs;
+        const SpatialReference* _transform;
+        double _x0, _y0, _sx, _sy, _lo, _hi, _extent, _tolerance;
+        EncodeScratch& _s;
+
+        // part -> _s.path in grid units
+        bool project(const Geometry* part)
         {
-            OE_WARN << "Failed to parse mvt" << key.str() << std::endl;
+            _s.path.clear();
+            if (part->empty())
+                return false;
+
+            const osg::Vec3d* begin = &part->front();
+            const osg::Vec3d* end = begin + part->size();
+
+            if (_transform)
+            {
+                _s.world.assign(begin, end);
+                if (!_transform->transform(_s.world, _srs.get()))
+                    return false;
+                begin = _s.world.data();
+                end = begin + _s.world.size();
+            }
+
+            _s.path.reserve(end - begin);
+            for (const osg::Vec3d* p = begin; p != end; ++p)
+                _s.path.push_back(osg::Vec2d((p->x() - _x0) * _sx, (_y0 - p->y()) * _sy));
+            return true;
+        }
+
+        // ring -> _s.grid, clipped, simplified and wound for MVT
+        bool ring(const Geometry* geom, bool exterior)
+        {
+            if (!project(geom))
+                return false;
+
+            while (_s.path.size() > 1 && _s.path.back() == _s.path.front())
+                _s.path.pop_back();
+
+            clipRing(_s.path, _lo, _hi, _s.temp);
+            simplify(_s.path, _tolerance, true, _s.stack);
+            quantize(_s.path, true, _s.grid);
+            if (_s.grid.size() < 3)
+                return false;
+
+            std::int64_t area = area2(_s.grid);
+            if (area == 0)
+                return false;
+            if ((area > 0) != exterior)
+                std::reverse(_s.grid.begin(), _s.grid.end());
+            return true;
+        }
+    };
+
+    // Encodes an attribute as an MVT Value message; false if it has no value
+    bool encodeValue(const AttributeValue& value, std::string& out)
+    {
+        out.clear();
+        if (!value.second.set)
+            return false;
+
+        PBFWriter w(out);
+        switch (value.first)
+        {
+        case ATTRTYPE_STRING:
+            w.bytes(VALUE_STRING, value.second.stringValue);
+            return true;
+        case ATTRTYPE_INT:
+            w.number(VALUE_SINT, zig_zag_encode64(value.second.intValue));
+            return true;
+        case ATTRTYPE_DOUBLE:
+            {
+                std::uint64_t bits;
+                ::memcpy(&bits, &value.second.doubleValue, 8);
+                w.fixed64(VALUE_DOUBLE, bits);
+            }
+            return true;
+        case ATTRTYPE_BOOL:
+            w.number(VALUE_BOOL, value.second.boolValue ? 1u : 0u);
+            return true;
+        default:
             return false;
         }
+    }
 
-        return true;
+    unsigned writeTile(const FeatureList& features, const TileKey& key, const std::string& layerName, std::string& out, const EncodeOptions* options)
+    {
+        out.clear();
+
+        if (!key.valid() || features.empty())
+            return 0u;
+
+        EncodeOptions defaults;
+        if (!options)
+            options = &defaults;
+
+        if (options->extent == 0u)
+            return 0u;
+
+        static thread_local EncodeScratch scratch;
+
+        GeometryEncoder encoder(key, *options, scratch);
+
+        // keys and values are written once per layer and referenced by index
+        std::unordered_map<std::string, unsigned> keyIndex, valueIndex;
+        std::vector<const std::string*> keys, values;
+
+        std::string layer, feature, value;
+        PBFWriter lw(layer);
+        lw.bytes(LAYER_NAME, layerName);
+
+        unsigned count = 0u;
+
+        for (auto& f : features)
+        {
+            if (!f.valid())
+                continue;
+
+            eGeomType type = encoder.encode(f.get());
+            if (type == MVT::Unknown)
+                continue;
+
+            scratch.tags.clear();
+            for (auto& attr : f->getAttrs())
+            {
+                if (!options->attributes.empty() && std::none_of(
+                    options->attributes.begin(), options->attributes.end(),
+                    [&attr](const std::string& name) { return ciEquals(name, attr.first); }))
+                {
+                    continue;
+                }
+
+                if (!encodeValue(attr.second, value))
+                    continue;
+
+                auto k = keyIndex.emplace(attr.first, (unsigned)keys.size());
+                if (k.second)
+                    keys.push_back(&k.first->first);
+
+                auto v = valueIndex.emplace(value, (unsigned)values.size());
+                if (v.second)
+                    values.push_back(&v.first->first);
+
+                scratch.tags.push_back(k.first->second);
+                scratch.tags.push_back(v.first->second);
+            }
+
+            feature.clear();
+            PBFWriter fw(feature);
+            if (f->getFID() >= 0)
+                fw.number(FEATURE_ID, (std::uint64_t)f->getFID());
+            if (!scratch.tags.empty())
+                fw.packed(FEATURE_TAGS, scratch.tags);
+            fw.number(FEATURE_TYPE, (unsigned)type);
+            fw.packed(FEATURE_GEOMETRY, scratch.cmds);
+
+            lw.bytes(LAYER_FEATURES, feature);
+            ++count;
+        }
+
+        if (count == 0u)
+            return 0u;
+
+        for (auto k : keys)
+            lw.bytes(LAYER_KEYS, *k);
+
+        // values are already-encoded messages
+        for (auto v : values)
+            lw.bytes(LAYER_VALUES, *v);
+
+        lw.number(LAYER_EXTENT, options->extent);
+        lw.number(LAYER_VERSION, 2u);
+
+        PBFWriter tw(out);
+        tw.bytes(TILE_LAYERS, layer);
+        return count;
     }
 
+
 }} // namespace osgEarth::MVT
 
 //........................................................................
@@ -467,6 +1248,10 @@ MVTFeatureSourceOptions::getConfig() const
 {
     Config conf = FeatureSource::Options::getConfig();
     conf.set("url", url());
+    if (!layers().empty())
+        conf.set("layers", joinStrings(layers(), ','));
+    if (!attributes().empty())
+        conf.set("attributes", joinStrings(attributes(), ','));
     return conf;
 }
 
@@ -474,6 +1259,10 @@ void
 MVTFeatureSourceOptions::fromConfig(const Config& conf)
 {
     conf.get("url", url());
+    if (conf.hasValue("layers"))
+        StringTokenizer(",").tokenize(conf.value("layers"), layers());
+    if (conf.hasValue("attributes"))
+        StringTokenizer(",").tokenize(conf.value("attributes"), attributes());
 }
 
 //........................................................................
@@ -482,6 +1271,30 @@ REGISTER_OSGEARTH_LAYER(mvtfeatures, MVTFeatureSource);
 
 OE_LAYER_PROPERTY_IMPL(MVTFeatureSource, URI, URL, url);
 
+void
+MVTFeatureSource::setLayers(const std::vector<std::string>& value)
+{
+    options().layers() = value;
+}
+
+const std::vector<std::string>&
+MVTFeatureSource::getLayers() const
+{
+    return options().layers();
+}
+
+void
+MVTFeatureSource::setAttributes(const std::vector<std::string>& value)
+{
+    options().attributes() = value;
+}
+
+const std::vector<std::string>&
+MVTFeatureSource::getAttributes() const
+{
+    return options().attributes();
+}
+
 
 Status
 MVTFeatureSource::openImplementation()
@@ -501,6 +1314,9 @@ MVTFeatureSource::openImplementation()
 
     setFeatureProfile(createFeatureProfile());
 
+    _decodeOptions.layers = options().layers();
+    _decodeOptions.attributes = options().attributes();
+
     return Status::NoError;
 }
 
@@ -565,9 +1381,7 @@ MVTFeatureSource::createFeatureCursorImplementation(const Query& query, Progress
         // the pointer returned from _blob gets freed internally by sqlite, supposedly
         const char* data = (const char*)sqlite3_column_blob(select, 0);
         int dataLen = sqlite3_column_bytes(select, 0);
-        std::string dataBuffer(data, dataLen);
-        std::stringstream in(dataBuffer);
-        MVT::readTile(in, key, features);
+        MVT::readTile(data, dataLen, key, features, &_decodeOptions);
     }
     else
     {
@@ -609,7 +1423,7 @@ MVTFeatureSource::iterateTiles(int zoomLevel, int limit, int offset, const GeoEx
 
     sqlite3_stmt* select = NULL;
     std::stringstream buf;
-    buf << "SELECT zoom_level, tile_column, tile_row, tile_data from tiles";
+    buf << "SELECT zoom_level, tile_column, tile_row, tile_data from tiles WHERE zoom_level = " << zoomLevel;
 
     if (extent.isValid())
     {
@@ -624,7 +1438,7 @@ MVTFeatureSource::iterateTiles(int zoomLevel, int limit, int offset, const GeoEx
         unsigned int minY = numRows - ll.getTileY() - 1;
         unsigned int maxY = numRows - ur.getTileY() - 1;
 
-        buf << " WHERE tile_column >= " << minX << " AND tile_column <= " << maxX << " AND tile_row >= " << minY << " AND tile_row <= " << maxY;
+        buf << " AND tile_column >= " << minX << " AND tile_column <= " << maxX << " AND tile_row >= " << minY << " AND tile_row <= " << maxY;
     }
 
     if (limit > 0)
@@ -655,8 +1469,6 @@ MVTFeatureSource::iterateTiles(int zoomLevel, int limit, int offset, const GeoEx
         // the pointer returned from _blob gets freed internally by sqlite, supposedly
         const char* data = (const char*)sqlite3_column_blob(select, 3);
         int dataLen = sqlite3_column_bytes(select, 3);
-        std::string dataBuffer(data, dataLen);
-        std::stringstream in(dataBuffer);
 
         FeatureList features;
 
@@ -673,7 +1485,7 @@ MVTFeatureSource::iterateTiles(int zoomLevel, int limit, int offset, const GeoEx
         }
 
 
-        MVT::readTile(in, key, features);
+        MVT::readTile(data, dataLen, key, features, &_decodeOptions);
 
         // apply filters before returning.
         applyFilters(features, key.getExtent());
@@ -771,4 +1583,299 @@ MVTFeatureSource::getMetaData(const std::string& key, std::string& value)
     return valid;
 }
 
+//........................................................................
+
+#undef LC
+#define LC "[MVTPackager] "
+
+namespace
+{
+    bool exec(sqlite3* db, const char* sql)
+    {
+        char* error = 0L;
+        if (sqlite3_exec(db, sql, 0L, 0L, &error) != SQLITE_OK)
+        {
+            OE_WARN << LC << "SQL failed: " << sql << "; " << (error ? error : "") << std::endl;
+            sqlite3_free(error);
+            return false;
+        }
+        return true;
+    }
+
+    bool putMetaData(sqlite3_stmt* insert, const std::string& name, const std::string& value)
+    {
+        sqlite3_reset(insert);
+        sqlite3_bind_text(insert, 1, name.c_str(), name.length(), SQLITE_TRANSIENT);
+        sqlite3_bind_text(insert, 2, value.c_str(), value.length(), SQLITE_TRANSIENT);
+        return sqlite3_step(insert) == SQLITE_DONE;
+    }
+
+    // tiles built and written per batch; bounds the memory in flight
+    const unsigned TILES_PER_THREAD = 64u;
+}
+
+MVTPackager::MVTPackager() :
+    _firstLevel(0u),
+    _maxLevel(14u),
+    _numThreads(std::max(1u, std::thread::hardware_concurrency()))
+{
+    //nop
+}
+
+bool
+MVTPackager::buildTile(
+    FeatureSource* features,
+    const TileKey& key,
+    const std::string& layerName,
+    osgDB::BaseCompressor* compressor,
+    ProgressCallback* progress,
+    std::string& out) const
+{
+    // query the tile extent plus the clipping buffer
+    const GeoExtent& extent = key.getExtent();
+    double margin = extent.width() * (double)_encodeOptions.buffer / (double)osg::maximum(_encodeOptions.extent, 1u);
+    GeoExtent queryExtent(
+        extent.getSRS(),
+        extent.xMin() - margin, extent.yMin() - margin,
+        extent.xMax() + margin, extent.yMax() + margin);
+
+    queryExtent = queryExtent.transform(features->getFeatureProfile()->getSRS());
+    if (!queryExtent.isValid())
+        return false;
+
+    Query query(_query);
+    query.bounds() = queryExtent.bounds();
+
+    osg::ref_ptr<FeatureCursor> cursor = features->createFeatureCursor(query, progress);
+    if (!cursor.valid())
+        return false;
+
+    FeatureList list;
+    cursor->fill(list);
+
+    if (list.empty())
+        return false;
+
+    // features too small for this level's grid encode to nothing, but
+    // they are still there for the children to pick up
+    std::string encoded;
+    if (MVT::writeTile(list, key, layerName, encoded, &_encodeOptions) > 0u)
+    {
+        std::ostringstream buf;
+        if (compressor->compress(buf, encoded))
+            out = buf.str();
+    }
+
+    return true;
+}
+
+Status
+MVTPackager::package(
+    FeatureSource* features,
+    const std::string& filename,
+    const std::string& layerName,
+    ProgressCallback* progress)
+{
+    if (!features || !features->isOpen() || !features->getFeatureProfile())
+        return Status(Status::ConfigurationError, "Feature source is not open");
+
+    const Profile* profile = Registry::instance()->getSphericalMercatorProfile();
+
+    GeoExtent extent = profile->clampAndTransformExtent(features->getFeatureProfile()->getExtent());
+    if (!extent.isValid())
+        return Status(Status::ConfigurationError, "Feature source extent does not intersect the output profile");
+
+    osg::ref_ptr<osgDB::BaseCompressor> compressor =
+        osgDB::Registry::instance()->getObjectWrapperManager()->findCompressor("zlib");
+    if (!compressor.valid())
+        return Status(Status::ServiceUnavailable, "zlib compressor is not available");
+
+    sqlite3* db = 0L;
+    if (sqlite3_open_v2(filename.c_str(), &db, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE, 0L) != SQLITE_OK)
+    {
+        Status status(Status::ResourceUnavailable, Stringify() << "Failed to open " << filename << ", " << sqlite3_errmsg(db));
+        sqlite3_close(db);
+        return status;
+    }
+
+    sqlite3_stmt* insertTile = 0L;
+    sqlite3_stmt* insertMeta = 0L;
+
+    bool ok =
+        exec(db, "PRAGMA synchronous=OFF") &&
+        exec(db, "DROP TABLE IF EXISTS tiles") &&
+        exec(db, "DROP TABLE IF EXISTS metadata") &&
+        exec(db, "CREATE TABLE metadata (name text, value text)") &&
+        exec(db, "CREATE TABLE tiles (zoom_level integer, tile_column integer, tile_row integer, tile_data blob)") &&
+        exec(db, "CREATE UNIQUE INDEX tile_index on tiles (zoom_level, tile_column, tile_row)") &&
+        sqlite3_prepare_v2(db, "INSERT INTO tiles VALUES (?, ?, ?, ?)", -1, &insertTile, 0L) == SQLITE_OK &&
+        sqlite3_prepare_v2(db, "INSERT INTO metadata VALUES (?, ?)", -1, &insertMeta, 0L) == SQLITE_OK;
+
+    if (!ok)
+    {
+        Status status(Status::ResourceUnavailable, Stringify() << "Failed to initialize " << filename << ", " << sqlite3_errmsg(db));
+        sqlite3_finalize(insertTile);
+        sqlite3_finalize(insertMeta);
+        sqlite3_close(db);
+        return status;
+    }
+
+    JobArena arena("oe.mvtpackager", osg::maximum(_numThreads, 1u));
+    const std::size_t batchSize = TILES_PER_THREAD * osg::maximum(_numThreads, 1u);
+
+    // tiles to build at the current level, and the children of the
+    // ones that had features for the next level
+    typedef std::pair<unsigned, unsigned> XY;
+    std::vector<XY> tiles, next;
+    {
+        std::vector<TileKey> keys;
+        profile->getIntersectingTiles(extent, _firstLevel, keys);
+        for (auto& key : keys)
+            tiles.push_back(XY(key.getTileX(), key.getTileY()));
+    }
+
+    osg::Timer_t start = osg::Timer::instance()->tick();
+    unsigned total = 0u;
+    unsigned maxLevel = _firstLevel;
+    std::vector<std::string> results;
+    std::vector<unsigned char> hasFeatures; // not vector<bool>; jobs write it concurrently
+
+    for (unsigned lod = _firstLevel; lod <= _maxLevel && !tiles.empty() && ok; ++lod)
+    {
+        unsigned cols = 0u, rows = 0u;
+        profile->getNumTiles(lod, cols, rows);
+
+        next.clear();
+        unsigned written = 0u;
+
+        for (std::size_t first = 0; first < tiles.size() && ok; first += batchSize)
+        {
+            std::size_t count = std::min(batchSize, tiles.size() - first);
+            results.assign(count, std::string());
+            hasFeatures.assign(count, 0u);
+
+            // each job writes only its own result slot, and the group join
+            // below waits for all of them
+            JobGroup group;
+            Job job(&arena, &group);
+
+            for (std::size_t i = 0; i < count; ++i)
+            {
+                TileKey key(lod, tiles[first + i].first, tiles[first + i].second, profile);
+                std::string* result = &results[i];
+                unsigned char* found = &hasFeatures[i];
+
+                job.dispatch([this, features, key, &layerName, &compressor, progress, result, found](Cancelable*)
+                {
+                    if (progress && progress->isCanceled())
+                        return;
+
+                    *found = buildTile(features, key, layerName, compressor.get(), progress, *result) ? 1u : 0u;
+                });
+            }
+
+            group.join();
+
+            if (progress && progress->isCanceled())
+            {
+                ok = false;
+                break;
+            }
+
+            // sqlite is only written from this thread, one transaction per batch
+            exec(db, "BEGIN TRANSACTION");
+            for (std::size_t i = 0; i < count; ++i)
+            {
+                unsigned x = tiles[first + i].first;
+                unsigned y = tiles[first + i].second;
+
+                // descend wherever the source had features, whether or not
+                // anything survived encoding at this level
+                if (hasFeatures[i] && lod < _maxLevel)
+                {
+                    next.push_back(XY(2 * x, 2 * y));
+                    next.push_back(XY(2 * x + 1, 2 * y));
+                    next.push_back(XY(2 * x, 2 * y + 1));
+                    next.push_back(XY(2 * x + 1, 2 * y + 1));
+                }
+
+                if (results[i].empty())
+                    continue;
+
+                sqlite3_reset(insertTile);
+                sqlite3_bind_int(insertTile, 1, lod);
+                sqlite3_bind_int(insertTile, 2, x);
+                sqlite3_bind_int(insertTile, 3, rows - y - 1);
+                sqlite3_bind_blob(insertTile, 4, results[i].data(), results[i].size(), SQLITE_STATIC);
+                if (sqlite3_step(insertTile) != SQLITE_DONE)
+                {
+                    OE_WARN << LC << "Failed to insert tile " << lod << "/" << x << "/" << y << ", " << sqlite3_errmsg(db) << std::endl;
+                    ok = false;
+                    break;
+                }
+                ++written;
+            }
+            exec(db, "COMMIT");
+        }
+
+        OE_INFO << LC << "Level " << lod << ": " << written << " of " << tiles.size() << " tiles written" << std::endl;
+
+        if (written > 0u)
+            maxLevel = lod;
+        total += written;
+        tiles.swap(next);
+
+        if (progress && progress->reportProgress(lod - _firstLevel + 1, _maxLevel - _firstLevel + 1))
+            ok = false;
+    }
+
+    if (ok)
+    {
+        GeoExtent bounds = extent.transform(SpatialReference::get("wgs84"));
+        double cx, cy;
+        bounds.getCentroid(cx, cy);
+
+        Util::Json::Value fields(Util::Json::objectValue);
+        const FeatureSchema& schema = features->getSchema();
+        for (auto& field : schema)
+        {
+            fields[field.first] =
+                field.second == ATTRTYPE_STRING ? "String" :
+                field.second == ATTRTYPE_BOOL ? "Boolean" :
+                "Number";
+        }
+
+        Util::Json::Value layer(Util::Json::objectValue);
+        layer["id"] = layerName;
+        layer["fields"] = fields;
+        layer["minzoom"] = _firstLevel;
+        layer["maxzoom"] = maxLevel;
+
+        Util::Json::Value json(Util::Json::objectValue);
+        json["vector_layers"].append(layer);
+
+        putMetaData(insertMeta, "name", layerName);
+        putMetaData(insertMeta, "format", "pbf");
+        putMetaData(insertMeta, "type", "overlay");
+        putMetaData(insertMeta, "minzoom", Stringify() << _firstLevel);
+        putMetaData(insertMeta, "maxzoom", Stringify() << maxLevel);
+        putMetaData(insertMeta, "bounds", Stringify() << bounds.xMin() << "," << bounds.yMin() << "," << bounds.xMax() << "," << bounds.yMax());
+        putMetaData(insertMeta, "center", Stringify() << cx << "," << cy << "," << _firstLevel);
+        putMetaData(insertMeta, "json", Util::Json::FastWriter().write(json));
+    }
+
+    sqlite3_finalize(insertTile);
+    sqlite3_finalize(insertMeta);
+    sqlite3_close(db);
+
+    if (!ok)
+        return Status(Status::GeneralError, "Packaging failed or was canceled");
+
+    OE_INFO << LC << "Wrote " << total << " tiles in "
+        << osg::Timer::instance()->delta_s(start, osg::Timer::instance()->tick()) << "s" << std::endl;
+
+    return Status::NoError;
+}
+
+
 #endif // OSGEARTH_HAVE_MVT
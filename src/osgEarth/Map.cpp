@@ -19,11 +19,144 @@
 #include <osgEarth/Map>
 #include <osgEarth/MapModelChange>
 #include <osgEarth/Registry>
+#include <osgEarth/Threading>
+#include <osg/Timer>
+#include <algorithm>
+#include <cstdlib>
+#include <sstream>
+#include <thread>
+#include <unordered_map>
 
 using namespace osgEarth;
+using namespace osgEarth::Threading;
 
 #define LC "[Map] "
 
+#define LAYER_OPEN_ARENA_NAME "oe.layeropen"
+
+namespace
+{
+    unsigned getLayerOpenConcurrency()
+    {
+        static unsigned concurrency = []()
+        {
+            unsigned value = std::max(2u, std::thread::hardware_concurrency());
+            JobArena::setConcurrency(LAYER_OPEN_ARENA_NAME, value);
+            return value;
+        }();
+        return concurrency;
+    }
+
+    // Collects the indices of all layers whose name appears as a value
+    // anywhere in the configuration tree (e.g. <terrain_constraint layer="roads"/>).
+    void findNamedReferences(
+        const Config& conf,
+        const std::unordered_map<std::string, std::vector<unsigned>>& names,
+        unsigned self,
+        std::vector<unsigned>& output)
+    {
+        if (!conf.value().empty())
+        {
+            auto i = names.find(conf.value());
+            if (i != names.end())
+            {
+                for (unsigned index : i->second)
+                {
+                    if (index != self && std::find(output.begin(), output.end(), index) == output.end())
+                        output.push_back(index);
+                }
+            }
+        }
+        for (const auto& child : conf.children())
+        {
+            findNamedReferences(child, names, self, output);
+        }
+    }
+
+    // Opens layers concurrently, one wave at a time. A layer that names
+    // another layer in its configuration may look that layer up while
+    // opening, so it waits for a later wave. Returns the number of waves.
+    unsigned openInWaves(const std::vector<Layer*>& toOpen)
+    {
+        std::unordered_map<std::string, std::vector<unsigned>> names;
+        for (unsigned i = 0; i < toOpen.size(); ++i)
+        {
+            if (!toOpen[i]->getName().empty())
+                names[toOpen[i]->getName()].push_back(i);
+        }
+
+        std::vector<std::vector<unsigned>> dependencies(toOpen.size());
+        if (names.size() > 0u)
+        {
+            for (unsigned i = 0; i < toOpen.size(); ++i)
+            {
+                findNamedReferences(toOpen[i]->getConfig(), names, i, dependencies[i]);
+            }
+        }
+
+        std::vector<bool> opened(toOpen.size(), false);
+        unsigned numOpened = 0u;
+        unsigned numWaves = 0u;
+
+        while (numOpened < toOpen.size())
+        {
+            std::vector<unsigned> wave;
+            for (unsigned i = 0; i < toOpen.size(); ++i)
+            {
+                if (opened[i])
+                    continue;
+
+                bool ready = true;
+                for (unsigned d : dependencies[i])
+                    if (!opened[d])
+                        ready = false;
+
+                if (ready)
+                    wave.push_back(i);
+            }
+
+            if (wave.empty())
+            {
+                // circular references; open the rest in map order.
+                OE_WARN << LC << "Circular layer references detected; opening remaining layers serially" << std::endl;
+                for (unsigned i = 0; i < toOpen.size(); ++i)
+                    if (!opened[i])
+                        wave.push_back(i);
+
+                for (unsigned i : wave)
+                    toOpen[i]->open();
+            }
+            else if (wave.size() == 1u)
+            {
+                toOpen[wave.front()]->open();
+            }
+            else
+            {
+                getLayerOpenConcurrency();
+                JobArena* arena = JobArena::get(LAYER_OPEN_ARENA_NAME);
+                JobGroup group;
+                for (unsigned i : wave)
+                {
+                    Layer* layer = toOpen[i];
+                    Job(arena, &group).dispatch([layer](Cancelable*)
+                        {
+                            layer->open();
+                        });
+                }
+                group.join();
+            }
+
+            for (unsigned i : wave)
+                opened[i] = true;
+
+            numOpened += wave.size();
+            ++numWaves;
+        }
+
+        return numWaves;
+    }
+}
+
 //...................................................................
 
 Map::LayerCB::LayerCB(Map* map) : _map(map) { }
@@ -60,6 +193,7 @@ Map::Options::getConfig() const
     conf.set( "elevation_interpolation", "triangulate", elevationInterpolation(), INTERP_TRIANGULATE);
 
     conf.set( "profile_layer", profileLayer() );
+    conf.set( "parallel_layer_open", parallelLayerOpen() );
 
     return conf;
 }
@@ -68,6 +202,7 @@ void
 Map::Options::fromConfig(const Config& conf)
 {
     elevationInterpolation().init(INTERP_BILINEAR);
+    parallelLayerOpen().init(false);
     
     conf.get( "name",         name() );
     conf.get( "profile",      profile() );
@@ -87,6 +222,7 @@ Map::Options::fromConfig(const Config& conf)
     conf.get( "elevation_interpolation", "triangulate", elevationInterpolation(), INTERP_TRIANGULATE);
 
     conf.get( "profile_layer", profileLayer() );
+    conf.get( "parallel_layer_open", parallelLayerOpen() );
 }
 
 //...................................................................
@@ -325,6 +461,21 @@ Map::getElevationInterpolation() const
     return options().elevationInterpolation().get();
 }
 
+void
+Map::setParallelLayerOpen(bool value)
+{
+    options().parallelLayerOpen() = value;
+}
+
+bool
+Map::getParallelLayerOpen() const
+{
+    if (options().parallelLayerOpen().isSet())
+        return options().parallelLayerOpen().get();
+
+    return ::getenv("OSGEARTH_PARALLEL_LAYER_OPEN") != nullptr;
+}
+
 Cache*
 Map::getCache() const
 {
@@ -621,19 +772,8 @@ Map::addLayers(const LayerVector& layers)
 
     //osgEarth::Registry::instance()->clearBlacklist();
 
-    for(LayerVector::const_iterator layerRef = layers.begin();
-        layerRef != layers.end();
-        ++layerRef)
-    {
-        Layer* layer = layerRef->get();
-        if ( !layer )
-            continue;
-
-        layer->setReadOptions(getReadOptions());
-
-        // open, but don't call addedToMap(layer) yet.
-        layer->open();
-    }
+    // open, but don't call addedToMap(layer) yet.
+    openLayers(layers);
 
     unsigned firstIndex;
     unsigned count = 0;
@@ -686,6 +826,71 @@ Map::addLayers(const LayerVector& layers)
     }
 }
 
+void
+Map::openLayers(const LayerVector& layers)
+{
+    std::vector<Layer*> toOpen;
+    toOpen.reserve(layers.size());
+
+    for(LayerVector::const_iterator layerRef = layers.begin();
+        layerRef != layers.end();
+        ++layerRef)
+    {
+        Layer* layer = layerRef->get();
+        if ( !layer )
+            continue;
+
+        layer->setReadOptions(getReadOptions());
+
+        if (!layer->isOpen() && layer->getEnabled())
+            toOpen.push_back(layer);
+    }
+
+    if (toOpen.empty())
+        return;
+
+    osg::Timer_t start = osg::Timer::instance()->tick();
+
+    unsigned numWaves = 0u;
+    bool parallel = getParallelLayerOpen() && toOpen.size() > 1u;
+    if (parallel)
+    {
+        numWaves = openInWaves(toOpen);
+    }
+    else
+    {
+        for (Layer* layer : toOpen)
+            layer->open();
+    }
+
+    double elapsed = osg::Timer::instance()->delta_s(start, osg::Timer::instance()->tick());
+
+    double total = 0.0;
+    for (Layer* layer : toOpen)
+    {
+        total += layer->getOpenDuration();
+        OE_DEBUG << LC << "Opened \"" << layer->getName() << "\" in "
+            << (int)(layer->getOpenDuration()*1000.0) << " ms" << std::endl;
+    }
+
+    if (toOpen.size() > 1u)
+    {
+        std::vector<Layer*> slowest(toOpen);
+        std::sort(slowest.begin(), slowest.end(), [](Layer* lhs, Layer* rhs) {
+            return lhs->getOpenDuration() > rhs->getOpenDuration(); });
+
+        std::stringstream buf;
+        buf << "Opened " << toOpen.size() << " layers";
+        if (parallel)
+            buf << " in " << numWaves << " wave(s)";
+        buf << ": " << (int)(elapsed*1000.0) << " ms elapsed, "
+            << (int)(total*1000.0) << " ms in layers; slowest:";
+        for (unsigned i = 0; i < std::min((std::size_t)3u, slowest.size()); ++i)
+            buf << " \"" << slowest[i]->getName() << "\" (" << (int)(slowest[i]->getOpenDuration()*1000.0) << " ms)";
+        OE_INFO << LC << buf.str() << std::endl;
+    }
+}
+
 void
 Map::installLayerCallbacks(Layer* layer)
 {
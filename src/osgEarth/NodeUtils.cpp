@@ -19,6 +19,7 @@
 
 #include <osgEarth/NodeUtils>
 #include <osg/Geometry>
+#include <osg/Texture>
 
 using namespace osgEarth;
 using namespace osgEarth::Util;
@@ -171,6 +172,84 @@ PrimitiveSetTypeCounter::apply(osg::Drawable& drawable)
     }
 }
 
+//------------------------------------------------------------------------
+
+MemoryUsageVisitor::MemoryUsageVisitor() :
+    osg::NodeVisitor(osg::NodeVisitor::TRAVERSE_ALL_CHILDREN),
+    _geometryBytes(0u),
+    _textureBytes(0u),
+    _imageBytes(0u)
+{
+    setNodeMaskOverride(~0);
+}
+
+void
+MemoryUsageVisitor::apply(osg::Node& node)
+{
+    apply(node.getStateSet());
+    traverse(node);
+}
+
+void
+MemoryUsageVisitor::apply(osg::Drawable& drawable)
+{
+    apply(drawable.getStateSet());
+
+    osg::Geometry* geom = drawable.asGeometry();
+    if (geom && _visited.insert(geom).second)
+    {
+        osg::Geometry::ArrayList arrays;
+        geom->getArrayList(arrays);
+        for (auto& array : arrays)
+        {
+            if (array.valid() && _visited.insert(array.get()).second)
+                _geometryBytes += array->getTotalDataSize();
+        }
+
+        for (auto& primset : geom->getPrimitiveSetList())
+        {
+            if (primset.valid() && _visited.insert(primset.get()).second)
+                _geometryBytes += primset->getTotalDataSize();
+        }
+    }
+}
+
+void
+MemoryUsageVisitor::apply(osg::StateSet* stateSet)
+{
+    if (!stateSet || !_visited.insert(stateSet).second)
+        return;
+
+    for (unsigned unit = 0; unit < stateSet->getNumTextureAttributeLists(); ++unit)
+    {
+        osg::Texture* tex = dynamic_cast<osg::Texture*>(
+            stateSet->getTextureAttribute(unit, osg::StateAttribute::TEXTURE));
+
+        if (!tex || !_visited.insert(tex).second)
+            continue;
+
+        if (tex->getNumImages() > 0 && tex->getImage(0))
+        {
+            for (unsigned i = 0; i < tex->getNumImages(); ++i)
+            {
+                const osg::Image* image = tex->getImage(i);
+                if (image && _visited.insert(image).second)
+                {
+                    _textureBytes += image->getTotalSizeInBytesIncludingMipmaps();
+                    _imageBytes += image->getTotalSizeInBytesIncludingMipmaps();
+                }
+            }
+        }
+        else
+        {
+            // image already released after GPU upload; assume RGBA8
+            _textureBytes +=
+                (std::size_t)osg::maximum(tex->getTextureWidth(), 1) *
+                (std::size_t)osg::maximum(tex->getTextureHeight(), 1) *
+                (std::size_t)osg::maximum(tex->getTextureDepth(), 1) * 4u;
+        }
+    }
+}
 
 namespace
 {
@@ -29,9 +29,19 @@
 #include <ogr_api.h>
 #include <gdal.h>
 #include <queue>
+#include <cstring>
 
 #define LC "[OGRFeatureSource] "
 
+#ifndef GDAL_VERSION_AT_LEAST
+#define GDAL_VERSION_AT_LEAST(MAJOR, MINOR, REV) ((GDAL_VERSION_MAJOR>MAJOR) || (GDAL_VERSION_MAJOR==MAJOR && (GDAL_VERSION_MINOR>MINOR || (GDAL_VERSION_MINOR==MINOR && GDAL_VERSION_REV>=REV))))
+#endif
+
+// OGR_L_GetArrowStream appeared in GDAL 3.6
+#if GDAL_VERSION_AT_LEAST(3,6,0)
+#define OE_OGR_ARROW_STREAM 1
+#endif
+
 using namespace osgEarth;
 
 namespace osgEarth { namespace OGR
@@ -48,6 +58,102 @@ namespace osgEarth { namespace OGR
         return h;
     }
 
+    // Layer name to use in SQL. Quoted if it is a shapefile, so we can handle
+    // any weird filenames like those with spaces or hyphens, or if it
+    // contains spaces (for PostgreSQL).
+    std::string getSQLLayerName(OGRDataSourceH ds, OGRLayerH layer)
+    {
+        std::string from = OGR_FD_GetName(OGR_L_GetLayerDefn(layer));
+        std::string driverName = OGR_Dr_GetName(OGR_DS_GetDriver(ds));
+
+        if (driverName == "ESRI Shapefile" || driverName == "VRT" ||
+            from.find(' ') != std::string::npos)
+        {
+            std::string delim = "\"";
+            from = delim + from + delim;
+        }
+        return from;
+    }
+
+    // True if a query expression is a complete SQL statement
+    // rather than just a WHERE clause.
+    bool isSelectStatement(const std::string& expr)
+    {
+        return osgEarth::toLower(expr).find("select") == 0;
+    }
+
+    // SQL statement for a query against a layer
+    std::string buildSQL(const std::string& from, const Query& query)
+    {
+        std::string expr;
+
+        if (query.expression().isSet())
+        {
+            // build the SQL: allow the Query to include either a full SQL statement or
+            // just the WHERE clause.
+            expr = query.expression().value();
+
+            // if the expression is just a where clause, expand it into a complete SQL expression.
+            if (!isSelectStatement(expr))
+            {
+                std::stringstream buf;
+                buf << "SELECT * FROM " << from << " WHERE " << expr;
+                expr = buf.str();
+            }
+        }
+        else
+        {
+            std::stringstream buf;
+            buf << "SELECT * FROM " << from;
+            expr = buf.str();
+        }
+
+        //Include the order by clause if it's set
+        if (query.orderby().isSet())
+        {
+            std::string orderby = query.orderby().value();
+
+            std::string temp = osgEarth::toLower(orderby);
+
+            if (temp.find("order by") != 0)
+            {
+                std::stringstream buf;
+                buf << "ORDER BY " << orderby;
+                orderby = buf.str();
+            }
+            expr += (" " + orderby);
+        }
+
+        return expr;
+    }
+
+    // Rectangle polygon to use as a spatial filter
+    OGRGeometryH createSpatialFilter(const Bounds& b)
+    {
+        OGRGeometryH ring = OGR_G_CreateGeometry(wkbLinearRing);
+        OGR_G_AddPoint(ring, b.xMin(), b.yMin(), 0);
+        OGR_G_AddPoint(ring, b.xMin(), b.yMax(), 0);
+        OGR_G_AddPoint(ring, b.xMax(), b.yMax(), 0);
+        OGR_G_AddPoint(ring, b.xMax(), b.yMin(), 0);
+        OGR_G_AddPoint(ring, b.xMin(), b.yMin(), 0);
+
+        OGRGeometryH polygon = OGR_G_CreateGeometry(wkbPolygon);
+        OGR_G_AddGeometryDirectly(polygon, ring);
+        // note: "Directly" above means the polygon takes ownership if ring handle
+        return polygon;
+    }
+
+    // Moves the corners of a polygon made by createSpatialFilter()
+    void updateSpatialFilter(OGRGeometryH polygon, const Bounds& b)
+    {
+        OGRGeometryH ring = OGR_G_GetGeometryRef(polygon, 0);
+        OGR_G_SetPoint(ring, 0, b.xMin(), b.yMin(), 0);
+        OGR_G_SetPoint(ring, 1, b.xMin(), b.yMax(), 0);
+        OGR_G_SetPoint(ring, 2, b.xMax(), b.yMax(), 0);
+        OGR_G_SetPoint(ring, 3, b.xMax(), b.yMin(), 0);
+        OGR_G_SetPoint(ring, 4, b.xMin(), b.yMin(), 0);
+    }
+
     /**
      * Determine whether a point is valid or not.  Some shapefiles can have points that are ridiculously big, which are really invalid data
      * but shapefiles have no way of marking the data as invalid.  So instead we check for really large values that are indiciative of something being wrong.
@@ -85,120 +191,394 @@ namespace osgEarth { namespace OGR
 
 //........................................................................
 
-OGR::OGRFeatureCursor::OGRFeatureCursor(
-    OGRDataSourceH dsHandle,
-    OGRLayerH layerHandle,
-    const FeatureSource* source,
-    const FeatureProfile* profile,
-    const Query& query,
-    const FeatureFilterChain* filters,
-    bool rewindPolygons,
-    unsigned chunkSize,
-    ProgressCallback* progress) :
-
-FeatureCursor     ( progress ),
-_source           ( source ),
-_dsHandle         ( dsHandle ),
-_layerHandle      ( layerHandle ),
-_resultSetHandle  ( 0L ),
-_spatialFilter    ( 0L ),
-_query            ( query ),
-_chunkSize        ( chunkSize == 0u ? 500u : chunkSize ),
-_nextHandleToQueue( 0L ),
-_resultSetEndReached(false),
-_profile          ( profile ),
-_filters          ( filters ),
-_rewindPolygons   ( rewindPolygons )
+OGR::HandlePool::HandlePool(const std::string& source, const std::string& layer, unsigned maxIdle) :
+    _source(source),
+    _layer(layer),
+    _maxIdle(maxIdle),
+    _mutex("OE.OGR.HandlePool")
 {
-    std::string expr;
-    std::string from = OGR_FD_GetName(OGR_L_GetLayerDefn(_layerHandle));
+    //nop
+}
 
-    std::string driverName = OGR_Dr_GetName(OGR_DS_GetDriver(dsHandle));
+OGR::HandlePool::~HandlePool()
+{
+    for (auto handle : _idle)
+        close(handle);
+}
 
-    // Quote the layer name if it is a shapefile, so we can handle any weird filenames like those with spaces or hyphens.
-    // Or quote any layers containing spaces for PostgreSQL
-    if (driverName == "ESRI Shapefile" || driverName == "VRT" ||
-        from.find(' ') != std::string::npos)
+OGR::PooledHandle*
+OGR::HandlePool::acquire()
+{
     {
-        std::string delim = "\"";
-        from = delim + from + delim;
+        Threading::ScopedMutexLock lock(_mutex);
+        if (!_idle.empty())
+        {
+            PooledHandle* handle = _idle.back();
+            _idle.pop_back();
+            return handle;
+        }
     }
 
-    if (_query.expression().isSet())
+    // Each cursor requires its own DS handle so that multi-threaded access will work.
+    OGRDataSourceH dsHandle = GDALOpenEx(
+        _source.c_str(),
+        GDAL_OF_VECTOR | GDAL_OF_READONLY,
+        nullptr,
+        nullptr,
+        nullptr);
+
+    if (!dsHandle)
+        return nullptr;
+
+    OGRLayerH layerHandle = openLayer(dsHandle, _layer);
+    if (!layerHandle)
     {
-        // build the SQL: allow the Query to include either a full SQL statement or
-        // just the WHERE clause.
-        expr = _query.expression().value();
+        OGRReleaseDataSource(dsHandle);
+        return nullptr;
+    }
+
+    PooledHandle* handle = new PooledHandle();
+    handle->dsHandle = dsHandle;
+    handle->layerHandle = layerHandle;
+    handle->spatialFilter = createSpatialFilter(Bounds(0, 0, 0, 0));
+    handle->from = getSQLLayerName(dsHandle, layerHandle);
+    return handle;
+}
 
-        // if the expression is just a where clause, expand it into a complete SQL expression.
-        std::string temp = osgEarth::toLower(expr);
+void
+OGR::HandlePool::release(PooledHandle* handle)
+{
+    if (!handle)
+        return;
 
-        if (temp.find("select") != 0)
+    {
+        Threading::ScopedMutexLock lock(_mutex);
+        if (_idle.size() < _maxIdle)
         {
-            std::stringstream buf;
-            buf << "SELECT * FROM " << from << " WHERE " << expr;
-            std::string bufStr;
-            bufStr = buf.str();
-            expr = bufStr;
+            _idle.push_back(handle);
+            return;
         }
     }
-    else
+
+    close(handle);
+}
+
+void
+OGR::HandlePool::close(PooledHandle* handle)
+{
+    if (handle->spatialFilter)
+        OGR_G_DestroyGeometry(handle->spatialFilter);
+    if (handle->dsHandle)
+        OGRReleaseDataSource(handle->dsHandle);
+    delete handle;
+}
+
+std::string
+OGR::HandlePool::getSQL(const PooledHandle* handle, const Query& query)
+{
+    std::string shape =
+        handle->from + '\n' +
+        query.expression().getOrUse(std::string()) + '\n' +
+        query.orderby().getOrUse(std::string());
+
+    Threading::ScopedMutexLock lock(_mutex);
+
+    auto i = _sql.find(shape);
+    if (i != _sql.end())
+        return i->second;
+
+    // tiled layers repeat a few query shapes; anything else is
+    // unlikely to repeat, so don't let it grow without bound
+    if (_sql.size() >= 256u)
+        _sql.clear();
+
+    std::string sql = buildSQL(handle->from, query);
+    _sql[shape] = sql;
+    return sql;
+}
+
+//........................................................................
+
+#ifdef OE_OGR_ARROW_STREAM
+
+// Converts whole record batches from OGR's Arrow stream to features,
+// instead of going through an OGRFeature for each one.
+struct OGR::OGRFeatureCursor::ArrowReader
+{
+    struct Column
+    {
+        int index;
+        std::string name;
+        char format;
+    };
+
+    ArrowArrayStream _stream;
+    ArrowSchema _schema;
+    int _fidColumn;
+    int _geomColumn;
+    std::vector<Column> _columns;
+    osg::ref_ptr<const FeatureProfile> _profile;
+    bool _rewindPolygons;
+
+    ArrowReader() : _fidColumn(-1), _geomColumn(-1), _rewindPolygons(true)
+    {
+        memset(&_stream, 0, sizeof(_stream));
+        memset(&_schema, 0, sizeof(_schema));
+    }
+
+    ~ArrowReader()
     {
-        std::stringstream buf;
-        buf << "SELECT * FROM " << from;
-        expr = buf.str();
+        if (_schema.release)
+            _schema.release(&_schema);
+        if (_stream.release)
+            _stream.release(&_stream);
     }
 
-    //Include the order by clause if it's set
-    if (_query.orderby().isSet())
+    // nullptr if the layer has no Arrow stream or has a column we
+    // don't convert; use the per-feature path then
+    static ArrowReader* open(OGRLayerH layer, unsigned batchSize, const FeatureProfile* profile, bool rewindPolygons)
     {
-        std::string orderby = _query.orderby().value();
+        std::unique_ptr<ArrowReader> reader(new ArrowReader());
+        reader->_profile = profile;
+        reader->_rewindPolygons = rewindPolygons;
+
+        std::string batch = Stringify() << "MAX_FEATURES_IN_BATCH=" << batchSize;
+        const char* options[] = { "INCLUDE_FID=YES", batch.c_str(), nullptr };
+
+        if (!OGR_L_GetArrowStream(layer, &reader->_stream, const_cast<char**>(options)))
+            return nullptr;
+
+        if (reader->_stream.get_schema(&reader->_stream, &reader->_schema) != 0)
+            return nullptr;
+
+        std::string fidName = OGR_L_GetFIDColumn(layer);
+        if (fidName.empty()) fidName = "OGC_FID";
 
-        std::string temp = osgEarth::toLower(orderby);
+        std::string geomName = OGR_L_GetGeometryColumn(layer);
+        if (geomName.empty()) geomName = "wkb_geometry";
 
-        if (temp.find("order by") != 0)
+        for (int i = 0; i < reader->_schema.n_children; ++i)
         {
-            std::stringstream buf;
-            buf << "ORDER BY " << orderby;
-            std::string bufStr;
-            bufStr = buf.str();
-            orderby = buf.str();
+            const ArrowSchema* child = reader->_schema.children[i];
+            std::string name = child->name ? child->name : "";
+            std::string format = child->format ? child->format : "";
+
+            if (name == fidName && format == "l")
+            {
+                reader->_fidColumn = i;
+            }
+            else if (name == geomName && (format == "z" || format == "Z"))
+            {
+                reader->_geomColumn = i;
+            }
+            else if (format.size() == 1 && strchr("bcCsSiIlLfguU", format[0]))
+            {
+                reader->_columns.push_back(Column{ i, osgEarth::toLower(name), format[0] });
+            }
+            else
+            {
+                return nullptr;
+            }
         }
-        expr += (" " + orderby);
+
+        return reader.release();
     }
 
-    // if the tilekey is set, convert it to feature profile coords
-    if (_query.tileKey().isSet() && !_query.bounds().isSet() && profile)
+    static bool isValid(const ArrowArray* a, int64_t row)
     {
-        GeoExtent localEx = _query.tileKey()->getExtent().transform(profile->getSRS());
-        _query.bounds() = localEx.bounds();
+        const uint8_t* bits = static_cast<const uint8_t*>(a->buffers[0]);
+        return a->null_count == 0 || bits == nullptr || ((bits[row >> 3] >> (row & 7)) & 1);
     }
 
-    // if there's a spatial extent in the query, build the spatial filter:
-    if (_query.bounds().isSet())
+    template<typename T>
+    static T value(const ArrowArray* a, int64_t row)
     {
-        OGRGeometryH ring = OGR_G_CreateGeometry(wkbLinearRing);
-        OGR_G_AddPoint(ring, _query.bounds()->xMin(), _query.bounds()->yMin(), 0);
-        OGR_G_AddPoint(ring, _query.bounds()->xMin(), _query.bounds()->yMax(), 0);
-        OGR_G_AddPoint(ring, _query.bounds()->xMax(), _query.bounds()->yMax(), 0);
-        OGR_G_AddPoint(ring, _query.bounds()->xMax(), _query.bounds()->yMin(), 0);
-        OGR_G_AddPoint(ring, _query.bounds()->xMin(), _query.bounds()->yMin(), 0);
-
-        _spatialFilter = OGR_G_CreateGeometry(wkbPolygon);
-        OGR_G_AddGeometryDirectly(_spatialFilter, ring);
-        // note: "Directly" above means _spatialFilter takes ownership if ring handle
+        return static_cast<const T*>(a->buffers[1])[row];
     }
 
+    // variable-length value (string or binary) with offsets of type T
+    template<typename T>
+    static const char* bytes(const ArrowArray* a, int64_t row, std::size_t& size)
+    {
+        const T* offsets = static_cast<const T*>(a->buffers[1]);
+        size = (std::size_t)(offsets[row + 1] - offsets[row]);
+        return static_cast<const char*>(a->buffers[2]) + offsets[row];
+    }
 
-    OE_DEBUG << LC << "SQL: " << expr << std::endl;
-    _resultSetHandle = GDALDatasetExecuteSQL(_dsHandle, expr.c_str(), _spatialFilter, 0L);
-
-    if (_resultSetHandle)
+    // reads the next batch; false at the end of the stream
+    bool next(FeatureList& out)
     {
-        OGR_L_ResetReading(_resultSetHandle);
+        ArrowArray batch;
+        if (_stream.get_next(&_stream, &batch) != 0)
+        {
+            const char* error = _stream.get_last_error(&_stream);
+            OE_WARN << LC << "Arrow stream error: " << (error ? error : "unknown") << std::endl;
+            return false;
+        }
+
+        if (batch.release == nullptr)
+            return false;
+
+        const SpatialReference* srs = _profile.valid() ? _profile->getSRS() : nullptr;
+
+        for (int64_t r = 0; r < batch.length; ++r)
+        {
+            FeatureID fid = 0;
+            if (_fidColumn >= 0)
+            {
+                const ArrowArray* a = batch.children[_fidColumn];
+                int64_t row = batch.offset + a->offset + r;
+                if (isValid(a, row))
+                    fid = value<int64_t>(a, row);
+            }
+
+            Geometry* geom = nullptr;
+            if (_geomColumn >= 0)
+            {
+                const ArrowArray* a = batch.children[_geomColumn];
+                int64_t row = batch.offset + a->offset + r;
+                if (isValid(a, row))
+                {
+                    std::size_t size;
+                    const char* wkb = _schema.children[_geomColumn]->format[0] == 'z' ?
+                        bytes<int32_t>(a, row, size) :
+                        bytes<int64_t>(a, row, size);
+
+                    OGRGeometryH geomHandle = nullptr;
+                    if (size > 0 && OGR_G_CreateFromWkb((unsigned char*)wkb, nullptr, &geomHandle, (int)size) == OGRERR_NONE)
+                    {
+                        geom = OgrUtils::createGeometry(geomHandle, _rewindPolygons);
+                        OGR_G_DestroyGeometry(geomHandle);
+                    }
+                }
+            }
+
+            osg::ref_ptr<Feature> feature = new Feature(geom, srs, Style(), fid);
+            if (_profile.valid() && _profile->geoInterp().isSet())
+                feature->geoInterp() = _profile->geoInterp().get();
+
+            for (auto& column : _columns)
+            {
+                const ArrowArray* a = batch.children[column.index];
+                int64_t row = batch.offset + a->offset + r;
+                bool valid = isValid(a, row);
+
+                switch (column.format)
+                {
+                case 'b':
+                    if (valid) feature->set(column.name, (long long)((static_cast<const uint8_t*>(a->buffers[1])[row >> 3] >> (row & 7)) & 1));
+                    else feature->setNull(column.name, ATTRTYPE_INT);
+                    break;
+                case 'c': case 'C': case 's': case 'S': case 'i': case 'I': case 'l': case 'L':
+                    if (valid)
+                    {
+                        long long v =
+                            column.format == 'c' ? value<int8_t>(a, row) :
+                            column.format == 'C' ? value<uint8_t>(a, row) :
+                            column.format == 's' ? value<int16_t>(a, row) :
+                            column.format == 'S' ? value<uint16_t>(a, row) :
+                            column.format == 'i' ? value<int32_t>(a, row) :
+                            column.format == 'I' ? value<uint32_t>(a, row) :
+                            column.format == 'l' ? value<int64_t>(a, row) :
+                            (long long)value<uint64_t>(a, row);
+                        feature->set(column.name, v);
+                    }
+                    else feature->setNull(column.name, ATTRTYPE_INT);
+                    break;
+                case 'f': case 'g':
+                    if (valid) feature->set(column.name, column.format == 'f' ? (double)value<float>(a, row) : value<double>(a, row));
+                    else feature->setNull(column.name, ATTRTYPE_DOUBLE);
+                    break;
+                default: // 'u', 'U'
+                    if (valid)
+                    {
+                        std::size_t size;
+                        const char* str = column.format == 'u' ?
+                            bytes<int32_t>(a, row, size) :
+                            bytes<int64_t>(a, row, size);
+                        feature->set(column.name, std::string(str, size));
+                    }
+                    else feature->setNull(column.name, ATTRTYPE_STRING);
+                }
+            }
+
+            out.push_back(feature.get());
+        }
+
+        batch.release(&batch);
+        return true;
     }
+};
 
-    readChunk();
+#else
+
+// GDAL too old for the Arrow stream; always use the per-feature path.
+struct OGR::OGRFeatureCursor::ArrowReader
+{
+    bool next(FeatureList&) { return false; }
+};
+
+#endif // OE_OGR_ARROW_STREAM
+
+//........................................................................
+
+OGR::OGRFeatureCursor::OGRFeatureCursor(
+    OGRDataSourceH dsHandle,
+    OGRLayerH layerHandle,
+    const FeatureSource* source,
+    const FeatureProfile* profile,
+    const Query& query,
+    const FeatureFilterChain* filters,
+    bool rewindPolygons,
+    unsigned chunkSize,
+    ProgressCallback* progress) :
+
+FeatureCursor     ( progress ),
+_source           ( source ),
+_dsHandle         ( dsHandle ),
+_layerHandle      ( layerHandle ),
+_resultSetHandle  ( 0L ),
+_spatialFilter    ( 0L ),
+_query            ( query ),
+_chunkSize        ( chunkSize == 0u ? 500u : chunkSize ),
+_nextHandleToQueue( 0L ),
+_resultSetEndReached(false),
+_profile          ( profile ),
+_filters          ( filters ),
+_rewindPolygons   ( rewindPolygons ),
+_pooledHandle     ( nullptr )
+{
+    execute();
+}
+
+OGR::OGRFeatureCursor::OGRFeatureCursor(
+    std::shared_ptr<HandlePool> pool,
+    PooledHandle* handle,
+    const FeatureSource* source,
+    const FeatureProfile* profile,
+    const Query& query,
+    const FeatureFilterChain* filters,
+    bool rewindPolygons,
+    unsigned chunkSize,
+    ProgressCallback* progress) :
+
+FeatureCursor     ( progress ),
+_source           ( source ),
+_dsHandle         ( handle->dsHandle ),
+_layerHandle      ( handle->layerHandle ),
+_resultSetHandle  ( 0L ),
+_spatialFilter    ( 0L ),
+_query            ( query ),
+_chunkSize        ( chunkSize == 0u ? 500u : chunkSize ),
+_nextHandleToQueue( 0L ),
+_resultSetEndReached(false),
+_profile          ( profile ),
+_filters          ( filters ),
+_rewindPolygons   ( rewindPolygons ),
+_pool             ( pool ),
+_pooledHandle     ( handle )
+{
+    execute();
 }
 
 OGR::OGRFeatureCursor::OGRFeatureCursor(OGRLayerH resultSetHandle, const FeatureProfile* profile) :
@@ -210,7 +590,8 @@ OGR::OGRFeatureCursor::OGRFeatureCursor(OGRLayerH resultSetHandle, const Feature
     _spatialFilter(0L),
     _chunkSize(500),
     _nextHandleToQueue(0L),
-    _resultSetEndReached(false)
+    _resultSetEndReached(false),
+    _pooledHandle(nullptr)
 {
     if (_resultSetHandle)
     {
@@ -222,19 +603,120 @@ OGR::OGRFeatureCursor::OGRFeatureCursor(OGRLayerH resultSetHandle, const Feature
 
 OGR::OGRFeatureCursor::~OGRFeatureCursor()
 {
+    // the stream must go before anything else touches the layer
+    _arrow.reset();
+
     if ( _nextHandleToQueue )
         OGR_F_Destroy( _nextHandleToQueue );
 
-    if ( _dsHandle && _resultSetHandle != _layerHandle )
+    if ( _dsHandle && _resultSetHandle && _resultSetHandle != _layerHandle )
         OGR_DS_ReleaseResultSet( _dsHandle, _resultSetHandle );
 
+    // Running SQL leaves the layer's filters up to the driver (executing
+    // it clears them), so the remembered attribute filter no longer holds.
+    // Reset both and forget it before the handle goes back to the pool.
+    if ( _pooledHandle && _resultSetHandle != _layerHandle )
+    {
+        OGR_L_SetSpatialFilter( _layerHandle, 0L );
+        OGR_L_SetAttributeFilter( _layerHandle, nullptr );
+        _pooledHandle->attributeFilter.clear();
+    }
+
     if ( _spatialFilter )
         OGR_G_DestroyGeometry( _spatialFilter );
 
-    if ( _dsHandle )
+    if ( _pool )
+        _pool->release( _pooledHandle );
+    else if ( _dsHandle )
         OGRReleaseDataSource( _dsHandle );
 }
 
+void
+OGR::OGRFeatureCursor::execute()
+{
+    // if the tilekey is set, convert it to feature profile coords
+    if (_query.tileKey().isSet() && !_query.bounds().isSet() && _profile.valid())
+    {
+        GeoExtent localEx = _query.tileKey()->getExtent().transform(_profile->getSRS());
+        _query.bounds() = localEx.bounds();
+    }
+
+    OGRGeometryH spatialFilter = 0L;
+
+    if (_pooledHandle)
+    {
+        // reuse the handle's filter polygon
+        if (_query.bounds().isSet())
+        {
+            updateSpatialFilter(_pooledHandle->spatialFilter, _query.bounds().get());
+            spatialFilter = _pooledHandle->spatialFilter;
+        }
+
+        // A query that is at most a WHERE clause runs straight on the layer,
+        // with no SQL to parse. The handle remembers its attribute filter,
+        // so repeating a query (as tiled layers do) doesn't set it again.
+        std::string where = _query.expression().getOrUse(std::string());
+
+        if (!_query.orderby().isSet() && !isSelectStatement(where))
+        {
+            OGR_L_SetSpatialFilter(_layerHandle, spatialFilter);
+
+            bool ok = true;
+            if (where != _pooledHandle->attributeFilter)
+            {
+                ok = OGR_L_SetAttributeFilter(_layerHandle, where.empty() ? nullptr : where.c_str()) == OGRERR_NONE;
+                if (!ok)
+                    OGR_L_SetAttributeFilter(_layerHandle, nullptr);
+                _pooledHandle->attributeFilter = ok ? where : std::string();
+            }
+
+            if (ok)
+            {
+                _resultSetHandle = _layerHandle;
+                OGR_L_ResetReading(_resultSetHandle);
+
+#ifdef OE_OGR_ARROW_STREAM
+                _arrow.reset(ArrowReader::open(_layerHandle, _chunkSize, _profile.get(), _rewindPolygons));
+                if (!_arrow)
+                    OGR_L_ResetReading(_resultSetHandle);
+#endif
+                readChunk();
+                return;
+            }
+
+            // the driver didn't take the WHERE clause; try it as SQL
+            OGR_L_SetSpatialFilter(_layerHandle, 0L);
+        }
+    }
+
+    std::string expr;
+    if (_pool)
+    {
+        expr = _pool->getSQL(_pooledHandle, _query);
+    }
+    else
+    {
+        expr = buildSQL(getSQLLayerName(_dsHandle, _layerHandle), _query);
+
+        // if there's a spatial extent in the query, build the spatial filter:
+        if (_query.bounds().isSet())
+        {
+            _spatialFilter = createSpatialFilter(_query.bounds().get());
+            spatialFilter = _spatialFilter;
+        }
+    }
+
+    OE_DEBUG << LC << "SQL: " << expr << std::endl;
+    _resultSetHandle = GDALDatasetExecuteSQL(_dsHandle, expr.c_str(), spatialFilter, 0L);
+
+    if (_resultSetHandle)
+    {
+        OGR_L_ResetReading(_resultSetHandle);
+    }
+
+    readChunk();
+}
+
 bool
 OGR::OGRFeatureCursor::hasMore() const
 {
@@ -259,6 +741,24 @@ OGR::OGRFeatureCursor::nextFeature()
     return _lastFeatureReturned.get();
 }
 
+bool
+OGR::OGRFeatureCursor::accept(Feature* feature) const
+{
+    if (_source != NULL && _source->isBlacklisted(feature->getFID()))
+    {
+        OE_DEBUG << LC << "Blacklisted feature " << feature->getFID() << " skipped" << std::endl;
+        return false;
+    }
+
+    if (!validateGeometry( feature->getGeometry() ))
+    {
+        OE_DEBUG << LC << "Invalid geometry found at feature " << feature->getFID() << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
 // reads a chunk of features into a memory cache; do this for performance
 // and to avoid needing the OGR Mutex every time
 void
@@ -270,38 +770,35 @@ OGR::OGRFeatureCursor::readChunk()
     while( _queue.size() < _chunkSize && !_resultSetEndReached )
     {
         FeatureList filterList;
-        while( filterList.size() < _chunkSize && !_resultSetEndReached )
+
+        if ( _arrow )
+        {
+            // a whole batch at once
+            FeatureList batch;
+            if ( !_arrow->next(batch) )
+            {
+                _resultSetEndReached = true;
+            }
+
+            for(auto& feature : batch)
+            {
+                if (accept(feature.get()))
+                    filterList.push_back(feature);
+            }
+        }
+
+        while( !_arrow && filterList.size() < _chunkSize && !_resultSetEndReached )
         {
             OGRFeatureH handle = OGR_L_GetNextFeature( _resultSetHandle );
             if ( handle )
             {
-                /*
-                // Crop the geometry by the spatial filter.  Could be useful for tiling.
-                if (_spatialFilter)
-                {
-                    OGRGeometryH geomRef = OGR_F_GetGeometryRef(handle);
-                    OGRGeometryH intersection = OGR_G_Intersection(geomRef, _spatialFilter);
-                    OGR_F_SetGeometry(handle, intersection);
-                }
-                */
                 osg::ref_ptr<Feature> feature = OgrUtils::createFeature( handle, _profile.get(), _rewindPolygons);
 
                 if (feature.valid())
                 {
-                    if (_source == NULL || !_source->isBlacklisted(feature->getFID()))
-                    {
-                        if (validateGeometry( feature->getGeometry() ))
-                        {
-                            filterList.push_back( feature.release() );
-                        }
-                        else
-                        {
-                            OE_DEBUG << LC << "Invalid geometry found at feature " << feature->getFID() << std::endl;
-                        }
-                    }
-                    else
+                    if (accept(feature.get()))
                     {
-                        OE_DEBUG << LC << "Blacklisted feature " << feature->getFID() << " skipped" << std::endl;
+                        filterList.push_back( feature.release() );
                     }
                 }
                 else
@@ -343,7 +840,7 @@ OGR::OGRFeatureCursor::readChunk()
         }
     }
 
-    if (_chunkSize == ~0)
+    if (_chunkSize == ~0 && !_arrow)
     {
         OGR_L_ResetReading(_resultSetHandle);
     }
@@ -364,12 +861,15 @@ OGRFeatureSource::Options::getConfig() const
     conf.set("geometry_url", _geometryUrl);
     conf.set("layer", _layer);
     conf.set("query", _query);
+    conf.set("max_open_handles", _maxOpenHandles);
     return conf;
 }
 
 void
 OGRFeatureSource::Options::fromConfig(const Config& conf)
 {
+    _maxOpenHandles.init(8u);
+
     conf.get("url", _url);
     conf.get("connection", _connection);
     conf.get("ogr_driver", _ogrDriver);
@@ -379,6 +879,7 @@ OGRFeatureSource::Options::fromConfig(const Config& conf)
     conf.get("geometry_url", _geometryUrl);
     conf.get("layer", _layer);
     conf.get("query", _query);
+    conf.get("max_open_handles", _maxOpenHandles);
 }
 
 //........................................................................
@@ -392,6 +893,7 @@ OE_LAYER_PROPERTY_IMPL(OGRFeatureSource, std::string, OGRDriver, ogrDriver);
 OE_LAYER_PROPERTY_IMPL(OGRFeatureSource, URI, GeometryURL, geometryUrl);
 OE_LAYER_PROPERTY_IMPL(OGRFeatureSource, std::string, Layer, layer);
 OE_LAYER_PROPERTY_IMPL(OGRFeatureSource, Query, Query, query);
+OE_LAYER_PROPERTY_IMPL(OGRFeatureSource, unsigned, MaxOpenHandles, maxOpenHandles);
 
 void
 OGRFeatureSource::init()
@@ -431,6 +933,9 @@ OGRFeatureSource::closeImplementation()
         _dsHandle = 0L;
     }
 
+    // open cursors keep the pool alive until they're done with it
+    _handlePool = nullptr;
+
     init();
 
     return FeatureSource::closeImplementation();
@@ -629,6 +1134,13 @@ OGRFeatureSource::openImplementation()
         }
 
 
+        // Read handles for queries. A writable source keeps none idle,
+        // so every query opens the data fresh and sees recent edits.
+        _handlePool = std::make_shared<OGR::HandlePool>(
+            _source,
+            options().layer().get(),
+            _writable ? 0u : options().maxOpenHandles().get());
+
         //Get the feature count
         _featureCount = OGR_L_GetFeatureCount(_layerHandle, 1);
 
@@ -786,6 +1298,9 @@ OGRFeatureSource::create(const FeatureProfile* profile,
 
     _geometryType = geometryType;
 
+    // new data is being written, so keep no read handles idle
+    _handlePool = std::make_shared<OGR::HandlePool>(_source, options().layer().get(), 0u);
+
     setStatus(Status::NoError);
     return getStatus();
 }
@@ -819,62 +1334,35 @@ OGRFeatureSource::createFeatureCursorImplementation(const Query& query, Progress
     }
     else
     {
-        OGRDataSourceH dsHandle = 0L;
-        OGRLayerH layerHandle = 0L;
-
-        const char* openOptions[2] = {
-            "OGR_GPKG_INTEGRITY_CHECK=NO",
-            nullptr
-        };
+        // hold a reference in case the source closes meanwhile
+        std::shared_ptr<OGR::HandlePool> pool = _handlePool;
+        if (!pool)
+            return 0L;
 
-        dsHandle = GDALOpenEx(
-            _source.c_str(),
-            GDAL_OF_VECTOR | GDAL_OF_READONLY,
-            nullptr,
-            nullptr, //openOptions,
-            nullptr);
+        OGR::PooledHandle* handle = pool->acquire();
+        if (!handle)
+            return 0L;
 
-        // open the handles safely:
-        // Each cursor requires its own DS handle so that multi-threaded access will work.
-        // The cursor impl will dispose of the new DS handle.
-        //dsHandle = OGROpenShared(_source.c_str(), 0, &_ogrDriverHandle);
-        if (dsHandle)
+        Query newQuery(query);
+        if (options().query().isSet())
         {
-            layerHandle = OGR::openLayer(dsHandle, options().layer().get());
+            newQuery = options().query()->combineWith(query);
         }
 
-        if (dsHandle && layerHandle)
-        {
-            Query newQuery(query);
-            if (options().query().isSet())
-            {
-                newQuery = options().query()->combineWith(query);
-            }
-
-            OE_DEBUG << newQuery.getConfig().toJSON(true) << std::endl;
-
-            // cursor is responsible for the OGR handles.
-            return new OGR::OGRFeatureCursor(
-                dsHandle,
-                layerHandle,
-                this,
-                getFeatureProfile(),
-                newQuery,
-                getFilters(),
-                _options->rewindPolygons().get(),
-                0, // default chunksize
-                progress
-                );
-        }
-        else
-        {
-            if (dsHandle)
-            {
-                OGRReleaseDataSource(dsHandle);
-            }
+        OE_DEBUG << newQuery.getConfig().toJSON(true) << std::endl;
 
-            return 0L;
-        }
+        // cursor returns the handle to the pool when it's done.
+        return new OGR::OGRFeatureCursor(
+            pool,
+            handle,
+            this,
+            getFeatureProfile(),
+            newQuery,
+            getFilters(),
+            _options->rewindPolygons().get(),
+            0, // default chunksize
+            progress
+            );
     }
 }
 
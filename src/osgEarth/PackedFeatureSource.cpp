@@ -0,0 +1,1207 @@
+/* -*-c++-*- */
+/* osgEarth - Geospatial SDK for OpenSceneGraph
+ * Copyright 2020 Pelican Mapping
+ * http://osgearth.org
+ *
+ * osgEarth is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+#include <osgEarth/PackedFeatureSource>
+#include <osgEarth/FeatureCursor>
+#include <osgEarth/Filter>
+#include <osgEarth/Registry>
+#include <osgEarth/Metrics>
+#include <osgDB/FileNameUtils>
+#include <algorithm>
+#include <cfloat>
+#include <cstring>
+#include <cstdio>
+#include <queue>
+
+#ifdef _WIN32
+#  include <windows.h>
+#else
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#  include <fcntl.h>
+#  include <unistd.h>
+#endif
+
+#define LC "[PackedFeatureSource] "
+
+using namespace osgEarth;
+using namespace osgEarth::PackedFeatures;
+
+//........................................................................
+
+namespace
+{
+    // File layout. Every section starts on an 8-byte boundary so the
+    // reader can use the mapped memory in place.
+    //
+    //   FileHeader
+    //   SRS WKT
+    //   FieldHeader[numFields], field names
+    //   R-tree boxes, double[numNodes * 4], leaves first, root last
+    //   FIDs, FeatureID[count]
+    //   FID index, {fid, position}[count] sorted by fid
+    //   geometry offsets, uint64[count + 1]
+    //   geometry records
+    //   one column per field: validity bytes, then values
+    //
+    // A geometry record is a {type, count} pair of uint32s followed by
+    // count xyz points. A polygon adds a {numHoles, 0} pair followed by
+    // one ring record per hole. A multi-geometry's count is its number
+    // of parts, and the parts follow it.
+
+    const char MAGIC[8] = { 'O', 'E', 'P', 'A', 'C', 'K', 'E', 'D' };
+    const std::uint32_t VERSION = 1u;
+
+    struct FileHeader
+    {
+        char          magic[8];
+        std::uint32_t version;
+        std::uint32_t nodeSize;
+        std::uint64_t count;
+        std::int32_t  geometryType;
+        std::uint32_t numFields;
+        double        bounds[4];
+        std::uint64_t numNodes;
+        std::uint64_t srs;
+        std::uint64_t srsSize;
+        std::uint64_t fields;
+        std::uint64_t index;
+        std::uint64_t fids;
+        std::uint64_t fidIndex;
+        std::uint64_t geomOffsets;
+        std::uint64_t geometry;
+    };
+
+    struct FieldHeader
+    {
+        std::uint32_t type;
+        std::uint32_t nameSize;
+        std::uint64_t name;
+        std::uint64_t valid;
+        std::uint64_t data;
+        std::uint64_t offsets; // strings and arrays only
+    };
+
+    static_assert(sizeof(FileHeader) % 8 == 0, "FileHeader must be 8-byte aligned");
+    static_assert(sizeof(FieldHeader) % 8 == 0, "FieldHeader must be 8-byte aligned");
+    static_assert(sizeof(osg::Vec3d) == 3 * sizeof(double), "osg::Vec3d must be packed");
+
+    template<typename T>
+    inline void put(std::string& out, const T& value)
+    {
+        out.append(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    template<typename T>
+    inline T take(const std::uint8_t*& ptr)
+    {
+        T value;
+        std::memcpy(&value, ptr, sizeof(T));
+        ptr += sizeof(T);
+        return value;
+    }
+
+    bool isVariableSize(AttributeType type)
+    {
+        return type == ATTRTYPE_STRING || type == ATTRTYPE_UNSPECIFIED || type == ATTRTYPE_DOUBLEARRAY;
+    }
+
+    // Hilbert curve index of a point on a 2^16 x 2^16 grid.
+    // From "Fast Hilbert curve generation, sorting, and range queries"
+    // (http://threadlocalmutex.com/?p=126), as used by flatbush.
+    std::uint32_t hilbert(std::uint32_t x, std::uint32_t y)
+    {
+        std::uint32_t a = x ^ y;
+        std::uint32_t b = 0xFFFF ^ a;
+        std::uint32_t c = 0xFFFF ^ (x | y);
+        std::uint32_t d = x & (y ^ 0xFFFF);
+
+        std::uint32_t A = a | (b >> 1);
+        std::uint32_t B = (a >> 1) ^ a;
+        std::uint32_t C = ((c >> 1) ^ (b & (d >> 1))) ^ c;
+        std::uint32_t D = ((a & (c >> 1)) ^ (d >> 1)) ^ d;
+
+        a = A; b = B; c = C; d = D;
+        A = ((a & (a >> 2)) ^ (b & (b >> 2)));
+        B = ((a & (b >> 2)) ^ (b & ((a ^ b) >> 2)));
+        C ^= ((a & (c >> 2)) ^ (b & (d >> 2)));
+        D ^= ((b & (c >> 2)) ^ ((a ^ b) & (d >> 2)));
+
+        a = A; b = B; c = C; d = D;
+        A = ((a & (a >> 4)) ^ (b & (b >> 4)));
+        B = ((a & (b >> 4)) ^ (b & ((a ^ b) >> 4)));
+        C ^= ((a & (c >> 4)) ^ (b & (d >> 4)));
+        D ^= ((b & (c >> 4)) ^ ((a ^ b) & (d >> 4)));
+
+        a = A; b = B; c = C; d = D;
+        C ^= ((a & (c >> 8)) ^ (b & (d >> 8)));
+        D ^= ((b & (c >> 8)) ^ ((a ^ b) & (d >> 8)));
+
+        a = C ^ (C >> 1);
+        b = D ^ (D >> 1);
+
+        std::uint32_t i0 = x ^ y;
+        std::uint32_t i1 = b | (0xFFFF ^ (i0 | a));
+
+        i0 = (i0 | (i0 << 8)) & 0x00FF00FF;
+        i0 = (i0 | (i0 << 4)) & 0x0F0F0F0F;
+        i0 = (i0 | (i0 << 2)) & 0x33333333;
+        i0 = (i0 | (i0 << 1)) & 0x55555555;
+
+        i1 = (i1 | (i1 << 8)) & 0x00FF00FF;
+        i1 = (i1 | (i1 << 4)) & 0x0F0F0F0F;
+        i1 = (i1 | (i1 << 2)) & 0x33333333;
+        i1 = (i1 | (i1 << 1)) & 0x55555555;
+
+        return (i1 << 1) | i0;
+    }
+
+    // End position (in nodes) of each R-tree level, leaves first.
+    void computeLevelBounds(std::size_t count, unsigned nodeSize, std::vector<std::size_t>& output)
+    {
+        output.clear();
+        std::size_t n = count;
+        std::size_t total = n;
+        output.push_back(total);
+        while (n > 1)
+        {
+            n = (n + nodeSize - 1) / nodeSize;
+            total += n;
+            output.push_back(total);
+        }
+    }
+
+    void encodeGeometry(const Geometry* geom, std::string& out)
+    {
+        if (geom->getType() == Geometry::TYPE_MULTI)
+        {
+            const GeometryCollection& parts = static_cast<const MultiGeometry*>(geom)->getComponents();
+            put<std::uint32_t>(out, Geometry::TYPE_MULTI);
+            put<std::uint32_t>(out, parts.size());
+            for (auto& part : parts)
+                encodeGeometry(part.get(), out);
+            return;
+        }
+
+        put<std::uint32_t>(out, geom->getType());
+        put<std::uint32_t>(out, geom->size());
+        out.append(
+            reinterpret_cast<const char*>(geom->asVector().data()),
+            geom->size() * sizeof(osg::Vec3d));
+
+        if (geom->getType() == Geometry::TYPE_POLYGON)
+        {
+            const RingCollection& holes = static_cast<const Polygon*>(geom)->getHoles();
+            put<std::uint32_t>(out, holes.size());
+            put<std::uint32_t>(out, 0u);
+            for (auto& hole : holes)
+                encodeGeometry(hole.get(), out);
+        }
+    }
+
+    Geometry* decodeGeometry(const std::uint8_t*& ptr)
+    {
+        const std::uint32_t* head = reinterpret_cast<const std::uint32_t*>(ptr);
+        Geometry::Type type = (Geometry::Type)head[0];
+        std::uint32_t count = head[1];
+        ptr += 2 * sizeof(std::uint32_t);
+
+        if (type == Geometry::TYPE_MULTI)
+        {
+            MultiGeometry* multi = new MultiGeometry();
+            for (std::uint32_t i = 0; i < count; ++i)
+            {
+                Geometry* part = decodeGeometry(ptr);
+                if (part)
+                    multi->add(part);
+            }
+            return multi;
+        }
+
+        Geometry* geom = 0L;
+        switch (type)
+        {
+        case Geometry::TYPE_POINT:      geom = new Point(count); break;
+        case Geometry::TYPE_LINESTRING: geom = new LineString(count); break;
+        case Geometry::TYPE_RING:       geom = new Ring(count); break;
+        case Geometry::TYPE_POLYGON:    geom = new Polygon(count); break;
+        default:                        geom = new PointSet(count); break;
+        }
+
+        const osg::Vec3d* points = reinterpret_cast<const osg::Vec3d*>(ptr);
+        geom->asVector().assign(points, points + count);
+        ptr += count * sizeof(osg::Vec3d);
+
+        if (type == Geometry::TYPE_POLYGON)
+        {
+            std::uint32_t numHoles = reinterpret_cast<const std::uint32_t*>(ptr)[0];
+            ptr += 2 * sizeof(std::uint32_t);
+            RingCollection& holes = static_cast<Polygon*>(geom)->getHoles();
+            for (std::uint32_t i = 0; i < numHoles; ++i)
+            {
+                osg::ref_ptr<Geometry> hole = decodeGeometry(ptr);
+                Ring* ring = dynamic_cast<Ring*>(hole.get());
+                if (ring)
+                    holes.push_back(ring);
+            }
+        }
+        return geom;
+    }
+
+    // Skips one spooled attribute value.
+    void skipValue(AttributeType type, const std::uint8_t*& ptr)
+    {
+        if (take<std::uint8_t>(ptr) == 0)
+            return;
+
+        switch (type)
+        {
+        case ATTRTYPE_INT:    ptr += sizeof(std::int64_t); break;
+        case ATTRTYPE_DOUBLE: ptr += sizeof(double); break;
+        case ATTRTYPE_BOOL:   ptr += sizeof(std::uint8_t); break;
+        case ATTRTYPE_DOUBLEARRAY: ptr += take<std::uint32_t>(ptr) * sizeof(double); break;
+        default:              ptr += take<std::uint32_t>(ptr); break;
+        }
+    }
+}
+
+//........................................................................
+
+namespace osgEarth { namespace PackedFeatures
+{
+    //! Read-only memory mapping of a whole file.
+    class MappedFile
+    {
+    public:
+        MappedFile() : _data(nullptr), _size(0u)
+        {
+#ifdef _WIN32
+            _file = INVALID_HANDLE_VALUE;
+            _mapping = NULL;
+#else
+            _fd = -1;
+#endif
+        }
+
+        ~MappedFile()
+        {
+            close();
+        }
+
+        bool open(const std::string& filename)
+        {
+            close();
+#ifdef _WIN32
+            _file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL,
+                OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+            if (_file == INVALID_HANDLE_VALUE)
+                return false;
+
+            LARGE_INTEGER size;
+            if (!GetFileSizeEx(_file, &size) || size.QuadPart == 0)
+                return false;
+            _size = (std::size_t)size.QuadPart;
+
+            _mapping = CreateFileMappingA(_file, NULL, PAGE_READONLY, 0, 0, NULL);
+            if (_mapping == NULL)
+                return false;
+
+            _data = (const std::uint8_t*)MapViewOfFile(_mapping, FILE_MAP_READ, 0, 0, 0);
+#else
+            _fd = ::open(filename.c_str(), O_RDONLY);
+            if (_fd < 0)
+                return false;
+
+            struct stat info;
+            if (::fstat(_fd, &info) != 0 || info.st_size == 0)
+                return false;
+            _size = (std::size_t)info.st_size;
+
+            void* data = ::mmap(nullptr, _size, PROT_READ, MAP_SHARED, _fd, 0);
+            _data = data != MAP_FAILED ? (const std::uint8_t*)data : nullptr;
+#endif
+            return _data != nullptr;
+        }
+
+        void close()
+        {
+#ifdef _WIN32
+            if (_data)
+                UnmapViewOfFile(_data);
+            if (_mapping != NULL)
+                CloseHandle(_mapping);
+            if (_file != INVALID_HANDLE_VALUE)
+                CloseHandle(_file);
+            _mapping = NULL;
+            _file = INVALID_HANDLE_VALUE;
+#else
+            if (_data)
+                ::munmap((void*)_data, _size);
+            if (_fd >= 0)
+                ::close(_fd);
+            _fd = -1;
+#endif
+            _data = nullptr;
+            _size = 0u;
+        }
+
+        const std::uint8_t* data() const { return _data; }
+        std::size_t size() const { return _size; }
+
+    private:
+        const std::uint8_t* _data;
+        std::size_t _size;
+#ifdef _WIN32
+        HANDLE _file;
+        HANDLE _mapping;
+#else
+        int _fd;
+#endif
+    };
+} }
+
+//........................................................................
+
+Writer::Writer(
+    const std::string& filename,
+    const SpatialReference* srs,
+    const FeatureSchema& schema,
+    const Geometry::Type& geometryType) :
+
+    _filename(filename),
+    _spoolName(filename + ".spool"),
+    _srs(srs),
+    _fields(schema.begin(), schema.end()),
+    _geometryType(geometryType),
+    _nodeSize(16u),
+    _spoolSize(0u)
+{
+    _bounds[0] = _bounds[1] = DBL_MAX;
+    _bounds[2] = _bounds[3] = -DBL_MAX;
+    _spool.open(_spoolName.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+}
+
+Writer::~Writer()
+{
+    if (_spool.is_open())
+        _spool.close();
+    std::remove(_spoolName.c_str());
+}
+
+bool
+Writer::add(const Feature* feature)
+{
+    const Geometry* geom = feature ? feature->getGeometry() : nullptr;
+    if (!geom || !_spool.good())
+        return false;
+
+    Bounds b = geom->getBounds();
+    if (!b.isValid())
+        return false;
+
+    Entry entry;
+    entry.box[0] = b.xMin();
+    entry.box[1] = b.yMin();
+    entry.box[2] = b.xMax();
+    entry.box[3] = b.yMax();
+    entry.hilbert = 0u;
+    entry.spool = _spoolSize;
+    entry.fid = feature->getFID();
+
+    _buffer.clear();
+    encodeGeometry(geom, _buffer);
+    entry.geomSize = _buffer.size();
+
+    // attributes are spooled row-wise and split into columns in finish()
+    const AttributeTable& attrs = feature->getAttrs();
+    for (auto& field : _fields)
+    {
+        AttributeTable::const_iterator i = attrs.find(field.first);
+        if (i == attrs.end() || !i->second.second.set)
+        {
+            put<std::uint8_t>(_buffer, 0u);
+            continue;
+        }
+
+        const AttributeValue& value = i->second;
+        put<std::uint8_t>(_buffer, 1u);
+        switch (field.second)
+        {
+        case ATTRTYPE_INT:
+            put<std::int64_t>(_buffer, value.getInt());
+            break;
+        case ATTRTYPE_DOUBLE:
+            put<double>(_buffer, value.getDouble());
+            break;
+        case ATTRTYPE_BOOL:
+            put<std::uint8_t>(_buffer, value.getBool() ? 1u : 0u);
+            break;
+        case ATTRTYPE_DOUBLEARRAY:
+        {
+            const std::vector<double>& array = value.getDoubleArrayValue();
+            put<std::uint32_t>(_buffer, array.size());
+            _buffer.append(reinterpret_cast<const char*>(array.data()), array.size() * sizeof(double));
+            break;
+        }
+        default:
+        {
+            std::string str = value.getString();
+            put<std::uint32_t>(_buffer, str.size());
+            _buffer.append(str);
+            break;
+        }
+        }
+    }
+    entry.rowSize = _buffer.size();
+
+    _spool.write(_buffer.data(), _buffer.size());
+    _spoolSize += _buffer.size();
+    _entries.push_back(entry);
+
+    _bounds[0] = std::min(_bounds[0], entry.box[0]);
+    _bounds[1] = std::min(_bounds[1], entry.box[1]);
+    _bounds[2] = std::max(_bounds[2], entry.box[2]);
+    _bounds[3] = std::max(_bounds[3], entry.box[3]);
+    return true;
+}
+
+Status
+Writer::finish(ProgressCallback* progress)
+{
+    OE_PROFILING_ZONE;
+
+    if (!_srs.valid())
+        return Status(Status::ConfigurationError, "Missing SRS");
+
+    _spool.close();
+    if (_spool.fail())
+        return Status(Status::GeneralError, Stringify() << "Failed to write \"" << _spoolName << "\"");
+
+    MappedFile spool;
+    if (_spoolSize > 0u && !spool.open(_spoolName))
+        return Status(Status::ResourceUnavailable, Stringify() << "Failed to map \"" << _spoolName << "\"");
+
+    const std::size_t count = _entries.size();
+    if (count == 0u)
+    {
+        _bounds[0] = _bounds[1] = _bounds[2] = _bounds[3] = 0.0;
+    }
+
+    // sort along the Hilbert curve by the center of each feature's box:
+    double width = _bounds[2] - _bounds[0];
+    double height = _bounds[3] - _bounds[1];
+    double sx = width > 0.0 ? 65535.0 / width : 0.0;
+    double sy = height > 0.0 ? 65535.0 / height : 0.0;
+    for (auto& e : _entries)
+    {
+        std::uint32_t x = (std::uint32_t)(sx * (0.5 * (e.box[0] + e.box[2]) - _bounds[0]));
+        std::uint32_t y = (std::uint32_t)(sy * (0.5 * (e.box[1] + e.box[3]) - _bounds[1]));
+        e.hilbert = hilbert(x, y);
+    }
+
+    std::sort(_entries.begin(), _entries.end(),
+        [](const Entry& lhs, const Entry& rhs) {
+            return lhs.hilbert < rhs.hilbert || (lhs.hilbert == rhs.hilbert && lhs.spool < rhs.spool);
+        });
+
+    if (progress && progress->isCanceled())
+        return Status(Status::GeneralError, "Canceled");
+
+    // pack the R-tree bottom-up; each parent covers nodeSize consecutive children.
+    std::vector<std::size_t> levelBounds;
+    computeLevelBounds(count, _nodeSize, levelBounds);
+    const std::size_t numNodes = levelBounds.back();
+
+    std::vector<double> boxes(numNodes * 4);
+    for (std::size_t i = 0; i < count; ++i)
+        std::memcpy(&boxes[i * 4], _entries[i].box, 4 * sizeof(double));
+
+    for (std::size_t level = 1; level < levelBounds.size(); ++level)
+    {
+        std::size_t child = level > 1 ? levelBounds[level - 2] : 0u;
+        std::size_t childEnd = levelBounds[level - 1];
+        for (std::size_t node = childEnd; node < levelBounds[level]; ++node)
+        {
+            double* box = &boxes[node * 4];
+            box[0] = box[1] = DBL_MAX;
+            box[2] = box[3] = -DBL_MAX;
+            for (std::size_t end = std::min(child + _nodeSize, childEnd); child < end; ++child)
+            {
+                const double* c = &boxes[child * 4];
+                box[0] = std::min(box[0], c[0]);
+                box[1] = std::min(box[1], c[1]);
+                box[2] = std::max(box[2], c[2]);
+                box[3] = std::max(box[3], c[3]);
+            }
+        }
+    }
+
+    std::ofstream out(_filename.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!out.is_open())
+        return Status(Status::ResourceUnavailable, Stringify() << "Failed to create \"" << _filename << "\"");
+
+    auto pos = [&]() { return (std::uint64_t)out.tellp(); };
+    auto write = [&](const void* data, std::size_t bytes) { out.write((const char*)data, bytes); };
+    auto pad = [&]() {
+        static const char zeros[8] = { 0 };
+        std::uint64_t p = pos();
+        if (p % 8u) write(zeros, 8u - p % 8u);
+    };
+
+    FileHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.nodeSize = _nodeSize;
+    header.count = count;
+    header.geometryType = _geometryType;
+    header.numFields = _fields.size();
+    std::memcpy(header.bounds, _bounds, sizeof(_bounds));
+    header.numNodes = numNodes;
+    write(&header, sizeof(header));
+
+    const std::string& wkt = _srs->getWKT();
+    header.srs = pos();
+    header.srsSize = wkt.size();
+    write(wkt.data(), wkt.size());
+    pad();
+
+    std::vector<FieldHeader> fields(_fields.size());
+    header.fields = pos();
+    if (!fields.empty())
+        write(fields.data(), fields.size() * sizeof(FieldHeader));
+    for (std::size_t f = 0; f < _fields.size(); ++f)
+    {
+        fields[f].type = _fields[f].second;
+        fields[f].nameSize = _fields[f].first.size();
+        fields[f].name = pos();
+        write(_fields[f].first.data(), _fields[f].first.size());
+    }
+    pad();
+
+    header.index = pos();
+    write(boxes.data(), boxes.size() * sizeof(double));
+    boxes = std::vector<double>();
+
+    header.fids = pos();
+    for (auto& e : _entries)
+        write(&e.fid, sizeof(FeatureID));
+
+    std::vector<std::pair<std::int64_t, std::int64_t>> fidIndex(count);
+    for (std::size_t i = 0; i < count; ++i)
+        fidIndex[i] = std::make_pair((std::int64_t)_entries[i].fid, (std::int64_t)i);
+    std::sort(fidIndex.begin(), fidIndex.end());
+    header.fidIndex = pos();
+    write(fidIndex.data(), fidIndex.size() * sizeof(fidIndex[0]));
+    fidIndex = std::vector<std::pair<std::int64_t, std::int64_t>>();
+
+    header.geomOffsets = pos();
+    std::uint64_t offset = 0u;
+    for (auto& e : _entries)
+    {
+        write(&offset, sizeof(offset));
+        offset += e.geomSize;
+    }
+    write(&offset, sizeof(offset));
+
+    header.geometry = pos();
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        write(spool.data() + _entries[i].spool, _entries[i].geomSize);
+
+        if ((i & 0xFFFF) == 0 && progress && progress->isCanceled())
+            return Status(Status::GeneralError, "Canceled");
+    }
+    pad();
+
+    // split the spooled rows into one column per field:
+    std::vector<const std::uint8_t*> values(count);
+    for (std::size_t f = 0; f < _fields.size(); ++f)
+    {
+        AttributeType type = _fields[f].second;
+
+        // locate this field's value in each row
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            const std::uint8_t* ptr = spool.data() + _entries[i].spool + _entries[i].geomSize;
+            for (std::size_t k = 0; k < f; ++k)
+                skipValue(_fields[k].second, ptr);
+            values[i] = ptr;
+        }
+
+        fields[f].valid = pos();
+        for (std::size_t i = 0; i < count; ++i)
+            write(values[i], 1u);
+        pad();
+
+        if (isVariableSize(type))
+        {
+            std::size_t unit = type == ATTRTYPE_DOUBLEARRAY ? sizeof(double) : 1u;
+
+            fields[f].offsets = pos();
+            std::uint64_t total = 0u;
+            for (std::size_t i = 0; i < count; ++i)
+            {
+                write(&total, sizeof(total));
+                const std::uint8_t* ptr = values[i];
+                if (take<std::uint8_t>(ptr))
+                    total += take<std::uint32_t>(ptr);
+            }
+            write(&total, sizeof(total));
+
+            fields[f].data = pos();
+            for (std::size_t i = 0; i < count; ++i)
+            {
+                const std::uint8_t* ptr = values[i];
+                if (take<std::uint8_t>(ptr))
+                {
+                    std::uint32_t size = take<std::uint32_t>(ptr);
+                    write(ptr, size * unit);
+                }
+            }
+        }
+        else
+        {
+            std::size_t size =
+                type == ATTRTYPE_INT ? sizeof(std::int64_t) :
+                type == ATTRTYPE_DOUBLE ? sizeof(double) :
+                sizeof(std::uint8_t);
+
+            const std::uint64_t zero = 0u;
+            fields[f].data = pos();
+            for (std::size_t i = 0; i < count; ++i)
+            {
+                const std::uint8_t* ptr = values[i];
+                write(take<std::uint8_t>(ptr) ? ptr : (const std::uint8_t*)&zero, size);
+            }
+        }
+        pad();
+
+        if (progress && progress->isCanceled())
+            return Status(Status::GeneralError, "Canceled");
+    }
+
+    // now that all the offsets are known, rewrite the headers.
+    out.seekp(header.fields);
+    if (!fields.empty())
+        write(fields.data(), fields.size() * sizeof(FieldHeader));
+    out.seekp(0);
+    write(&header, sizeof(header));
+    out.close();
+
+    if (out.fail())
+        return Status(Status::GeneralError, Stringify() << "Failed to write \"" << _filename << "\"");
+
+    spool.close();
+    std::remove(_spoolName.c_str());
+
+    OE_INFO << LC << "Wrote " << count << " features to " << _filename << std::endl;
+    return Status::NoError;
+}
+
+//........................................................................
+
+Reader::Reader() :
+    _count(0u),
+    _nodeSize(16u),
+    _geometryType(Geometry::TYPE_UNKNOWN),
+    _boxes(nullptr),
+    _fids(nullptr),
+    _fidIndex(nullptr),
+    _geomOffsets(nullptr),
+    _geometry(nullptr)
+{
+    //nop
+}
+
+Reader::~Reader()
+{
+    //nop
+}
+
+Status
+Reader::open(const std::string& filename)
+{
+    _file.reset(new MappedFile());
+    if (!_file->open(filename))
+        return Status(Status::ResourceUnavailable, Stringify() << "Failed to map \"" << filename << "\"");
+
+    const std::uint8_t* base = _file->data();
+    const std::uint64_t size = _file->size();
+
+    FileHeader header;
+    if (size < sizeof(header))
+        return Status(Status::ResourceUnavailable, Stringify() << "\"" << filename << "\" is not a packed feature file");
+    std::memcpy(&header, base, sizeof(header));
+
+    if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0)
+        return Status(Status::ResourceUnavailable, Stringify() << "\"" << filename << "\" is not a packed feature file");
+
+    if (header.version != VERSION)
+        return Status(Status::ResourceUnavailable, Stringify() << "Unsupported packed feature file version " << header.version);
+
+    _count = header.count;
+    _nodeSize = header.nodeSize;
+    _geometryType = (Geometry::Type)header.geometryType;
+    computeLevelBounds(_count, _nodeSize, _levelBounds);
+
+    auto inRange = [&](std::uint64_t offset, std::uint64_t bytes) {
+        return offset % 8u == 0u && offset <= size && bytes <= size - offset;
+    };
+
+    if (_nodeSize < 2u ||
+        header.numNodes != _levelBounds.back() ||
+        !inRange(header.srs, header.srsSize) ||
+        !inRange(header.fields, header.numFields * sizeof(FieldHeader)) ||
+        !inRange(header.index, header.numNodes * 4 * sizeof(double)) ||
+        !inRange(header.fids, _count * sizeof(FeatureID)) ||
+        !inRange(header.fidIndex, _count * 2 * sizeof(std::int64_t)) ||
+        !inRange(header.geomOffsets, (_count + 1) * sizeof(std::uint64_t)) ||
+        !inRange(header.geometry, 0u))
+    {
+        return Status(Status::ResourceUnavailable, Stringify() << "\"" << filename << "\" is corrupt");
+    }
+
+    _srs = SpatialReference::create(std::string((const char*)base + header.srs, header.srsSize));
+    if (!_srs.valid())
+        return Status(Status::ResourceUnavailable, Stringify() << "Unrecognized SRS in \"" << filename << "\"");
+
+    _bounds.set(header.bounds[0], header.bounds[1], header.bounds[2], header.bounds[3]);
+
+    _boxes = reinterpret_cast<const double*>(base + header.index);
+    _fids = reinterpret_cast<const FeatureID*>(base + header.fids);
+    _fidIndex = reinterpret_cast<const std::int64_t*>(base + header.fidIndex);
+    _geomOffsets = reinterpret_cast<const std::uint64_t*>(base + header.geomOffsets);
+    _geometry = base + header.geometry;
+
+    if (!inRange(header.geometry, _geomOffsets[_count]))
+        return Status(Status::ResourceUnavailable, Stringify() << "\"" << filename << "\" is corrupt");
+
+    _fields.clear();
+    _schema.clear();
+    const FieldHeader* fields = reinterpret_cast<const FieldHeader*>(base + header.fields);
+    for (std::uint32_t f = 0; f < header.numFields; ++f)
+    {
+        const FieldHeader& fh = fields[f];
+        AttributeType type = (AttributeType)fh.type;
+        std::uint64_t width =
+            type == ATTRTYPE_INT ? sizeof(std::int64_t) :
+            type == ATTRTYPE_DOUBLE ? sizeof(double) :
+            type == ATTRTYPE_BOOL ? 1u : 0u;
+
+        if (!inRange(fh.valid, _count) ||
+            !inRange(fh.data, width * _count) ||
+            (fh.name > size || fh.nameSize > size - fh.name) ||
+            (isVariableSize(type) && !inRange(fh.offsets, (_count + 1) * sizeof(std::uint64_t))))
+        {
+            return Status(Status::ResourceUnavailable, Stringify() << "\"" << filename << "\" is corrupt");
+        }
+
+        if (isVariableSize(type))
+        {
+            const std::uint64_t* offsets = reinterpret_cast<const std::uint64_t*>(base + fh.offsets);
+            std::uint64_t unit = type == ATTRTYPE_DOUBLEARRAY ? sizeof(double) : 1u;
+            if (!inRange(fh.data, offsets[_count] * unit))
+                return Status(Status::ResourceUnavailable, Stringify() << "\"" << filename << "\" is corrupt");
+        }
+
+        Field field;
+        field.name = std::string((const char*)base + fh.name, fh.nameSize);
+        field.type = type;
+        field.valid = base + fh.valid;
+        field.data = base + fh.data;
+        field.offsets = isVariableSize(type) ? reinterpret_cast<const std::uint64_t*>(base + fh.offsets) : nullptr;
+        _fields.push_back(field);
+        _schema[field.name] = type;
+    }
+
+    return Status::NoError;
+}
+
+void
+Reader::search(const Bounds& bounds, std::vector<Range>& output) const
+{
+    OE_PROFILING_ZONE;
+
+    output.clear();
+    if (_count == 0u)
+        return;
+
+    struct Span { std::size_t level, begin, end; };
+    std::vector<Span> stack;
+    std::vector<std::size_t> hits;
+
+    std::size_t top = _levelBounds.size() - 1;
+    stack.push_back(Span{ top, _levelBounds[top] - 1, _levelBounds[top] });
+
+    while (!stack.empty())
+    {
+        Span span = stack.back();
+        stack.pop_back();
+
+        std::size_t levelStart = span.level > 0 ? _levelBounds[span.level - 1] : 0u;
+        std::size_t childStart = span.level > 1 ? _levelBounds[span.level - 2] : 0u;
+
+        for (std::size_t node = span.begin; node < span.end; ++node)
+        {
+            const double* box = _boxes + node * 4;
+            if (box[2] < bounds.xMin() || box[0] > bounds.xMax() ||
+                box[3] < bounds.yMin() || box[1] > bounds.yMax())
+            {
+                continue;
+            }
+
+            if (span.level == 0)
+            {
+                hits.push_back(node);
+            }
+            else
+            {
+                std::size_t begin = childStart + (node - levelStart) * _nodeSize;
+                std::size_t end = std::min(begin + _nodeSize, _levelBounds[span.level - 1]);
+                stack.push_back(Span{ span.level - 1, begin, end });
+            }
+        }
+    }
+
+    // the leaves are in file order, so the hits collapse into runs.
+    std::sort(hits.begin(), hits.end());
+    for (std::size_t hit : hits)
+    {
+        if (!output.empty() && output.back().end == hit)
+            ++output.back().end;
+        else
+            output.push_back(Range{ hit, hit + 1 });
+    }
+}
+
+Feature*
+Reader::read(std::size_t index) const
+{
+    if (index >= _count)
+        return nullptr;
+
+    const std::uint8_t* ptr = _geometry + _geomOffsets[index];
+    Feature* feature = new Feature(decodeGeometry(ptr), _srs.get(), Style(), _fids[index]);
+
+    for (auto& field : _fields)
+    {
+        if (field.valid[index] == 0)
+        {
+            feature->setNull(field.name, field.type);
+            continue;
+        }
+
+        switch (field.type)
+        {
+        case ATTRTYPE_INT:
+            feature->set(field.name, (long long)reinterpret_cast<const std::int64_t*>(field.data)[index]);
+            break;
+        case ATTRTYPE_DOUBLE:
+            feature->set(field.name, reinterpret_cast<const double*>(field.data)[index]);
+            break;
+        case ATTRTYPE_BOOL:
+            feature->set(field.name, field.data[index] != 0);
+            break;
+        case ATTRTYPE_DOUBLEARRAY:
+        {
+            const double* values = reinterpret_cast<const double*>(field.data);
+            feature->set(field.name, std::vector<double>(
+                values + field.offsets[index],
+                values + field.offsets[index + 1]));
+            break;
+        }
+        default:
+            feature->set(field.name, std::string(
+                (const char*)field.data + field.offsets[index],
+                field.offsets[index + 1] - field.offsets[index]));
+            break;
+        }
+    }
+
+    return feature;
+}
+
+bool
+Reader::find(FeatureID fid, std::size_t& index) const
+{
+    std::size_t lo = 0u, hi = _count;
+    while (lo < hi)
+    {
+        std::size_t mid = lo + (hi - lo) / 2;
+        if (_fidIndex[mid * 2] < fid)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    if (lo < _count && _fidIndex[lo * 2] == fid)
+    {
+        index = (std::size_t)_fidIndex[lo * 2 + 1];
+        return true;
+    }
+    return false;
+}
+
+//........................................................................
+
+namespace
+{
+    /**
+     * Decodes features from the runs an R-tree query returned,
+     * a chunk at a time.
+     */
+    class PackedFeatureCursor : public FeatureCursor
+    {
+    public:
+        PackedFeatureCursor(
+            std::shared_ptr<Reader> reader,
+            const FeatureSource* source,
+            const FeatureProfile* profile,
+            const Query& query,
+            ProgressCallback* progress) :
+
+            FeatureCursor(progress),
+            _reader(reader),
+            _source(source),
+            _profile(profile),
+            _filters(source->getFilters()),
+            _query(query),
+            _range(0u),
+            _next(0u),
+            _limit(query.limit().isSet() ? std::max(query.limit().get(), 0) : ~0u),
+            _count(0u),
+            _end(false)
+        {
+            if (_query.tileKey().isSet() && !_query.bounds().isSet())
+            {
+                GeoExtent localEx = _query.tileKey()->getExtent().transform(_profile->getSRS());
+                _query.bounds() = localEx.bounds();
+            }
+
+            if (_query.bounds().isSet())
+            {
+                _reader->search(_query.bounds().get(), _ranges);
+            }
+            else if (_reader->size() > 0u)
+            {
+                _ranges.push_back(Range{ 0u, _reader->size() });
+            }
+
+            if (!_ranges.empty())
+                _next = _ranges.front().begin;
+
+            readChunk();
+        }
+
+        bool hasMore() const override
+        {
+            return !_queue.empty();
+        }
+
+        Feature* nextFeature() override
+        {
+            if (!hasMore())
+                return 0L;
+
+            if (_queue.size() == 1u)
+                readChunk();
+
+            _lastFeatureReturned = _queue.front();
+            _queue.pop();
+            return _lastFeatureReturned.get();
+        }
+
+    private:
+        std::shared_ptr<Reader> _reader;
+        const FeatureSource* _source;
+        osg::ref_ptr<const FeatureProfile> _profile;
+        osg::ref_ptr<const FeatureFilterChain> _filters;
+        Query _query;
+        std::vector<Range> _ranges;
+        std::size_t _range;
+        std::size_t _next;
+        unsigned _limit;
+        unsigned _count;
+        bool _end;
+        std::queue<osg::ref_ptr<Feature>> _queue;
+        osg::ref_ptr<Feature> _lastFeatureReturned;
+
+        void readChunk()
+        {
+            const std::size_t chunkSize = 128u;
+
+            while (_queue.size() < chunkSize && !_end)
+            {
+                FeatureList chunk;
+                while (chunk.size() < chunkSize)
+                {
+                    if (_range >= _ranges.size() || _count >= _limit)
+                    {
+                        _end = true;
+                        break;
+                    }
+
+                    std::size_t index = _next++;
+                    if (_next >= _ranges[_range].end && ++_range < _ranges.size())
+                        _next = _ranges[_range].begin;
+
+                    osg::ref_ptr<Feature> feature = _reader->read(index);
+                    if (feature.valid() && !_source->isBlacklisted(feature->getFID()))
+                    {
+                        chunk.push_back(feature);
+                        ++_count;
+                    }
+                }
+
+                if (_filters.valid() && !_filters->empty() && !chunk.empty())
+                {
+                    FilterContext cx;
+                    cx.setProfile(_profile.get());
+                    if (_query.bounds().isSet())
+                        cx.extent() = GeoExtent(_profile->getSRS(), _query.bounds().get());
+                    else
+                        cx.extent() = _profile->getExtent();
+
+                    for (FeatureFilterChain::const_iterator i = _filters->begin(); i != _filters->end(); ++i)
+                    {
+                        cx = i->get()->push(chunk, cx);
+                    }
+                }
+
+                for (auto& feature : chunk)
+                    _queue.push(feature);
+            }
+        }
+    };
+}
+
+//........................................................................
+
+Config
+PackedFeatureSource::Options::getConfig() const
+{
+    Config conf = FeatureSource::Options::getConfig();
+    conf.set("url", _url);
+    return conf;
+}
+
+void
+PackedFeatureSource::Options::fromConfig(const Config& conf)
+{
+    conf.get("url", _url);
+}
+
+//........................................................................
+
+REGISTER_OSGEARTH_LAYER(packedfeatures, PackedFeatureSource);
+
+OE_LAYER_PROPERTY_IMPL(PackedFeatureSource, URI, URL, url);
+
+Status
+PackedFeatureSource::openImplementation()
+{
+    Status parent = FeatureSource::openImplementation();
+    if (parent.isError())
+        return parent;
+
+    if (!options().url().isSet())
+        return Status(Status::ConfigurationError, "Missing required url");
+
+    std::string filename = options().url()->full();
+    if (osgDB::containsServerAddress(filename))
+        return Status(Status::ConfigurationError, "Packed feature files must be local");
+
+    std::shared_ptr<PackedFeatures::Reader> reader = std::make_shared<PackedFeatures::Reader>();
+    Status status = reader->open(filename);
+    if (status.isError())
+        return status;
+
+    GeoExtent extent(reader->getSRS(), reader->getBounds());
+    if (!extent.isValid() || reader->size() == 0u)
+    {
+        // an empty file still needs a valid profile
+        Bounds srsBounds;
+        if (reader->getSRS()->isGeographic())
+            extent = GeoExtent(reader->getSRS(), -180.0, -90.0, 180.0, 90.0);
+        else if (reader->getSRS()->getBounds(srsBounds))
+            extent = GeoExtent(reader->getSRS(), srsBounds);
+    }
+
+    FeatureProfile* profile = new FeatureProfile(extent);
+    if (options().geoInterp().isSet())
+    {
+        profile->geoInterp() = options().geoInterp().get();
+    }
+    setFeatureProfile(profile);
+
+    _reader = reader;
+
+    OE_INFO << LC << getName() << " : opened " << _reader->size() << " features" << std::endl;
+
+    return Status::NoError;
+}
+
+Status
+PackedFeatureSource::closeImplementation()
+{
+    // cursors hold their own reference, so the mapping stays
+    // alive until the last one goes away.
+    _reader = nullptr;
+    return FeatureSource::closeImplementation();
+}
+
+FeatureCursor*
+PackedFeatureSource::createFeatureCursorImplementation(const Query& query, ProgressCallback* progress)
+{
+    std::shared_ptr<PackedFeatures::Reader> reader = _reader;
+    if (!reader || !getFeatureProfile())
+        return 0L;
+
+    return new PackedFeatureCursor(reader, this, getFeatureProfile(), query, progress);
+}
+
+int
+PackedFeatureSource::getFeatureCount() const
+{
+    return _reader ? (int)_reader->size() : -1;
+}
+
+Feature*
+PackedFeatureSource::getFeature(FeatureID fid)
+{
+    std::shared_ptr<PackedFeatures::Reader> reader = _reader;
+    std::size_t index;
+    if (reader && !isBlacklisted(fid) && reader->find(fid, index))
+    {
+        return reader->read(index);
+    }
+    return 0L;
+}
+
+const FeatureSchema&
+PackedFeatureSource::getSchema() const
+{
+    return _reader ? _reader->getSchema() : FeatureSource::getSchema();
+}
+
+Geometry::Type
+PackedFeatureSource::getGeometryType() const
+{
+    return _reader ? _reader->getGeometryType() : Geometry::TYPE_UNKNOWN;
+}
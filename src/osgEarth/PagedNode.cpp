@@ -50,10 +50,16 @@ PagedNode2::PagedNode2() :
     _priorityScale(1.0f),
     _refinePolicy(REFINE_REPLACE),
     _preCompile(true),
-    _autoUnload(true)
+    _autoUnload(true),
+    _residencyHandle(0u),
+    _lastFrame(0u)
 {
     _job.setName(typeid(*this).name());
     _job.setArena(PAGEDNODE_ARENA_NAME);
+
+    static unsigned s_defaultSubsystem =
+        Registry::residencyManager()->addSubsystem("PagedNode");
+    _residencySubsystem = s_defaultSubsystem;
 }
 
 PagedNode2::~PagedNode2()
@@ -62,6 +68,9 @@ PagedNode2::~PagedNode2()
     // note: do not call reset() from here, we never want to
     // releaseGLObjects in this dtor b/c it could be called
     // from a pager thread at cancelation
+
+    if (_residencyHandle != 0u)
+        Registry::residencyManager()->remove(_residencyHandle);
 }
 
 bool
@@ -92,6 +101,11 @@ PagedNode2::traverse(osg::NodeVisitor& nv)
         }
     }
 
+    if (nv.getFrameStamp())
+    {
+        _lastFrame = nv.getFrameStamp()->getFrameNumber();
+    }
+
     if (nv.getTraversalMode() == nv.TRAVERSE_ALL_CHILDREN)
     {
         for (auto& child : _children)
@@ -180,6 +194,12 @@ PagedNode2::touch()
     {
         _token = _pagingManager->use(this, _token);
     }
+
+    // and tell the global memory budget as well
+    if (_residencyHandle != 0u)
+    {
+        Registry::residencyManager()->touch(_residencyHandle, _lastFrame);
+    }
 }
 
 bool
@@ -205,6 +225,30 @@ PagedNode2::merge(int revision)
         if (_callbacks.valid())
             _callbacks->firePostMergeNode(_compiled.get().get());
 
+        // account for the new content in the global memory budget
+        // (if there is one; otherwise skip the traversal)
+        ResidencyManager* residency = Registry::residencyManager();
+        if (_residencyHandle != 0u)
+        {
+            residency->remove(_residencyHandle);
+            _residencyHandle = 0u;
+        }
+
+        if (residency->isEnabled())
+        {
+            MemoryUsageVisitor mem;
+            _compiled.get()->accept(mem);
+            _residencyHandle = residency->add(
+                _residencySubsystem,
+                this,
+                mem.getCPUBytes(),
+                mem.getGPUBytes(),
+                _priorityScale);
+
+            if (_pagingManager)
+                _pagingManager->_residencySubsystems.insert(_residencySubsystem);
+        }
+
         _merged = true;
         _failed = false;
     }
@@ -354,6 +398,12 @@ void PagedNode2::unload()
     _failed = false;
     _token = nullptr;
 
+    if (_residencyHandle != 0u)
+    {
+        Registry::residencyManager()->remove(_residencyHandle);
+        _residencyHandle = 0u;
+    }
+
     // prevents a node in the PagingManager's merge queue from
     // being merged with old data.
     _revision++;
@@ -369,6 +419,7 @@ PagingManager::PagingManager() :
     _mergeMutex(OE_MUTEX_NAME),
     _tracker(),
     _mergesPerFrame(4u),
+    _frame(0u),
     _newFrame(false)
 {
     setCullingActive(false);
@@ -398,6 +449,11 @@ PagingManager::traverse(osg::NodeVisitor& nv)
 {
     ObjectStorage::set(&nv, this);
 
+    if (nv.getFrameStamp())
+    {
+        _frame = nv.getFrameStamp()->getFrameNumber();
+    }
+
     if (nv.getVisitorType() == nv.CULL_VISITOR)
     {
         _newFrame.exchange(true);
@@ -433,6 +489,40 @@ PagingManager::update()
             });
     }
 
+    // Discard nodes evicted by the global memory budget
+    if (_residencySubsystems.empty() == false)
+    {
+        ResidencyManager* residency = Registry::residencyManager();
+
+        for (unsigned subsystem : _residencySubsystems)
+        {
+            residency->collect(subsystem, _frame, _mergesPerFrame, _evictions);
+
+            for (auto& ref : _evictions)
+            {
+                PagedNode2* node = dynamic_cast<PagedNode2*>(ref.get());
+                if (!node)
+                    continue;
+
+                PagingManager* owner = node->_pagingManager;
+
+                if (node->getAutoUnload() && owner != nullptr)
+                {
+                    // drop the tracker entry first so it cannot unload
+                    // the node again after it reloads
+                    ScopedMutexLock lock(owner->_trackerMutex);
+                    owner->_tracker.remove(node->_token);
+                    node->unload();
+                }
+                else
+                {
+                    residency->touch(node->_residencyHandle, _frame);
+                }
+            }
+            _evictions.clear();
+        }
+    }
+
     // Handle merges
     if (_mergeQueue.empty() == false)
     {
@@ -0,0 +1,319 @@
+/* -*-c++-*- */
+/* osgEarth - Geospatial SDK for OpenSceneGraph
+ * Copyright 2020 Pelican Mapping
+ * http://osgearth.org
+ *
+ * osgEarth is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+#include <osgEarth/ProfileSampler>
+#include <osgEarth/Map>
+#include <osgEarth/ElevationPool>
+#include <osgEarth/GeoMath>
+#include <osgEarth/Progress>
+#include <osgEarth/Threading>
+#include <osgEarth/Metrics>
+#include <atomic>
+#include <cfloat>
+#include <cmath>
+#include <thread>
+
+#define LC "[ProfileSampler] "
+
+#define PROFILE_SAMPLER_ARENA_NAME "oe.profilesampler"
+
+using namespace osgEarth;
+using namespace osgEarth::Util;
+
+namespace
+{
+    // Shared pool, sized once; ProfileSampler::setNumThreads decides
+    // how many jobs a batch is split into.
+    JobArena* getArena()
+    {
+        static bool sized = []()
+        {
+            JobArena::setConcurrency(
+                PROFILE_SAMPLER_ARENA_NAME,
+                std::max(2u, std::thread::hardware_concurrency()));
+            return true;
+        }();
+        (void)sized;
+        return JobArena::get(PROFILE_SAMPLER_ARENA_NAME);
+    }
+
+    // most stations along one profile
+    const int MAX_STATIONS = 1 << 20;
+
+    inline osg::Vec3d toUnit(double latRad, double lonRad)
+    {
+        return osg::Vec3d(cos(latRad)*cos(lonRad), cos(latRad)*sin(lonRad), sin(latRad));
+    }
+
+    // point a fraction "t" of the way along the great circle from a to b
+    inline osg::Vec3d slerp(const osg::Vec3d& a, const osg::Vec3d& b, double angle, double t)
+    {
+        if (angle < 1e-12)
+            return a;
+        double s = sin(angle);
+        return a * (sin((1.0 - t)*angle) / s) + b * (sin(t*angle) / s);
+    }
+
+    // Samples of one profile, in the order they go into the
+    // elevation query: each station's center line sample, then
+    // its cross-track samples (if any).
+    struct Layout
+    {
+        ProfileSampler::Profile* profile;
+        std::size_t offset;
+        int stations;
+        int across;
+    };
+}
+
+ProfileSampler::ProfileSampler(const Map* map) :
+    _map(map),
+    _resolution(30.0, Units::METERS),
+    _numThreads(std::max(1u, std::thread::hardware_concurrency()))
+{
+    //nop
+}
+
+void
+ProfileSampler::setResolution(const Distance& value)
+{
+    _resolution = value;
+    _lod.unset();
+}
+
+void
+ProfileSampler::setLOD(unsigned value)
+{
+    _lod = value;
+}
+
+int
+ProfileSampler::sample(
+    std::vector<Profile>& profiles,
+    ProgressCallback* progress) const
+{
+    OE_PROFILING_ZONE;
+
+    osg::ref_ptr<const Map> map;
+    if (_map.lock(map) == false || map->getProfile() == nullptr)
+        return -1;
+
+    const SpatialReference* srs = map->getSRS();
+    const SpatialReference* geo = srs->getGeodeticSRS();
+    const double radius = geo->getEllipsoid().getSemiMajorAxis();
+    ElevationPool* pool = map->getElevationPool();
+
+    // resolution of the elevation query
+    Distance resolution = _resolution;
+    if (_lod.isSet())
+    {
+        unsigned tw, th;
+        map->getProfile()->getNumTiles(_lod.get(), tw, th);
+        double width = map->getProfile()->getExtent().width() / (double)tw;
+        resolution = Distance(width / (double)(ELEVATION_TILE_SIZE - 1), srs->getUnits());
+    }
+
+    const unsigned numThreads = osg::maximum(_numThreads, 1u);
+    const std::size_t profilesPerJob = osg::maximum(
+        (std::size_t)1u, profiles.size() / (numThreads * 4u));
+
+    JobGroup group;
+    Job job(getArena(), &group);
+
+    std::atomic_int sampled(0);
+
+    for (std::size_t p0 = 0; p0 < profiles.size(); p0 += profilesPerJob)
+    {
+        std::size_t p1 = osg::minimum(p0 + profilesPerJob, profiles.size());
+
+        job.dispatch([&, p0, p1](Cancelable*)
+        {
+            if (progress && progress->isCanceled())
+                return;
+
+            std::vector<Layout> layouts;
+            std::vector<osg::Vec3d> points;
+            std::vector<osg::Vec3d> path;
+            std::vector<double> lengths;
+
+            for (std::size_t p = p0; p < p1; ++p)
+            {
+                Profile& profile = profiles[p];
+                profile.distances.clear();
+                profile.elevations.clear();
+                profile.minimums.clear();
+                profile.maximums.clear();
+                profile.means.clear();
+                profile.minElevation = NO_DATA_VALUE;
+                profile.maxElevation = NO_DATA_VALUE;
+
+                // path as latitude/longitude in radians
+                path.clear();
+                for (auto& point : profile.path)
+                {
+                    GeoPoint g = point.transform(geo);
+                    if (g.isValid())
+                        path.emplace_back(osg::DegreesToRadians(g.y()), osg::DegreesToRadians(g.x()), 0.0);
+                }
+                if (path.size() < 2)
+                    continue;
+
+                const double spacing = resolution.asDistance(Units::METERS, osg::RadiansToDegrees(path[0].x()));
+                if (spacing <= 0.0)
+                    continue;
+
+                lengths.resize(path.size() - 1);
+                double total = 0.0;
+                for (std::size_t i = 0; i + 1 < path.size(); ++i)
+                {
+                    lengths[i] = GeoMath::distance(path[i].x(), path[i].y(), path[i + 1].x(), path[i + 1].y(), radius);
+                    total += lengths[i];
+                }
+
+                Layout layout;
+                layout.profile = &profile;
+                layout.offset = points.size();
+                layout.stations = osg::clampBetween((int)std::ceil(total / spacing), 1, MAX_STATIONS - 1) + 1;
+                layout.across = profile.corridorWidth > 0.0 ?
+                    osg::maximum((int)std::ceil(profile.corridorWidth / spacing), 1) + 1 :
+                    0;
+
+                const double step = total / (double)(layout.stations - 1);
+                std::size_t seg = 0;
+                double segStart = 0.0;
+
+                for (int k = 0; k < layout.stations; ++k)
+                {
+                    double s = osg::minimum(k * step, total);
+                    while (seg + 1 < lengths.size() && s > segStart + lengths[seg])
+                        segStart += lengths[seg++];
+
+                    const osg::Vec3d& a = path[seg];
+                    const osg::Vec3d& b = path[seg + 1];
+                    double t = lengths[seg] > 0.0 ? osg::clampBetween((s - segStart) / lengths[seg], 0.0, 1.0) : 0.0;
+
+                    osg::Vec3d u = slerp(toUnit(a.x(), a.y()), toUnit(b.x(), b.y()), lengths[seg] / radius, t);
+                    double lat = asin(osg::clampBetween(u.z(), -1.0, 1.0));
+                    double lon = atan2(u.y(), u.x());
+
+                    profile.distances.push_back(s);
+                    points.emplace_back(osg::RadiansToDegrees(lon), osg::RadiansToDegrees(lat), 0.0);
+
+                    if (layout.across > 0)
+                    {
+                        double heading = t < 1.0 ?
+                            GeoMath::bearing(lat, lon, b.x(), b.y()) :
+                            GeoMath::bearing(b.x(), b.y(), a.x(), a.y()) + osg::PI;
+
+                        for (int c = 0; c < layout.across; ++c)
+                        {
+                            double offset = profile.corridorWidth * ((double)c / (double)(layout.across - 1) - 0.5);
+                            double outLat, outLon;
+                            GeoMath::destination(lat, lon, heading + osg::PI_2, offset, outLat, outLon, radius);
+                            points.emplace_back(osg::RadiansToDegrees(outLon), osg::RadiansToDegrees(outLat), 0.0);
+                        }
+                    }
+                }
+
+                layouts.push_back(layout);
+            }
+
+            if (points.empty())
+                return;
+
+            if (!geo->isHorizEquivalentTo(srs) && !geo->transform(points, srs))
+            {
+                OE_WARN << LC << "Failed to transform profile samples to the map SRS" << std::endl;
+                return;
+            }
+
+            // one query for every profile in the job
+            ElevationPool::WorkingSet ws;
+            if (pool->sampleMapCoords(points, resolution, &ws, progress) < 0)
+                return;
+
+            for (auto& layout : layouts)
+            {
+                Profile& profile = *layout.profile;
+                const osg::Vec3d* sample = &points[layout.offset];
+
+                float lo = FLT_MAX, hi = -FLT_MAX;
+                auto extend = [&](float h) {
+                    if (h != NO_DATA_VALUE) {
+                        lo = osg::minimum(lo, h);
+                        hi = osg::maximum(hi, h);
+                    }
+                };
+
+                profile.elevations.reserve(layout.stations);
+                if (layout.across > 0)
+                {
+                    profile.minimums.reserve(layout.stations);
+                    profile.maximums.reserve(layout.stations);
+                    profile.means.reserve(layout.stations);
+                }
+
+                for (int k = 0; k < layout.stations; ++k)
+                {
+                    float center = (float)(sample++)->z();
+                    profile.elevations.push_back(center);
+                    extend(center);
+
+                    if (layout.across > 0)
+                    {
+                        float cmin = FLT_MAX, cmax = -FLT_MAX;
+                        double sum = 0.0;
+                        int count = 0;
+                        for (int c = 0; c < layout.across; ++c)
+                        {
+                            float h = (float)(sample++)->z();
+                            if (h != NO_DATA_VALUE)
+                            {
+                                cmin = osg::minimum(cmin, h);
+                                cmax = osg::maximum(cmax, h);
+                                sum += h;
+                                ++count;
+                            }
+                        }
+                        profile.minimums.push_back(count > 0 ? cmin : NO_DATA_VALUE);
+                        profile.maximums.push_back(count > 0 ? cmax : NO_DATA_VALUE);
+                        profile.means.push_back(count > 0 ? (float)(sum / count) : NO_DATA_VALUE);
+                        if (count > 0)
+                        {
+                            extend(cmin);
+                            extend(cmax);
+                        }
+                    }
+                }
+
+                if (lo <= hi)
+                {
+                    profile.minElevation = lo;
+                    profile.maxElevation = hi;
+                }
+                ++sampled;
+            }
+        });
+    }
+    group.join();
+
+    if (progress && progress->isCanceled())
+        return -1;
+
+    return sampled;
+}
@@ -21,6 +21,8 @@
 #include <osgEarth/Cube>
 #include <osgEarth/ShaderFactory>
 #include <osgEarth/ObjectIndex>
+#include <osgEarth/ResidencyManager>
+#include <osgEarth/GDAL>
 #include <osgEarth/HTTPClient>
 #include <osgEarth/TerrainEngineNode>
 
@@ -112,6 +114,10 @@ _blacklist("Reg.BlackList(OE)")
     // Default object index for tracking scene object by UID.
     _objectIndex = new ObjectIndex();
 
+    // Global memory budget for paged data.
+    _residencyManager = new ResidencyManager();
+    _gdalBlockCache = new GDAL::BlockCache();
+
     // activate KMZ support
     osgDB::Registry::instance()->addArchiveExtension( "kmz" );
     osgDB::Registry::instance()->addArchiveExtension( "3tz");
@@ -278,6 +284,10 @@ Registry::release()
     // Shared object index
     if (_objectIndex.valid())
         _objectIndex = new ObjectIndex();
+
+    // Decoded GDAL blocks
+    if (_gdalBlockCache.valid())
+        _gdalBlockCache->clear();
 }
 
 Threading::RecursiveMutex& osgEarth::getGDALMutex()
@@ -665,6 +675,18 @@ Registry::getObjectIndex() const
     return _objectIndex.get();
 }
 
+ResidencyManager*
+Registry::getResidencyManager() const
+{
+    return _residencyManager.get();
+}
+
+GDAL::BlockCache*
+Registry::getGDALBlockCache() const
+{
+    return _gdalBlockCache.get();
+}
+
 void
 Registry::startActivity(const std::string& activity)
 {
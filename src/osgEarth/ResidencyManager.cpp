@@ -0,0 +1,266 @@
+/* -*-c++-*- */
+/* osgEarth - Geospatial SDK for OpenSceneGraph
+ * Copyright 2020 Pelican Mapping
+ * http://osgearth.org
+ *
+ * osgEarth is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+#include <osgEarth/ResidencyManager>
+#include <osgEarth/Notify>
+#include <algorithm>
+#include <cstdlib>
+
+using namespace osgEarth;
+using namespace osgEarth::Util;
+using namespace osgEarth::Threading;
+
+#define LC "[ResidencyManager] "
+
+ResidencyManager::ResidencyManager() :
+    _mutex(OE_MUTEX_NAME),
+    _maxBytes(0u),
+    _totalBytes(0u),
+    _minIdleFrames(2u),
+    _lastSelectFrame(~0u)
+{
+    const char* c = ::getenv("OSGEARTH_MAX_RESIDENT_MB");
+    if (c)
+    {
+        _maxBytes = (std::size_t)::atoi(c) * 1024u * 1024u;
+        OE_INFO << LC << "Resident memory budget = " << (_maxBytes.load() / 1048576u) << " MB" << std::endl;
+    }
+
+    // slot 0 is reserved so that 0 is never a valid handle
+    _units.emplace_back();
+}
+
+void
+ResidencyManager::setMaxBytes(std::size_t value)
+{
+    ScopedMutexLock lock(_mutex);
+    _maxBytes = value;
+}
+
+unsigned
+ResidencyManager::addSubsystem(const std::string& name)
+{
+    ScopedMutexLock lock(_mutex);
+
+    for (unsigned i = 0; i < _subsystems.size(); ++i)
+    {
+        if (_subsystems[i]._name == name)
+            return i;
+    }
+
+    _subsystems.emplace_back();
+    _subsystems.back()._name = name;
+    _victims.emplace_back();
+    return (unsigned)_subsystems.size() - 1u;
+}
+
+ResidencyManager::Handle
+ResidencyManager::add(
+    unsigned subsystem,
+    osg::Referenced* user,
+    std::size_t cpuBytes,
+    std::size_t gpuBytes,
+    float priority)
+{
+    ScopedMutexLock lock(_mutex);
+
+    OE_SOFT_ASSERT_AND_RETURN(subsystem < _subsystems.size(), 0u);
+
+    Handle handle;
+    if (!_freeList.empty())
+    {
+        handle = _freeList.back();
+        _freeList.pop_back();
+    }
+    else
+    {
+        handle = (Handle)_units.size();
+        _units.emplace_back();
+    }
+
+    Unit& unit = _units[handle];
+    unit._user = user;
+    unit._subsystem = subsystem;
+    unit._cpuBytes = cpuBytes;
+    unit._gpuBytes = gpuBytes;
+    unit._priority = priority;
+    unit._lastFrame = _lastSelectFrame == ~0u ? 0u : _lastSelectFrame;
+    unit._live = true;
+    unit._evict = false;
+
+    Stats& stats = _subsystems[subsystem];
+    stats._cpuBytes += cpuBytes;
+    stats._gpuBytes += gpuBytes;
+    stats._units++;
+    _totalBytes += cpuBytes + gpuBytes;
+
+    return handle;
+}
+
+void
+ResidencyManager::update(Handle handle, std::size_t cpuBytes, std::size_t gpuBytes)
+{
+    ScopedMutexLock lock(_mutex);
+
+    if (handle == 0u || handle >= _units.size() || !_units[handle]._live)
+        return;
+
+    Unit& unit = _units[handle];
+    Stats& stats = _subsystems[unit._subsystem];
+    stats._cpuBytes = stats._cpuBytes - unit._cpuBytes + cpuBytes;
+    stats._gpuBytes = stats._gpuBytes - unit._gpuBytes + gpuBytes;
+    _totalBytes = _totalBytes - (unit._cpuBytes + unit._gpuBytes) + (cpuBytes + gpuBytes);
+    unit._cpuBytes = cpuBytes;
+    unit._gpuBytes = gpuBytes;
+}
+
+void
+ResidencyManager::touch(Handle handle, unsigned frame)
+{
+    ScopedMutexLock lock(_mutex);
+
+    if (handle != 0u && handle < _units.size())
+    {
+        Unit& unit = _units[handle];
+        unit._lastFrame = std::max(unit._lastFrame, frame);
+        unit._evict = false;
+    }
+}
+
+void
+ResidencyManager::remove(Handle handle)
+{
+    ScopedMutexLock lock(_mutex);
+
+    if (handle == 0u || handle >= _units.size() || !_units[handle]._live)
+        return;
+
+    Unit& unit = _units[handle];
+    Stats& stats = _subsystems[unit._subsystem];
+    stats._cpuBytes -= unit._cpuBytes;
+    stats._gpuBytes -= unit._gpuBytes;
+    stats._units--;
+    _totalBytes -= unit._cpuBytes + unit._gpuBytes;
+
+    unit = Unit();
+    _freeList.push_back(handle);
+}
+
+void
+ResidencyManager::select(unsigned frame)
+{
+    // assumes lock held
+    _lastSelectFrame = frame;
+
+    for (auto& victims : _victims)
+    {
+        for (Handle h : victims)
+            _units[h]._evict = false;
+        victims.clear();
+    }
+
+    if (_maxBytes == 0u || _totalBytes <= _maxBytes)
+        return;
+
+    struct Candidate
+    {
+        float _score;
+        Handle _handle;
+        bool operator < (const Candidate& rhs) const { return _score > rhs._score; }
+    };
+
+    std::vector<Candidate> candidates;
+    for (Handle h = 1u; h < _units.size(); ++h)
+    {
+        const Unit& unit = _units[h];
+        if (unit._live && unit._lastFrame + _minIdleFrames <= frame)
+        {
+            float idle = (float)(frame - unit._lastFrame);
+            candidates.push_back(Candidate{ idle / std::max(unit._priority, 0.01f), h });
+        }
+    }
+
+    std::sort(candidates.begin(), candidates.end());
+
+    std::size_t excess = _totalBytes - _maxBytes;
+    for (auto& c : candidates)
+    {
+        if (excess == 0u)
+            break;
+
+        Unit& unit = _units[c._handle];
+        unit._evict = true;
+        _victims[unit._subsystem].push_back(c._handle);
+        excess -= std::min(excess, unit._cpuBytes + unit._gpuBytes);
+    }
+}
+
+void
+ResidencyManager::collect(
+    unsigned subsystem,
+    unsigned frame,
+    unsigned maxCount,
+    std::vector<osg::ref_ptr<osg::Referenced>>& output)
+{
+    ScopedMutexLock lock(_mutex);
+
+    OE_SOFT_ASSERT_AND_RETURN(subsystem < _subsystems.size(), void());
+
+    if (frame != _lastSelectFrame)
+    {
+        select(frame);
+    }
+
+    std::vector<Handle>& victims = _victims[subsystem];
+    unsigned count = 0u;
+    while (!victims.empty() && count < maxCount)
+    {
+        Unit& unit = _units[victims.back()];
+        victims.pop_back();
+
+        // may have been touched or recycled since selection
+        if (unit._live && unit._evict)
+        {
+            unit._evict = false;
+
+            // the owner may be in its destructor on another thread,
+            // about to call remove(); never revive it.
+            osg::ref_ptr<osg::Referenced> user;
+            if (unit._user.lock(user))
+            {
+                output.push_back(user);
+                _subsystems[subsystem]._evictions++;
+                ++count;
+            }
+        }
+    }
+}
+
+std::size_t
+ResidencyManager::getTotalBytes() const
+{
+    ScopedMutexLock lock(_mutex);
+    return _totalBytes;
+}
+
+void
+ResidencyManager::getStats(std::vector<Stats>& output) const
+{
+    ScopedMutexLock lock(_mutex);
+    output = _subsystems;
+}
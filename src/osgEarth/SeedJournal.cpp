@@ -0,0 +1,499 @@
+/* -*-c++-*- */
+/* osgEarth - Geospatial SDK for OpenSceneGraph
+* Copyright 2020 Pelican Mapping
+* http://osgearth.org
+*
+* osgEarth is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+#include <osgEarth/SeedJournal>
+#include <osgEarth/Profile>
+#include <osgEarth/FileUtils>
+#include <osgEarth/StringUtils>
+#include <osgEarth/Notify>
+#include <sstream>
+#include <iomanip>
+#include <memory>
+#include <unordered_set>
+
+#if defined(WIN32) && !defined(__CYGWIN__)
+    #include <windows.h>
+    #include <process.h>
+    #define OE_GETPID _getpid
+#else
+    #include <fcntl.h>
+    #include <unistd.h>
+    #include <sys/file.h>
+    #include <sys/types.h>
+    #include <sys/stat.h>
+    #define OE_GETPID getpid
+#endif
+
+#define LC "[SeedJournal] "
+
+#define MANIFEST_HEADER "osgearth-seed-journal 1"
+
+using namespace osgEarth;
+using namespace osgEarth::Util;
+
+namespace
+{
+    // Small file with an exclusive advisory lock that is shared across
+    // processes and released by the OS if the owning process dies.
+    // The lock belongs to the open file (flock, or LockFileEx on Windows),
+    // not to the process, so closing some other handle on the same file
+    // does not drop it the way a POSIX fcntl lock would be dropped.
+    class LockFile
+    {
+    public:
+        static LockFile* open(const std::string& path)
+        {
+#if defined(WIN32) && !defined(__CYGWIN__)
+            HANDLE h = ::CreateFileA(
+                path.c_str(),
+                GENERIC_READ | GENERIC_WRITE,
+                FILE_SHARE_READ | FILE_SHARE_WRITE,
+                NULL,
+                OPEN_ALWAYS,
+                FILE_ATTRIBUTE_NORMAL,
+                NULL);
+            return h != INVALID_HANDLE_VALUE ? new LockFile(h) : nullptr;
+#else
+            int fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+            return fd >= 0 ? new LockFile(fd) : nullptr;
+#endif
+        }
+
+        ~LockFile()
+        {
+            unlock();
+#if defined(WIN32) && !defined(__CYGWIN__)
+            ::CloseHandle(_h);
+#else
+            ::close(_fd);
+#endif
+        }
+
+        bool lock(bool wait)
+        {
+#if defined(WIN32) && !defined(__CYGWIN__)
+            OVERLAPPED ov = { 0 };
+            DWORD flags = LOCKFILE_EXCLUSIVE_LOCK | (wait ? 0 : LOCKFILE_FAIL_IMMEDIATELY);
+            _locked = ::LockFileEx(_h, flags, 0, MAXDWORD, MAXDWORD, &ov) != 0;
+#else
+            _locked = ::flock(_fd, LOCK_EX | (wait ? 0 : LOCK_NB)) == 0;
+#endif
+            return _locked;
+        }
+
+        void unlock()
+        {
+            if (!_locked)
+                return;
+#if defined(WIN32) && !defined(__CYGWIN__)
+            OVERLAPPED ov = { 0 };
+            ::UnlockFileEx(_h, 0, MAXDWORD, MAXDWORD, &ov);
+#else
+            ::flock(_fd, LOCK_UN);
+#endif
+            _locked = false;
+        }
+
+        std::string read()
+        {
+            std::string result;
+            char buf[4096];
+#if defined(WIN32) && !defined(__CYGWIN__)
+            ::SetFilePointer(_h, 0, NULL, FILE_BEGIN);
+            DWORD n = 0;
+            while (::ReadFile(_h, buf, sizeof(buf), &n, NULL) && n > 0)
+                result.append(buf, n);
+#else
+            ::lseek(_fd, 0, SEEK_SET);
+            ssize_t n;
+            while ((n = ::read(_fd, buf, sizeof(buf))) > 0)
+                result.append(buf, n);
+#endif
+            return result;
+        }
+
+        void write(const std::string& data, bool append)
+        {
+#if defined(WIN32) && !defined(__CYGWIN__)
+            if (append)
+            {
+                ::SetFilePointer(_h, 0, NULL, FILE_END);
+            }
+            else
+            {
+                ::SetFilePointer(_h, 0, NULL, FILE_BEGIN);
+                ::SetEndOfFile(_h);
+            }
+            DWORD n = 0;
+            ::WriteFile(_h, data.data(), (DWORD)data.size(), &n, NULL);
+            ::FlushFileBuffers(_h);
+#else
+            if (append)
+            {
+                ::lseek(_fd, 0, SEEK_END);
+            }
+            else
+            {
+                ::lseek(_fd, 0, SEEK_SET);
+                if (::ftruncate(_fd, 0) != 0)
+                    return;
+            }
+            const char* ptr = data.data();
+            std::size_t left = data.size();
+            while (left > 0)
+            {
+                ssize_t n = ::write(_fd, ptr, left);
+                if (n <= 0) break;
+                ptr += n, left -= n;
+            }
+            ::fsync(_fd);
+#endif
+        }
+
+    private:
+#if defined(WIN32) && !defined(__CYGWIN__)
+        LockFile(HANDLE h) : _h(h), _locked(false) { }
+        HANDLE _h;
+#else
+        LockFile(int fd) : _fd(fd), _locked(false) { }
+        int _fd;
+#endif
+        bool _locked;
+    };
+
+    std::string makeParams(
+        const Profile* profile,
+        unsigned minLevel,
+        unsigned maxLevel,
+        unsigned unitDepth,
+        const std::vector<GeoExtent>& extents)
+    {
+        std::stringstream buf;
+        buf << "profile " << profile->getHorizSignature() << "\n"
+            << "levels " << minLevel << " " << maxLevel << " depth " << unitDepth << "\n";
+        for (auto& extent : extents)
+            buf << "extent " << extent.toString() << "\n";
+        return buf.str();
+    }
+}
+
+//...................................................................
+
+SeedJournal::SeedJournal(const std::string& path) :
+    _path(path),
+    _unitDepth(6u),
+    _cursor(0u),
+    _mutex("SeedJournal(OE)")
+{
+    //nop
+}
+
+SeedJournal::~SeedJournal()
+{
+    // Abandon any units we still hold so other workers can take them
+    for (auto& claim : _claims)
+        delete static_cast<LockFile*>(claim.second);
+}
+
+std::string
+SeedJournal::claimFile(unsigned id) const
+{
+    return _path + "/claims/" + std::to_string(id);
+}
+
+Status
+SeedJournal::open(
+    const Profile* profile,
+    unsigned minLevel,
+    unsigned maxLevel,
+    const std::vector<GeoExtent>& extents)
+{
+    Threading::ScopedMutexLock lock(_mutex);
+
+    if (profile == nullptr)
+        return Status(Status::ConfigurationError, "Missing profile");
+
+    if (!makeDirectory(_path + "/claims"))
+        return Status(Status::ResourceUnavailable, "Cannot create journal directory " + _path);
+
+    _profile = profile;
+    _units.clear();
+    _done.clear();
+    _cursor = 0u;
+
+    std::string params = makeParams(profile, minLevel, maxLevel, _unitDepth, extents);
+
+    // Only one worker builds the manifest; the rest wait and read it.
+    std::unique_ptr<LockFile> manifest(LockFile::open(_path + "/manifest"));
+    if (!manifest || !manifest->lock(true))
+        return Status(Status::ResourceUnavailable, "Cannot lock manifest in " + _path);
+
+    std::string existing = manifest->read();
+    if (existing.empty())
+    {
+        std::stringstream buf;
+        buf << MANIFEST_HEADER << "\n" << params;
+
+        for (unsigned lod = minLevel; lod <= maxLevel; ++lod)
+        {
+            unsigned ancestorLOD = lod > _unitDepth ? lod - _unitDepth : 0u;
+
+            std::vector<TileKey> keys;
+            if (extents.empty())
+            {
+                unsigned w, h;
+                profile->getNumTiles(ancestorLOD, w, h);
+                for (unsigned y = 0; y < h; ++y)
+                    for (unsigned x = 0; x < w; ++x)
+                        keys.push_back(TileKey(ancestorLOD, x, y, profile));
+            }
+            else
+            {
+                std::unordered_set<TileKey> unique;
+                for (auto& extent : extents)
+                {
+                    std::vector<TileKey> hits;
+                    profile->getIntersectingTiles(extent, ancestorLOD, hits);
+                    for (auto& key : hits)
+                        if (key.getLOD() == ancestorLOD && unique.insert(key).second)
+                            keys.push_back(key);
+                }
+            }
+
+            for (auto& key : keys)
+            {
+                WorkUnit unit;
+                unit._id = (unsigned)_units.size();
+                unit._lod = lod;
+                unit._ancestor = key;
+                _units.push_back(unit);
+                buf << "unit " << lod << " " << ancestorLOD << " " << key.getTileX() << " " << key.getTileY() << "\n";
+            }
+        }
+
+        manifest->write(buf.str(), false);
+        OE_INFO << LC << "Created " << _units.size() << " work units in " << _path << std::endl;
+    }
+    else
+    {
+        std::string header = std::string(MANIFEST_HEADER) + "\n" + params;
+        if (existing.compare(0, header.size(), header) != 0)
+        {
+            return Status(Status::ConfigurationError,
+                "Journal in " + _path + " was created with different seeding parameters");
+        }
+
+        std::istringstream in(existing.substr(header.size()));
+        std::string tag;
+        unsigned lod, ancestorLOD, x, y;
+        while (in >> tag >> lod >> ancestorLOD >> x >> y)
+        {
+            if (tag != "unit")
+                break;
+
+            WorkUnit unit;
+            unit._id = (unsigned)_units.size();
+            unit._lod = lod;
+            unit._ancestor = TileKey(ancestorLOD, x, y, profile);
+            _units.push_back(unit);
+        }
+
+        readJournal(&_done, nullptr);
+
+        OE_INFO << LC << "Resuming " << _path << ": "
+            << _done.size() << " of " << _units.size() << " work units finished" << std::endl;
+    }
+
+    return STATUS_OK;
+}
+
+bool
+SeedJournal::claim(WorkUnit& out)
+{
+    Threading::ScopedMutexLock lock(_mutex);
+
+    // Walk the whole list once starting at the cursor, so units abandoned
+    // by a dead worker are picked up again on the way around.
+    for (unsigned i = 0; i < _units.size(); ++i)
+    {
+        unsigned id = (_cursor + i) % _units.size();
+
+        if (_done.count(id) > 0 || _claims.count(id) > 0)
+            continue;
+
+        LockFile* file = LockFile::open(claimFile(id));
+        if (file == nullptr)
+            continue;
+
+        if (!file->lock(false))
+        {
+            delete file; // another worker has it
+            continue;
+        }
+
+        if (startsWith(file->read(), "done"))
+        {
+            _done.insert(id); // another worker finished it
+            delete file;
+            continue;
+        }
+
+        file->write(Stringify() << "claimed " << OE_GETPID() << "\n", false);
+
+        _claims[id] = file;
+        _cursor = id + 1;
+        out = _units[id];
+        return true;
+    }
+
+    return false;
+}
+
+void
+SeedJournal::complete(const WorkUnit& unit, unsigned tiles, double seconds)
+{
+    Threading::ScopedMutexLock lock(_mutex);
+
+    auto i = _claims.find(unit._id);
+    OE_SOFT_ASSERT_AND_RETURN(i != _claims.end(), void());
+
+    // Journal first: if we die before marking the claim file, a resumed
+    // run still sees the unit as finished.
+    std::unique_ptr<LockFile> journal(LockFile::open(_path + "/journal"));
+    if (journal && journal->lock(true))
+    {
+        std::stringstream buf;
+        buf << "unit " << unit._id << " " << unit._lod << " " << tiles << " "
+            << std::fixed << std::setprecision(3) << seconds << " "
+            << OE_GETPID() << "\n";
+        journal->write(buf.str(), true);
+    }
+    else
+    {
+        OE_WARN << LC << "Failed to record unit " << unit._id << " in " << _path << "/journal" << std::endl;
+    }
+
+    LockFile* file = static_cast<LockFile*>(i->second);
+    file->write("done\n", false);
+    delete file;
+    _claims.erase(i);
+    _done.insert(unit._id);
+}
+
+void
+SeedJournal::release(const WorkUnit& unit)
+{
+    Threading::ScopedMutexLock lock(_mutex);
+
+    auto i = _claims.find(unit._id);
+    if (i != _claims.end())
+    {
+        delete static_cast<LockFile*>(i->second);
+        _claims.erase(i);
+    }
+}
+
+bool
+SeedJournal::isComplete() const
+{
+    Threading::ScopedMutexLock lock(_mutex);
+
+    std::set<unsigned> done;
+    readJournal(&done, nullptr);
+    return done.size() >= _units.size();
+}
+
+void
+SeedJournal::getThroughput(std::map<unsigned, Throughput>& perLOD) const
+{
+    Threading::ScopedMutexLock lock(_mutex);
+    readJournal(nullptr, &perLOD);
+}
+
+std::string
+SeedJournal::getReport() const
+{
+    std::set<unsigned> done;
+    std::map<unsigned, Throughput> perLOD;
+    {
+        Threading::ScopedMutexLock lock(_mutex);
+        readJournal(&done, &perLOD);
+    }
+
+    std::stringstream buf;
+    buf << "Seed journal " << _path << ": "
+        << done.size() << " of " << _units.size() << " units finished\n"
+        << "    LOD    units      tiles    seconds    tiles/s\n";
+
+    Throughput total;
+    for (auto& i : perLOD)
+    {
+        const Throughput& t = i.second;
+        buf << std::setw(7) << i.first
+            << std::setw(9) << t._units
+            << std::setw(11) << t._tiles
+            << std::setw(11) << std::fixed << std::setprecision(1) << t._seconds
+            << std::setw(11) << std::fixed << std::setprecision(1) << t.tilesPerSecond()
+            << "\n";
+        total._units += t._units;
+        total._tiles += t._tiles;
+        total._seconds += t._seconds;
+    }
+
+    buf << "  total"
+        << std::setw(9) << total._units
+        << std::setw(11) << total._tiles
+        << std::setw(11) << std::fixed << std::setprecision(1) << total._seconds
+        << std::setw(11) << std::fixed << std::setprecision(1) << total.tilesPerSecond()
+        << "\n";
+
+    return buf.str();
+}
+
+void
+SeedJournal::readJournal(std::set<unsigned>* done, std::map<unsigned, Throughput>* perLOD) const
+{
+    // Callers hold _mutex, so this never overlaps our own complete(); the
+    // file lock keeps other workers from appending mid-read.
+    std::unique_ptr<LockFile> journal(LockFile::open(_path + "/journal"));
+    if (!journal || !journal->lock(true))
+        return;
+
+    std::istringstream in(journal->read());
+    journal->unlock();
+
+    std::string tag;
+    unsigned id, lod, tiles, pid;
+    double seconds;
+    while (in >> tag >> id >> lod >> tiles >> seconds >> pid)
+    {
+        if (done)
+            done->insert(id);
+
+        if (perLOD)
+        {
+            Throughput& t = (*perLOD)[lod];
+            t._units++;
+            t._tiles += tiles;
+            t._seconds += seconds;
+        }
+    }
+}
@@ -0,0 +1,540 @@
+/* -*-c++-*- */
+/* osgEarth - Geospatial SDK for OpenSceneGraph
+ * Copyright 2020 Pelican Mapping
+ * http://osgearth.org
+ *
+ * osgEarth is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+#include <osgEarth/SimplificationIndex>
+#include <osgEarth/FeatureSource>
+#include <osgEarth/FeatureCursor>
+#include <osgEarth/Progress>
+#include <osgEarth/Math>
+#include <algorithm>
+#include <cfloat>
+#include <functional>
+#include <queue>
+
+#define LC "[SimplificationIndex] "
+
+using namespace osgEarth;
+
+namespace
+{
+    // A vertex position, for matching shared vertices across features
+    struct VertexKey
+    {
+        VertexKey() : x(0.0), y(0.0) { }
+        // adding 0.0 folds -0.0 into 0.0 so equal keys hash alike
+        VertexKey(const osg::Vec3d& v) : x(v.x() + 0.0), y(v.y() + 0.0) { }
+        double x, y;
+        bool operator == (const VertexKey& rhs) const { return x == rhs.x && y == rhs.y; }
+    };
+
+    struct VertexKeyHash
+    {
+        std::size_t operator()(const VertexKey& k) const {
+            return hash_value_unsigned(std::hash<double>()(k.x), std::hash<double>()(k.y));
+        }
+    };
+
+    // The distinct neighbors of one vertex position over every path that
+    // visits it. A position with more than two is where paths meet or
+    // diverge, i.e. a junction.
+    struct Neighbors
+    {
+        Neighbors() : count(0u), junction(false) { }
+        VertexKey a, b;
+        unsigned char count;
+        bool junction;
+
+        void add(const VertexKey& n)
+        {
+            if (junction)
+                return;
+            if (count > 0u && n == a)
+                return;
+            if (count > 1u && n == b)
+                return;
+            if (count == 0u)
+                a = n, count = 1u;
+            else if (count == 1u)
+                b = n, count = 2u;
+            else
+                junction = true;
+        }
+    };
+
+    bool isClosed(const Geometry* part)
+    {
+        return
+            part->getType() == Geometry::TYPE_POLYGON ||
+            part->getType() == Geometry::TYPE_RING;
+    }
+
+    bool isSimplifiable(const Geometry* part)
+    {
+        return isClosed(part) || part->getType() == Geometry::TYPE_LINESTRING;
+    }
+
+    inline double effectiveArea(const osg::Vec3d& a, const osg::Vec3d& b, const osg::Vec3d& c)
+    {
+        return 0.5 * fabs((b.x() - a.x()) * (c.y() - a.y()) - (c.x() - a.x()) * (b.y() - a.y()));
+    }
+
+    // Junctions over a whole data set (the shared-edge topology)
+    class Topology
+    {
+    public:
+        void add(const Geometry* geom)
+        {
+            ConstGeometryIterator i(geom, true);
+            while (i.hasMore())
+            {
+                const Geometry* part = i.next();
+                if (isSimplifiable(part))
+                    addPath(part->asVector(), isClosed(part));
+            }
+        }
+
+        bool isJunction(const osg::Vec3d& v) const
+        {
+            auto i = _vertices.find(VertexKey(v));
+            return i != _vertices.end() && i->second.junction;
+        }
+
+        // A ring with one or two junctions could collapse between them.
+        // Picks extra vertices to make junctions of, chosen from the ring's
+        // shape alone, so that every feature sharing one of them keeps it
+        // too and shared runs stay identical.
+        void findPins(const Geometry* geom, std::vector<VertexKey>& pins) const
+        {
+            ConstGeometryIterator i(geom, true);
+            while (i.hasMore())
+            {
+                const Geometry* part = i.next();
+                if (isClosed(part))
+                    findPins(part->asVector(), pins);
+            }
+        }
+
+        void pin(const std::vector<VertexKey>& pins)
+        {
+            for (auto& key : pins)
+                _vertices[key].junction = true;
+        }
+
+    private:
+        std::unordered_map<VertexKey, Neighbors, VertexKeyHash> _vertices;
+
+        static bool lessXY(const osg::Vec3d& a, const osg::Vec3d& b)
+        {
+            return a.x() < b.x() || (a.x() == b.x() && a.y() < b.y());
+        }
+
+        void findPins(const Vec3dVector& path, std::vector<VertexKey>& pins) const
+        {
+            std::size_t n = path.size();
+            if (n < 3u)
+                return;
+
+            std::vector<VertexKey> junctions;
+            for (auto& v : path)
+            {
+                if (isJunction(v) && std::find(junctions.begin(), junctions.end(), VertexKey(v)) == junctions.end())
+                    junctions.push_back(VertexKey(v));
+            }
+
+            // none: the whole ring is one cyclic run, which keeps three
+            if (junctions.empty() || junctions.size() >= 3u)
+                return;
+
+            // candidates: the lowest and highest vertices in (x, y) order,
+            // then the one farthest from the line between them
+            std::size_t lo = 0u, hi = 0u;
+            for (std::size_t i = 1u; i < n; ++i)
+            {
+                if (lessXY(path[i], path[lo])) lo = i;
+                if (lessXY(path[hi], path[i])) hi = i;
+            }
+
+            std::size_t far = lo;
+            double farArea = 0.0;
+            for (std::size_t i = 0u; i < n; ++i)
+            {
+                double area = effectiveArea(path[lo], path[i], path[hi]);
+                if (area > farArea || (area == farArea && area > 0.0 && lessXY(path[i], path[far])))
+                    far = i, farArea = area;
+            }
+
+            std::size_t candidates[3] = { lo, hi, far };
+            for (unsigned c = 0u; c < 3u && junctions.size() < 3u; ++c)
+            {
+                VertexKey key(path[candidates[c]]);
+                if (std::find(junctions.begin(), junctions.end(), key) == junctions.end())
+                {
+                    junctions.push_back(key);
+                    pins.push_back(key);
+                }
+            }
+        }
+
+        void addPath(const Vec3dVector& path, bool closed)
+        {
+            std::size_t n = path.size();
+            if (n == 0u)
+                return;
+
+            for (std::size_t i = 0; i < n; ++i)
+            {
+                VertexKey key(path[i]);
+                Neighbors& nb = _vertices[key];
+
+                bool first = (i == 0u), last = (i == n - 1u);
+                if ((!closed && (first || last)) || (closed && n < 3u))
+                {
+                    nb.junction = true;
+                    continue;
+                }
+
+                VertexKey prev(path[first ? n - 1u : i - 1u]);
+                VertexKey next(path[last ? 0u : i + 1u]);
+                if (!(prev == key)) nb.add(prev);
+                if (!(next == key)) nb.add(next);
+            }
+        }
+    };
+
+    struct Candidate
+    {
+        double area;
+        double x, y;
+        unsigned index;
+        unsigned stamp;
+
+        // Ties break on position so that a shared run ranks the same way
+        // whichever direction a feature walks it
+        bool operator > (const Candidate& rhs) const {
+            if (area != rhs.area) return area > rhs.area;
+            if (x != rhs.x) return x > rhs.x;
+            if (y != rhs.y) return y > rhs.y;
+            return index > rhs.index;
+        }
+    };
+
+    // Visvalingam-Whyatt over the path vertices listed in run. A cyclic run
+    // stops at three vertices; otherwise the run's endpoints stay fixed.
+    // Ranks of removed vertices go into ranks (indexed like the path) and
+    // never decrease in removal order.
+    void rankRun(const Vec3dVector& path, const std::vector<unsigned>& run, bool cyclic, float* ranks)
+    {
+        unsigned m = run.size();
+        unsigned minRemaining = cyclic ? 3u : 2u;
+        if (m <= minRemaining)
+            return;
+
+        std::vector<unsigned> prev(m), next(m), stamp(m, 0u);
+        for (unsigned i = 0; i < m; ++i)
+        {
+            prev[i] = i > 0u ? i - 1u : m - 1u;
+            next[i] = i < m - 1u ? i + 1u : 0u;
+        }
+
+        std::priority_queue<Candidate, std::vector<Candidate>, std::greater<Candidate> > heap;
+
+        auto push = [&](unsigned i)
+        {
+            const osg::Vec3d& v = path[run[i]];
+            Candidate c;
+            c.area = effectiveArea(path[run[prev[i]]], v, path[run[next[i]]]);
+            c.x = v.x(), c.y = v.y();
+            c.index = i;
+            c.stamp = ++stamp[i];
+            heap.push(c);
+        };
+
+        unsigned begin = cyclic ? 0u : 1u;
+        unsigned end = cyclic ? m : m - 1u;
+        for (unsigned i = begin; i < end; ++i)
+            push(i);
+
+        std::vector<bool> removed(m, false);
+        unsigned remaining = m;
+        double floor = 0.0;
+
+        while (!heap.empty() && remaining > minRemaining)
+        {
+            Candidate c = heap.top();
+            heap.pop();
+            if (removed[c.index] || c.stamp != stamp[c.index])
+                continue;
+
+            floor = std::max(floor, c.area);
+            ranks[run[c.index]] = (float)floor;
+            removed[c.index] = true;
+            --remaining;
+
+            unsigned p = prev[c.index], n = next[c.index];
+            next[p] = n;
+            prev[n] = p;
+
+            if (cyclic || p != 0u) push(p);
+            if (cyclic || n != m - 1u) push(n);
+        }
+    }
+
+    // Ranks one part (outer ring, hole, or line) into ranks[0..size)
+    void rankPart(const Geometry* part, const Topology& topology, float* ranks)
+    {
+        const Vec3dVector& path = part->asVector();
+        unsigned n = path.size();
+        std::fill(ranks, ranks + n, FLT_MAX);
+
+        if (!isSimplifiable(part) || n < 3u)
+            return;
+
+        bool closed = isClosed(part);
+
+        std::vector<unsigned> junctions;
+        for (unsigned i = 0; i < n; ++i)
+        {
+            if ((!closed && (i == 0u || i == n - 1u)) || topology.isJunction(path[i]))
+                junctions.push_back(i);
+        }
+
+        std::vector<unsigned> run;
+        if (closed && junctions.empty())
+        {
+            // a ring that shares nothing with any other path
+            run.resize(n);
+            for (unsigned i = 0; i < n; ++i)
+                run[i] = i;
+            rankRun(path, run, true, ranks);
+            return;
+        }
+
+        // runs between consecutive junctions; a ring's last run wraps around
+        unsigned numRuns = closed ? junctions.size() : junctions.size() - 1u;
+        for (unsigned r = 0; r < numRuns; ++r)
+        {
+            unsigned from = junctions[r];
+            unsigned to = r + 1u < junctions.size() ? junctions[r + 1u] : junctions[0] + n;
+            run.clear();
+            for (unsigned i = from; i <= to; ++i)
+                run.push_back(i % n);
+            rankRun(path, run, false, ranks);
+        }
+    }
+
+    void rankGeometry(const Geometry* geom, const Topology& topology, std::vector<float>& ranks)
+    {
+        ranks.resize(geom->getTotalPointCount());
+        unsigned offset = 0u;
+        ConstGeometryIterator i(geom, true);
+        while (i.hasMore())
+        {
+            const Geometry* part = i.next();
+            rankPart(part, topology, ranks.data() + offset);
+            offset += part->size();
+        }
+    }
+}
+
+//........................................................................
+
+SimplificationIndex::SimplificationIndex()
+{
+    //nop
+}
+
+Status
+SimplificationIndex::build(FeatureSource* source, ProgressCallback* progress)
+{
+    if (!source)
+        return Status(Status::AssertionFailure, "Missing feature source");
+
+    _entries.clear();
+
+    // Pass 1: find every junction
+    Topology topology;
+    {
+        osg::ref_ptr<FeatureCursor> cursor = source->createFeatureCursor(Query(), progress);
+        if (!cursor.valid())
+            return Status(Status::ResourceUnavailable, "Failed to read features");
+
+        while (cursor->hasMore())
+        {
+            osg::ref_ptr<Feature> feature = cursor->nextFeature();
+            if (feature.valid() && feature->getGeometry())
+                topology.add(feature->getGeometry());
+
+            if (progress && progress->isCanceled())
+                return Status(Status::GeneralError, "Canceled");
+        }
+    }
+
+    // Pass 2: pin rings that have too few junctions; collect first and
+    // apply after, so the choice does not depend on the reading order
+    {
+        osg::ref_ptr<FeatureCursor> cursor = source->createFeatureCursor(Query(), progress);
+        if (!cursor.valid())
+            return Status(Status::ResourceUnavailable, "Failed to read features");
+
+        std::vector<VertexKey> pins;
+        while (cursor->hasMore())
+        {
+            osg::ref_ptr<Feature> feature = cursor->nextFeature();
+            if (feature.valid() && feature->getGeometry())
+                topology.findPins(feature->getGeometry(), pins);
+
+            if (progress && progress->isCanceled())
+                return Status(Status::GeneralError, "Canceled");
+        }
+        topology.pin(pins);
+    }
+
+    // Pass 3: rank the vertices of each feature
+    osg::ref_ptr<FeatureCursor> cursor = source->createFeatureCursor(Query(), progress);
+    if (!cursor.valid())
+        return Status(Status::ResourceUnavailable, "Failed to read features");
+
+    std::size_t numPoints = 0u;
+    while (cursor->hasMore())
+    {
+        osg::ref_ptr<Feature> feature = cursor->nextFeature();
+        if (!feature.valid() || !feature->getGeometry())
+            continue;
+
+        const Geometry* geom = feature->getGeometry();
+        auto inserted = _entries.emplace(feature->getFID(), Entry());
+        Entry& entry = inserted.first->second;
+        if (!inserted.second)
+        {
+            // FIDs must be unique for the index to identify a feature
+            entry.valid = false;
+            entry.ranks.clear();
+            continue;
+        }
+
+        entry.valid = true;
+        entry.numPoints = geom->getTotalPointCount();
+        entry.bounds = geom->getBounds();
+        rankGeometry(geom, topology, entry.ranks);
+        numPoints += entry.numPoints;
+
+        if (progress && progress->isCanceled())
+        {
+            _entries.clear();
+            return Status(Status::GeneralError, "Canceled");
+        }
+    }
+
+    OE_INFO << LC << "Ranked " << numPoints << " vertices in " << _entries.size()
+        << " features from \"" << source->getName() << "\"" << std::endl;
+
+    return STATUS_OK;
+}
+
+void
+SimplificationIndex::build(const FeatureList& features)
+{
+    _entries.clear();
+
+    Topology topology;
+    for (auto& feature : features)
+    {
+        if (feature.valid() && feature->getGeometry())
+            topology.add(feature->getGeometry());
+    }
+
+    std::vector<VertexKey> pins;
+    for (auto& feature : features)
+    {
+        if (feature.valid() && feature->getGeometry())
+            topology.findPins(feature->getGeometry(), pins);
+    }
+    topology.pin(pins);
+
+    for (auto& feature : features)
+    {
+        if (!feature.valid() || !feature->getGeometry())
+            continue;
+
+        const Geometry* geom = feature->getGeometry();
+        auto inserted = _entries.emplace(feature->getFID(), Entry());
+        Entry& entry = inserted.first->second;
+        if (!inserted.second)
+        {
+            entry.valid = false;
+            entry.ranks.clear();
+            continue;
+        }
+
+        entry.valid = true;
+        entry.numPoints = geom->getTotalPointCount();
+        entry.bounds = geom->getBounds();
+        rankGeometry(geom, topology, entry.ranks);
+    }
+}
+
+const std::vector<float>*
+SimplificationIndex::getRanks(FeatureID fid) const
+{
+    auto i = _entries.find(fid);
+    return i != _entries.end() && i->second.valid ? &i->second.ranks : 0L;
+}
+
+bool
+SimplificationIndex::simplify(Feature* feature, double minArea) const
+{
+    if (!feature || !feature->getGeometry())
+        return false;
+
+    auto i = _entries.find(feature->getFID());
+    if (i == _entries.end() || !i->second.valid)
+        return false;
+
+    const Entry& entry = i->second;
+
+    // make sure this is still the geometry we ranked
+    Geometry* geom = feature->getGeometry();
+    if ((unsigned)geom->getTotalPointCount() != entry.numPoints)
+        return false;
+
+    Bounds bounds = geom->getBounds();
+    if (bounds._min != entry.bounds._min || bounds._max != entry.bounds._max)
+        return false;
+
+    unsigned offset = 0u;
+    GeometryIterator parts(geom, true);
+    while (parts.hasMore())
+    {
+        Geometry* part = parts.next();
+        std::vector<osg::Vec3d>& verts = part->asVector();
+        unsigned n = verts.size();
+        const float* ranks = entry.ranks.data() + offset;
+
+        unsigned kept = 0u;
+        for (unsigned v = 0; v < n; ++v)
+        {
+            if ((double)ranks[v] >= minArea)
+                verts[kept++] = verts[v];
+        }
+        verts.resize(kept);
+
+        offset += n;
+    }
+
+    return true;
+}
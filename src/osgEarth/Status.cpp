@@ -34,7 +34,8 @@ namespace
         "Service unavailable",
         "Configuration error",
         "Assertion failure",
-        "Error"
+        "Error",
+        "No data"
     };
 }
 
@@ -42,7 +43,7 @@ std::string
 Status::toString() const
 {
     return Stringify()
-        << ((int)_code < 6 ? m[(int)_code] : "Bad error code")
+        << ((int)_code < 7 ? m[(int)_code] : "Bad error code")
         << " : "
         << message();
 }
@@ -25,6 +25,8 @@
 #include <osgEarth/FileUtils>
 #include <osgEarth/NetworkMonitor>
 #include <osgEarth/Threading>
+#include <osgEarth/Endian>
+#include <osgEarth/StringUtils>
 #include <osgEarth/GLUtils>
 #include <osgDB/FileNameUtils>
 #include <osgDB/Registry>
@@ -119,6 +121,22 @@ Asset::getJSON() const
 
 //........................................................................
 
+namespace
+{
+    // 3D Tiles boxes are oriented (center + 3 half-axes); we store the
+    // axis-aligned approximation.
+    void setOrientedBox(BoundingVolume& bv, const osg::Vec3d& center, const osg::Vec3d& xvec, const osg::Vec3d& yvec, const osg::Vec3d& zvec)
+    {
+        bv.box() = osg::BoundingBoxd();
+        bv.box()->expandBy(center+xvec);
+        bv.box()->expandBy(center-xvec);
+        bv.box()->expandBy(center+yvec);
+        bv.box()->expandBy(center-yvec);
+        bv.box()->expandBy(center+zvec);
+        bv.box()->expandBy(center-zvec);
+    }
+}
+
 void
 BoundingVolume::fromJSON(const Json::Value& value)
 {
@@ -163,18 +181,12 @@ BoundingVolume::fromJSON(const Json::Value& value)
                 values[index] = (*j).asDouble();
                 index++;
             }
-            Json::Value::const_iterator i = a.begin();
             osg::Vec3d center(values[0], values[1], values[2]);
             osg::Vec3d xvec(values[3], values[4], values[5]);
             osg::Vec3d yvec(values[6], values[7], values[8]);
             osg::Vec3d zvec(values[9], values[10], values[11]);
 
-            box()->expandBy(center+xvec);
-            box()->expandBy(center-xvec);
-            box()->expandBy(center+yvec);
-            box()->expandBy(center-yvec);
-            box()->expandBy(center+zvec);
-            box()->expandBy(center-zvec);
+            setOrientedBox(*this, center, xvec, yvec, zvec);
         }
         else OE_WARN << "Invalid box array" << std::endl;
     }
@@ -249,6 +261,294 @@ BoundingVolume::asBoundingSphere() const
 
 //........................................................................
 
+void
+ImplicitTiling::fromJSON(const Json::Value& value)
+{
+    if (value.isMember("subdivisionScheme"))
+        subdivisionScheme() = value.get("subdivisionScheme", "").asString();
+    if (value.isMember("subtreeLevels"))
+        subtreeLevels() = value.get("subtreeLevels", 0u).asUInt();
+
+    // "maximumLevel" is the 3DTILES_implicit_tiling extension's name
+    // for the level count, which 1.1 renamed to availableLevels.
+    if (value.isMember("availableLevels"))
+        availableLevels() = value.get("availableLevels", 0u).asUInt();
+    else if (value.isMember("maximumLevel"))
+        availableLevels() = value.get("maximumLevel", 0u).asUInt() + 1u;
+
+    if (value.isMember("subtrees"))
+    {
+        const Json::Value& st = value["subtrees"];
+        if (st.isMember("uri"))
+            subtrees() = st.get("uri", "").asString();
+        else if (st.isMember("url"))
+            subtrees() = st.get("url", "").asString();
+    }
+}
+
+Json::Value
+ImplicitTiling::getJSON() const
+{
+    Json::Value value(Json::objectValue);
+    if (subdivisionScheme().isSet())
+        value["subdivisionScheme"] = subdivisionScheme().get();
+    if (subtreeLevels().isSet())
+        value["subtreeLevels"] = subtreeLevels().get();
+    if (availableLevels().isSet())
+        value["availableLevels"] = availableLevels().get();
+    if (subtrees().isSet())
+    {
+        Json::Value st(Json::objectValue);
+        st["uri"] = subtrees().get();
+        value["subtrees"] = st;
+    }
+    return value;
+}
+
+bool
+ImplicitTiling::isOctree() const
+{
+    return osgEarth::ciEquals(subdivisionScheme().get(), "OCTREE");
+}
+
+std::string
+ImplicitTiling::expand(const std::string& templ, unsigned level, unsigned x, unsigned y, unsigned z)
+{
+    std::string result = templ;
+    replaceIn(result, "{level}", Stringify() << level);
+    replaceIn(result, "{x}", Stringify() << x);
+    replaceIn(result, "{y}", Stringify() << y);
+    replaceIn(result, "{z}", Stringify() << z);
+    return result;
+}
+
+//........................................................................
+
+namespace
+{
+    const char* SUBTREE_MAGIC = "subt";
+    const unsigned SUBTREE_HEADER_SIZE = 24u;
+
+    struct BufferView
+    {
+        unsigned _buffer = 0u;
+        std::size_t _offset = 0u;
+        std::size_t _length = 0u;
+    };
+
+    bool readAvailability(
+        const Json::Value& value,
+        const std::vector<std::string>& buffers,
+        const std::vector<BufferView>& views,
+        int& out_constant,
+        std::vector<uint8_t>& out_bits)
+    {
+        if (value.isMember("constant"))
+        {
+            out_constant = value.get("constant", 0).asInt();
+            return true;
+        }
+
+        // "bufferView" is the 3DTILES_implicit_tiling extension name.
+        const char* key =
+            value.isMember("bitstream") ? "bitstream" :
+            value.isMember("bufferView") ? "bufferView" :
+            nullptr;
+
+        if (!key)
+            return false;
+
+        unsigned index = value.get(key, 0u).asUInt();
+        if (index >= views.size())
+            return false;
+
+        const BufferView& view = views[index];
+        if (view._buffer >= buffers.size())
+            return false;
+
+        const std::string& buffer = buffers[view._buffer];
+        if (view._offset + view._length > buffer.size())
+            return false;
+
+        out_constant = -1;
+        out_bits.assign(
+            (const uint8_t*)buffer.data() + view._offset,
+            (const uint8_t*)buffer.data() + view._offset + view._length);
+        return true;
+    }
+}
+
+bool
+Subtree::Availability::get(uint64_t index) const
+{
+    if (_constant >= 0)
+        return _constant != 0;
+
+    uint64_t byte = index >> 3;
+    if (byte >= _bits.size())
+        return false;
+
+    return ((_bits[byte] >> (index & 7)) & 1) != 0;
+}
+
+uint64_t
+Subtree::morton(bool octree, unsigned x, unsigned y, unsigned z)
+{
+    uint64_t result = 0;
+    for (unsigned bit = 0; bit < 21; ++bit)
+    {
+        if (octree)
+        {
+            result |= (uint64_t)((x >> bit) & 1) << (3 * bit);
+            result |= (uint64_t)((y >> bit) & 1) << (3 * bit + 1);
+            result |= (uint64_t)((z >> bit) & 1) << (3 * bit + 2);
+        }
+        else
+        {
+            result |= (uint64_t)((x >> bit) & 1) << (2 * bit);
+            result |= (uint64_t)((y >> bit) & 1) << (2 * bit + 1);
+        }
+    }
+    return result;
+}
+
+uint64_t
+Subtree::levelOffset(unsigned relativeLevel) const
+{
+    // number of tiles in all levels above this one: (N^L - 1) / (N - 1)
+    uint64_t n = _octree ? 8u : 4u;
+    return (((uint64_t)1 << ((_octree ? 3u : 2u) * relativeLevel)) - 1u) / (n - 1u);
+}
+
+bool
+Subtree::isTileAvailable(unsigned relativeLevel, uint64_t morton) const
+{
+    return _tiles.get(levelOffset(relativeLevel) + morton);
+}
+
+bool
+Subtree::isContentAvailable(unsigned relativeLevel, uint64_t morton) const
+{
+    return _content.get(levelOffset(relativeLevel) + morton);
+}
+
+bool
+Subtree::isChildSubtreeAvailable(uint64_t morton) const
+{
+    return _childSubtrees.get(morton);
+}
+
+Subtree*
+Subtree::create(
+    const std::string& data,
+    const ImplicitTiling& tiling,
+    const URIContext& uc,
+    const osgDB::Options* readOptions)
+{
+    std::string json;
+    std::string binary;
+
+    if (data.size() >= SUBTREE_HEADER_SIZE && data.compare(0, 4, SUBTREE_MAGIC) == 0)
+    {
+        uint64_t jsonLength, binaryLength;
+        ::memcpy(&jsonLength, data.data() + 8, 8);
+        ::memcpy(&binaryLength, data.data() + 16, 8);
+        jsonLength = le64toh(jsonLength);
+        binaryLength = le64toh(binaryLength);
+
+        if (SUBTREE_HEADER_SIZE + jsonLength + binaryLength > data.size())
+        {
+            OE_WARN << LC << "Truncated subtree" << std::endl;
+            return nullptr;
+        }
+
+        json = data.substr(SUBTREE_HEADER_SIZE, jsonLength);
+        binary = data.substr(SUBTREE_HEADER_SIZE + jsonLength, binaryLength);
+    }
+    else
+    {
+        json = data;
+    }
+
+    Json::Reader reader;
+    Json::Value root(Json::objectValue);
+    if (!reader.parse(json, root, false))
+    {
+        OE_WARN << LC << "Invalid subtree JSON" << std::endl;
+        return nullptr;
+    }
+
+    // resolve buffers; a buffer without a uri is the internal binary chunk.
+    std::vector<std::string> buffers;
+    const Json::Value& jbuffers = root["buffers"];
+    for (Json::Value::const_iterator i = jbuffers.begin(); i != jbuffers.end(); ++i)
+    {
+        if ((*i).isMember("uri"))
+        {
+            URI uri((*i).get("uri", "").asString(), uc);
+            ReadResult rr = uri.readString(readOptions);
+            if (rr.failed())
+            {
+                OE_WARN << LC << "Failed to read subtree buffer " << uri.full() << ": " << rr.errorDetail() << std::endl;
+                return nullptr;
+            }
+            buffers.push_back(rr.getString());
+        }
+        else
+        {
+            buffers.push_back(binary);
+        }
+    }
+
+    std::vector<BufferView> views;
+    const Json::Value& jviews = root["bufferViews"];
+    for (Json::Value::const_iterator i = jviews.begin(); i != jviews.end(); ++i)
+    {
+        BufferView view;
+        view._buffer = (*i).get("buffer", 0u).asUInt();
+        view._offset = (std::size_t)(*i).get("byteOffset", 0u).asDouble();
+        view._length = (std::size_t)(*i).get("byteLength", 0u).asDouble();
+        views.push_back(view);
+    }
+
+    osg::ref_ptr<Subtree> subtree = new Subtree();
+    subtree->_octree = tiling.isOctree();
+
+    if (!readAvailability(root["tileAvailability"], buffers, views, subtree->_tiles._constant, subtree->_tiles._bits))
+    {
+        OE_WARN << LC << "Subtree has no valid tileAvailability" << std::endl;
+        return nullptr;
+    }
+
+    // 1.1 allows multiple contents per tile; we only use the first.
+    const Json::Value& content = root["contentAvailability"];
+    if (content.isArray() && content.size() > 0)
+        readAvailability(content[0u], buffers, views, subtree->_content._constant, subtree->_content._bits);
+    else if (content.isObject())
+        readAvailability(content, buffers, views, subtree->_content._constant, subtree->_content._bits);
+
+    readAvailability(root["childSubtreeAvailability"], buffers, views, subtree->_childSubtrees._constant, subtree->_childSubtrees._bits);
+
+    return subtree.release();
+}
+
+//........................................................................
+
+struct osgEarth::Contrib::ThreeDTiles::ImplicitContext
+{
+    ImplicitTiling _tiling;
+    URIContext _uc;
+    std::string _contentTemplate;
+    double _rootError = 0.0;
+
+    // root bounding volume, either a region or an oriented box
+    bool _isBox = false;
+    osg::BoundingBoxd _region;
+    osg::Vec3d _center, _xAxis, _yAxis, _zAxis;
+};
+
+//........................................................................
+
 void
 TileContent::fromJSON(const Json::Value& value, LoadContext& lc)
 {
@@ -303,15 +603,63 @@ Tile::fromJSON(const Json::Value& value, LoadContext& uc)
         }
     }
 
+    if (value.isMember("implicitTiling"))
+    {
+        implicitTiling() = ImplicitTiling(value["implicitTiling"]);
+
+        // This tile becomes a container whose only child is the implicit
+        // root at (0,0,0,0); the content URI is a template for every level.
+        _implicit = std::make_shared<ImplicitContext>();
+        _implicit->_tiling = implicitTiling().get();
+        _implicit->_uc = uc._uc;
+        _implicit->_rootError = geometricError().get();
+
+        const Json::Value& jcontent = value["content"];
+        _implicit->_contentTemplate = jcontent.get("uri", jcontent.get("url", "")).asString();
+        content().unset();
+
+        const Json::Value& bv = value["boundingVolume"];
+        if (bv.isMember("box") && bv["box"].size() == 12)
+        {
+            const Json::Value& a = bv["box"];
+            _implicit->_isBox = true;
+            _implicit->_center.set(a[0u].asDouble(), a[1u].asDouble(), a[2u].asDouble());
+            _implicit->_xAxis.set(a[3u].asDouble(), a[4u].asDouble(), a[5u].asDouble());
+            _implicit->_yAxis.set(a[6u].asDouble(), a[7u].asDouble(), a[8u].asDouble());
+            _implicit->_zAxis.set(a[9u].asDouble(), a[10u].asDouble(), a[11u].asDouble());
+        }
+        else if (boundingVolume()->region().isSet())
+        {
+            _implicit->_region = boundingVolume()->region().get();
+        }
+        else
+        {
+            OE_WARN << LC << "Implicit tiling requires a region or box bounding volume" << std::endl;
+            _implicit = nullptr;
+        }
+
+        _implicitRoot = _implicit != nullptr;
+    }
+
     if (value.isMember("children"))
     {
         const Json::Value& a = value["children"];
-        if (a.isArray())
+        if (a.isArray() && a.size() > 0)
         {
-            for (Json::Value::const_iterator i = a.begin(); i != a.end(); ++i)
+            if (uc._document)
             {
-                osg::ref_ptr<Tile> tile = new Tile(*i, uc);
-                children().push_back(tile.get());
+                // Defer parsing until a viewer actually needs the children.
+                _document = uc._document;
+                _pendingChildren = &a;
+                _uc = uc._uc;
+            }
+            else
+            {
+                for (Json::Value::const_iterator i = a.begin(); i != a.end(); ++i)
+                {
+                    osg::ref_ptr<Tile> tile = new Tile(*i, uc);
+                    children().push_back(tile.get());
+                }
             }
         }
     }
@@ -332,9 +680,22 @@ Tile::getJSON() const
         value["refine"] = (refine().get() == REFINE_ADD) ? "ADD" : "REPLACE";
     if (content().isSet())
         value["content"] = content()->getJSON();
+    if (implicitTiling().isSet())
+    {
+        value["implicitTiling"] = implicitTiling()->getJSON();
+        if (_implicit)
+        {
+            Json::Value jcontent(Json::objectValue);
+            jcontent["uri"] = _implicit->_contentTemplate;
+            value["content"] = jcontent;
+        }
+    }
 
-
-    if (!children().empty())
+    if (_pendingChildren)
+    {
+        value["children"] = *_pendingChildren;
+    }
+    else if (!children().empty())
     {
         Json::Value collection(Json::arrayValue);
         for(unsigned i=0; i<children().size(); ++i)
@@ -396,6 +757,197 @@ Tile::getBoundingSphere()
     return bsphere;
 }
 
+bool
+Tile::hasUnresolvedChildren() const
+{
+    if (_pendingChildren)
+        return true;
+
+    if (_implicit && !_implicitResolved)
+    {
+        if (_implicitRoot)
+            return true;
+
+        const ImplicitTiling& tiling = _implicit->_tiling;
+        return
+            !tiling.availableLevels().isSet() ||
+            _level + 1 < tiling.availableLevels().get();
+    }
+
+    return false;
+}
+
+bool
+Tile::childrenRequireIO() const
+{
+    if (!_implicit || _implicitResolved)
+        return false;
+
+    if (_implicitRoot)
+        return true;
+
+    // children on the last level of a subtree live in child subtrees.
+    unsigned subtreeLevels = osg::maximum(_implicit->_tiling.subtreeLevels().get(), 1u);
+    return (_level % subtreeLevels) == subtreeLevels - 1;
+}
+
+void
+Tile::resolveChildren(const osgDB::Options* readOptions)
+{
+    if (_pendingChildren)
+    {
+        LoadContext lc;
+        lc._uc = _uc;
+        lc._document = _document;
+
+        for (Json::Value::const_iterator i = _pendingChildren->begin(); i != _pendingChildren->end(); ++i)
+        {
+            osg::ref_ptr<Tile> tile = new Tile(*i, lc);
+            children().push_back(tile.get());
+        }
+
+        _pendingChildren = nullptr;
+        _document = nullptr;
+        _uc = URIContext();
+    }
+
+    if (_implicit && !_implicitResolved)
+    {
+        std::vector<osg::ref_ptr<Tile>> resolved;
+        resolveImplicitChildren(readOptions, resolved);
+        children().insert(children().end(), resolved.begin(), resolved.end());
+
+        // publish last; the cull thread polls hasUnresolvedChildren()
+        // while this runs on a job.
+        _implicitResolved = true;
+    }
+}
+
+void
+Tile::resolveImplicitChildren(const osgDB::Options* readOptions, std::vector<osg::ref_ptr<Tile>>& output) const
+{
+    if (_implicitRoot)
+    {
+        osg::ref_ptr<Subtree> subtree = loadSubtree(0, 0, 0, 0, readOptions);
+        if (subtree.valid() && subtree->isTileAvailable(0, 0))
+        {
+            output.push_back(createImplicitChild(0, 0, 0, 0, subtree.get()));
+        }
+        return;
+    }
+
+    if (_implicit->_tiling.availableLevels().isSet() &&
+        _level + 1 >= _implicit->_tiling.availableLevels().get())
+    {
+        return;
+    }
+
+    bool octree = _implicit->_tiling.isOctree();
+    unsigned subtreeLevels = osg::maximum(_implicit->_tiling.subtreeLevels().get(), 1u);
+    unsigned numChildren = octree ? 8u : 4u;
+
+    unsigned childLevel = _level + 1;
+    unsigned subtreeRootLevel = (_level / subtreeLevels) * subtreeLevels;
+    unsigned childRelativeLevel = childLevel - subtreeRootLevel;
+
+    for (unsigned i = 0; i < numChildren; ++i)
+    {
+        unsigned cx = 2 * _x + (i & 1);
+        unsigned cy = 2 * _y + ((i >> 1) & 1);
+        unsigned cz = octree ? 2 * _z + ((i >> 2) & 1) : 0u;
+
+        // child coordinates relative to the current subtree's root:
+        unsigned rx = cx - ((cx >> childRelativeLevel) << childRelativeLevel);
+        unsigned ry = cy - ((cy >> childRelativeLevel) << childRelativeLevel);
+        unsigned rz = cz - ((cz >> childRelativeLevel) << childRelativeLevel);
+        uint64_t morton = Subtree::morton(octree, rx, ry, rz);
+
+        if (childRelativeLevel < subtreeLevels)
+        {
+            if (_subtree->isTileAvailable(childRelativeLevel, morton))
+            {
+                output.push_back(createImplicitChild(childLevel, cx, cy, cz, _subtree.get()));
+            }
+        }
+        else if (_subtree->isChildSubtreeAvailable(morton))
+        {
+            osg::ref_ptr<Subtree> subtree = loadSubtree(childLevel, cx, cy, cz, readOptions);
+            if (subtree.valid() && subtree->isTileAvailable(0, 0))
+            {
+                output.push_back(createImplicitChild(childLevel, cx, cy, cz, subtree.get()));
+            }
+        }
+    }
+}
+
+Subtree*
+Tile::loadSubtree(unsigned level, unsigned x, unsigned y, unsigned z, const osgDB::Options* readOptions) const
+{
+    URI uri(ImplicitTiling::expand(_implicit->_tiling.subtrees().get(), level, x, y, z), _implicit->_uc);
+
+    ReadResult rr = uri.readString(readOptions);
+    if (rr.failed())
+    {
+        OE_WARN << LC << "Failed to read subtree \"" << uri.full() << "\": " << rr.errorDetail() << std::endl;
+        return nullptr;
+    }
+
+    return Subtree::create(rr.getString(), _implicit->_tiling, URIContext(uri.full()), readOptions);
+}
+
+Tile*
+Tile::createImplicitChild(unsigned level, unsigned x, unsigned y, unsigned z, Subtree* subtree) const
+{
+    const ImplicitContext& ic = *_implicit;
+    bool octree = ic._tiling.isOctree();
+    double n = (double)(1u << level);
+
+    Tile* tile = new Tile();
+    tile->_implicit = _implicit;
+    tile->_subtree = subtree;
+    tile->_level = level, tile->_x = x, tile->_y = y, tile->_z = z;
+    tile->geometricError() = ic._rootError / n;
+
+    if (ic._isBox)
+    {
+        double fx = (2.0*x + 1.0) / n - 1.0;
+        double fy = (2.0*y + 1.0) / n - 1.0;
+        double fz = octree ? (2.0*z + 1.0) / n - 1.0 : 0.0;
+        osg::Vec3d center = ic._center + ic._xAxis*fx + ic._yAxis*fy + ic._zAxis*fz;
+        setOrientedBox(
+            tile->boundingVolume().mutable_value(),
+            center,
+            ic._xAxis / n,
+            ic._yAxis / n,
+            octree ? ic._zAxis / n : ic._zAxis);
+    }
+    else
+    {
+        const osg::BoundingBoxd& r = ic._region;
+        double dx = (r.xMax() - r.xMin()) / n;
+        double dy = (r.yMax() - r.yMin()) / n;
+        double dz = octree ? (r.zMax() - r.zMin()) / n : (r.zMax() - r.zMin());
+        double zmin = octree ? r.zMin() + dz*z : r.zMin();
+        tile->boundingVolume()->region() = osg::BoundingBoxd(
+            r.xMin() + dx*x, r.yMin() + dy*y, zmin,
+            r.xMin() + dx*(x+1), r.yMin() + dy*(y+1), zmin + dz);
+    }
+
+    unsigned subtreeLevels = osg::maximum(ic._tiling.subtreeLevels().get(), 1u);
+    unsigned relativeLevel = level % subtreeLevels;
+    unsigned rx = x - ((x >> relativeLevel) << relativeLevel);
+    unsigned ry = y - ((y >> relativeLevel) << relativeLevel);
+    unsigned rz = z - ((z >> relativeLevel) << relativeLevel);
+
+    if (!ic._contentTemplate.empty() &&
+        subtree->isContentAvailable(relativeLevel, Subtree::morton(octree, rx, ry, rz)))
+    {
+        tile->content()->uri() = URI(ImplicitTiling::expand(ic._contentTemplate, level, x, y, z), ic._uc);
+    }
+
+    return tile;
+}
+
 //........................................................................
 
 void
@@ -436,8 +988,10 @@ Tileset::create(const std::string& json, const URIContext& uc)
 
     LoadContext lc;
     lc._uc = uc;
+    lc._document = std::make_shared<Json::Value>();
+    lc._document->swap(root);
 
-    return new Tileset(root, lc);
+    return new Tileset(*lc._document, lc);
 }
 
 static VirtualProgram* getOrCreateDebugVirtualProgram()
@@ -475,6 +1029,14 @@ randomColor()
 
 namespace
 {
+    // ResidencyManager subsystem shared by all tileset nodes
+    unsigned residencySubsystem()
+    {
+        static unsigned s_subsystem =
+            Registry::residencyManager()->addSubsystem("3D Tiles");
+        return s_subsystem;
+    }
+
     struct LoadTilesetOperation
     {
         LoadTilesetOperation(ThreeDTilesetNode* parentTileset, const URI& uri, osgDB::Options* options) :
@@ -600,6 +1162,7 @@ ThreeDTileNode::ThreeDTileNode(ThreeDTilesetNode* tileset, Tile* tile, bool imme
     _firstVisit(true),
     _options(options),
     _trackerItrValid(false),
+    _residencyHandle(0u),
     _lastCulledFrameNumber(0),
     _lastCulledFrameTime(0.0f)
 {
@@ -657,6 +1220,57 @@ ThreeDTileNode::ThreeDTileNode(ThreeDTilesetNode* tileset, Tile* tile, bool imme
         OE_PROFILING_ZONE_TEXT("Immediate load");
     }
 
+    // Child nodes are created on demand in requestChildren().
+
+    _debugColor = randomColor();
+
+    getOrCreateStateSet()->getOrCreateUniform("debugColor", osg::Uniform::FLOAT_VEC4)->set(_debugColor);
+
+    computeBoundingVolume();
+
+    createDebugBounds();
+}
+
+bool ThreeDTileNode::requestChildren(bool immediate)
+{
+    if (_childrenCreated)
+        return true;
+
+    // A pending request owns the tile's children until its job finishes,
+    // so check it before asking the tile anything.
+    if (_requestedChildren)
+    {
+        if (immediate)
+            _childrenFuture.join();
+        else if (!_childrenFuture.isAvailable())
+            return false;
+    }
+    else if (_tile->hasUnresolvedChildren())
+    {
+        if (immediate || !_tile->childrenRequireIO())
+        {
+            _tile->resolveChildren(_options.get());
+        }
+        else
+        {
+            // Subtree reads happen off the cull thread.
+            osg::ref_ptr<Tile> tile = _tile;
+            osg::ref_ptr<osgDB::Options> options = _options;
+
+            NetworkMonitor::ScopedRequestLayer layerRequest(_tileset->getOwnerName());
+
+            _childrenFuture = Job(JobArena::get("oe.3dtiles")).dispatch<bool>(
+                [tile, options](Cancelable*)
+                {
+                    tile->resolveChildren(options.get());
+                    return true;
+                }
+            );
+            _requestedChildren = true;
+            return false;
+        }
+    }
+
     if (_tile->children().size() > 0)
     {
         _children = new osg::Group;
@@ -666,21 +1280,12 @@ ThreeDTileNode::ThreeDTileNode(ThreeDTilesetNode* tileset, Tile* tile, bool imme
             child->setParentTile(this);
             _children->addChild(child);
         }
-
-        if (_children->getNumChildren() == 0)
-        {
-            _children = 0;
-        }
         addChild(_children.get());
     }
 
-    _debugColor = randomColor();
-
-    getOrCreateStateSet()->getOrCreateUniform("debugColor", osg::Uniform::FLOAT_VEC4)->set(_debugColor);
-
-    computeBoundingVolume();
-
-    createDebugBounds();
+    _childrenCreated = true;
+    _childrenFuture.abandon();
+    return true;
 }
 
 void ThreeDTileNode::setParentTile(ThreeDTileNode* parentTile)
@@ -899,10 +1504,31 @@ void ThreeDTileNode::resolveContent()
             _tileset->runPostMergeOperations(_content.get());
 
             addChild(_content.get());
+
+            MemoryUsageVisitor mem;
+            _content->accept(mem);
+            _contentBytes = mem.getTotalBytes();
+            _tileset->adjustResidentBytes(_contentBytes);
+
+            // immediately loaded tiles are owned by their parent and never expire
+            if (!_immediateLoad && Registry::residencyManager()->isEnabled())
+            {
+                _residencyHandle = Registry::residencyManager()->add(
+                    residencySubsystem(),
+                    this,
+                    mem.getCPUBytes(),
+                    mem.getGPUBytes());
+            }
         }
     }
 }
 
+ThreeDTileNode::~ThreeDTileNode()
+{
+    if (_residencyHandle != 0u)
+        Registry::residencyManager()->remove(_residencyHandle);
+}
+
 
 void ThreeDTileNode::requestContent(ICO* ico)
 {
@@ -984,6 +1610,15 @@ bool ThreeDTileNode::unloadContent()
 
         _content->releaseGLObjects();
         _content = nullptr;
+
+        _tileset->adjustResidentBytes(-(std::ptrdiff_t)_contentBytes);
+        _contentBytes = 0u;
+    }
+
+    if (_residencyHandle != 0u)
+    {
+        Registry::residencyManager()->remove(_residencyHandle);
+        _residencyHandle = 0u;
     }
 
     _firstVisit = true;
@@ -1045,6 +1680,11 @@ void ThreeDTileNode::updateTracking(osgUtil::CullVisitor* cv)
         _tileset->touchTile(this);
         _lastCulledFrameNumber = cv->getFrameStamp()->getFrameNumber();
         _lastCulledFrameTime = cv->getFrameStamp()->getReferenceTime();
+
+        if (_residencyHandle != 0u)
+        {
+            Registry::residencyManager()->touch(_residencyHandle, _lastCulledFrameNumber);
+        }
     }
 }
 
@@ -1085,8 +1725,13 @@ void ThreeDTileNode::traverse(osg::NodeVisitor& nv)
 
         updateTracking(cv);
 
+        // Only materialize children once this tile wants to refine.
         bool areChildrenReady = true;
-        if (_children.valid())
+        if (error > _tileset->getMaximumScreenSpaceError() && !requestChildren(false))
+        {
+            areChildrenReady = false;
+        }
+        else if (_children.valid())
         {
             for (unsigned int i = 0; i < _children->getNumChildren(); i++)
             {
@@ -1204,7 +1849,9 @@ ThreeDTilesetNode::ThreeDTilesetNode(Tileset* tileset, const std::string& author
     _tileset(tileset),
     _options(options),
     _maximumScreenSpaceError(15.0f),
-    _maxTiles(50),
+    _maxTiles(0),
+    _maxResidentBytes(256u * 1024u * 1024u),
+    _residentBytes(0),
     _showBoundingVolumes(false),
     _showColorPerTile(false),
     _maxAge(5.0f),
@@ -1220,6 +1867,12 @@ ThreeDTilesetNode::ThreeDTilesetNode(Tileset* tileset, const std::string& author
         setMaxTiles((unsigned)atoi(c));
     }
 
+    c = ::getenv("OSGEARTH_3DTILES_MAX_MEMORY_MB");
+    if (c)
+    {
+        setMaxResidentBytes((std::size_t)atoi(c) * 1024u * 1024u);
+    }
+
     c = ::getenv("OSGEARTH_3DTILES_MAX_AGE");
     if (c)
     {
@@ -1276,6 +1929,26 @@ void ThreeDTilesetNode::setMaxTiles(unsigned int maxTiles)
     _maxTiles = maxTiles;
 }
 
+std::size_t ThreeDTilesetNode::getMaxResidentBytes() const
+{
+    return _maxResidentBytes;
+}
+
+void ThreeDTilesetNode::setMaxResidentBytes(std::size_t value)
+{
+    _maxResidentBytes = value;
+}
+
+std::size_t ThreeDTilesetNode::getResidentBytes() const
+{
+    return (std::size_t)osg::maximum(_residentBytes.load(), (std::ptrdiff_t)0);
+}
+
+void ThreeDTilesetNode::adjustResidentBytes(std::ptrdiff_t delta)
+{
+    _residentBytes += delta;
+}
+
 float ThreeDTilesetNode::getMaxAge() const
 {
     return _maxAge;
@@ -1383,6 +2056,20 @@ void ThreeDTilesetNode::expireTiles(const osg::NodeVisitor& nv)
     osg::Timer_t startTime = osg::Timer::instance()->tick();
     osg::Timer_t endTime;
 
+    // First unload any tiles the global memory budget wants evicted.
+    // These may belong to a different tileset node.
+    if (Registry::residencyManager()->isEnabled())
+    {
+        std::vector<osg::ref_ptr<osg::Referenced>> evictions;
+        Registry::residencyManager()->collect(residencySubsystem(), frameNumber, 64u, evictions);
+        for (auto& ref : evictions)
+        {
+            ThreeDTileNode* tile = dynamic_cast<ThreeDTileNode*>(ref.get());
+            if (tile)
+                tile->_tileset->evictTile(tile, frameNumber);
+        }
+    }
+
     ScopedMutexLock lock(_mutex);
 
     // Max time in ms to allocate to erasing tiles
@@ -1392,7 +2079,14 @@ void ThreeDTilesetNode::expireTiles(const osg::NodeVisitor& nv)
 
     unsigned int numErased = 0;
     unsigned int numSkipped = 0;
-    while (_tracker.size() > _maxTiles && itr != _sentryItr)
+    auto overBudget = [&]()
+    {
+        return
+            getResidentBytes() > _maxResidentBytes ||
+            (_maxTiles > 0u && _tracker.size() > _maxTiles);
+    };
+
+    while (overBudget() && itr != _sentryItr)
     {
         osg::ref_ptr< ThreeDTileNode > tile = dynamic_cast<ThreeDTileNode*>(itr->get());
         if (tile.valid())
@@ -1434,6 +2128,24 @@ void ThreeDTilesetNode::expireTiles(const osg::NodeVisitor& nv)
     _sentryItr = --_tracker.end();
 }
 
+void ThreeDTilesetNode::evictTile(ThreeDTileNode* tile, unsigned frameNumber)
+{
+    ScopedMutexLock lock(_mutex);
+
+    if (tile->getAutoUnload() && tile->unloadContent())
+    {
+        if (tile->_trackerItrValid)
+        {
+            _tracker.erase(tile->_trackerItr);
+            tile->_trackerItrValid = false;
+        }
+    }
+    else
+    {
+        Registry::residencyManager()->touch(tile->_residencyHandle, frameNumber);
+    }
+}
+
 void ThreeDTilesetNode::traverse(osg::NodeVisitor& nv)
 {
     if (nv.getVisitorType() == nv.UPDATE_VISITOR)
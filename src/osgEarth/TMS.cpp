@@ -1196,6 +1196,8 @@ TMSImageLayer::createImageImplementation(const TileKey& key, ProgressCallback* p
 
     if (r.succeeded())
         return GeoImage(r.releaseImage(), key.getExtent());
+    else if (r.code() == ReadResult::RESULT_NOT_FOUND)
+        return GeoImage(Status(Status::NoData, r.errorDetail()));
     else
         return GeoImage(Status(r.errorDetail()));
 }
@@ -18,12 +18,210 @@
  */
 
 #include <osgEarth/Terrain>
+#include <osgEarth/ElevationPool>
 #include <osgViewer/View>
+#include <osg/Math>
+#include <unordered_set>
+#include <cmath>
 
 #define LC "[Terrain] "
 
 using namespace osgEarth;
 
+namespace
+{
+    // Deepest LOD of the callback index. Footprints smaller than a tile
+    // at this LOD all land in cells at this LOD.
+    const unsigned INDEX_LOD = 16u;
+
+    // Spreads the low 32 bits of v out to the even bits
+    inline std::uint64_t spread(std::uint64_t v)
+    {
+        v &= 0xffffffffull;
+        v = (v | (v << 16)) & 0x0000ffff0000ffffull;
+        v = (v | (v << 8))  & 0x00ff00ff00ff00ffull;
+        v = (v | (v << 4))  & 0x0f0f0f0f0f0f0f0full;
+        v = (v | (v << 2))  & 0x3333333333333333ull;
+        v = (v | (v << 1))  & 0x5555555555555555ull;
+        return v;
+    }
+
+    // Morton code of a tile's first descendant at INDEX_LOD
+    inline std::uint64_t morton(unsigned lod, unsigned x, unsigned y)
+    {
+        unsigned shift = INDEX_LOD - lod;
+        return spread((std::uint64_t)x << shift) | (spread((std::uint64_t)y << shift) << 1);
+    }
+
+    // Index cell of a tile at or above INDEX_LOD. Ordering cells by their
+    // Morton code keeps every tile's descendants together.
+    inline std::uint64_t cell(unsigned lod, unsigned x, unsigned y)
+    {
+        return (morton(lod, x, y) << 5) | lod;
+    }
+
+    inline unsigned cellLOD(std::uint64_t cell)
+    {
+        return (unsigned)(cell & 0x1f);
+    }
+}
+
+//---------------------------------------------------------------------------
+
+TerrainCallbackIndex::TerrainCallbackIndex(const Profile* profile) :
+    _profile(profile)
+{
+    for (auto& count : _perLOD)
+        count = 0u;
+}
+
+bool
+TerrainCallbackIndex::insert(TerrainCallback* callback, const GeoExtent& footprint)
+{
+    if (!callback || !footprint.isValid() || !_profile.valid())
+        return false;
+
+    GeoExtent extent = footprint;
+    if (!extent.getSRS()->isHorizEquivalentTo(_profile->getSRS()))
+    {
+        extent = extent.transform(_profile->getSRS());
+    }
+
+    std::uint64_t key;
+    if (!extent.isValid() || extent.crossesAntimeridian() || !getCell(extent, key))
+        return false;
+
+    auto i = _entries.find(callback);
+    if (i == _entries.end())
+    {
+        i = _entries.emplace(callback, IndexedCallback()).first;
+        i->second._callback = callback;
+        i->second._cell = _cells.emplace(key, &i->second);
+        ++_perLOD[cellLOD(key)];
+    }
+    else if (i->second._cell->first != key)
+    {
+        // moved to another cell
+        --_perLOD[cellLOD(i->second._cell->first)];
+        _cells.erase(i->second._cell);
+        i->second._cell = _cells.emplace(key, &i->second);
+        ++_perLOD[cellLOD(key)];
+    }
+
+    i->second._xmin = extent.xMin();
+    i->second._ymin = extent.yMin();
+    i->second._xmax = extent.xMax();
+    i->second._ymax = extent.yMax();
+    return true;
+}
+
+bool
+TerrainCallbackIndex::remove(const TerrainCallback* callback)
+{
+    auto i = _entries.find(callback);
+    if (i == _entries.end())
+        return false;
+
+    --_perLOD[cellLOD(i->second._cell->first)];
+    _cells.erase(i->second._cell);
+    _entries.erase(i);
+    return true;
+}
+
+bool
+TerrainCallbackIndex::contains(const TerrainCallback* callback) const
+{
+    return _entries.find(callback) != _entries.end();
+}
+
+bool
+TerrainCallbackIndex::getCell(const GeoExtent& extent, std::uint64_t& out_cell) const
+{
+    const GeoExtent& pe = _profile->getExtent();
+    unsigned tw, th;
+    _profile->getNumTiles(INDEX_LOD, tw, th);
+
+    // keep the Morton code (2 bits per level) and the LOD within 64 bits
+    if (tw > (1u << 29) || th > (1u << 29))
+        return false;
+
+    double dx = pe.width() / (double)tw;
+    double dy = pe.height() / (double)th;
+
+    // tiles holding the northwest and southeast corners at INDEX_LOD
+    unsigned x0 = (unsigned)osg::clampBetween(floor((extent.xMin() - pe.xMin()) / dx), 0.0, (double)(tw - 1));
+    unsigned y0 = (unsigned)osg::clampBetween(floor((pe.yMax() - extent.yMax()) / dy), 0.0, (double)(th - 1));
+    unsigned x1 = (unsigned)osg::clampBetween(floor((extent.xMax() - pe.xMin()) / dx), 0.0, (double)(tw - 1));
+    unsigned y1 = (unsigned)osg::clampBetween(floor((pe.yMax() - extent.yMin()) / dy), 0.0, (double)(th - 1));
+
+    // climb until one tile holds both
+    unsigned lod = INDEX_LOD;
+    while (x0 != x1 || y0 != y1)
+    {
+        if (lod == 0u)
+            return false;
+        x0 >>= 1, y0 >>= 1, x1 >>= 1, y1 >>= 1;
+        --lod;
+    }
+
+    out_cell = cell(lod, x0, y0);
+    return true;
+}
+
+void
+TerrainCallbackIndex::query(const TileKey& key, std::vector<const Entry*>& output) const
+{
+    if (_entries.empty())
+        return;
+
+    // no key means everything may have changed
+    if (!key.valid())
+    {
+        for (auto& i : _cells)
+            output.push_back(i.second);
+        return;
+    }
+
+    unsigned lod = key.getLOD();
+    unsigned x = key.getTileX(), y = key.getTileY();
+
+    // Cells above the tile (or the one holding it, if the tile is
+    // deeper than the index) hold footprints that may miss it:
+    const GeoExtent extent = key.getExtent();
+    unsigned top = std::min(lod, INDEX_LOD + 1u);
+    for (unsigned l = 0; l < top; ++l)
+    {
+        if (_perLOD[l] == 0u)
+            continue;
+
+        auto range = _cells.equal_range(cell(l, x >> (lod - l), y >> (lod - l)));
+        for (auto i = range.first; i != range.second; ++i)
+        {
+            const Entry* entry = i->second;
+            if (entry->_xmin <= extent.xMax() && entry->_xmax >= extent.xMin() &&
+                entry->_ymin <= extent.yMax() && entry->_ymax >= extent.yMin())
+            {
+                output.push_back(entry);
+            }
+        }
+    }
+
+    // ...while the tile's own cell and everything below it lie inside it,
+    // and sit together in Morton order:
+    if (lod <= INDEX_LOD)
+    {
+        std::uint64_t first = morton(lod, x, y);
+        std::uint64_t count = 1ull << (2u * (INDEX_LOD - lod));
+        auto end = _cells.lower_bound((first + count) << 5);
+        for (auto i = _cells.lower_bound(first << 5); i != end; ++i)
+        {
+            // skip ancestors that happen to start at the same place
+            if (cellLOD(i->first) >= lod)
+                output.push_back(i->second);
+        }
+    }
+}
+
 //---------------------------------------------------------------------------
 
 Terrain::onTileUpdateOperation::onTileUpdateOperation(const TileKey& key, osg::Node* node, Terrain* terrain)
@@ -65,7 +263,9 @@ Terrain::Terrain(osg::Node* graph, const Profile* mapProfile) :
 _graph         ( graph ),
 _profile       ( mapProfile ),
 _callbacksMutex(OE_MUTEX_NAME),
-_callbacksSize (0)
+_callbackIndex (mapProfile),
+_callbacksSize (0),
+_batchClamping (false)
 {
     _updateQueue = new osg::OperationQueue();
 }
@@ -245,11 +445,74 @@ Terrain::addTerrainCallback( TerrainCallback* cb )
     }
 }
 
+void
+Terrain::addTerrainCallback(TerrainCallback* cb, const GeoExtent& footprint)
+{
+    if (!cb)
+        return;
+
+    {
+        Threading::ScopedWriteLock exclusiveLock(_callbacksMutex);
+
+        bool moving = _callbackIndex.contains(cb);
+        if (_callbackIndex.insert(cb, footprint))
+        {
+            if (!moving)
+            {
+                // first time: make sure it's not in the unindexed list
+                for (CallbackList::iterator c = _callbacks.begin(); c != _callbacks.end(); ++c)
+                {
+                    if (c->get() == cb)
+                    {
+                        _callbacks.erase(c);
+                        --_callbacksSize;
+                        break;
+                    }
+                }
+                ++_callbacksSize;
+            }
+            return;
+        }
+    }
+
+    // no cell holds it, so it hears about everything
+    addTerrainCallback(cb);
+}
+
+void
+Terrain::collectRecipients(const TileKey& key, std::vector<Recipient>& out) const
+{
+    for (auto& cb : _callbacks)
+    {
+        out.push_back(Recipient{ cb, 0.0, 0.0, false });
+    }
+
+    if (_callbackIndex.empty())
+        return;
+
+    std::vector<const TerrainCallbackIndex::Entry*> entries;
+    _callbackIndex.query(key, entries);
+
+    for (auto entry : entries)
+    {
+        out.push_back(Recipient{
+            entry->_callback,
+            0.5*(entry->_xmin + entry->_xmax),
+            0.5*(entry->_ymin + entry->_ymax),
+            true });
+    }
+}
+
 void
 Terrain::removeTerrainCallback( TerrainCallback* cb )
 {
     Threading::ScopedWriteLock exclusiveLock( _callbacksMutex );
 
+    if (_callbackIndex.remove(cb))
+    {
+        --_callbacksSize;
+    }
+
     for( CallbackList::iterator i = _callbacks.begin(); i != _callbacks.end(); )
     {        
         if ( i->get() == cb )
@@ -282,20 +545,116 @@ Terrain::notifyTileUpdate( const TileKey& key, osg::Node* node )
 }
 
 void
-Terrain::fireTileUpdate( const TileKey& key, osg::Node* node )
+Terrain::removeTerrainCallbacks(const std::vector<osg::ref_ptr<TerrainCallback>>& callbacks)
 {
-    Threading::ScopedReadLock sharedLock( _callbacksMutex );
+    Threading::ScopedWriteLock exclusiveLock(_callbacksMutex);
 
-    for( CallbackList::iterator i = _callbacks.begin(); i != _callbacks.end(); )
-    {       
-        TerrainCallbackContext context( this );
-        i->get()->onTileUpdate( key, node, context );
+    std::unordered_set<const TerrainCallback*> unindexed;
 
-        // if the callback set the "remove" flag, discard the callback.
-        if ( context.markedForRemoval() )
-            i = _callbacks.erase( i );
+    for (auto& cb : callbacks)
+    {
+        if (_callbackIndex.remove(cb.get()))
+        {
+            --_callbacksSize;
+        }
         else
-            ++i;
+        {
+            unindexed.insert(cb.get());
+        }
+    }
+
+    if (!unindexed.empty())
+    {
+        for (CallbackList::iterator i = _callbacks.begin(); i != _callbacks.end(); )
+        {
+            if (unindexed.count(i->get()) > 0)
+            {
+                i = _callbacks.erase(i);
+                --_callbacksSize;
+            }
+            else
+            {
+                ++i;
+            }
+        }
+    }
+}
+
+void
+Terrain::fireTileUpdate( const TileKey& key, osg::Node* node )
+{
+    // Gather the callbacks that care about this tile. Call them without
+    // the lock held, so they are free to add or remove callbacks.
+    std::vector<Recipient> recipients;
+    {
+        Threading::ScopedReadLock sharedLock( _callbacksMutex );
+        collectRecipients(key, recipients);
+    }
+
+    std::vector<osg::ref_ptr<TerrainCallback>> removals;
+
+    // Re-clamp everything pinned to a point in one elevation query:
+    osg::ref_ptr<ElevationPool> pool;
+    if (_batchClamping && key.valid() && _elevationPool.lock(pool))
+    {
+        std::vector<osg::Vec4d> points;
+        std::vector<Recipient*> clamped;
+
+        // sample at the resolution of the updated tile
+        double resolution = key.getResolution(ELEVATION_TILE_SIZE).first;
+
+        for (auto& r : recipients)
+        {
+            if (r._indexed && dynamic_cast<TerrainClampCallback*>(r._callback.get()))
+            {
+                points.emplace_back(r._x, r._y, 0.0, resolution);
+                clamped.push_back(&r);
+            }
+        }
+
+        if (!points.empty())
+        {
+            pool->sampleMapCoords(points, nullptr, nullptr);
+
+            for (unsigned i = 0; i < points.size(); ++i)
+            {
+                Recipient& r = *clamped[i];
+                TerrainCallbackContext context(this);
+
+                if (points[i].z() != NO_DATA_VALUE)
+                {
+                    static_cast<TerrainClampCallback*>(r._callback.get())->onElevationUpdate(
+                        key, points[i].z(), context);
+                }
+                else
+                {
+                    r._callback->onTileUpdate(key, node, context);
+                }
+
+                if (context.markedForRemoval())
+                    removals.push_back(r._callback);
+
+                r._callback = nullptr;
+            }
+        }
+    }
+
+    for (auto& r : recipients)
+    {
+        if (r._callback.valid())
+        {
+            TerrainCallbackContext context( this );
+            r._callback->onTileUpdate( key, node, context );
+
+            // if the callback set the "remove" flag, discard the callback.
+            if ( context.markedForRemoval() )
+                removals.push_back(r._callback);
+        }
+    }
+
+    if (!removals.empty())
+    {
+        removeTerrainCallbacks(removals);
     }
 }
 
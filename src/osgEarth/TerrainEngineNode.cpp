@@ -146,6 +146,9 @@ TerrainEngineNode::setMap(const Map* map, const TerrainOptions& options)
     // to query the in-memory terrain graph, subscribe to tile events, etc.
     _terrainInterface = new Terrain( this, map->getProfile() );
 
+    // for re-clamping terrain-relative objects in bulk
+    _terrainInterface->_elevationPool = map->getElevationPool();
+
     // Register a callback so we can process further map model changes
     _map->addMapCallback( new TerrainEngineNodeCallbackProxy(this) );
 
@@ -66,6 +66,8 @@ TerrainOptions::getConfig() const
     conf.set( "priority_scale", priorityScale() );
     conf.set( "texture_compression", textureCompression());
     conf.set( "concurrency", concurrency());
+    conf.set( "layer_fetch_concurrency", layerFetchConcurrency());
+    conf.set( "max_fetches_per_layer", maxFetchesPerLayer());
 
     return conf;
 }
@@ -105,6 +107,8 @@ TerrainOptions::fromConfig(const Config& conf)
     priorityScale().init(1.0f);
     textureCompression().setDefault("");
     concurrency().setDefault(4u);
+    layerFetchConcurrency().setDefault(0u);
+    maxFetchesPerLayer().setDefault(4u);
 
 
     conf.get( "tile_size", _tileSize );
@@ -141,6 +145,8 @@ TerrainOptions::fromConfig(const Config& conf)
     conf.get( "priority_scale", priorityScale());
     conf.get( "texture_compression", textureCompression());
     conf.get( "concurrency", concurrency());
+    conf.get( "layer_fetch_concurrency", layerFetchConcurrency());
+    conf.get( "max_fetches_per_layer", maxFetchesPerLayer());
 
     // report on deprecated usage
     const std::string deprecated_keys[] = {
@@ -198,6 +204,8 @@ OE_PROPERTY_IMPL(TerrainOptionsAPI, unsigned, MergesPerFrame, mergesPerFrame);
 OE_PROPERTY_IMPL(TerrainOptionsAPI, float, PriorityScale, priorityScale);
 OE_PROPERTY_IMPL(TerrainOptionsAPI, std::string, TextureCompressionMethod, textureCompression);
 OE_PROPERTY_IMPL(TerrainOptionsAPI, unsigned, Concurrency, concurrency);
+OE_PROPERTY_IMPL(TerrainOptionsAPI, unsigned, LayerFetchConcurrency, layerFetchConcurrency);
+OE_PROPERTY_IMPL(TerrainOptionsAPI, unsigned, MaxFetchesPerLayer, maxFetchesPerLayer);
 
 void
 TerrainOptionsAPI::setDriver(const std::string& value)
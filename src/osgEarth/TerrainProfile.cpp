@@ -22,6 +22,7 @@
 #include <osgEarth/TerrainProfile>
 #include <osgEarth/MapNode>
 #include <osgEarth/TerrainEngineNode>
+#include <osgEarth/ProfileSampler>
 
 using namespace osgEarth;
 using namespace osgEarth::Contrib;
@@ -234,3 +235,23 @@ void TerrainProfileCalculator::computeTerrainProfile( osgEarth::MapNode* mapNode
         profile.addElevation( slice.getDistanceHeightIntersections()[i].first, slice.getDistanceHeightIntersections()[i].second);
     }
 }
+
+void TerrainProfileCalculator::computeTerrainProfile( const osgEarth::Map* map, const GeoPoint& start, const GeoPoint& end, const Distance& resolution, TerrainProfile& profile)
+{
+    ProfileSampler sampler(map);
+    sampler.setResolution(resolution);
+    sampler.setNumThreads(1u);
+
+    std::vector<ProfileSampler::Profile> profiles(1);
+    profiles[0].path.push_back(start);
+    profiles[0].path.push_back(end);
+    sampler.sample(profiles);
+
+    profile.clear();
+    const ProfileSampler::Profile& result = profiles[0];
+    for (unsigned int i = 0; i < result.elevations.size(); i++)
+    {
+        if (result.elevations[i] != NO_DATA_VALUE)
+            profile.addElevation( result.distances[i], result.elevations[i] );
+    }
+}
@@ -29,7 +29,10 @@
 
 #define LC "[TerrainTileModelFactory] "
 
+#define ARENA_LAYER_FETCH "oe.layer.fetch"
+
 using namespace osgEarth;
+using namespace osgEarth::Threading;
 
 //.........................................................................
 
@@ -138,9 +141,48 @@ void CreateTileManifest::setProgressive(bool value)
 
 //.........................................................................
 
+// Counting limit on the concurrent fetches from one layer
+struct TerrainTileModelFactory::FetchLimit
+{
+    FetchLimit(unsigned max) : _max(max), _count(0u) { }
+
+    // false if canceled while waiting
+    bool acquire(ProgressCallback* progress)
+    {
+        std::unique_lock<Mutex> lock(_mutex);
+        while (_count >= _max)
+        {
+            if (progress && progress->isCanceled())
+                return false;
+            _available.wait_for(lock, std::chrono::milliseconds(50));
+        }
+        ++_count;
+        return true;
+    }
+
+    void release()
+    {
+        ScopedMutexLock lock(_mutex);
+        --_count;
+        _available.notify_one();
+    }
+
+    Mutex _mutex;
+    std::condition_variable_any _available;
+    unsigned _max;
+    unsigned _count;
+};
+
+//.........................................................................
+
 TerrainTileModelFactory::TerrainTileModelFactory(const TerrainOptions& options) :
 _options( options )
 {
+    if (_options.layerFetchConcurrency() > 0u)
+    {
+        JobArena::setConcurrency(ARENA_LAYER_FETCH, _options.layerFetchConcurrency().get());
+    }
+
     // Create an empty texture that we can use as a placeholder
     _emptyColorTexture = new osg::Texture2D(ImageUtils::createEmptyImage());
     _emptyColorTexture->setUnRefImageDataAfterApply(Registry::instance()->unRefImageDataAfterApply().get());
@@ -166,6 +208,12 @@ TerrainTileModelFactory::createTileModel(
         key,
         map->getDataModelRevision() );
 
+    if (_options.layerFetchConcurrency() > 0u)
+    {
+        addLayersConcurrently(model.get(), map, requirements, key, manifest, progress, false);
+        return model.release();
+    }
+
     // assemble all the components:
     addColorLayers(model.get(), map, requirements, key, manifest, progress, false);
 
@@ -196,6 +244,12 @@ TerrainTileModelFactory::createStandaloneTileModel(
         key,
         map->getDataModelRevision());
 
+    if (_options.layerFetchConcurrency() > 0u)
+    {
+        addLayersConcurrently(model.get(), map, requirements, key, manifest, progress, true);
+        return model.release();
+    }
+
     // assemble all the components:
     addColorLayers(model.get(), map, requirements, key, manifest, progress, true);
 
@@ -219,6 +273,45 @@ TerrainTileModelFactory::addImageLayer(
     const TileKey& key,
     const TerrainEngineRequirements* reqs,
     ProgressCallback* progress)
+{
+    TerrainTileImageLayerModel* layerModel = createImageLayerModel(
+        model, imageLayer, key, reqs, progress);
+
+    if (layerModel)
+    {
+        attachImageLayerModel(model, layerModel);
+    }
+
+    return layerModel;
+}
+
+void
+TerrainTileModelFactory::attachImageLayerModel(
+    TerrainTileModel* model,
+    TerrainTileImageLayerModel* layerModel) const
+{
+    const ImageLayer* imageLayer = layerModel->getImageLayer();
+
+    model->colorLayers().push_back(layerModel);
+
+    if (imageLayer->isShared())
+    {
+        model->sharedLayers().push_back(layerModel);
+    }
+
+    if (imageLayer->isDynamic() || imageLayer->getAsyncLoading())
+    {
+        model->setRequiresUpdateTraverse(true);
+    }
+}
+
+TerrainTileImageLayerModel*
+TerrainTileModelFactory::createImageLayerModel(
+    const TerrainTileModel* model,
+    ImageLayer* imageLayer,
+    const TileKey& key,
+    const TerrainEngineRequirements* reqs,
+    ProgressCallback* progress)
 {
     OE_PROFILING_ZONE;
     OE_PROFILING_ZONE_TEXT(imageLayer->getName());
@@ -299,18 +392,6 @@ TerrainTileModelFactory::addImageLayer(
         layerModel->setTexture(tex);
         layerModel->setMatrix(new osg::RefMatrixf(scaleBiasMatrix));
         layerModel->setRevision(imageLayer->getRevision());
-
-        model->colorLayers().push_back(layerModel);
-
-        if (imageLayer->isShared())
-        {
-            model->sharedLayers().push_back(layerModel);
-        }
-
-        if (imageLayer->isDynamic() || imageLayer->getAsyncLoading())
-        {
-            model->setRequiresUpdateTraverse(true);
-        }
     }
 
     return layerModel;
@@ -323,13 +404,30 @@ TerrainTileModelFactory::addStandaloneImageLayer(
     const TileKey& key,
     const TerrainEngineRequirements* reqs,
     ProgressCallback* progress)
+{
+    TerrainTileImageLayerModel* layerModel = createStandaloneImageLayerModel(
+        model, imageLayer, key, reqs, progress);
+
+    if (layerModel)
+    {
+        attachImageLayerModel(model, layerModel);
+    }
+}
+
+TerrainTileImageLayerModel*
+TerrainTileModelFactory::createStandaloneImageLayerModel(
+    const TerrainTileModel* model,
+    ImageLayer* imageLayer,
+    const TileKey& key,
+    const TerrainEngineRequirements* reqs,
+    ProgressCallback* progress)
 {
     TerrainTileImageLayerModel* layerModel = NULL;
     TileKey keyToUse = key;
     osg::Matrixf scaleBiasMatrix;
     while (keyToUse.valid() && !layerModel)
     {
-        layerModel = addImageLayer(model, imageLayer, keyToUse, reqs, progress);
+        layerModel = createImageLayerModel(model, imageLayer, keyToUse, reqs, progress);
         if (!layerModel)
         {
             TileKey parentKey = keyToUse.createParentKey();
@@ -346,6 +444,7 @@ TerrainTileModelFactory::addStandaloneImageLayer(
     {
         layerModel->setMatrix(new osg::RefMatrixf(scaleBiasMatrix));
     }
+    return layerModel;
 }
 
 void
@@ -400,6 +499,134 @@ TerrainTileModelFactory::addColorLayers(
     }
 }
 
+std::shared_ptr<TerrainTileModelFactory::FetchLimit>
+TerrainTileModelFactory::getFetchLimit(const Layer* layer)
+{
+    ScopedMutexLock lock(_fetchLimitsMutex);
+    std::shared_ptr<FetchLimit>& limit = _fetchLimits[layer->getUID()];
+    if (limit == nullptr)
+        limit = std::make_shared<FetchLimit>(std::max(_options.maxFetchesPerLayer().get(), 1u));
+    return limit;
+}
+
+void
+TerrainTileModelFactory::addLayersConcurrently(
+    TerrainTileModel* model,
+    const Map* map,
+    const TerrainEngineRequirements* reqs,
+    const TileKey& key,
+    const CreateTileManifest& manifest,
+    ProgressCallback* progress,
+    bool standalone)
+{
+    OE_PROFILING_ZONE;
+
+    // One slot per color layer, in map order, so the results can be
+    // attached in the same order as the serial path would.
+    struct Slot
+    {
+        osg::ref_ptr<Layer> _layer;
+        osg::ref_ptr<TerrainTileImageLayerModel> _result;
+    };
+    std::vector<Slot> slots;
+
+    LayerVector layers;
+    map->getLayers(layers);
+
+    for (auto& layer : layers)
+    {
+        if (!layer->isOpen() ||
+            layer->getRenderType() != layer->RENDERTYPE_TERRAIN_SURFACE ||
+            manifest.excludes(layer.get()))
+        {
+            continue;
+        }
+
+        slots.emplace_back();
+        slots.back()._layer = layer.get();
+    }
+
+    // The jobs only write to their own slot (or to the model's own
+    // elevation or land cover member), and the group join below waits for
+    // all of them, so it is safe for them to reference locals.
+    JobGroup group;
+    Job job(JobArena::get(ARENA_LAYER_FETCH), &group);
+    job.setName(key.str());
+
+    for (auto& slot : slots)
+    {
+        ImageLayer* imageLayer = dynamic_cast<ImageLayer*>(slot._layer.get());
+        if (imageLayer == nullptr)
+            continue;
+
+        Slot* slotPtr = &slot;
+        std::shared_ptr<FetchLimit> limit = getFetchLimit(imageLayer);
+
+        job.dispatch([this, slotPtr, imageLayer, limit, model, &key, reqs, progress, standalone](Cancelable*)
+        {
+            if (progress && progress->isCanceled())
+                return;
+
+            if (!limit->acquire(progress))
+                return;
+
+            if (standalone)
+                slotPtr->_result = createStandaloneImageLayerModel(model, imageLayer, key, reqs, progress);
+            else
+                slotPtr->_result = createImageLayerModel(model, imageLayer, key, reqs, progress);
+
+            limit->release();
+        });
+    }
+
+    if (reqs == 0L || reqs->elevationTexturesRequired())
+    {
+        unsigned border = (reqs && reqs->elevationBorderRequired()) ? 1u : 0u;
+
+        job.dispatch([this, model, map, &key, &manifest, border, progress, standalone](Cancelable*)
+        {
+            if (progress && progress->isCanceled())
+                return;
+
+            if (standalone)
+                addStandaloneElevation(model, map, key, manifest, border, progress);
+            else
+                addElevation(model, map, key, manifest, border, progress);
+        });
+    }
+
+    job.dispatch([this, model, map, &key, reqs, &manifest, progress, standalone](Cancelable*)
+    {
+        if (progress && progress->isCanceled())
+            return;
+
+        if (standalone)
+            addStandaloneLandCover(model, map, key, reqs, manifest, progress);
+        else
+            addLandCover(model, map, key, reqs, manifest, progress);
+    });
+
+    // Wait for everything, even when canceled: the jobs check the
+    // progress callback and return quickly.
+    group.join();
+
+    for (auto& slot : slots)
+    {
+        if (slot._result.valid())
+        {
+            attachImageLayerModel(model, slot._result.get());
+        }
+        else if (dynamic_cast<ImageLayer*>(slot._layer.get()) == nullptr)
+        {
+            // non-image kind of TILE layer:
+            TerrainTileColorLayerModel* colorModel = new TerrainTileColorLayerModel();
+            colorModel->setLayer(slot._layer.get());
+            colorModel->setRevision(slot._layer->getRevision());
+            model->colorLayers().push_back(colorModel);
+        }
+    }
+}
+
 void
 TerrainTileModelFactory::addElevation(
     TerrainTileModel*            model,
@@ -38,6 +38,7 @@ ThreeDTilesLayer::Options::getConfig() const
     Config conf = VisibleLayer::Options::getConfig();
     conf.set("url", _url);
     conf.set("max_sse", _maximumScreenSpaceError);
+    conf.set("max_memory", _maxMemory);
     return conf;
 }
 
@@ -45,8 +46,10 @@ void
 ThreeDTilesLayer::Options::fromConfig( const Config& conf )
 {
     _maximumScreenSpaceError.init(15.0f);
+    _maxMemory.init(256u);
     conf.get("url", _url);
     conf.get("max_sse", _maximumScreenSpaceError);
+    conf.get("max_memory", _maxMemory);
 }
 
 //........................................................................
@@ -94,6 +97,7 @@ ThreeDTilesLayer::openImplementation()
     _tilesetNode = new ThreeDTilesetNode(tileset, "", getSceneGraphCallbacks(), readOptions.get());
     _tilesetNode->setMaximumScreenSpaceError(*options().maximumScreenSpaceError());
     _tilesetNode->setOwnerName(getName());
+    _tilesetNode->setMaxResidentBytes((std::size_t)options().maxMemory().get() * 1024u * 1024u);
 
     return STATUS_OK;
 }
@@ -114,6 +118,22 @@ ThreeDTilesLayer::setMaximumScreenSpaceError(float maximumScreenSpaceError)
     }
 }
 
+unsigned
+ThreeDTilesLayer::getMaxMemory() const
+{
+    return options().maxMemory().get();
+}
+
+void
+ThreeDTilesLayer::setMaxMemory(unsigned megabytes)
+{
+    options().maxMemory() = megabytes;
+    if (_tilesetNode)
+    {
+        _tilesetNode->setMaxResidentBytes((std::size_t)megabytes * 1024u * 1024u);
+    }
+}
+
 osg::Node*
 ThreeDTilesLayer::getNode() const
 {
@@ -27,6 +27,18 @@ using namespace osgEarth;
 
 #define LC "[TileLayer] Layer \"" << getName() << "\" "
 
+namespace
+{
+    // cache key for a serialized availability index
+    std::string getAvailabilityKey(const Profile* profile)
+    {
+        return Stringify() << std::hex << profile->getHorizSignature() << "_availability";
+    }
+
+    // save an index once it has accumulated this many changes
+    const unsigned AVAILABILITY_SAVE_THRESHOLD = 512u;
+}
+
 //------------------------------------------------------------------------
 
 Config
@@ -44,6 +56,7 @@ TileLayer::Options::getConfig() const
     conf.set("no_data_value", _noDataValue);
     conf.set("profile", _profile);
     conf.set("tile_size", _tileSize);
+    conf.set("availability_index", _availabilityIndex);
 
     return conf;
 }
@@ -58,6 +71,7 @@ TileLayer::Options::fromConfig(const Config& conf)
     _noDataValue.init( -32767.0f ); // SHRT_MIN
     _minValidValue.init( -32766.0f ); // -(2^15 - 2)
     _maxValidValue.init( 32767.0f );
+    _availabilityIndex.init( false );
 
     conf.get( "min_level", _minLevel );
     conf.get( "max_level", _maxLevel );
@@ -70,6 +84,7 @@ TileLayer::Options::fromConfig(const Config& conf)
     conf.get( "nodata_value", _noDataValue); // back compat
     conf.get( "min_valid_value", _minValidValue);
     conf.get( "max_valid_value", _maxValidValue);
+    conf.get( "availability_index", _availabilityIndex);
 }
 
 //------------------------------------------------------------------------
@@ -313,7 +328,10 @@ TileLayer::openImplementation()
         setProfile(Profile::create(options().profile().get()));
 
     if (isOpen())
+    {
         _cacheBinMetadata.clear();
+        _dataAvailability.clear();
+    }
 
     if (_memCache.valid())
         _memCache->clear();
@@ -324,6 +342,12 @@ TileLayer::openImplementation()
 Status
 TileLayer::closeImplementation()
 {
+    saveDataAvailability(true);
+    {
+        Threading::ScopedMutexLock lock(layerMutex());
+        _dataAvailability.clear();
+    }
+
     setProfile(nullptr);
 
     return Layer::closeImplementation();
@@ -744,6 +768,116 @@ TileLayer::dirtyDataExtents()
     _dataExtentsUnion = GeoExtent::INVALID;
 }
 
+void
+TileLayer::setAvailabilityIndex(bool value)
+{
+    setOptionThatRequiresReopen(options().availabilityIndex(), value);
+}
+
+bool
+TileLayer::getAvailabilityIndex() const
+{
+    return options().availabilityIndex().get();
+}
+
+DataAvailability*
+TileLayer::getDataAvailability(const Profile* profile)
+{
+    if (!profile || options().availabilityIndex() != true || isDynamic())
+        return nullptr;
+
+    std::string key = getAvailabilityKey(profile);
+
+    {
+        Threading::ScopedMutexLock lock(layerMutex());
+        DataAvailabilityMap::iterator i = _dataAvailability.find(key);
+        if (i != _dataAvailability.end())
+            return i->second.get();
+    }
+
+    osg::ref_ptr<DataAvailability> index = new DataAvailability(profile);
+
+    // resume the index stored with the cache bin if there is one:
+    bool loaded = false;
+    CacheBin* bin = getCacheBin(profile);
+    if (bin)
+    {
+        ReadResult rr = bin->readString(key, getReadOptions());
+        if (rr.succeeded())
+        {
+            loaded = index->read(rr.getString());
+            if (!loaded)
+            {
+                OE_WARN << LC << "Availability index appears to be corrupt; starting over" << std::endl;
+            }
+        }
+    }
+
+    if (!loaded)
+    {
+        prepopulateDataAvailability(index.get());
+    }
+
+    Threading::ScopedMutexLock lock(layerMutex());
+    osg::ref_ptr<DataAvailability>& slot = _dataAvailability[key];
+    if (!slot.valid())
+        slot = index.get();
+    return slot.get();
+}
+
+void
+TileLayer::recordDataAvailability(const TileKey& key, bool hasData)
+{
+    DataAvailability* index = getDataAvailability(key.getProfile());
+    if (!index)
+        return;
+
+    if (hasData)
+    {
+        // data appeared where there was none before
+        if (index->get(key) == DataAvailability::NO_DATA)
+            index->set(key, DataAvailability::UNKNOWN);
+    }
+    else
+    {
+        index->set(key, DataAvailability::NO_DATA);
+    }
+
+    if (index->getNumChanges() >= AVAILABILITY_SAVE_THRESHOLD)
+    {
+        saveDataAvailability(false);
+    }
+}
+
+void
+TileLayer::saveDataAvailability(bool force)
+{
+    if (!getCacheSettings() || !getCacheSettings()->cachePolicy()->isCacheWriteable())
+        return;
+
+    std::vector<std::pair<std::string, osg::ref_ptr<DataAvailability>>> indexes;
+    {
+        Threading::ScopedMutexLock lock(layerMutex());
+        indexes.assign(_dataAvailability.begin(), _dataAvailability.end());
+    }
+
+    for (auto& i : indexes)
+    {
+        DataAvailability* index = i.second.get();
+        unsigned changes = index->getNumChanges();
+
+        if (changes >= AVAILABILITY_SAVE_THRESHOLD || (force && changes > 0u))
+        {
+            CacheBin* bin = getCacheBin(index->getProfile());
+            if (bin)
+            {
+                osg::ref_ptr<StringObject> data = new StringObject(index->write());
+                bin->write(i.first, data.get(), getReadOptions());
+            }
+        }
+    }
+}
+
 const DataExtent&
 TileLayer::getDataExtentsUnion() const
 {
@@ -19,6 +19,7 @@
 #include <osgEarth/TileVisitor>
 #include <osgEarth/CacheEstimator>
 #include <osgEarth/FileUtils>
+#include <osg/Timer>
 #include <thread>
 
 #if OSG_VERSION_GREATER_OR_EQUAL(3,5,10)
@@ -309,6 +310,101 @@ bool MultithreadedTileVisitor::handleTile(const TileKey& key)
 
 /*****************************************************************************************/
 
+JournaledTileVisitor::JournaledTileVisitor(const std::string& journalPath) :
+    TileVisitor(),
+    _journal(new SeedJournal(journalPath)),
+    _numThreads(1u)
+{
+}
+
+JournaledTileVisitor::JournaledTileVisitor(const std::string& journalPath, TileHandler* handler) :
+    TileVisitor(handler),
+    _journal(new SeedJournal(journalPath)),
+    _numThreads(1u)
+{
+}
+
+void JournaledTileVisitor::run(const Profile* mapProfile)
+{
+    _profile = mapProfile;
+
+    resetProgress();
+
+    // Every LOD becomes a set of work units, so the range must be finite
+    if (_maxLevel > 30)
+    {
+        OE_WARN << "[JournaledTileVisitor] Set a max level before seeding with a journal" << std::endl;
+        return;
+    }
+
+    Status status = _journal->open(mapProfile, _minLevel, _maxLevel, _extents);
+    if (status.isError())
+    {
+        OE_WARN << "[JournaledTileVisitor] " << status.message() << std::endl;
+        return;
+    }
+
+    estimate();
+
+    if (_numThreads <= 1u)
+    {
+        processUnits();
+        return;
+    }
+
+    // Each thread claims units of its own, just like another process would
+    OE_INFO << "Starting " << _numThreads << " threads " << std::endl;
+
+    JobArena arena("oe.journaledtilevisitor", _numThreads);
+    JobGroup group;
+    for (unsigned int i = 0; i < _numThreads; ++i)
+    {
+        Job job(&arena, &group);
+        job.setName("processUnits");
+        job.dispatch([this](Cancelable*) { processUnits(); });
+    }
+    group.join();
+}
+
+void JournaledTileVisitor::processUnits()
+{
+    SeedJournal::WorkUnit unit;
+    while (_journal->claim(unit))
+    {
+        osg::Timer_t start = osg::Timer::instance()->tick();
+        unsigned tiles = 0u;
+
+        // every tile at the unit's LOD beneath its ancestor
+        unsigned span = 1u << (unit._lod - unit._ancestor.getLOD());
+        unsigned x0 = unit._ancestor.getTileX() * span;
+        unsigned y0 = unit._ancestor.getTileY() * span;
+
+        for (unsigned y = y0; y < y0 + span; ++y)
+        {
+            for (unsigned x = x0; x < x0 + span; ++x)
+            {
+                if (_progress.valid() && _progress->isCanceled())
+                {
+                    // unfinished; leave it for the next run
+                    _journal->release(unit);
+                    return;
+                }
+
+                TileKey key(unit._lod, x, y, _profile.get());
+                if (intersects(key.getExtent()) && hasData(key))
+                {
+                    handleTile(key);
+                    ++tiles;
+                }
+            }
+        }
+
+        _journal->complete(unit, tiles, osg::Timer::instance()->delta_s(start, osg::Timer::instance()->tick()));
+    }
+}
+
+/*****************************************************************************************/
+
 TaskList::TaskList(const Profile* profile):
 _profile( profile )
 {
@@ -20,9 +20,13 @@
 #include <osgEarth/VerticalDatum>
 #include <osgEarth/Threading>
 #include <osgEarth/GeoData>
+#include <osgEarth/TileKey>
+#include <osgEarth/Containers>
+#include <osgEarth/Metrics>
 
 #include <osgDB/ReadFile>
 #include <stdlib.h>
+#include <cmath>
 
 using namespace osgEarth;
 
@@ -37,8 +41,135 @@ namespace
     VDatumCache _vdatumCache;
     Threading::Mutex _vdataCacheMutex("VDatumCache(OE)");
     bool _vdatumWarning = false;
+
+    // number of tiles whose geoid offsets each datum keeps
+    const unsigned GEOID_PATCH_CACHE_SIZE = 64u;
+
+    // posts per side of the lattice transformed to geographic when
+    // a grid is not in a geographic SRS
+    const unsigned GEOID_LATTICE_SIZE = 17u;
+
+    // Longitude lon shifted by whole turns to within 180 degrees of ref
+    inline double unwrap(double lon, double ref)
+    {
+        return lon - 360.0*std::floor((lon - ref + 180.0) / 360.0);
+    }
+
+    // Geographic coordinates of each post of a cols x rows grid over
+    // an extent, row by row from the south.
+    bool computeGridCoords(
+        const GeoExtent& extent,
+        unsigned cols, unsigned rows,
+        std::vector<double>& lat, std::vector<double>& lon)
+    {
+        lat.resize(cols*rows);
+        lon.resize(cols*rows);
+
+        const SpatialReference* srs = extent.getSRS();
+
+        if (srs->isGeographic())
+        {
+            // separable, so work it out directly
+            double xstep = extent.width() / double(cols-1);
+            double ystep = extent.height() / double(rows-1);
+            for(unsigned r=0, i=0; r<rows; ++r)
+            {
+                double y = extent.south() + ystep*double(r);
+                for(unsigned c=0; c<cols; ++c, ++i)
+                {
+                    double x = extent.west() + xstep*double(c);
+                    lat[i] = y;
+                    lon[i] = x > 180.0 ? x - 360.0 : x;
+                }
+            }
+            return true;
+        }
+
+        // Transform a coarse lattice in one call and interpolate the
+        // rest; geoids vary much too slowly for the difference to show.
+        unsigned lc = osg::minimum(cols, GEOID_LATTICE_SIZE);
+        unsigned lr = osg::minimum(rows, GEOID_LATTICE_SIZE);
+        std::vector<osg::Vec3d> lattice;
+        lattice.reserve(lc*lr);
+        for(unsigned r=0; r<lr; ++r)
+            for(unsigned c=0; c<lc; ++c)
+                lattice.emplace_back(
+                    extent.west() + extent.width()*double(c)/double(lc-1),
+                    extent.south() + extent.height()*double(r)/double(lr-1),
+                    0.0);
+
+        if (!srs->transform(lattice, srs->getGeographicSRS()))
+            return false;
+
+        for(unsigned r=0, i=0; r<rows; ++r)
+        {
+            double v = double(r)*double(lr-1)/double(rows-1);
+            unsigned r0 = osg::minimum((unsigned)v, lr-2);
+            double fr = v - double(r0);
+            for(unsigned c=0; c<cols; ++c, ++i)
+            {
+                double u = double(c)*double(lc-1)/double(cols-1);
+                unsigned c0 = osg::minimum((unsigned)u, lc-2);
+                double fc = u - double(c0);
+                const osg::Vec3d& sw = lattice[r0*lc + c0];
+                const osg::Vec3d& se = lattice[r0*lc + c0 + 1];
+                const osg::Vec3d& nw = lattice[(r0+1)*lc + c0];
+                const osg::Vec3d& ne = lattice[(r0+1)*lc + c0 + 1];
+
+                lat[i] =
+                    (sw.y()*(1.0-fc) + se.y()*fc)*(1.0-fr) +
+                    (nw.y()*(1.0-fc) + ne.y()*fc)*fr;
+
+                // A cell that straddles the antimeridian (common in polar
+                // projections) has corners near both +180 and -180; bring
+                // them to the same side of the sw corner before blending.
+                double x =
+                    (sw.x()*(1.0-fc) + unwrap(se.x(), sw.x())*fc)*(1.0-fr) +
+                    (unwrap(nw.x(), sw.x())*(1.0-fc) + unwrap(ne.x(), sw.x())*fc)*fr;
+                lon[i] = x > 180.0 ? x - 360.0 : x < -180.0 ? x + 360.0 : x;
+            }
+        }
+        return true;
+    }
+
+    // Applies msl2hae with one datum's geoid offsets, the unit conversion,
+    // and hae2msl with the other's, to every valid post at once.
+    void applyGeoidOffsets(
+        const VerticalDatum* from,
+        const VerticalDatum* to,
+        const float* fromOffsets,
+        const float* toOffsets,
+        osg::HeightField* hf)
+    {
+        Units fromUnits = from ? from->getUnits() : Units::METERS;
+        Units toUnits = to ? to->getUnits() : Units::METERS;
+        double scale = fromUnits.convertTo(toUnits, 1.0);
+
+        float* h = &hf->getFloatArray()->front();
+        unsigned count = hf->getNumColumns() * hf->getNumRows();
+        for(unsigned i=0; i<count; ++i)
+        {
+            if (h[i] != NO_DATA_VALUE)
+            {
+                double hae = double(h[i]) + (fromOffsets ? fromOffsets[i] : 0.0f);
+                h[i] = float(hae*scale - (toOffsets ? toOffsets[i] : 0.0f));
+            }
+        }
+    }
+
+    bool hasGeoid(const VerticalDatum* datum)
+    {
+        return datum && datum->getGeoid() && datum->getGeoid()->isValid();
+    }
 } 
 
+struct VerticalDatum::GeoidPatchCache
+{
+    using Patch = std::shared_ptr<const std::vector<float>>;
+    LRUCache<TileKey, Patch> _lru;
+    GeoidPatchCache() : _lru(true, GEOID_PATCH_CACHE_SIZE) { }
+};
+
 VerticalDatum*
 VerticalDatum::get( const std::string& initString )
 {
@@ -85,7 +216,8 @@ VerticalDatum::VerticalDatum(const std::string& name,
 _name      ( name ),
 _initString( initString ),
 _geoid     ( geoid ),
-_units     ( Units::METERS )
+_units     ( Units::METERS ),
+_patches   ( std::make_shared<GeoidPatchCache>() )
 {
     if ( _geoid.valid() )
         _units = _geoid->getUnits();
@@ -94,7 +226,8 @@ _units     ( Units::METERS )
 VerticalDatum::VerticalDatum( const Units& units ) :
 _name      ( units.getName() ),
 _initString( units.getName() ),
-_units     ( units )
+_units     ( units ),
+_patches   ( std::make_shared<GeoidPatchCache>() )
 {
     //nop
 }
@@ -149,41 +282,107 @@ VerticalDatum::transform(const VerticalDatum* from,
     if ( from == to )
         return true;
 
+    OE_PROFILING_ZONE;
+
     unsigned cols = hf->getNumColumns();
     unsigned rows = hf->getNumRows();
-    
-    osg::Vec3d sw(extent.west(), extent.south(), 0.0);
-    osg::Vec3d ne(extent.east(), extent.north(), 0.0);
-    
-    double xstep = std::abs(extent.east() - extent.west()) / double(cols-1);
-    double ystep = std::abs(extent.north() - extent.south()) / double(rows-1);
+    if ( cols < 2 || rows < 2 )
+        return false;
 
-    if ( !extent.getSRS()->isGeographic() )
-    {
-        const SpatialReference* geoSRS = extent.getSRS()->getGeographicSRS();
-        extent.getSRS()->transform(sw, geoSRS, sw);
-        extent.getSRS()->transform(ne, geoSRS, ne);
-        xstep = (ne.x()-sw.x()) / double(cols-1);
-        ystep = (ne.y()-sw.y()) / double(rows-1);
-    }
+    std::vector<float> fromOffsets, toOffsets;
 
-    for( unsigned c=0; c<cols; ++c)
+    if ( hasGeoid(from) || hasGeoid(to) )
     {
-        double lon = sw.x() + xstep*double(c);
-        for( unsigned r=0; r<rows; ++r)
+        std::vector<double> lat, lon;
+        if ( !computeGridCoords(extent, cols, rows, lat, lon) )
+            return false;
+
+        if ( hasGeoid(from) )
         {
-            double lat = sw.y() + ystep*double(r);
-            float& h = hf->getHeight(c, r);
-            if (h != NO_DATA_VALUE)
-            {
-                VerticalDatum::transform( from, to, lat, lon, h );
-            }
+            fromOffsets.resize(cols*rows);
+            from->getGeoid()->getHeights(lat.data(), lon.data(), cols*rows, fromOffsets.data());
+        }
+        if ( hasGeoid(to) )
+        {
+            toOffsets.resize(cols*rows);
+            to->getGeoid()->getHeights(lat.data(), lon.data(), cols*rows, toOffsets.data());
         }
     }
 
+    applyGeoidOffsets(
+        from, to,
+        fromOffsets.empty() ? nullptr : fromOffsets.data(),
+        toOffsets.empty() ? nullptr : toOffsets.data(),
+        hf);
+
     return true;
 }
 
+bool
+VerticalDatum::transform(const VerticalDatum* from,
+                         const VerticalDatum* to,
+                         const TileKey&       key,
+                         osg::HeightField*    hf )
+{
+    if ( from == to )
+        return true;
+
+    OE_PROFILING_ZONE;
+
+    unsigned cols = hf->getNumColumns();
+    unsigned rows = hf->getNumRows();
+    if ( cols < 2 || rows < 2 )
+        return false;
+
+    std::shared_ptr<const std::vector<float>> fromOffsets, toOffsets;
+
+    if ( hasGeoid(from) )
+    {
+        fromOffsets = from->getGeoidPatch(key, cols, rows);
+        if ( !fromOffsets )
+            return false;
+    }
+
+    if ( hasGeoid(to) )
+    {
+        toOffsets = to->getGeoidPatch(key, cols, rows);
+        if ( !toOffsets )
+            return false;
+    }
+
+    applyGeoidOffsets(
+        from, to,
+        fromOffsets ? fromOffsets->data() : nullptr,
+        toOffsets ? toOffsets->data() : nullptr,
+        hf);
+
+    return true;
+}
+
+std::shared_ptr<const std::vector<float>>
+VerticalDatum::getGeoidPatch(const TileKey& key, unsigned cols, unsigned rows) const
+{
+    if ( !hasGeoid(this) )
+        return nullptr;
+
+    // a cached patch is only good for a grid of the same size
+    LRUCache<TileKey, GeoidPatchCache::Patch>::Record rec;
+    if ( _patches && _patches->_lru.get(key, rec) && rec.value()->size() == cols*rows )
+        return rec.value();
+
+    std::vector<double> lat, lon;
+    if ( !computeGridCoords(key.getExtent(), cols, rows, lat, lon) )
+        return nullptr;
+
+    auto patch = std::make_shared<std::vector<float>>(cols*rows);
+    _geoid->getHeights(lat.data(), lon.data(), cols*rows, patch->data());
+
+    if ( _patches )
+        _patches->_lru.insert(key, patch);
+
+    return patch;
+}
+
 double 
 VerticalDatum::msl2hae( double lat_deg, double lon_deg, double msl ) const
 {
@@ -0,0 +1,524 @@
+/* -*-c++-*- */
+/* osgEarth - Geospatial SDK for OpenSceneGraph
+ * Copyright 2020 Pelican Mapping
+ * http://osgearth.org
+ *
+ * osgEarth is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+#include <osgEarth/Viewshed>
+#include <osgEarth/Map>
+#include <osgEarth/ElevationPool>
+#include <osgEarth/GeoMath>
+#include <osgEarth/Progress>
+#include <osgEarth/Threading>
+#include <osgEarth/Metrics>
+#include <atomic>
+#include <cmath>
+#include <limits>
+#include <thread>
+
+#define LC "[Viewshed] "
+
+#define VIEWSHED_ARENA_NAME "oe.viewshed"
+#define LINE_OF_SIGHT_ARENA_NAME "oe.lineofsight"
+
+using namespace osgEarth;
+using namespace osgEarth::Util;
+using namespace osgEarth::Threading;
+
+namespace
+{
+    // Shared pools, sized once; Viewshed::setNumThreads decides how
+    // many jobs each analysis is split into.
+    JobArena* getArena(const char* name)
+    {
+        static bool sized = []()
+        {
+            unsigned value = std::max(2u, std::thread::hardware_concurrency());
+            JobArena::setConcurrency(VIEWSHED_ARENA_NAME, value);
+            JobArena::setConcurrency(LINE_OF_SIGHT_ARENA_NAME, value);
+            return true;
+        }();
+        (void)sized;
+        return JobArena::get(name);
+    }
+
+    // horizon of a cell that nothing blocks
+    const float NO_HORIZON = -std::numeric_limits<float>::infinity();
+
+    // largest raster is (2*MAX_RADIUS_CELLS+1) cells on a side
+    const int MAX_RADIUS_CELLS = 2048;
+
+    // most samples along one sight line
+    const int MAX_LOS_SAMPLES = 65536;
+
+    // Square grid of cells centered on the observer. Cell (r,r) holds
+    // the observer and rows run south to north.
+    struct Grid
+    {
+        int r, n;
+        std::vector<float> elev;     // terrain, lowered for curvature
+        std::vector<float> horizon;  // height of the sight line above each cell
+        std::vector<unsigned char> valid;
+        std::vector<unsigned char> visible;
+
+        Grid(int radius) : r(radius), n(2 * radius + 1)
+        {
+            elev.resize(n*n);
+            horizon.resize(n*n);
+            valid.resize(n*n);
+            visible.resize(n*n, 0);
+        }
+
+        int index(int col, int row) const { return row * n + col; }
+    };
+
+    // One of the eight octants around the observer. Cells in an octant
+    // are addressed by ring "a" (distance along the major axis) and
+    // "b" (0 <= b <= a along the minor axis).
+    struct Octant
+    {
+        int sx, sy;
+        bool swap;
+
+        int index(const Grid& g, int a, int b) const {
+            int u = swap ? b : a, v = swap ? a : b;
+            return g.index(g.r + sx * u, g.r + sy * v);
+        }
+    };
+
+    const Octant OCTANTS[8] = {
+        { 1, 1, false }, { 1, -1, false }, { -1, 1, false }, { -1, -1, false },
+        { 1, 1, true  }, { 1, -1, true  }, { -1, 1, true  }, { -1, -1, true  }
+    };
+
+    // XDraw step: the sight line to a cell in ring a passes through
+    // ring a-1 at height zPrev; extend it out to ring a.
+    inline void
+    sweep(Grid& g, int cell, int a, double zPrev, double zObs, double targetHeight)
+    {
+        double zLine = a > 1 && zPrev != (double)NO_HORIZON ?
+            zObs + (zPrev - zObs) * (double)a / (double)(a - 1) :
+            (double)NO_HORIZON;
+
+        if (g.valid[cell])
+        {
+            g.visible[cell] = g.elev[cell] + targetHeight >= zLine ? 1 : 0;
+            g.horizon[cell] = (float)osg::maximum((double)g.elev[cell], zLine);
+        }
+        else
+        {
+            // no data: see straight through it, carrying the horizon
+            // from the ring before (none at all next to the observer)
+            g.horizon[cell] = (float)zLine;
+        }
+    }
+
+    // Horizon between two cells of a ring. A side with no horizon
+    // doesn't constrain the line, so use the other one.
+    inline double
+    interpolate(float h0, float h1, double w)
+    {
+        if (h0 == NO_HORIZON) return h1;
+        if (h1 == NO_HORIZON) return h0;
+        return h0 * w + h1 * (1.0 - w);
+    }
+
+    // XDraw sweep. The axes and diagonals border two octants each,
+    // so do them first; then each octant's interior only reads cells
+    // that it owns or that are already done, and the octants can run
+    // in parallel.
+    void
+    sweepGrid(Grid& grid, double zObs, double targetHeight, JobArena* arena)
+    {
+        OE_PROFILING_ZONE_NAMED("sweep");
+
+        const int r = grid.r;
+        const int center = grid.index(r, r);
+        grid.visible[center] = 1;
+        grid.horizon[center] = grid.valid[center] ? grid.elev[center] : NO_HORIZON;
+
+        for (auto& oct : OCTANTS)
+        {
+            for (int a = 1; a <= r; ++a)
+            {
+                sweep(grid, oct.index(grid, a, 0), a, grid.horizon[oct.index(grid, a - 1, 0)], zObs, targetHeight);
+                sweep(grid, oct.index(grid, a, a), a, grid.horizon[oct.index(grid, a - 1, a - 1)], zObs, targetHeight);
+            }
+        }
+
+        auto interior = [&grid, r, zObs, targetHeight](const Octant& oct)
+        {
+            for (int a = 2; a <= r; ++a)
+            {
+                for (int b = 1; b < a; ++b)
+                {
+                    // the sight line crosses ring a-1 between
+                    // cells b-1 and b
+                    double w = (double)b / (double)a;
+                    double zPrev = interpolate(
+                        grid.horizon[oct.index(grid, a - 1, b - 1)],
+                        grid.horizon[oct.index(grid, a - 1, b)],
+                        w);
+
+                    sweep(grid, oct.index(grid, a, b), a, zPrev, zObs, targetHeight);
+                }
+            }
+        };
+
+        if (arena == nullptr)
+        {
+            for (auto& oct : OCTANTS)
+                interior(oct);
+            return;
+        }
+
+        JobGroup group;
+        Job job(arena, &group);
+        for (auto& oct : OCTANTS)
+        {
+            job.dispatch([&interior, &oct](Cancelable*)
+            {
+                interior(oct);
+            });
+        }
+        group.join();
+    }
+}
+
+Viewshed::Viewshed(const Map* map) :
+    _map(map),
+    _resolution(30.0, Units::METERS),
+    _targetHeight(0.0),
+    _refraction(0.13),
+    _curvature(true),
+    _visibleColor(0.0f, 1.0f, 0.0f, 0.5f),
+    _hiddenColor(1.0f, 0.0f, 0.0f, 0.5f),
+    _numThreads(std::max(1u, std::thread::hardware_concurrency()))
+{
+    //nop
+}
+
+double
+Viewshed::getEffectiveRadius(const Map* map) const
+{
+    if (!_curvature)
+        return 0.0;
+
+    // refraction bends sight lines along a curve, which is the same
+    // as straight lines over a larger earth
+    double radius = map->getSRS()->getEllipsoid().getSemiMajorAxis();
+    return radius / osg::maximum(1.0 - _refraction, 1e-6);
+}
+
+GeoImage
+Viewshed::compute(
+    const GeoPoint& observer,
+    const Distance& radius,
+    ProgressCallback* progress) const
+{
+    OE_PROFILING_ZONE;
+
+    osg::ref_ptr<const Map> map;
+    if (_map.lock(map) == false || map->getSRS() == nullptr)
+        return GeoImage::INVALID;
+
+    const SpatialReference* srs = map->getSRS();
+    ElevationPool* pool = map->getElevationPool();
+
+    GeoPoint obs = observer.transform(srs);
+    if (!obs.isValid())
+    {
+        OE_WARN << LC << "Failed to transform the observer to the map SRS" << std::endl;
+        return GeoImage::INVALID;
+    }
+
+    double radiusMeters = radius.as(Units::METERS);
+    double res = _resolution.as(Units::METERS);
+    if (radiusMeters <= 0.0 || res <= 0.0)
+        return GeoImage::INVALID;
+
+    if (radiusMeters / res > (double)MAX_RADIUS_CELLS)
+    {
+        res = radiusMeters / (double)MAX_RADIUS_CELLS;
+        OE_INFO << LC << "Radius too large for the resolution; using " << res << "m cells" << std::endl;
+    }
+
+    const int r = (int)std::ceil(radiusMeters / res);
+
+    // cell size in map units, square on the ground at the observer
+    double step = map->getProfile()->getExtent().width() * 1e-6;
+    osg::Vec3d p0(obs.x(), obs.y(), 0.0);
+    double metersPerUnitX = GeoMath::distance(p0, p0 + osg::Vec3d(step, 0, 0), srs) / step;
+    double metersPerUnitY = GeoMath::distance(p0, p0 + osg::Vec3d(0, step, 0), srs) / step;
+    if (metersPerUnitX <= 0.0 || metersPerUnitY <= 0.0)
+        return GeoImage::INVALID;
+
+    const double dx = res / metersPerUnitX;
+    const double dy = res / metersPerUnitY;
+
+    Grid grid(r);
+    const int n = grid.n;
+    const double effectiveRadius = getEffectiveRadius(map.get());
+    const unsigned numThreads = osg::maximum(_numThreads, 1u);
+
+    JobArena* arena = numThreads > 1u ? getArena(VIEWSHED_ARENA_NAME) : nullptr;
+
+    // Sample the terrain, a band of rows per job. Each cell is lowered
+    // by the drop of the earth's surface away from the observer.
+    {
+        OE_PROFILING_ZONE_NAMED("sample");
+
+        auto sampleRows = [&](int row0, int row1)
+        {
+            if (progress && progress->isCanceled())
+                return;
+
+            std::vector<osg::Vec3d> points;
+            points.reserve((row1 - row0) * n);
+            for (int row = row0; row < row1; ++row)
+                for (int col = 0; col < n; ++col)
+                    points.emplace_back(obs.x() + (col - r)*dx, obs.y() + (row - r)*dy, 0.0);
+
+            ElevationPool::WorkingSet ws;
+            if (pool->sampleMapCoords(points, Distance(res, Units::METERS), &ws, progress) < 0)
+                return;
+
+            auto p = points.begin();
+            for (int row = row0; row < row1; ++row)
+            {
+                for (int col = 0; col < n; ++col, ++p)
+                {
+                    int i = grid.index(col, row);
+                    grid.valid[i] = p->z() != NO_DATA_VALUE ? 1 : 0;
+                    if (grid.valid[i])
+                    {
+                        double d2 = ((col - r)*(col - r) + (row - r)*(row - r)) * res * res;
+                        double drop = effectiveRadius > 0.0 ? d2 / (2.0 * effectiveRadius) : 0.0;
+                        grid.elev[i] = (float)(p->z() - drop);
+                    }
+                }
+            }
+        };
+
+        if (arena == nullptr)
+        {
+            sampleRows(0, n);
+        }
+        else
+        {
+            const int rowsPerJob = osg::maximum(1, n / (int)(numThreads * 4u));
+            JobGroup group;
+            Job job(arena, &group);
+
+            for (int row0 = 0; row0 < n; row0 += rowsPerJob)
+            {
+                int row1 = osg::minimum(row0 + rowsPerJob, n);
+                job.dispatch([&sampleRows, row0, row1](Cancelable*)
+                {
+                    sampleRows(row0, row1);
+                });
+            }
+            group.join();
+        }
+    }
+
+    if (progress && progress->isCanceled())
+        return GeoImage::INVALID;
+
+    const int center = grid.index(r, r);
+    const double ground = grid.valid[center] ? grid.elev[center] : 0.0;
+    const double zObs = obs.isRelative() ? ground + obs.z() : obs.z();
+
+    sweepGrid(grid, zObs, _targetHeight, arena);
+
+    // Visibility raster. The image's first row is its southern edge.
+    osg::ref_ptr<osg::Image> image = new osg::Image();
+    image->allocateImage(n, n, 1, GL_RGBA, GL_UNSIGNED_BYTE);
+
+    const double radiusCells2 = (radiusMeters / res) * (radiusMeters / res);
+
+    for (int row = 0; row < n; ++row)
+    {
+        unsigned char* ptr = image->data(0, row);
+        for (int col = 0; col < n; ++col, ptr += 4)
+        {
+            int i = grid.index(col, row);
+            double d2 = (double)((col - r)*(col - r) + (row - r)*(row - r));
+
+            osg::Vec4f color(0, 0, 0, 0);
+            if (grid.valid[i] && d2 <= radiusCells2)
+                color = grid.visible[i] ? _visibleColor : _hiddenColor;
+
+            for (int c = 0; c < 4; ++c)
+                ptr[c] = (unsigned char)(osg::clampBetween(color[c], 0.0f, 1.0f) * 255.0f);
+        }
+    }
+
+    GeoExtent extent(
+        srs,
+        obs.x() - (r + 0.5)*dx, obs.y() - (r + 0.5)*dy,
+        obs.x() + (r + 0.5)*dx, obs.y() + (r + 0.5)*dy);
+
+    return GeoImage(image.get(), extent);
+}
+
+int
+Viewshed::computeLineOfSight(
+    std::vector<LineOfSightQuery>& queries,
+    ProgressCallback* progress) const
+{
+    OE_PROFILING_ZONE;
+
+    osg::ref_ptr<const Map> map;
+    if (_map.lock(map) == false || map->getSRS() == nullptr)
+        return -1;
+
+    const SpatialReference* srs = map->getSRS();
+    ElevationPool* pool = map->getElevationPool();
+    const double res = _resolution.as(Units::METERS);
+    if (res <= 0.0)
+        return -1;
+
+    const double effectiveRadius = getEffectiveRadius(map.get());
+    const unsigned numThreads = osg::maximum(_numThreads, 1u);
+
+    JobGroup group;
+    Job job(getArena(LINE_OF_SIGHT_ARENA_NAME), &group);
+
+    std::atomic_int answered(0);
+
+    // Each job samples the terrain under all its sight lines
+    // with a single elevation query.
+    const std::size_t queriesPerJob = osg::maximum(
+        (std::size_t)1u, queries.size() / (numThreads * 4u));
+
+    for (std::size_t q0 = 0; q0 < queries.size(); q0 += queriesPerJob)
+    {
+        std::size_t q1 = osg::minimum(q0 + queriesPerJob, queries.size());
+
+        job.dispatch([&, q0, q1](Cancelable*)
+        {
+            if (progress && progress->isCanceled())
+                return;
+
+            struct Line {
+                LineOfSightQuery* query;
+                GeoPoint start, end;
+                double length;
+                int samples;
+                std::size_t offset;
+            };
+
+            std::vector<Line> lines;
+            std::vector<osg::Vec3d> points;
+
+            for (std::size_t q = q0; q < q1; ++q)
+            {
+                LineOfSightQuery& query = queries[q];
+                query.visible = false;
+                query.obstruction = GeoPoint::INVALID;
+
+                Line line;
+                line.query = &query;
+                line.start = query.start.transform(srs);
+                line.end = query.end.transform(srs);
+                if (!line.start.isValid() || !line.end.isValid())
+                    continue;
+
+                line.length = GeoMath::distance(line.start.vec3d(), line.end.vec3d(), srs);
+                line.samples = osg::clampBetween((int)std::ceil(line.length / res), 1, MAX_LOS_SAMPLES);
+                line.offset = points.size();
+
+                for (int k = 0; k <= line.samples; ++k)
+                {
+                    double t = (double)k / (double)line.samples;
+                    osg::Vec3d p = line.start.vec3d() * (1.0 - t) + line.end.vec3d() * t;
+                    points.emplace_back(p.x(), p.y(), 0.0);
+                }
+                lines.push_back(line);
+            }
+
+            if (points.empty())
+                return;
+
+            ElevationPool::WorkingSet ws;
+            if (pool->sampleMapCoords(points, Distance(res, Units::METERS), &ws, progress) < 0)
+                return;
+
+            for (auto& line : lines)
+            {
+                const osg::Vec3d* p = &points[line.offset];
+
+                auto height = [](const GeoPoint& gp, const osg::Vec3d& sample) {
+                    double ground = sample.z() != NO_DATA_VALUE ? sample.z() : 0.0;
+                    return gp.isRelative() ? ground + gp.z() : gp.z();
+                };
+                double z0 = height(line.start, p[0]);
+                double z1 = height(line.end, p[line.samples]);
+
+                line.query->visible = true;
+
+                for (int k = 1; k < line.samples; ++k)
+                {
+                    if (p[k].z() == NO_DATA_VALUE)
+                        continue;
+
+                    // the earth bulges up into the sight line
+                    double t = (double)k / (double)line.samples;
+                    double d0 = t * line.length, d1 = line.length - d0;
+                    double bulge = effectiveRadius > 0.0 ? d0 * d1 / (2.0 * effectiveRadius) : 0.0;
+
+                    if (p[k].z() + bulge > z0 + (z1 - z0) * t)
+                    {
+                        line.query->visible = false;
+                        line.query->obstruction = GeoPoint(srs, p[k].x(), p[k].y(), p[k].z(), ALTMODE_ABSOLUTE);
+                        break;
+                    }
+                }
+                ++answered;
+            }
+        });
+    }
+    group.join();
+
+    if (progress && progress->isCanceled())
+        return -1;
+
+    return answered;
+}
+
+void
+Viewshed::computeVisibility(
+    int radius,
+    const std::vector<float>& elevation,
+    const std::vector<unsigned char>& valid,
+    double observerHeight,
+    double targetHeight,
+    std::vector<unsigned char>& visible)
+{
+    Grid grid(osg::maximum(radius, 0));
+    OE_SOFT_ASSERT_AND_RETURN(elevation.size() == grid.elev.size(), void());
+    OE_SOFT_ASSERT_AND_RETURN(valid.size() == grid.valid.size(), void());
+
+    grid.elev = elevation;
+    grid.valid = valid;
+
+    sweepGrid(grid, observerHeight, targetHeight, nullptr);
+
+    for (std::size_t i = 0; i < grid.visible.size(); ++i)
+        grid.visible[i] = grid.valid[i] ? grid.visible[i] : 0;
+
+    visible.swap(grid.visible);
+}
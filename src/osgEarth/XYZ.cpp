@@ -243,6 +243,8 @@ XYZImageLayer::createImageImplementation(const TileKey& key, ProgressCallback* p
 
     if (r.succeeded())
         return GeoImage(r.releaseImage(), key.getExtent());
+    else if (r.code() == ReadResult::RESULT_NOT_FOUND)
+        return GeoImage(Status(Status::NoData, r.errorDetail()));
     else
         return GeoImage(Status(r.errorDetail()));
 }
@@ -325,7 +327,6 @@ XYZElevationLayer::createHeightFieldImplementation(const TileKey& key, ProgressC
             return GeoHeightField(hf, key.getExtent());
         }
     }
-    
 
-    return GeoHeightField::INVALID;
+    return GeoHeightField(geoImage.getStatus());
 }
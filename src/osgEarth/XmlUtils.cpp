@@ -21,6 +21,9 @@
 
 #include "tinyxml.h"
 
+#include <algorithm>
+#include <cstring>
+
 
 using namespace osgEarth;
 using namespace osgEarth::Util;
@@ -551,3 +554,518 @@ XmlDocument::store( std::ostream& out ) const
 
     //out << doc;    
 }
+
+//........................................................................
+
+namespace
+{
+    // Reads XML text directly into a Config tree, one pass and no DOM.
+    // Mirrors what the tinyxml path above produces: lowercase tag and
+    // attribute names, attributes (sorted) before child elements, element
+    // text with whitespace condensed, CDATA kept verbatim, and xi:include
+    // elements replaced by the documents they reference.
+    class XmlConfigReader
+    {
+    public:
+        XmlConfigReader(const std::string& xml, const std::string& referrer) :
+            _begin(xml.c_str()),
+            _end(xml.c_str() + xml.size()),
+            _p(xml.c_str()),
+            _error(0L)
+        {
+            // resolve the referrer once, so each node can take it as-is
+            Config temp("temp");
+            temp.setReferrer(referrer);
+            _referrer = temp.referrer();
+        }
+
+        bool read(Config& document)
+        {
+            document = Config("Document");
+            document.setReferrer(_referrer);
+
+            // UTF-8 byte order mark
+            if (_end - _p >= 3 && (unsigned char)_p[0] == 0xEF && (unsigned char)_p[1] == 0xBB && (unsigned char)_p[2] == 0xBF)
+                _p += 3;
+
+            while (ok())
+            {
+                skipWhiteSpace();
+                if (_p >= _end)
+                    return fail("Document empty");
+                if (*_p != '<')
+                    return fail("Error parsing element");
+                if (startsWith("<?"))
+                    skipPast("?>");
+                else if (startsWith("<!--"))
+                    skipPast("-->");
+                else if (startsWith("<!"))
+                    skipDeclaration();
+                else
+                    return readElement(document) && ok();
+            }
+            return false;
+        }
+
+        // reports a parse failure the same way XmlDocument::load does
+        void report(const std::string& xml, const std::string& context) const
+        {
+            int row = 1, col = 1;
+            for (const char* c = _begin; c < _error && c < _end; ++c)
+            {
+                if (*c == '\n') ++row, col = 1;
+                else ++col;
+            }
+
+            std::stringstream buf;
+            buf << "XML parsing error";
+            if (!context.empty())
+                buf << " in \"" << context << "\"";
+            OE_WARN << buf.str() << std::endl;
+            OE_WARN << _message << " (row " << row << ", col " << col << ")" << std::endl;
+
+            StringVector output;
+            StringTokenizer lines(xml, output, "\n", "", true, false);
+            int startLine = osg::maximum(0, row - 12);
+            int endLine = osg::minimum((int)(output.size()) - 1, row + 4);
+            for (int i = startLine; i <= endLine; ++i)
+            {
+                OE_WARN << " " << i + 1 << (i + 1 == row ? " *" : "  ") << "\t" << output[i] << std::endl;
+            }
+        }
+
+    private:
+        const char* _begin;
+        const char* _end;
+        const char* _p;
+        const char* _error;
+        std::string _message;
+        std::string _referrer;
+
+        bool ok() const { return _error == 0L; }
+
+        bool fail(const char* message)
+        {
+            if (!_error)
+            {
+                _error = _p;
+                _message = message;
+            }
+            return false;
+        }
+
+        bool startsWith(const char* s) const
+        {
+            const char* p = _p;
+            while (*s && p < _end && *p == *s) ++p, ++s;
+            return *s == 0;
+        }
+
+        static bool isWhiteSpace(char c)
+        {
+            return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f' || c == '\v';
+        }
+
+        void skipWhiteSpace()
+        {
+            while (_p < _end && isWhiteSpace(*_p)) ++_p;
+        }
+
+        bool skipPast(const char* terminator)
+        {
+            std::size_t len = strlen(terminator);
+            while (_p < _end)
+            {
+                if (startsWith(terminator))
+                {
+                    _p += len;
+                    return true;
+                }
+                ++_p;
+            }
+            return fail("Unexpected end of document");
+        }
+
+        // <!DOCTYPE ...> and friends, which may nest <...> blocks
+        bool skipDeclaration()
+        {
+            int depth = 0;
+            for (++_p; _p < _end; ++_p)
+            {
+                if (*_p == '<') ++depth;
+                else if (*_p == '>' && depth-- == 0)
+                {
+                    ++_p;
+                    return true;
+                }
+            }
+            return fail("Unexpected end of document");
+        }
+
+        static bool isNameChar(char c)
+        {
+            return !isWhiteSpace(c) && c != '/' && c != '>' && c != '=' && c != '<';
+        }
+
+        bool readName(std::string& name)
+        {
+            const char* start = _p;
+            while (_p < _end && isNameChar(*_p)) ++_p;
+            if (_p == start)
+                return fail("Failed to read element name");
+            name.assign(start, _p);
+            return true;
+        }
+
+        static void appendUTF8(unsigned long c, std::string& out)
+        {
+            if (c < 0x80) out += (char)c;
+            else if (c < 0x800) { out += (char)(0xC0 | (c >> 6)); out += (char)(0x80 | (c & 0x3F)); }
+            else if (c < 0x10000) { out += (char)(0xE0 | (c >> 12)); out += (char)(0x80 | ((c >> 6) & 0x3F)); out += (char)(0x80 | (c & 0x3F)); }
+            else if (c < 0x200000) { out += (char)(0xF0 | (c >> 18)); out += (char)(0x80 | ((c >> 12) & 0x3F)); out += (char)(0x80 | ((c >> 6) & 0x3F)); out += (char)(0x80 | (c & 0x3F)); }
+        }
+
+        // Decodes the entity at _p (which points to '&') into out. Like
+        // tinyxml, a '&' that does not start a known entity is dropped.
+        void readEntity(std::string& out)
+        {
+            static const struct { const char* str; char chr; } entities[] = {
+                { "&amp;", '&' }, { "&lt;", '<' }, { "&gt;", '>' }, { "&quot;", '\"' }, { "&apos;", '\'' }
+            };
+
+            if (startsWith("&#"))
+            {
+                const char* p = _p + 2;
+                bool hex = p < _end && *p == 'x';
+                if (hex) ++p;
+                unsigned long code = 0;
+                const char* digits = p;
+                for (; p < _end && *p != ';'; ++p)
+                {
+                    char c = *p;
+                    int d =
+                        c >= '0' && c <= '9' ? c - '0' :
+                        hex && c >= 'a' && c <= 'f' ? c - 'a' + 10 :
+                        hex && c >= 'A' && c <= 'F' ? c - 'A' + 10 : -1;
+                    if (d < 0) break;
+                    code = code * (hex ? 16 : 10) + d;
+                }
+                if (p < _end && *p == ';' && p > digits)
+                {
+                    appendUTF8(code, out);
+                    _p = p + 1;
+                    return;
+                }
+            }
+            else
+            {
+                for (auto& e : entities)
+                {
+                    if (startsWith(e.str))
+                    {
+                        out += e.chr;
+                        _p += strlen(e.str);
+                        return;
+                    }
+                }
+            }
+
+            ++_p;
+        }
+
+        // Text up to the next '<', with runs of whitespace condensed to a
+        // single space and leading/trailing whitespace dropped.
+        void readText(std::string& out)
+        {
+            bool whitespace = false;
+            bool any = false;
+            while (_p < _end && *_p != '<')
+            {
+                if (isWhiteSpace(*_p))
+                {
+                    whitespace = true;
+                    ++_p;
+                    continue;
+                }
+                if (whitespace && any)
+                    out += ' ';
+                whitespace = false;
+                any = true;
+                if (*_p == '&')
+                    readEntity(out);
+                else
+                    out += *_p++;
+            }
+        }
+
+        bool readAttributeValue(std::string& value)
+        {
+            skipWhiteSpace();
+            if (_p >= _end)
+                return fail("Error reading attributes");
+
+            if (*_p != '\"' && *_p != '\'')
+            {
+                // unquoted, which tinyxml tolerates too
+                while (_p < _end && !isWhiteSpace(*_p) && *_p != '>' && !startsWith("/>"))
+                {
+                    if (*_p == '&')
+                        readEntity(value);
+                    else
+                        value += *_p++;
+                }
+                return true;
+            }
+
+            char quote = *_p++;
+            while (_p < _end && *_p != quote)
+            {
+                if (*_p == '&')
+                    readEntity(value);
+                else
+                    value += *_p++;
+            }
+            if (_p >= _end)
+                return fail("Error reading attributes");
+            ++_p;
+            return true;
+        }
+
+        bool readElement(Config& parent)
+        {
+            ++_p; // '<'
+            std::string rawName;
+            if (!readName(rawName))
+                return false;
+
+            // attributes; sorted and de-duplicated (last wins), like XmlAttributes
+            std::vector<std::pair<std::string, std::string> > attrs;
+            std::vector<std::string> rawAttrNames;
+            bool empty = false;
+            for (;;)
+            {
+                skipWhiteSpace();
+                if (_p >= _end)
+                    return fail("Error reading element");
+                if (startsWith("/>"))
+                {
+                    _p += 2;
+                    empty = true;
+                    break;
+                }
+                if (*_p == '>')
+                {
+                    ++_p;
+                    break;
+                }
+
+                std::string name;
+                if (!readName(name))
+                    return false;
+                for (auto& a : rawAttrNames)
+                    if (a == name)
+                        return fail("Error parsing element");
+                rawAttrNames.push_back(name);
+                skipWhiteSpace();
+                if (_p >= _end || *_p != '=')
+                    return fail("Error reading attributes");
+                ++_p;
+                attrs.emplace_back(osgEarth::toLower(name), std::string());
+                if (!readAttributeValue(attrs.back().second))
+                    return false;
+            }
+
+            std::stable_sort(attrs.begin(), attrs.end(),
+                [](const std::pair<std::string, std::string>& a, const std::pair<std::string, std::string>& b) {
+                    return a.first < b.first;
+                });
+
+            std::string name = osgEarth::toLower(rawName);
+
+            if (name == "xi:include")
+            {
+                if (!empty && !skipContent(rawName))
+                    return false;
+
+                std::string href;
+                for (auto& a : attrs)
+                    if (a.first == "href")
+                        href = a.second;
+
+                parent.add(include(href));
+                return true;
+            }
+
+            // build the node in place; no copies of subtrees
+            parent.children().push_back(Config(name));
+            Config& conf = parent.children().back();
+            conf.setReferrer(_referrer);
+
+            for (std::size_t i = 0; i < attrs.size(); ++i)
+            {
+                if (i + 1 < attrs.size() && attrs[i + 1].first == attrs[i].first)
+                    continue;
+                conf.children().push_back(Config(attrs[i].first, attrs[i].second));
+                conf.children().back().setReferrer(_referrer);
+            }
+
+            if (empty)
+                return true;
+
+            std::string text;
+            for (;;)
+            {
+                skipWhiteSpace();
+                if (_p >= _end)
+                    return fail("Error reading end tag");
+
+                if (*_p != '<')
+                {
+                    readText(text);
+                }
+                else if (startsWith("</"))
+                {
+                    _p += 2;
+                    std::string endName;
+                    if (!readName(endName))
+                        return false;
+                    if (endName != rawName)
+                        return fail("Error reading end tag");
+                    skipWhiteSpace();
+                    if (_p >= _end || *_p != '>')
+                        return fail("Error reading end tag");
+                    ++_p;
+                    break;
+                }
+                else if (startsWith("<![CDATA["))
+                {
+                    _p += 9;
+                    const char* start = _p;
+                    if (!skipPast("]]>"))
+                        return false;
+                    text.append(start, _p - 3);
+                }
+                else if (startsWith("<!--"))
+                {
+                    if (!skipPast("-->"))
+                        return false;
+                }
+                else if (startsWith("<?"))
+                {
+                    if (!skipPast("?>"))
+                        return false;
+                }
+                else if (startsWith("<!"))
+                {
+                    if (!skipDeclaration())
+                        return false;
+                }
+                else if (!readElement(conf))
+                {
+                    return false;
+                }
+            }
+
+            conf.setValue(trim(text));
+            return true;
+        }
+
+        // skips the content of an element whose start tag has been read
+        bool skipContent(const std::string& rawName)
+        {
+            Config scratch;
+            std::string text;
+            for (;;)
+            {
+                skipWhiteSpace();
+                if (_p >= _end)
+                    return fail("Error reading end tag");
+                if (startsWith("</"))
+                {
+                    _p += 2;
+                    std::string endName;
+                    if (!readName(endName) || endName != rawName)
+                        return fail("Error reading end tag");
+                    skipWhiteSpace();
+                    if (_p >= _end || *_p != '>')
+                        return fail("Error reading end tag");
+                    ++_p;
+                    return true;
+                }
+                else if (*_p != '<')
+                    readText(text);
+                else if (startsWith("<![CDATA["))
+                    { if (!skipPast("]]>")) return false; }
+                else if (startsWith("<!--"))
+                    { if (!skipPast("-->")) return false; }
+                else if (startsWith("<?"))
+                    { if (!skipPast("?>")) return false; }
+                else if (startsWith("<!"))
+                    { if (!skipDeclaration()) return false; }
+                else if (!readElement(scratch))
+                    return false;
+            }
+        }
+
+        Config include(const std::string& href) const
+        {
+            if (href.empty())
+            {
+                OE_WARN << "Missing href with xi:include" << std::endl;
+                return Config();
+            }
+
+            URI uri(href, URIContext(_referrer));
+            const std::string& fullURI = uri.full();
+            OE_DEBUG << "Loading href from " << fullURI << std::endl;
+
+            Config doc;
+            if (XmlDocument::readConfig(URI(fullURI), 0L, doc) && !doc.children().empty())
+            {
+                Config conf = doc.children().front();
+                conf.setExternalRef(href);
+                conf.setReferrer(fullURI);
+                return conf;
+            }
+            else
+            {
+                OE_WARN << "Failed to load xi:include from " << fullURI << std::endl;
+                return Config();
+            }
+        }
+    };
+}
+
+bool
+XmlDocument::readConfig( std::istream& in, const URIContext& uriContext, Config& output )
+{
+    std::stringstream buffer;
+    buffer << in.rdbuf();
+    const std::string xml = buffer.str();
+
+    XmlConfigReader reader(xml, URI("", uriContext).full());
+    if (!reader.read(output))
+    {
+        reader.report(xml, uriContext.referrer());
+        output = Config();
+        return false;
+    }
+    return true;
+}
+
+bool
+XmlDocument::readConfig( const URI& uri, const osgDB::Options* dbOptions, Config& output )
+{
+    ReadResult r = uri.readString( dbOptions );
+    if ( r.failed() )
+        return false;
+
+    XmlConfigReader reader(r.getString(), uri.full());
+    if (!reader.read(output))
+    {
+        reader.report(r.getString(), uri.full());
+        output = Config();
+        return false;
+    }
+    return true;
+}
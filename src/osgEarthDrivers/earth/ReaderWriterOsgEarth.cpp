@@ -222,12 +222,10 @@ class ReaderWriterEarth : public osgDB::ReaderWriter
             // from an "anonymous" stream here)
             URIContext uriContext( readOptions ); 
 
-            osg::ref_ptr<XmlDocument> doc = XmlDocument::load( in, uriContext );
-            if ( !doc.valid() )
+            Config docConf;
+            if ( !XmlDocument::readConfig( in, uriContext, docConf ) )
                 return ReadResult::ERROR_IN_READING_FILE;
 
-            Config docConf = doc->getConfig();
-
             // support both "map" and "earth" tag names at the top level
             Config conf;
             if ( docConf.hasChild( "map" ) )
@@ -63,7 +63,7 @@ DrawTileCommand::apply(
     }
 
     // MVM for this tile:
-    state.applyModelViewMatrix(_modelViewMatrix.get());
+    state.applyModelViewMatrix(*_modelViewMatrix);
 
     // MVM uniforms for GL3 core:
     if (state.getUseModelViewAndProjectionUniforms())
@@ -209,7 +209,7 @@ DrawTileCommand::debug(
 void
 DrawTileCommand::draw(osg::RenderInfo& ri) const
 {
-    OE_SOFT_ASSERT_AND_RETURN(_geom.valid(), void());
+    OE_SOFT_ASSERT_AND_RETURN(_geom != nullptr, void());
 
     _geom->_ptype[ri.getContextID()] = _drawPatch ? GL_PATCHES : _geom->getDrawElements()->getMode();
     _geom->draw(ri);
@@ -227,7 +227,7 @@ DrawTileCommand::visit(osg::RenderInfo& ri) const
         tileData._revision = _tileRevision;
         //tileData._geomBBox = &_geom->getBoundingBox();
         tileData._tileBBox = &_tile->getBoundingBox();
-        tileData._modelViewMatrix = _modelViewMatrix.get();
+        tileData._modelViewMatrix = _modelViewMatrix;
         _drawCallback->visitTile(ri, tileData);
     }
 }
@@ -235,7 +235,7 @@ DrawTileCommand::visit(osg::RenderInfo& ri) const
 
 void DrawTileCommand::accept(osg::PrimitiveFunctor& functor) const
 {
-    if (_geom.valid() && _geom->supports(functor))
+    if (_geom != nullptr && _geom->supports(functor))
     {
         _geom->accept(functor);
     }
@@ -243,7 +243,7 @@ void DrawTileCommand::accept(osg::PrimitiveFunctor& functor) const
 
 void DrawTileCommand::accept(osg::PrimitiveIndexFunctor& functor) const
 {
-    if (_geom.valid() && _geom->supports(functor))
+    if (_geom != nullptr && _geom->supports(functor))
     {
         _geom->accept(functor);
     }
@@ -20,6 +20,7 @@
 #include "TerrainRenderData"
 #include <osgEarth/Metrics>
 #include <sstream>
+#include <algorithm>
 
 using namespace osgEarth::REX;
 
@@ -43,6 +44,41 @@ _draw(true)
     _tiles.reserve(128);
 }
 
+void
+LayerDrawable::sortTiles()
+{
+    _order.resize(_tiles.size());
+    for (unsigned i = 0; i < _tiles.size(); ++i)
+    {
+        DrawTileSortKey& key = _order[i];
+        key._range = _tiles[i]._range;
+        key._index = i;
+        key._geom = _tiles[i]._geom;
+    }
+    std::sort(_order.begin(), _order.end());
+}
+
+void
+LayerDrawable::reset()
+{
+    _tiles.clear();
+    _order.clear();
+    _renderType = Layer::RENDERTYPE_TERRAIN_SURFACE;
+    _layer = 0L;
+    _visibleLayer = 0L;
+    _imageLayer = 0L;
+    _patchLayer = 0L;
+    _drawOrder = 0;
+    _clearOsgState = false;
+    _drawState = 0L;
+    _draw = true;
+    setName(std::string());
+    setStateSet(nullptr);
+
+    // bounds come from the new frame's DrawState
+    dirtyBound();
+}
+
 LayerDrawable::~LayerDrawable()
 {
     // Drawable's DTOR will release GL objects on any attached stateset;
@@ -91,8 +127,9 @@ LayerDrawable::drawImplementation(osg::RenderInfo& ri) const
     {
         TileBatch batch(_drawState.get());
         batch._tiles.reserve(_tiles.size());
-        for (auto& tile : _tiles)
+        forEachTileInDrawOrder([&](const DrawTileCommand& tile) {
             batch._tiles.push_back(&tile);
+        });
 
         _patchLayer->getRenderer()->draw(ri, batch);
     }
@@ -107,11 +144,11 @@ LayerDrawable::drawImplementation(osg::RenderInfo& ri) const
             ext->glUniform1i(pps._layerUidUL, uid);
         }
 
-        for (auto& tile : _tiles)
-        {
-            tile.apply(ri, _drawState.get());
+        DrawState* ds = _drawState.get();
+        forEachTileInDrawOrder([&](const DrawTileCommand& tile) {
+            tile.apply(ri, ds);
             tile.draw(ri);
-        }
+        });
     }
 
     // If set, dirty all OSG state to prevent any leakage - this is sometimes
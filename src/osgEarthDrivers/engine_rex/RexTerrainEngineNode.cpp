@@ -35,6 +35,7 @@
 #include <osgEarth/Metrics>
 #include <osgEarth/Elevation>
 #include <osgEarth/LandCover>
+#include <osgEarth/CameraUtils>
 
 #include <osg/Version>
 #include <osg/BlendFunc>
@@ -166,6 +167,12 @@ RexTerrainEngineNode::RexTerrainEngineNode() :
     _terrain = new osg::Group();
     addChild(_terrain.get());
 
+    // storage for cull output, recycled from frame to frame
+    _renderDataPool = new TerrainRenderDataPool();
+
+    // tiles selected for the primary view, shared with other cameras
+    _tileSelection = new TileSelection();
+
     // force an update traversal in order to compute layer extents.
     _cachedLayerExtentsComputeRequired = true;
     ADJUST_UPDATE_TRAV_COUNT(this, +1);
@@ -337,6 +344,14 @@ RexTerrainEngineNode::setMap(const Map* map, const TerrainOptions& inOptions)
     // Calculate the LOD morphing parameters:
     unsigned maxLOD = options().maxLOD().getOrUse(DEFAULT_MAX_LOD);
 
+    // the tile registry can only key tiles down to a certain depth
+    unsigned registryMaxLOD = TileNodeRegistry::getMaxLOD(map->getProfile());
+    if (maxLOD > registryMaxLOD)
+    {
+        OE_WARN << LC << "Max LOD " << maxLOD << " is too deep for this profile; using " << registryMaxLOD << std::endl;
+        maxLOD = registryMaxLOD;
+    }
+
     _selectionInfo.initialize(
         0u, // always zero, not the terrain options firstLOD
         maxLOD,
@@ -549,6 +564,9 @@ RexTerrainEngineNode::dirtyTerrain()
         _liveTiles->releaseAll(nullptr);
     }
 
+    // forget tiles the primary view selected from the old terrain:
+    _tileSelection->clear();
+
     // scrub the geometry pool:
     _geometryPool->clear();
 
@@ -639,10 +657,39 @@ RexTerrainEngineNode::cull_traverse(osg::NodeVisitor& nv)
     TerrainCuller culler(cv, this->getEngineContext());
 
     // Prepare the culler with the set of renderable layers:
-    culler.setup(getMap(), _cachedLayerExtents, this->getEngineContext()->getRenderBindings());
+    culler.setup(getMap(), _cachedLayerExtents, this->getEngineContext()->getRenderBindings(), _renderDataPool.get());
 
-    // Assemble the terrain drawables:
-    _terrain->accept(culler);
+    // Assemble the terrain drawables. A camera sharing the primary view's
+    // tile selection filters that; everyone else traverses the quadtree.
+    const osg::Camera* camera = cv->getCurrentCamera();
+    unsigned frame = _clock.getFrame();
+
+    std::shared_ptr<const TileSelection::Tiles> selection;
+    if (!culler._isSpy && CameraUtils::sharesTerrainSelection(camera))
+    {
+        selection = _tileSelection->get(frame);
+    }
+
+    if (selection)
+    {
+        culler.applySelection(*selection);
+    }
+    else
+    {
+        if (!culler._isSpy &&
+            CameraUtils::isPrimaryTerrainView(camera) &&
+            _tileSelection->isWanted(frame))
+        {
+            culler._selection = _tileSelection->beginRecording();
+        }
+
+        _terrain->accept(culler);
+
+        if (culler._selection)
+        {
+            _tileSelection->endRecording(frame);
+        }
+    }
 
     // If we're using geometry pooling, optimize the drawable for shared state
     // by sorting the draw commands.
@@ -34,7 +34,8 @@ _currentTileNode(0L),
 _orphanedPassesDetected(0u),
 _cv(cullVisitor),
 _context(context),
-_layerExtents(nullptr)
+_layerExtents(nullptr),
+_selection(nullptr)
 {
     setVisitorType(CULL_VISITOR);
     setTraversalMode(TRAVERSE_ALL_CHILDREN);
@@ -59,11 +60,15 @@ _layerExtents(nullptr)
 }
 
 void
-TerrainCuller::setup(const Map* map, LayerExtentMap& layerExtents, const RenderBindings& bindings)
+TerrainCuller::setup(
+    const Map* map,
+    LayerExtentMap& layerExtents,
+    const RenderBindings& bindings,
+    TerrainRenderDataPool* pool)
 {
     unsigned frameNum = getFrameStamp() ? getFrameStamp()->getFrameNumber() : 0u;
     _layerExtents = &layerExtents;
-    _terrain.setup(map, bindings, frameNum, _cv);
+    _terrain.setup(map, bindings, frameNum, _cv, pool);
 }
 
 float
@@ -92,8 +97,8 @@ TerrainCuller::addDrawCommand(UID uid, const TileRenderModel* model, const Rende
     }
 
     // add a new Draw command to the appropriate layer
-    osg::ref_ptr<LayerDrawable> drawable = _terrain.layer(uid);
-    if (drawable.valid())
+    LayerDrawable* drawable = _terrain.layer(uid);
+    if (drawable)
     {
         // Layer marked for drawing?
         if (drawable->_draw)
@@ -119,6 +124,7 @@ TerrainCuller::addDrawCommand(UID uid, const TileRenderModel* model, const Rende
             // install everything we need in the Draw Command:
             tile->_colorSamplers = pass ? &(pass->samplers()) : 0L;
             tile->_sharedSamplers = &model->_sharedSamplers;
+            // the surface matrix, which came from the frame's arena:
             tile->_modelViewMatrix = _cv->getModelViewMatrix();
             tile->_keyValue = tileNode->getTileKeyValue();
             tile->_geom = surface->getDrawable()->_geom.get();
@@ -196,7 +202,7 @@ TerrainCuller::apply(osg::Node& node)
 bool
 TerrainCuller::isCulledToBBox(osg::Transform* node, const osg::BoundingBox& box)
 {
-    osg::RefMatrix* matrix = createOrReuseMatrix(*_cv->getModelViewMatrix());
+    osg::RefMatrix* matrix = _terrain._drawState->createMatrix(*_cv->getModelViewMatrix());
     node->computeLocalToWorldMatrix(*matrix, this);
     _cv->pushModelViewMatrix(matrix, node->getReferenceFrame());
     bool culled = _cv->isCulled(box);
@@ -204,6 +210,31 @@ TerrainCuller::isCulledToBBox(osg::Transform* node, const osg::BoundingBox& box)
     return culled;
 }
 
+void
+TerrainCuller::applySelection(const TileSelection::Tiles& tiles)
+{
+    // The selection already settled the level of detail, so all that's left
+    // is the visibility test TileNode::traverse would do. Nothing here
+    // subdivides or loads; the primary view drives both.
+    osg::ref_ptr<TileNode> tile;
+    for (auto& entry : tiles)
+    {
+        // unloaded since the primary view selected it
+        if (!entry.lock(tile))
+            continue;
+
+        SurfaceNode* surface = tile->getSurfaceNode();
+        if (tile->isEmpty() || surface == nullptr)
+            continue;
+
+        if (isCulled(*tile) || !surface->isVisibleFrom(getViewPointLocal()))
+            continue;
+
+        apply(*tile);
+        surface->accept(*this);
+    }
+}
+
 void
 TerrainCuller::apply(TileNode& node)
 {
@@ -248,7 +279,7 @@ TerrainCuller::apply(TileNode& node)
             SurfaceNode* surface = node.getSurfaceNode();
                     
             // push the surface matrix:
-            osg::RefMatrix* matrix = createOrReuseMatrix(*_cv->getModelViewMatrix());
+            osg::RefMatrix* matrix = _terrain._drawState->createMatrix(*_cv->getModelViewMatrix());
             surface->computeLocalToWorldMatrix(*matrix,this);
             _cv->pushModelViewMatrix(matrix, surface->getReferenceFrame());
 
@@ -280,7 +311,7 @@ TerrainCuller::apply(SurfaceNode& node)
     float range = _cv->getDistanceToViewPoint(node.getBound().center(), true) - node.getBound().radius();
 
     // push the surface matrix:
-    osg::RefMatrix* matrix = createOrReuseMatrix(*getModelViewMatrix());
+    osg::RefMatrix* matrix = _terrain._drawState->createMatrix(*getModelViewMatrix());
     node.computeLocalToWorldMatrix(*matrix,this);
     _cv->pushModelViewMatrix(matrix, node.getReferenceFrame());
 
@@ -23,20 +23,80 @@
 #include <osgEarth/CameraUtils>
 
 using namespace osgEarth::REX;
+using namespace osgEarth::Threading;
 
 #undef  LC
 #define LC "[TerrainRenderData] "
 
 
+TerrainRenderDataPool::TerrainRenderDataPool() :
+    _mutex("TerrainRenderDataPool(OE)"),
+    _nextLayerDrawable(0u)
+{
+    //nop
+}
+
+osg::ref_ptr<DrawState>
+TerrainRenderDataPool::acquireDrawState(const RenderBindings* bindings)
+{
+    // the returned ref_ptr is what marks an object in use,
+    // so it must be taken under the lock
+    ScopedMutexLock lock(_mutex);
+
+    // idle drawables still point at the state they last drew with;
+    // let go so that state can be recycled too
+    for (auto& drawable : _layerDrawables)
+    {
+        if (drawable->referenceCount() == 1 && drawable->_drawState.valid())
+            drawable->reset();
+    }
+
+    for (auto& drawState : _drawStates)
+    {
+        if (drawState->referenceCount() == 1)
+        {
+            drawState->reset(bindings);
+            return drawState;
+        }
+    }
+
+    osg::ref_ptr<DrawState> drawState = new DrawState();
+    drawState->_bindings = bindings;
+    _drawStates.push_back(drawState);
+    return drawState;
+}
+
+osg::ref_ptr<LayerDrawable>
+TerrainRenderDataPool::acquireLayerDrawable()
+{
+    ScopedMutexLock lock(_mutex);
+
+    // start where the last search left off, since the drawables
+    // before that were most likely just handed out
+    for (std::size_t n = 0; n < _layerDrawables.size(); ++n)
+    {
+        std::size_t i = (_nextLayerDrawable + n) % _layerDrawables.size();
+        if (_layerDrawables[i]->referenceCount() == 1)
+        {
+            _nextLayerDrawable = i + 1;
+            _layerDrawables[i]->reset();
+            return _layerDrawables[i];
+        }
+    }
+
+    osg::ref_ptr<LayerDrawable> drawable = new LayerDrawable();
+    _layerDrawables.push_back(drawable);
+    _nextLayerDrawable = 0u;
+    return drawable;
+}
+
 unsigned
 TerrainRenderData::sortDrawCommands()
 {
     unsigned total = 0;
     for (LayerDrawableList::iterator i = _layerList.begin(); i != _layerList.end(); ++i)
     {
-        //TODO: review and benchmark list vs. vector vs. unsorted here.
-        DrawTileCommands& cmds = i->get()->_tiles;
-        std::sort(cmds.begin(), cmds.end());
+        i->get()->sortTiles();
         total += i->get()->_tiles.size();
     }
     return total;
@@ -46,13 +106,14 @@ void
 TerrainRenderData::setup(const Map* map,
                          const RenderBindings& bindings,
                          unsigned frameNum,
-                         osgUtil::CullVisitor* cv)
+                         osgUtil::CullVisitor* cv,
+                         TerrainRenderDataPool* pool)
 {
     _bindings = &bindings;
+    _pool = pool;
 
-    // Create a new State object to track sampler and uniform settings
-    _drawState = new DrawState();
-    _drawState->_bindings = &bindings;
+    // Get a State object to track sampler and uniform settings
+    _drawState = _pool->acquireDrawState(&bindings);
 
     // Is this a depth camera? Because if it is, we don't need any color layers.
     const osg::Camera* cam = cv->getCurrentCamera();
@@ -132,7 +193,7 @@ namespace
 LayerDrawable*
 TerrainRenderData::addLayerDrawable(const Layer* layer)
 {
-    LayerDrawable* drawable = new LayerDrawable();
+    osg::ref_ptr<LayerDrawable> drawable = _pool->acquireLayerDrawable();
     if (layer) {
         drawable->setName(layer->getName());
     }
@@ -143,7 +204,7 @@ TerrainRenderData::addLayerDrawable(const Layer* layer)
 
     if (layer)
     {
-        _layerMap[layer->getUID()] = drawable;
+        _layerMap.emplace_back(layer->getUID(), drawable.get());
 
         drawable->_layer = layer;
         drawable->_visibleLayer = dynamic_cast<const VisibleLayer*>(layer);
@@ -155,8 +216,8 @@ TerrainRenderData::addLayerDrawable(const Layer* layer)
     }
     else
     {
-        _layerMap[-1] = drawable;
+        _layerMap.emplace_back(-1, drawable.get());
     }
 
-    return drawable;
+    return drawable.get();
 }
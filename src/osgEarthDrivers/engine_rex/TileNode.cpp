@@ -426,6 +426,30 @@ TileNode::cull_spy(TerrainCuller* culler)
     return visible;
 }
 
+void
+TileNode::select_hidden(TerrainCuller* culler)
+{
+    if (_empty)
+        return;
+
+    // Only walk tiles that already exist, and don't touch them: the
+    // primary view can't see them, so they go dormant and unload as
+    // usual, and the selection falls back to their parent after that.
+    if (_childrenReady && shouldSubDivide(culler, _context->getSelectionInfo()))
+    {
+        for (int i = 0; i < 4; ++i)
+        {
+            TileNode* child = getSubTile(i);
+            if (child)
+                child->select_hidden(culler);
+        }
+    }
+    else
+    {
+        culler->_selection->push_back(this);
+    }
+}
+
 bool
 TileNode::cull(TerrainCuller* culler)
 {
@@ -519,6 +543,9 @@ TileNode::cull(TerrainCuller* culler)
     if ( canAcceptSurface )
     {
         _surface->accept( *culler );
+
+        if (culler->_selection)
+            culler->_selection->push_back(this);
     }
 
     // If this tile is marked dirty, try loading data.
@@ -568,6 +595,12 @@ TileNode::traverse(osg::NodeVisitor& nv)
             {
                 cull(culler);
             }
+
+            else if (culler->_selection)
+            {
+                // primary view can't see this tile, but others might
+                select_hidden(culler);
+            }
         }
     }
 
@@ -1080,6 +1113,9 @@ TileNode::merge(
         _context->getEngine()->getTerrain()->notifyTileUpdate(getKey(), this);
     }
 
+    // Account for the new data in the global memory budget.
+    _context->liveTiles()->updateResidency(this);
+
     // Bump the data revision for the tile.
     ++_revision;
 }
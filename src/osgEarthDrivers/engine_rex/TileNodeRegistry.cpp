@@ -19,6 +19,8 @@
 #include "TileNodeRegistry"
 
 #include <osgEarth/Metrics>
+#include <osgEarth/Registry>
+#include <functional>
 
 using namespace osgEarth::REX;
 using namespace osgEarth;
@@ -28,8 +30,6 @@ using namespace osgEarth;
 #define OE_TEST OE_NULL
 //#define OE_TEST OE_INFO
 
-#define SENTRY_VALUE NULL
-
 #define PROFILING_REX_TILES "Live Terrain Tiles"
 
 //----------------------------------------------------------------------------
@@ -41,8 +41,11 @@ _notifyNeighbors   ( false ),
 _firstLOD          ( 0u ),
 _mutex("TileNodeRegistry(OE)")
 {
-    _tracker.push_front(SENTRY_VALUE);
-    _sentryptr = _tracker.begin();
+    _residencySubsystem = osgEarth::Registry::residencyManager()->addSubsystem("Terrain");
+
+    _sentry._tile = nullptr;
+    _sentry._residency = 0u;
+    _tracker.push_front(&_sentry);
 }
 
 TileNodeRegistry::~TileNodeRegistry()
@@ -50,6 +53,35 @@ TileNodeRegistry::~TileNodeRegistry()
     releaseAll(NULL);
 }
 
+std::uint64_t
+TileNodeRegistry::pack(const TileKey& key)
+{
+    // A leading 1 bit, then the index of the root tile the key descends
+    // from, then LOD bits each of X and Y within that root tile. Every
+    // LOD gets its own range of values, above those of coarser LODs.
+    unsigned w, h;
+    key.getProfile()->getNumTiles(0u, w, h);
+    const unsigned lod = key.getLOD();
+    const std::uint64_t mask = (1ull << lod) - 1ull;
+    const std::uint64_t root = (std::uint64_t)(key.getTileY() >> lod) * w + (key.getTileX() >> lod);
+    return
+        (((std::uint64_t)w * h + root) << (2u * lod)) |
+        (((std::uint64_t)key.getTileX() & mask) << lod) |
+        ((std::uint64_t)key.getTileY() & mask);
+}
+
+unsigned
+TileNodeRegistry::getMaxLOD(const Profile* profile)
+{
+    // keys stay below 2^63, clear of the table's reserved ~0
+    unsigned w, h;
+    profile->getNumTiles(0u, w, h);
+    unsigned bits = 0u;
+    while ((1ull << bits) < 2ull * w * h)
+        ++bits;
+    return bits < 63u ? (63u - bits) / 2u : 0u;
+}
+
 void
 TileNodeRegistry::setRevisioningEnabled(bool value)
 {
@@ -76,12 +108,12 @@ TileNodeRegistry::setMapRevision(const Revision& rev,
             {
                 _maprev = rev;
 
-                for( TileTable::iterator i = _tiles.begin(); i != _tiles.end(); ++i )
+                if ( setToDirty )
                 {
-                    if ( setToDirty )
+                    _tiles.forEach([](std::uint64_t, osg::ref_ptr<TileNode>& tile)
                     {
-                        i->second._tile->refreshAllLayers();
-                    }
+                        tile->refreshAllLayers();
+                    });
                 }
             }
 
@@ -98,17 +130,17 @@ TileNodeRegistry::setDirty(const GeoExtent& extent,
 {
     _mutex.lock();
     
-    for( TileTable::iterator i = _tiles.begin(); i != _tiles.end(); ++i )
+    _tiles.forEach([&](std::uint64_t, osg::ref_ptr<TileNode>& tile)
     {
-        const TileKey& key = i->first;
+        const TileKey& key = tile->getKey();
 
         if (minLevel <= key.getLOD() && 
             maxLevel >= key.getLOD() &&
             (extent.isInvalid() || extent.intersects(key.getExtent())))
         {
-            i->second._tile->refreshLayers(manifest);
+            tile->refreshLayers(manifest);
         }
-    }
+    });
 
     _mutex.unlock();
 }
@@ -124,35 +156,36 @@ TileNodeRegistry::add(TileNode* tile)
     // not yet itself been removed by the Unloader. So we have to check!
 
     bool recyclingOrphan = false;
-    TrackerEntry* se;
-    TableEntry* te;
 
-    TileTable::iterator i = _tiles.find(tile->getKey());
-    if (i != _tiles.end())
+    osg::ref_ptr<TileNode>& entry = _tiles[pack(tile->getKey())];
+    if (entry.valid())
     {
-        // found an orphan! Reuse and overwrite it.
+        // found an orphan! Overwrite it.
         recyclingOrphan = true;
-        te = &i->second;
-        se = (*te->_trackerptr);
-        _tracker.erase(te->_trackerptr); // since we need to move it to the front
+
+        TileTrackerEntry& orphan = entry->trackerEntry();
+        if (orphan.linked())
+            _tracker.remove(&orphan);
+
+        // the orphan's data no longer counts against the memory budget
+        if (orphan._residency != 0u)
+            osgEarth::Registry::residencyManager()->remove(orphan._residency);
+        orphan._residency = 0u;
+
         OE_DEBUG << "Reused orphaned tile record " << tile->getKey().str() << std::endl;
     }
-    else
-    {
-        te = &_tiles[tile->getKey()];
-        se = new TrackerEntry();
-    }
 
     // init the tracker entry and place it at the front of the tracker:
-    se->_tile = tile;
-    se->_lastTime = DBL_MAX;
-    se->_lastFrame = ~0;
-    se->_lastRange = FLT_MAX;
-    _tracker.push_front(se);
+    TileTrackerEntry& se = tile->trackerEntry();
+    se._tile = tile;
+    se._lastTime = DBL_MAX;
+    se._lastFrame = ~0;
+    se._lastRange = FLT_MAX;
+    se._residency = 0u;
+    _tracker.push_front(&se);
 
     // init the table entry:
-    te->_tile = tile;
-    te->_trackerptr = _tracker.begin();
+    entry = tile;
     
     // Start waiting on our neighbors.
     // (If we're recycling and orphaned record, we need to remove old listeners first)
@@ -171,17 +204,17 @@ TileNodeRegistry::add(TileNode* tile)
         startListeningFor(key.createNeighborKey(0, 1), tile);
 
         // check for tiles that are waiting on this tile, and notify them!
-        TileKeyOneToMany::iterator notifier = _notifiers.find( tile->getKey() );
+        TileKeyOneToMany::iterator notifier = _notifiers.find( pack(key) );
         if ( notifier != _notifiers.end() )
         {
             TileKeySet& listeners = notifier->second;
 
             for(TileKeySet::iterator listener = listeners.begin(); listener != listeners.end(); ++listener)
             {
-                TileTable::iterator i = _tiles.find( *listener );
-                if ( i != _tiles.end())
+                osg::ref_ptr<TileNode>* i = _tiles.find( *listener );
+                if ( i )
                 {
-                    i->second._tile->notifyOfArrival( tile );
+                    (*i)->notifyOfArrival( tile );
                 }
             }
             _notifiers.erase( notifier );
@@ -201,10 +234,10 @@ TileNodeRegistry::startListeningFor(const TileKey& tileToWaitFor, TileNode* wait
 {
     // ASSUME EXCLUSIVE LOCK
 
-    TileTable::iterator i = _tiles.find(tileToWaitFor);
-    if (i != _tiles.end())
+    osg::ref_ptr<TileNode>* i = _tiles.find(pack(tileToWaitFor));
+    if (i)
     {
-        TileNode* tile = i->second._tile.get();
+        TileNode* tile = i->get();
 
         OE_DEBUG << LC << waiter->getKey().str() << " listened for " << tileToWaitFor.str()
             << ", but it was already in the repo.\n";
@@ -214,7 +247,7 @@ TileNodeRegistry::startListeningFor(const TileKey& tileToWaitFor, TileNode* wait
     else
     {
         OE_DEBUG << LC << waiter->getKey().str() << " listened for " << tileToWaitFor.str() << ".\n";
-        _notifiers[tileToWaitFor].insert( waiter->getKey() );
+        _notifiers[pack(tileToWaitFor)].insert( pack(waiter->getKey()) );
     }
 }
 
@@ -223,11 +256,11 @@ TileNodeRegistry::stopListeningFor(const TileKey& tileToWaitFor, const TileKey&
 {
     // ASSUME EXCLUSIVE LOCK
 
-    TileKeyOneToMany::iterator i = _notifiers.find(tileToWaitFor);
+    TileKeyOneToMany::iterator i = _notifiers.find(pack(tileToWaitFor));
     if (i != _notifiers.end())
     {
         // remove the waiter from this set:
-        i->second.erase(waiterKey);
+        i->second.erase(pack(waiterKey));
 
         // if the set is now empty, remove the set entirely
         if (i->second.empty())
@@ -242,20 +275,22 @@ TileNodeRegistry::releaseAll(osg::State* state)
 {
     ScopedMutexLock lock(_mutex);
 
-    for (auto& tile : _tiles)
+    // unlink everything before the table lets go of the tiles
+    for (Util::IntrusiveListNode* i = _tracker.front(); i != nullptr; i = _tracker.next(i))
     {
-        tile.second._tile->releaseGLObjects(state);
+        TileTrackerEntry* e = static_cast<TileTrackerEntry*>(i);
+        if (e->_residency != 0u)
+            osgEarth::Registry::residencyManager()->remove(e->_residency);
+        e->_residency = 0u;
     }
-    _tiles.clear();
+    _tracker.clear();
+    _tracker.push_front(&_sentry);
 
-    for (Tracker::iterator i = _tracker.begin(); i != _tracker.end(); ++i)
+    _tiles.forEach([state](std::uint64_t, osg::ref_ptr<TileNode>& tile)
     {
-        TrackerEntry* e = *i;
-        delete e;
-    }
-    _tracker.clear();
-    _tracker.push_front(SENTRY_VALUE);
-    _sentryptr = _tracker.begin();
+        tile->releaseGLObjects(state);
+    });
+    _tiles.clear();
 
     _notifiers.clear();
 
@@ -269,30 +304,34 @@ TileNodeRegistry::touch(TileNode* tile, osg::NodeVisitor& nv)
 {
     ScopedMutexLock lock(_mutex);
 
-    // Find the tracker for this tile and update its timestamp
-    TileTable::iterator i = _tiles.find(tile->getKey());
-    if (i != _tiles.end())
+    // The tracker entry lives in the tile, so there's nothing to look up;
+    // an unlinked entry means the tile isn't (or is no longer) registered.
+    TileTrackerEntry& se = tile->trackerEntry();
+    if (se.linked())
     {
-        TableEntry& e = i->second;
-        TrackerEntry* se = (*e._trackerptr);
-        se->_lastTime = _clock->getTime();
-        se->_lastFrame = _clock->getFrame();
+        se._lastTime = _clock->getTime();
+        se._lastFrame = _clock->getFrame();
 
         const osg::BoundingSphere& bs = tile->getBound();
         float range = nv.getDistanceToViewPoint(bs.center(), true) - bs.radius();
-        se->_lastRange = osg::minimum(se->_lastRange, range);
+        se._lastRange = osg::minimum(se._lastRange, range);
 
         // Move the tracker to the front of the list (ahead of the sentry).
         // Once a cull traversal is complete, all visited tiles will be
         // in front of the sentry, leaving all non-visited tiles behind it.
-        _tracker.erase(e._trackerptr);
-        _tracker.push_front(se);
-        e._trackerptr = _tracker.begin();
+        _tracker.move_to_front(&se);
+
+        if (se._residency != 0u && nv.getFrameStamp())
+        {
+            osgEarth::Registry::residencyManager()->touch(
+                se._residency,
+                nv.getFrameStamp()->getFrameNumber());
+        }
 
         // Does it need an update traversal?
         if (tile->updateRequired())
         {
-            _tilesToUpdate.push_back(tile->getKey());
+            _tilesToUpdate.push_back(pack(tile->getKey()));
         }
     }
     else
@@ -301,6 +340,29 @@ TileNodeRegistry::touch(TileNode* tile, osg::NodeVisitor& nv)
     }
 }
 
+void
+TileNodeRegistry::updateResidency(TileNode* tile)
+{
+    ScopedMutexLock lock(_mutex);
+
+    // nothing to account for without a budget
+    ResidencyManager* residency = osgEarth::Registry::residencyManager();
+    if (!residency->isEnabled())
+        return;
+
+    TileTrackerEntry& se = tile->trackerEntry();
+    if (se.linked())
+    {
+        std::size_t cpuBytes, gpuBytes;
+        tile->renderModel().getMemoryUsage(cpuBytes, gpuBytes);
+
+        if (se._residency == 0u)
+            se._residency = residency->add(_residencySubsystem, tile, cpuBytes, gpuBytes);
+        else
+            residency->update(se._residency, cpuBytes, gpuBytes);
+    }
+}
+
 void
 TileNodeRegistry::update(osg::NodeVisitor& nv)
 {
@@ -310,20 +372,18 @@ TileNodeRegistry::update(osg::NodeVisitor& nv)
     {
         // Sorting these from high to low LOD will reduce the number 
         // of inheritance steps each updated image will have to perform
-        // against the tile's children
+        // against the tile's children. (Deeper LODs have higher keys.)
         std::sort(
             _tilesToUpdate.begin(),
             _tilesToUpdate.end(),
-            [](const TileKey& lhs, const TileKey& rhs) {
-                return lhs.getLOD() > rhs.getLOD();
-            });
+            std::greater<std::uint64_t>());
 
-        for (auto& key : _tilesToUpdate)
+        for (auto key : _tilesToUpdate)
         {
-            auto iter = _tiles.find(key);
-            if (iter != _tiles.end())
+            osg::ref_ptr<TileNode>* tile = _tiles.find(key);
+            if (tile)
             {
-                iter->second._tile->update(nv);
+                (*tile)->update(nv);
             }
         }
 
@@ -344,16 +404,46 @@ TileNodeRegistry::collectDormantTiles(
 
     unsigned count = 0u;
 
+    // First honor the global memory budget: the ResidencyManager may want
+    // idle tiles unloaded sooner than the age/range thresholds allow.
+    ResidencyManager* residency = osgEarth::Registry::residencyManager();
+    if (nv.getFrameStamp() && residency->isEnabled())
+    {
+        unsigned frame = nv.getFrameStamp()->getFrameNumber();
+
+        residency->collect(_residencySubsystem, frame, maxTiles, _evictions);
+
+        for (auto& ref : _evictions)
+        {
+            TileNode* tile = dynamic_cast<TileNode*>(ref.get());
+            if (!tile || !tile->trackerEntry().linked())
+                continue;
+
+            if (count < maxTiles &&
+                tile->getDoNotExpire() == false &&
+                tile->areSiblingsDormant())
+            {
+                removeDormantTile(tile, output);
+                ++count;
+            }
+            else
+            {
+                residency->touch(tile->trackerEntry()._residency, frame);
+            }
+        }
+        _evictions.clear();
+    }
+
     // After cull, all visited tiles are in front of the sentry, and all
     // non-visited tiles are behind it. Start at the sentry position and
     // iterate over the non-visited tiles, checking them for deletion.
-    Tracker::iterator i = _sentryptr;
-    Tracker::iterator tmp;
-    for(++i; i != _tracker.end() && count < maxTiles; ++i)
+    Util::IntrusiveListNode* next;
+    for (Util::IntrusiveListNode* i = _tracker.next(&_sentry); i != nullptr && count < maxTiles; i = next)
     {
-        TrackerEntry* se = *i;
+        // grab the next link now, since removal unlinks this one:
+        next = _tracker.next(i);
 
-        const TileKey& key = se->_tile->getKey();
+        TileTrackerEntry* se = static_cast<TileTrackerEntry*>(i);
 
         if (se->_tile->getDoNotExpire() == false &&
             se->_lastTime < oldestAllowableTime &&
@@ -361,26 +451,7 @@ TileNodeRegistry::collectDormantTiles(
             se->_lastRange > farthestAllowableRange &&
             se->_tile->areSiblingsDormant())
         {
-            if (_notifyNeighbors)
-            {
-                // remove neighbor listeners:
-                stopListeningFor(key.createNeighborKey(1, 0), key);
-                stopListeningFor(key.createNeighborKey(0, 1), key);
-            }
-
-            // back up the iterator so we can safely erase the tracker entry:
-            tmp = i;
-            --i;
-
-            // put the tile on the output list:
-            output.push_back(se->_tile);
-
-            // remove it from the main tile table:
-            _tiles.erase(key);
-
-            // remove it from the tracker list:
-            _tracker.erase(tmp);
-            delete se;
+            removeDormantTile(se->_tile, output);
 
             ++count;
         }
@@ -392,9 +463,7 @@ TileNodeRegistry::collectDormantTiles(
     }
 
     // reset the sentry.
-    _tracker.erase(_sentryptr);
-    _tracker.push_front(SENTRY_VALUE);
-    _sentryptr =_tracker.begin();
+    _tracker.move_to_front(&_sentry);
 
     OE_PROFILING_PLOT(PROFILING_REX_TILES, (float)(_tiles.size()));
 }
@@ -406,11 +475,43 @@ TileNodeRegistry::get(const TileKey& key) const
 
     osg::ref_ptr<TileNode> result;
 
-    auto iter = _tiles.find(key);
-    if (iter != _tiles.end())
+    const osg::ref_ptr<TileNode>* tile = _tiles.find(pack(key));
+    if (tile)
     {
-        result = iter->second._tile.get();
+        result = tile->get();
     }
 
     return result;
 }
+
+void
+TileNodeRegistry::removeDormantTile(
+    TileNode* tile,
+    std::vector<osg::observer_ptr<TileNode>>& output)
+{
+    // ASSUME EXCLUSIVE LOCK
+
+    const TileKey key = tile->getKey();
+    TileTrackerEntry& se = tile->trackerEntry();
+
+    if (_notifyNeighbors)
+    {
+        // remove neighbor listeners:
+        stopListeningFor(key.createNeighborKey(1, 0), key);
+        stopListeningFor(key.createNeighborKey(0, 1), key);
+    }
+
+    if (se._residency != 0u)
+    {
+        osgEarth::Registry::residencyManager()->remove(se._residency);
+        se._residency = 0u;
+    }
+
+    // put the tile on the output list:
+    output.push_back(tile);
+
+    // remove it from the tracker list, then from the main tile table
+    // (which may release the last reference to the tile):
+    _tracker.remove(&se);
+    _tiles.erase(pack(key));
+}
@@ -0,0 +1,161 @@
+/* -*-c++-*- */
+/* osgEarth - Geospatial SDK for OpenSceneGraph
+* Copyright 2020 Pelican Mapping
+* http://osgearth.org
+*
+* osgEarth is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#include <osgEarth/catch.hpp>
+
+#include <osgEarth/TileVisitor>
+#include <osgEarth/SeedJournal>
+#include <osgEarth/FileUtils>
+#include <osgEarth/Profile>
+#include <osgEarth/Threading>
+#include <map>
+
+using namespace osgEarth;
+using namespace osgEarth::Util;
+
+namespace
+{
+    // Records every key it sees; optionally "kills" the run after N tiles.
+    struct RecordingHandler : public TileHandler
+    {
+        std::map<TileKey, int>& _seen;
+        ProgressCallback* _killer;
+        unsigned _killAfter;
+        unsigned _count;
+        Threading::Mutex _mutex;
+
+        RecordingHandler(std::map<TileKey, int>& seen, ProgressCallback* killer, unsigned killAfter) :
+            _seen(seen), _killer(killer), _killAfter(killAfter), _count(0u) { }
+
+        bool handleTile(const TileKey& key, const TileVisitor& tv) override
+        {
+            Threading::ScopedMutexLock lock(_mutex);
+            _seen[key]++;
+            if (_killer && ++_count == _killAfter)
+                _killer->cancel();
+            return true;
+        }
+    };
+}
+
+TEST_CASE("CacheSeed")
+{
+    osg::ref_ptr<const Profile> profile = Profile::create(Profile::GLOBAL_GEODETIC);
+    std::string path = getTempName("seed_journal_test");
+
+    // LODs 0-3 of a 2x1 root profile = 170 tiles; a unit depth of 1
+    // gives 44 units of at most 4 tiles each.
+    const unsigned totalTiles = 2 + 8 + 32 + 128;
+
+    SECTION("Killed run resumes from the journal")
+    {
+        std::map<TileKey, int> first, second;
+
+        {
+            osg::ref_ptr<ProgressCallback> progress = new ProgressCallback();
+            osg::ref_ptr<JournaledTileVisitor> v = new JournaledTileVisitor(
+                path, new RecordingHandler(first, progress.get(), 50u));
+            v->getJournal()->setUnitDepth(1u);
+            v->setMinLevel(0u);
+            v->setMaxLevel(3u);
+            v->setProgressCallback(progress.get());
+            v->run(profile.get());
+
+            REQUIRE(first.size() == 50u);
+            REQUIRE(v->getJournal()->getUnits().size() == 44u);
+            REQUIRE(!v->getJournal()->isComplete());
+        }
+
+        osg::ref_ptr<JournaledTileVisitor> v = new JournaledTileVisitor(
+            path, new RecordingHandler(second, nullptr, 0u));
+        v->getJournal()->setUnitDepth(1u);
+        v->setMinLevel(0u);
+        v->setMaxLevel(3u);
+        v->run(profile.get());
+
+        REQUIRE(v->getJournal()->isComplete());
+
+        // every tile was seeded, and only the interrupted unit was redone
+        std::map<TileKey, int> all = first;
+        for (auto& i : second)
+            all[i.first] += i.second;
+        REQUIRE(all.size() == totalTiles);
+        REQUIRE(first.size() + second.size() - totalTiles < 4u);
+
+        std::map<unsigned, SeedJournal::Throughput> perLOD;
+        v->getJournal()->getThroughput(perLOD);
+        REQUIRE(perLOD[3]._tiles == 128u);
+        REQUIRE(perLOD[3]._units == 32u);
+    }
+
+    SECTION("Threads split the units without overlap")
+    {
+        std::map<TileKey, int> seen;
+
+        osg::ref_ptr<JournaledTileVisitor> v = new JournaledTileVisitor(
+            path, new RecordingHandler(seen, nullptr, 0u));
+        v->getJournal()->setUnitDepth(1u);
+        v->setMinLevel(0u);
+        v->setMaxLevel(3u);
+        v->setNumThreads(4u);
+        v->run(profile.get());
+
+        REQUIRE(v->getJournal()->isComplete());
+        REQUIRE(seen.size() == totalTiles);
+        for (auto& i : seen)
+            REQUIRE(i.second == 1);
+    }
+
+    SECTION("Claims are per journal, not per process")
+    {
+        // two workers in one process must not claim the same unit
+        osg::ref_ptr<SeedJournal> a = new SeedJournal(path);
+        osg::ref_ptr<SeedJournal> b = new SeedJournal(path);
+        a->setUnitDepth(1u);
+        b->setUnitDepth(1u);
+        REQUIRE(a->open(profile.get(), 0u, 3u, {}).isOK());
+        REQUIRE(b->open(profile.get(), 0u, 3u, {}).isOK());
+
+        SeedJournal::WorkUnit unitA, unitB;
+        REQUIRE(a->claim(unitA));
+        REQUIRE(b->claim(unitB));
+        REQUIRE(unitA._id != unitB._id);
+
+        // each sees what the other has finished
+        REQUIRE(!a->isComplete());
+        b->complete(unitB, 0u, 0.0);
+        std::map<unsigned, SeedJournal::Throughput> perLOD;
+        a->getThroughput(perLOD);
+        REQUIRE(perLOD[unitB._lod]._units == 1u);
+
+        a->release(unitA);
+    }
+
+    SECTION("Journal rejects different parameters")
+    {
+        osg::ref_ptr<SeedJournal> journal = new SeedJournal(path);
+        REQUIRE(journal->open(profile.get(), 0u, 2u, {}).isOK());
+
+        osg::ref_ptr<SeedJournal> other = new SeedJournal(path);
+        REQUIRE(other->open(profile.get(), 0u, 3u, {}).isError());
+    }
+}
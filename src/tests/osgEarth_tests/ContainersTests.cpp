@@ -0,0 +1,82 @@
+/* -*-c++-*- */
+/* osgEarth - Geospatial SDK for OpenSceneGraph
+* Copyright 2020 Pelican Mapping
+* http://osgearth.org
+*
+* osgEarth is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#include <osgEarth/catch.hpp>
+
+#include <osgEarth/Containers>
+
+using namespace osgEarth::Util;
+
+TEST_CASE("OpenHashMap")
+{
+    OpenHashMap<int> map;
+
+    // enough to force a few rehashes:
+    for (int i = 0; i < 1000; ++i)
+        map[(std::uint64_t)i * 7919u] = i;
+    REQUIRE(map.size() == 1000u);
+    REQUIRE(map.find(7919u * 500u) != nullptr);
+    REQUIRE(*map.find(7919u * 500u) == 500);
+    REQUIRE(map.find(3u) == nullptr);
+
+    // erasing shifts the rest of a probe run back; all must stay reachable
+    for (int i = 0; i < 1000; i += 2)
+        REQUIRE(map.erase((std::uint64_t)i * 7919u));
+    REQUIRE(!map.erase(0u));
+    REQUIRE(map.size() == 500u);
+    for (int i = 1; i < 1000; i += 2)
+        REQUIRE(map.find((std::uint64_t)i * 7919u) != nullptr);
+
+    int sum = 0;
+    map.forEach([&](std::uint64_t, int& value) { sum += value; });
+    REQUIRE(sum == 250000);
+
+    map.clear();
+    REQUIRE(map.empty());
+}
+
+TEST_CASE("IntrusiveList")
+{
+    IntrusiveListNode a, b, c;
+    IntrusiveList list;
+    REQUIRE(list.empty());
+
+    list.push_front(&a);
+    list.push_front(&b);
+    list.push_front(&c);
+    REQUIRE(list.front() == &c);
+    REQUIRE(list.next(&c) == &b);
+    REQUIRE(list.next(&a) == nullptr);
+
+    list.move_to_front(&a);
+    REQUIRE(list.front() == &a);
+    REQUIRE(list.next(&a) == &c);
+
+    list.remove(&c);
+    REQUIRE(!c.linked());
+    REQUIRE(list.next(&a) == &b);
+
+    list.clear();
+    REQUIRE(list.empty());
+    REQUIRE(!a.linked());
+    REQUIRE(!b.linked());
+}
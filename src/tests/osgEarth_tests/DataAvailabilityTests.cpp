@@ -0,0 +1,174 @@
+/* -*-c++-*- */
+/* osgEarth - Geospatial SDK for OpenSceneGraph
+* Copyright 2020 Pelican Mapping
+* http://osgearth.org
+*
+* osgEarth is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#include <osgEarth/catch.hpp>
+
+#include <osgEarth/DataAvailability>
+#include <osgEarth/Profile>
+#include <osgEarth/ImageLayer>
+
+using namespace osgEarth;
+
+namespace
+{
+    // Image layer that fails with a chosen status, or returns an image
+    // when the status is OK, and counts its reads
+    class ScriptedImageLayer : public ImageLayer
+    {
+    public:
+        META_Layer(osgEarth, ScriptedImageLayer, Options, ImageLayer, scriptedimage);
+
+        void setResult(const Status& value) { _result = value; }
+
+        unsigned getNumReads() const { return _reads; }
+
+        Status openImplementation() override
+        {
+            Status parent = ImageLayer::openImplementation();
+            if (parent.isError())
+                return parent;
+
+            setProfile(Profile::create(Profile::GLOBAL_GEODETIC));
+            return Status::NoError;
+        }
+
+        GeoImage createImageImplementation(const TileKey& key, ProgressCallback* progress) const override
+        {
+            ++_reads;
+            if (_result.isError())
+                return GeoImage(_result);
+
+            osg::ref_ptr<osg::Image> image = new osg::Image();
+            image->allocateImage(4, 4, 1, GL_RGBA, GL_UNSIGNED_BYTE);
+            return GeoImage(image.get(), key.getExtent());
+        }
+
+    protected:
+        void init() override
+        {
+            ImageLayer::init();
+            _reads = 0u;
+            options().cachePolicy() = CachePolicy::NO_CACHE;
+        }
+
+    private:
+        Status _result;
+        mutable unsigned _reads;
+    };
+}
+
+TEST_CASE("DataAvailability")
+{
+    osg::ref_ptr<const Profile> profile = Profile::create(Profile::GLOBAL_GEODETIC);
+    osg::ref_ptr<DataAvailability> index = new DataAvailability(profile.get());
+
+    SECTION("Recorded keys")
+    {
+        TileKey key(5, 10, 12, profile.get());
+        REQUIRE(index->get(key) == DataAvailability::UNKNOWN);
+
+        index->set(key, DataAvailability::NO_DATA);
+        REQUIRE(index->isEmpty(key));
+        REQUIRE(index->get(key.createChildKey(0)) == DataAvailability::UNKNOWN);
+        REQUIRE(index->getNumChanges() == 1u);
+
+        index->set(key, DataAvailability::UNKNOWN);
+        REQUIRE(!index->isEmpty(key));
+        REQUIRE(index->size() == 0u);
+    }
+
+    SECTION("Coverage marks empty subtrees")
+    {
+        DataExtentList extents;
+        extents.push_back(DataExtent(GeoExtent(profile->getSRS(), 10, 10, 20, 20)));
+        index->addCoverage(extents, 3u);
+
+        // western hemisphere root and everything under it:
+        TileKey west(0, 0, 0, profile.get());
+        REQUIRE(index->get(west) == DataAvailability::EMPTY_SUBTREE);
+        REQUIRE(index->isEmpty(TileKey(12, 5, 900, profile.get())));
+
+        // keys overlapping the coverage stay unknown:
+        TileKey east(0, 1, 0, profile.get());
+        REQUIRE(index->get(east) == DataAvailability::UNKNOWN);
+        REQUIRE(!index->isEmpty(TileKey(3, 8, 3, profile.get())));
+    }
+
+    SECTION("Serialization")
+    {
+        index->set(TileKey(7, 100, 50, profile.get()), DataAvailability::NO_DATA);
+        index->set(TileKey(2, 1, 1, profile.get()), DataAvailability::EMPTY_SUBTREE);
+        std::string data = index->write();
+        REQUIRE(index->getNumChanges() == 0u);
+
+        osg::ref_ptr<DataAvailability> copy = new DataAvailability(profile.get());
+        REQUIRE(copy->read(data));
+        REQUIRE(copy->size() == 2u);
+        REQUIRE(copy->get(TileKey(7, 100, 50, profile.get())) == DataAvailability::NO_DATA);
+        REQUIRE(copy->get(TileKey(4, 5, 6, profile.get())) == DataAvailability::EMPTY_SUBTREE);
+
+        REQUIRE(!copy->read("garbage"));
+    }
+}
+
+TEST_CASE("Layer availability index is off by default")
+{
+    osg::ref_ptr<ScriptedImageLayer> layer = new ScriptedImageLayer();
+    REQUIRE(layer->open().isOK());
+    REQUIRE(layer->getAvailabilityIndex() == false);
+    REQUIRE(layer->getDataAvailability(layer->getProfile()) == nullptr);
+}
+
+TEST_CASE("Layers record only explicit no-data results")
+{
+    osg::ref_ptr<ScriptedImageLayer> layer = new ScriptedImageLayer();
+    layer->setAvailabilityIndex(true);
+    REQUIRE(layer->open().isOK());
+
+    DataAvailability* index = layer->getDataAvailability(layer->getProfile());
+    REQUIRE(index != nullptr);
+
+    TileKey key(4, 3, 5, layer->getProfile());
+
+    SECTION("A failed read is not recorded as no data")
+    {
+        layer->setResult(Status(Status::ResourceUnavailable, "HTTP 503"));
+        REQUIRE(!layer->createImage(key).valid());
+        REQUIRE(index->get(key) == DataAvailability::UNKNOWN);
+        REQUIRE(index->getNumChanges() == 0u);
+
+        // the source recovers and is asked again
+        layer->setResult(Status::OK());
+        REQUIRE(layer->createImage(key).valid());
+        REQUIRE(layer->getNumReads() == 2u);
+    }
+
+    SECTION("A no-data read is recorded and skips the source next time")
+    {
+        layer->setResult(Status(Status::NoData));
+        REQUIRE(!layer->createImage(key).valid());
+        REQUIRE(index->get(key) == DataAvailability::NO_DATA);
+
+        REQUIRE(!layer->createImage(key).valid());
+        REQUIRE(layer->getNumReads() == 1u);
+    }
+}
@@ -0,0 +1,96 @@
+/* -*-c++-*- */
+/* osgEarth - Geospatial SDK for OpenSceneGraph
+* Copyright 2020 Pelican Mapping
+* http://osgearth.org
+*
+* osgEarth is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#include <osgEarth/catch.hpp>
+
+#include <osgEarth/ElevationRangeIndex>
+#include <osgEarth/Profile>
+
+using namespace osgEarth;
+
+TEST_CASE("ElevationRangeIndex")
+{
+    osg::ref_ptr<const Profile> profile = Profile::create(Profile::GLOBAL_GEODETIC);
+    osg::ref_ptr<ElevationRangeIndex> index = new ElevationRangeIndex(profile.get());
+
+    TileKey parent(1, 2, 1, profile.get());
+    index->add(parent, 0.0f, 100.0f);
+    index->add(parent.createChildKey(0), 10.0f, 50.0f);
+    index->add(parent.createChildKey(3), -20.0f, 250.0f);
+
+    float minHeight, maxHeight;
+
+    SECTION("Children widen recorded ancestors")
+    {
+        REQUIRE(index->getRange(parent, minHeight, maxHeight));
+        REQUIRE(minHeight == -20.0f);
+        REQUIRE(maxHeight == 250.0f);
+    }
+
+    SECTION("Unrecorded keys use the closest ancestor")
+    {
+        REQUIRE(index->getRange(parent.createChildKey(1).createChildKey(2), minHeight, maxHeight));
+        REQUIRE(maxHeight == 250.0f);
+        REQUIRE(!index->getRange(TileKey(1, 0, 0, profile.get()), minHeight, maxHeight));
+    }
+
+    SECTION("Extent query")
+    {
+        bool complete = true;
+        REQUIRE(index->getRange(GeoExtent(profile->getSRS(), 10, -30, 20, -20), 2, minHeight, maxHeight, &complete));
+        REQUIRE(complete);
+        REQUIRE(minHeight == 10.0f);
+        REQUIRE(maxHeight == 50.0f);
+
+        REQUIRE(index->getRange(profile->getExtent(), 1, minHeight, maxHeight, &complete));
+        REQUIRE(!complete);
+    }
+
+    SECTION("Extent query borrowing an ancestor's range is not complete")
+    {
+        // child 1 was never recorded, so its range comes from the parent
+        bool complete = true;
+        REQUIRE(index->getRange(GeoExtent(profile->getSRS(), 50, -30, 60, -20), 2, minHeight, maxHeight, &complete));
+        REQUIRE(!complete);
+        REQUIRE(minHeight == -20.0f);
+        REQUIRE(maxHeight == 250.0f);
+
+        // nor is a finer query under a recorded key
+        complete = true;
+        REQUIRE(index->getRange(GeoExtent(profile->getSRS(), 10, -30, 20, -20), 3, minHeight, maxHeight, &complete));
+        REQUIRE(!complete);
+        REQUIRE(minHeight == 10.0f);
+        REQUIRE(maxHeight == 50.0f);
+    }
+
+    SECTION("Serialization rounds outward")
+    {
+        index->add(TileKey(3, 9, 2, profile.get()), 1.5f, 2.5f);
+
+        osg::ref_ptr<ElevationRangeIndex> copy = new ElevationRangeIndex(profile.get());
+        REQUIRE(copy->read(index->write()));
+        REQUIRE(copy->size() == index->size());
+        REQUIRE(copy->getRange(TileKey(3, 9, 2, profile.get()), minHeight, maxHeight));
+        REQUIRE(minHeight == 1.0f);
+        REQUIRE(maxHeight == 3.0f);
+    }
+}
@@ -0,0 +1,79 @@
+/* -*-c++-*- */
+/* osgEarth - Geospatial SDK for OpenSceneGraph
+* Copyright 2018 Pelican Mapping
+* http://osgearth.org
+*
+* osgEarth is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#include <osgEarth/catch.hpp>
+
+#include <osgEarth/EntityTable>
+#include <osgEarth/GeoData>
+
+using namespace osgEarth;
+
+TEST_CASE( "EntityTable matches GeoPoint" ) {
+    osg::ref_ptr<const SpatialReference> wgs84 = SpatialReference::get("wgs84");
+    REQUIRE(wgs84.valid());
+
+    osg::ref_ptr<EntityTable> table = new EntityTable(wgs84.get());
+    table->resize(3);
+    double lon[3] = { -77.0, 2.35, 151.2 };
+    double lat[3] = { 38.9, 48.85, -33.87 };
+    double alt[3] = { 0.0, 500.0, 10000.0 };
+    float heading[3] = { 0.0f, 90.0f, 225.0f };
+    for (unsigned i = 0; i < 3; ++i)
+    {
+        table->x()[i] = lon[i];
+        table->y()[i] = lat[i];
+        table->z()[i] = alt[i];
+        table->heading()[i] = heading[i];
+    }
+
+    REQUIRE(table->update());
+    REQUIRE(table->getInstanceMatrices().size() == 3);
+
+    for (unsigned i = 0; i < 3; ++i)
+    {
+        GeoPoint p(wgs84.get(), lon[i], lat[i], alt[i], ALTMODE_ABSOLUTE);
+        osg::Matrixd local2world;
+        REQUIRE(p.createLocalToWorld(local2world));
+
+        osg::Vec3d world = table->getWorldPosition(i);
+        REQUIRE((world - local2world.getTrans()).length() < 0.01);
+
+        // instance matrices are relative to the origin, in floats
+        const osg::Matrixf& m = table->getInstanceMatrices()[i];
+        osg::Vec3d trans = osg::Vec3d(m.getTrans()) + table->getOrigin();
+        REQUIRE((trans - world).length() < 1.0);
+
+        // up axis is the local vertical
+        osg::Vec3d up(m(2, 0), m(2, 1), m(2, 2));
+        osg::Vec3d expectedUp(local2world(2, 0), local2world(2, 1), local2world(2, 2));
+        REQUIRE((up - expectedUp).length() < 1e-5);
+    }
+
+    // heading 90 points the forward axis east
+    const osg::Matrixf& m = table->getInstanceMatrices()[1];
+    osg::Vec3d forward(m(1, 0), m(1, 1), m(1, 2));
+    GeoPoint p(wgs84.get(), lon[1], lat[1], alt[1], ALTMODE_ABSOLUTE);
+    osg::Matrixd local2world;
+    p.createLocalToWorld(local2world);
+    osg::Vec3d east(local2world(0, 0), local2world(0, 1), local2world(0, 2));
+    REQUIRE((forward - east).length() < 1e-5);
+}
@@ -0,0 +1,457 @@
+/* -*-c++-*- */
+/* osgEarth - Geospatial SDK for OpenSceneGraph
+* Copyright 2020 Pelican Mapping
+* http://osgearth.org
+*
+* osgEarth is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+
+#include <osgEarth/catch.hpp>
+
+#include <osgEarth/GDAL>
+#include <osgEarth/Registry>
+#include <osgEarth/FileUtils>
+#include <osgEarth/TileKey>
+#include <osgEarth/Profile>
+#include <osgEarth/SpatialReference>
+#include <osgEarth/StringUtils>
+#include <osgDB/FileNameUtils>
+#include <cstdio>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+
+#include <gdal_priv.h>
+#include <cpl_vsi.h>
+
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <poll.h>
+#include <unistd.h>
+#include <atomic>
+#include <thread>
+#endif
+
+using namespace osgEarth;
+
+namespace
+{
+    // Writes a WGS84 Float32 GeoTIFF with a few nodata pixels, optionally
+    // in 256x256 internal tiles like a cloud-optimized GeoTIFF
+    std::string createTestDEM(int size = 64, bool tiled = false)
+    {
+        const float nodata = -9999.0f;
+
+        GDALDriver* mem = GetGDALDriverManager()->GetDriverByName("MEM");
+        GDALDriver* gtiff = GetGDALDriverManager()->GetDriverByName("GTiff");
+        if (!mem || !gtiff)
+            return "";
+
+        GDALDataset* ds = mem->Create("", size, size, 1, GDT_Float32, nullptr);
+
+        // 10x10 degrees, not aligned to any tile boundary
+        double geotransform[6] = { 3.3, 10.0 / size, 0.0, 47.1, 0.0, -10.0 / size };
+        ds->SetGeoTransform(geotransform);
+        ds->SetProjection(SpatialReference::get("wgs84")->getWKT().c_str());
+
+        std::vector<float> data(size * size);
+        for (int r = 0; r < size; ++r)
+            for (int c = 0; c < size; ++c)
+                data[r*size + c] = 500.0f * sinf(0.21f*c) * cosf(0.13f*r) + 3.7f*r;
+
+        data[10 * size + 12] = nodata;
+        data[33 * size + 40] = nodata;
+        data[50 * size + 5] = nodata;
+
+        GDALRasterBand* band = ds->GetRasterBand(1);
+        band->SetNoDataValue(nodata);
+        band->RasterIO(GF_Write, 0, 0, size, size, &data[0], size, size, GDT_Float32, 0, 0);
+
+        char** createOptions = nullptr;
+        if (tiled)
+            createOptions = CSLSetNameValue(createOptions, "TILED", "YES");
+
+        std::string filename = getTempName("oe_gdal_test", ".tif");
+        GDALDataset* tif = gtiff->CreateCopy(filename.c_str(), ds, FALSE, createOptions, nullptr, nullptr);
+        CSLDestroy(createOptions);
+        GDALClose(ds);
+        if (!tif)
+            return "";
+        GDALClose(tif);
+        return filename;
+    }
+
+    void compareHeightFields(const std::string& filename, RasterInterpolation interp)
+    {
+        GDAL::Options options;
+        options.url() = URI(filename);
+        options.interpolation() = interp;
+
+        GDAL::Driver::Ptr windowed = std::make_shared<GDAL::Driver>();
+        GDAL::Driver::Ptr perPost = std::make_shared<GDAL::Driver>();
+        perPost->setUseReadWindow(false);
+
+        DataExtentList extents;
+        REQUIRE(windowed->open("windowed", options, 17u, &extents, nullptr).isOK());
+        REQUIRE(perPost->open("perPost", options, 17u, &extents, nullptr).isOK());
+
+        const Profile* profile = windowed->getProfile();
+        REQUIRE(profile != nullptr);
+
+        // keys coarser than, near, and finer than the source resolution,
+        // including ones straddling the dataset edges
+        std::vector<TileKey> keys;
+        profile->getIntersectingTiles(GeoExtent(profile->getSRS(), 3.3, 37.1, 13.3, 47.1), 4u, keys);
+        profile->getIntersectingTiles(GeoExtent(profile->getSRS(), 3.3, 37.1, 13.3, 47.1), 6u, keys);
+        profile->getIntersectingTiles(GeoExtent(profile->getSRS(), 6.0, 40.0, 7.0, 41.0), 9u, keys);
+        REQUIRE(!keys.empty());
+
+        for (auto& key : keys)
+        {
+            osg::ref_ptr<osg::HeightField> a = windowed->createHeightField(key, 17u, nullptr);
+            osg::ref_ptr<osg::HeightField> b = perPost->createHeightField(key, 17u, nullptr);
+            REQUIRE(a.valid() == b.valid());
+            if (a.valid())
+            {
+                REQUIRE(a->getHeightList() == b->getHeightList());
+            }
+        }
+    }
+}
+
+TEST_CASE("GDAL windowed heightfield reads match per-post reads")
+{
+    // registers the GDAL drivers
+    Registry::instance();
+
+    std::string filename = createTestDEM();
+    REQUIRE(!filename.empty());
+
+    SECTION("Bilinear")
+    {
+        compareHeightFields(filename, INTERP_BILINEAR);
+    }
+
+    SECTION("Average")
+    {
+        compareHeightFields(filename, INTERP_AVERAGE);
+    }
+
+    ::remove(filename.c_str());
+}
+
+TEST_CASE("GDAL driver pool bounds the number of open drivers")
+{
+    Registry::instance();
+
+    std::string filename = createTestDEM();
+    REQUIRE(!filename.empty());
+
+    GDAL::Options options;
+    options.url() = URI(filename);
+
+    unsigned opened = 0u;
+    GDAL::DriverPool::Factory factory = [&]()
+    {
+        GDAL::Driver::Ptr driver = std::make_shared<GDAL::Driver>();
+        if (driver->open("pool", options, 17u, nullptr, nullptr).isError())
+            return GDAL::Driver::Ptr();
+        ++opened;
+        return driver;
+    };
+
+    GDAL::DriverPool pool;
+    pool.setMaxSize(2u);
+
+    {
+        GDAL::DriverPool::Lease a(pool, factory);
+        GDAL::DriverPool::Lease b(pool, factory);
+        REQUIRE(a.valid());
+        REQUIRE(b.valid());
+        REQUIRE(pool.getNumOpen() == 2u);
+    }
+
+    // returned drivers are reused:
+    {
+        GDAL::DriverPool::Lease c(pool, factory);
+        REQUIRE(c.valid());
+        REQUIRE(opened == 2u);
+    }
+
+    pool.clear();
+    REQUIRE(pool.getNumOpen() == 0u);
+
+    // a closed pool hands out nothing until it reopens:
+    pool.close();
+    {
+        GDAL::DriverPool::Lease d(pool, factory);
+        REQUIRE(!d.valid());
+        REQUIRE(opened == 2u);
+    }
+    pool.open();
+    {
+        GDAL::DriverPool::Lease e(pool, factory);
+        REQUIRE(e.valid());
+    }
+
+    ::remove(filename.c_str());
+}
+
+TEST_CASE("GDAL block cache honors its budget")
+{
+    osg::ref_ptr<GDAL::BlockCache> cache = new GDAL::BlockCache();
+    cache->setMaxBytes(3u * 1024u * sizeof(float));
+
+    for (int i = 0; i < 4; ++i)
+    {
+        cache->put(std::to_string(i), std::make_shared<std::vector<float>>(1024u, (float)i));
+        cache->get("0"); // keep the first one warm
+    }
+
+    REQUIRE(cache->getTotalBytes() <= cache->getMaxBytes());
+    REQUIRE(cache->get("0") != nullptr);
+    REQUIRE(cache->get("1") == nullptr);
+    REQUIRE(cache->get("3") != nullptr);
+}
+
+#ifndef _WIN32
+
+namespace
+{
+    // Stands in for a cloud store: serves one file over HTTP on a loopback
+    // port, honoring single byte ranges, and records what it was asked for.
+    class RangeServer
+    {
+    public:
+        RangeServer(const std::string& filename) :
+            _listener(-1),
+            _port(0),
+            _done(false),
+            numFullGets(0u),
+            numOtherPaths(0u),
+            bytesServed(0u)
+        {
+            std::ifstream in(filename.c_str(), std::ios::binary);
+            _data.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+            _path = "/" + osgDB::getSimpleFileName(filename);
+
+            _listener = ::socket(AF_INET, SOCK_STREAM, 0);
+            sockaddr_in addr = { };
+            addr.sin_family = AF_INET;
+            addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+            addr.sin_port = 0;
+            socklen_t len = sizeof(addr);
+            if (_listener >= 0 &&
+                ::bind(_listener, (sockaddr*)&addr, sizeof(addr)) == 0 &&
+                ::listen(_listener, 16) == 0 &&
+                ::getsockname(_listener, (sockaddr*)&addr, &len) == 0)
+            {
+                _port = ntohs(addr.sin_port);
+                _thread = std::thread([this]() { run(); });
+            }
+        }
+
+        ~RangeServer()
+        {
+            _done = true;
+            if (_thread.joinable())
+                _thread.join();
+            if (_listener >= 0)
+                ::close(_listener);
+        }
+
+        bool valid() const { return _port != 0 && !_data.empty(); }
+
+        std::string url() const
+        {
+            return Stringify() << "http://127.0.0.1:" << _port << _path;
+        }
+
+        std::size_t size() const { return _data.size(); }
+
+        std::atomic<unsigned> numFullGets;
+        std::atomic<unsigned> numOtherPaths;
+        std::atomic<std::size_t> bytesServed;
+
+    private:
+        std::string _data;
+        std::string _path;
+        int _listener;
+        unsigned short _port;
+        std::atomic<bool> _done;
+        std::thread _thread;
+
+        void run()
+        {
+            while (!_done)
+            {
+                // wake up now and then to check for shutdown
+                pollfd p = { _listener, POLLIN, 0 };
+                if (::poll(&p, 1, 100) > 0)
+                {
+                    int fd = ::accept(_listener, nullptr, nullptr);
+                    if (fd >= 0)
+                    {
+                        serve(fd);
+                        ::close(fd);
+                    }
+                }
+            }
+        }
+
+        // one request per connection
+        void serve(int fd)
+        {
+            std::string request;
+            char buf[4096];
+            while (request.find("\r\n\r\n") == std::string::npos)
+            {
+                ssize_t n = ::recv(fd, buf, sizeof(buf), 0);
+                if (n <= 0)
+                    return;
+                request.append(buf, n);
+            }
+
+            std::istringstream in(request);
+            std::string method, path, line;
+            in >> method >> path;
+            std::getline(in, line);
+
+            long long first = -1, last = -1;
+            while (std::getline(in, line) && line != "\r")
+            {
+                if (startsWith(line, "range: bytes=", false))
+                    sscanf(line.c_str() + 13, "%lld-%lld", &first, &last);
+            }
+
+            const long long size = (long long)_data.size();
+            std::string body;
+            std::ostringstream out;
+
+            if (path != _path)
+            {
+                ++numOtherPaths;
+                out << "HTTP/1.1 404 Not Found\r\n"
+                    << "Content-Length: 0\r\n";
+            }
+            else if (first >= 0 && first < size)
+            {
+                if (last < 0 || last >= size)
+                    last = size - 1;
+                body = _data.substr((std::size_t)first, (std::size_t)(last - first + 1));
+                out << "HTTP/1.1 206 Partial Content\r\n"
+                    << "Content-Range: bytes " << first << "-" << last << "/" << size << "\r\n"
+                    << "Content-Length: " << body.size() << "\r\n";
+            }
+            else
+            {
+                if (method == "GET")
+                    ++numFullGets;
+                body = _data;
+                out << "HTTP/1.1 200 OK\r\n"
+                    << "Content-Length: " << body.size() << "\r\n";
+            }
+
+            out << "Accept-Ranges: bytes\r\n"
+                << "Content-Type: image/tiff\r\n"
+                << "Connection: close\r\n\r\n";
+
+            if (method == "GET")
+            {
+                out << body;
+                bytesServed += body.size();
+            }
+
+            std::string response = out.str();
+            for (std::size_t sent = 0; sent < response.size(); )
+            {
+                ssize_t n = ::send(fd, response.data() + sent, response.size() - sent, MSG_NOSIGNAL);
+                if (n <= 0)
+                    return;
+                sent += (std::size_t)n;
+            }
+        }
+    };
+}
+
+TEST_CASE("GDAL reads http rasters with range requests")
+{
+    Registry::instance();
+
+    // /vsicurl/ is only there when GDAL was built with curl
+    char** prefixes = VSIGetFileSystemsPrefixes();
+    bool haveCurl = CSLFindString(prefixes, "/vsicurl/") >= 0;
+    CSLDestroy(prefixes);
+    if (!haveCurl)
+    {
+        WARN("GDAL has no /vsicurl/ support; skipping");
+        return;
+    }
+
+    // 1024x1024 floats in 256x256 tiles, 4MB in all
+    std::string filename = createTestDEM(1024, true);
+    REQUIRE(!filename.empty());
+
+    {
+        RangeServer server(filename);
+        REQUIRE(server.valid());
+
+        GDAL::Options localOptions;
+        localOptions.url() = URI(filename);
+
+        GDAL::Options remoteOptions;
+        remoteOptions.url() = URI(server.url());
+
+        GDAL::Driver::Ptr local = std::make_shared<GDAL::Driver>();
+        GDAL::Driver::Ptr remote = std::make_shared<GDAL::Driver>();
+        REQUIRE(local->open("local", localOptions, 17u, nullptr, nullptr).isOK());
+        REQUIRE(remote->open("remote", remoteOptions, 17u, nullptr, nullptr).isOK());
+
+        const Profile* profile = remote->getProfile();
+        REQUIRE(profile != nullptr);
+        REQUIRE(profile->isHorizEquivalentTo(local->getProfile()));
+
+        // a small area inside one internal tile
+        std::vector<TileKey> keys;
+        profile->getIntersectingTiles(GeoExtent(profile->getSRS(), 6.9, 43.2, 7.0, 43.3), 9u, keys);
+        REQUIRE(!keys.empty());
+
+        for (auto& key : keys)
+        {
+            osg::ref_ptr<osg::HeightField> a = local->createHeightField(key, 17u, nullptr);
+            osg::ref_ptr<osg::HeightField> b = remote->createHeightField(key, 17u, nullptr);
+            REQUIRE(a.valid());
+            REQUIRE(b.valid());
+            REQUIRE(a->getHeightList() == b->getHeightList());
+        }
+
+        remote = nullptr;
+
+        // never downloaded the whole file or probed for sidecar files,
+        // and fetched only a fraction of the bytes
+        REQUIRE(server.numFullGets == 0u);
+        REQUIRE(server.numOtherPaths == 0u);
+        REQUIRE(server.bytesServed < server.size() / 2u);
+    }
+
+    ::remove(filename.c_str());
+}
+
+#endif // _WIN32
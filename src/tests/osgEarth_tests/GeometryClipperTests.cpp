@@ -0,0 +1,101 @@
+/* -*-c++-*- */
+/* osgEarth - Geospatial SDK for OpenSceneGraph
+* Copyright 2018 Pelican Mapping
+* http://osgearth.org
+*
+* osgEarth is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#include <osgEarth/catch.hpp>
+
+#include <osgEarth/GeometryClipper>
+#include <osgEarth/Profile>
+
+using namespace osgEarth;
+
+TEST_CASE( "GeometryClipper clips to a rectangle" ) {
+    GeometryClipper clipper(Bounds(5.0, 5.0, 15.0, 15.0));
+
+    SECTION("Polygons") {
+        osg::ref_ptr<Polygon> square = new Polygon(4);
+        square->push_back(0.0, 0.0);
+        square->push_back(10.0, 0.0);
+        square->push_back(10.0, 10.0);
+        square->push_back(0.0, 10.0);
+
+        osg::ref_ptr<Geometry> output;
+        REQUIRE(clipper.clip(square.get(), output));
+        REQUIRE(output->getType() == Geometry::TYPE_POLYGON);
+        REQUIRE(output->size() == 4u);
+        Bounds b = output->getBounds();
+        REQUIRE(b.xMin() == Approx(5.0));
+        REQUIRE(b.yMin() == Approx(5.0));
+        REQUIRE(b.xMax() == Approx(10.0));
+        REQUIRE(b.yMax() == Approx(10.0));
+
+        // the input is untouched
+        REQUIRE(square->size() == 4u);
+        REQUIRE(square->getBounds().xMin() == 0.0);
+    }
+
+    SECTION("Lines that leave and re-enter become several parts") {
+        osg::ref_ptr<LineString> line = new LineString(4);
+        line->push_back(0.0, 6.0);
+        line->push_back(20.0, 6.0);
+        line->push_back(20.0, 8.0);
+        line->push_back(0.0, 8.0);
+
+        osg::ref_ptr<Geometry> output;
+        REQUIRE(clipper.clip(line.get(), output));
+        REQUIRE(output->getType() == Geometry::TYPE_MULTI);
+        REQUIRE(output->getNumComponents() == 2u);
+        REQUIRE(output->getTotalPointCount() == 4);
+    }
+
+    SECTION("Geometry outside the rectangle is rejected") {
+        osg::ref_ptr<Point> point = new Point(1);
+        point->push_back(1.0, 1.0);
+        osg::ref_ptr<Geometry> output;
+        REQUIRE(clipper.clip(point.get(), output) == false);
+    }
+}
+
+TEST_CASE( "ClipCache matches clipping from the original" ) {
+    osg::ref_ptr<const Profile> profile = Profile::create(
+        SpatialReference::get("spherical-mercator"), 0.0, 0.0, 16.0, 16.0, 1u, 1u);
+    REQUIRE(profile.valid());
+
+    osg::ref_ptr<Polygon> triangle = new Polygon(3);
+    triangle->push_back(1.0, 1.0);
+    triangle->push_back(15.0, 2.0);
+    triangle->push_back(3.0, 14.0);
+
+    osg::ref_ptr<ClipCache> cache = new ClipCache();
+
+    TileKey parent(0, 0, 0, profile.get());
+    TileKey child = parent.createChildKey(2);
+    Bounds childBounds = child.getExtent().bounds();
+
+    osg::ref_ptr<Geometry> fromCache, fromOriginal;
+    REQUIRE(cache->clip(1, triangle.get(), parent, parent.getExtent().bounds(), fromCache));
+    REQUIRE(cache->clip(1, triangle.get(), child, childBounds, fromCache));
+    REQUIRE(GeometryClipper(childBounds).clip(triangle.get(), fromOriginal));
+
+    REQUIRE(fromCache->getTotalPointCount() == fromOriginal->getTotalPointCount());
+    REQUIRE(fromCache->getBounds().xMin() == Approx(fromOriginal->getBounds().xMin()));
+    REQUIRE(fromCache->getBounds().yMax() == Approx(fromOriginal->getBounds().yMax()));
+}
@@ -25,6 +25,9 @@
 #include <osgEarth/ImageLayer>
 #include <osgEarth/Registry>
 #include <osgEarth/GDAL>
+#include <osgEarth/Composite>
+#include <osgEarth/ImageUtils>
+#include <atomic>
 
 using namespace osgEarth;
 
@@ -67,4 +70,91 @@ TEST_CASE("Attribution works")
 
     REQUIRE(status.isOK());
     REQUIRE(layer->getAttribution() == attribution);
-}
\ No newline at end of file
+}
+
+namespace
+{
+    // Image layer that returns a solid color and counts its reads
+    class SolidImageLayer : public ImageLayer
+    {
+    public:
+        META_Layer(osgEarth, SolidImageLayer, Options, ImageLayer, solidimage);
+
+        void setColor(const osg::Vec4& color) { _color = color; }
+
+        unsigned getNumReads() const { return _reads; }
+
+        Status openImplementation() override
+        {
+            Status parent = ImageLayer::openImplementation();
+            if (parent.isError())
+                return parent;
+
+            setProfile(Profile::create(Profile::GLOBAL_GEODETIC));
+            return Status::NoError;
+        }
+
+        GeoImage createImageImplementation(const TileKey& key, ProgressCallback* progress) const override
+        {
+            ++_reads;
+            osg::ref_ptr<osg::Image> image = new osg::Image();
+            image->allocateImage(16, 16, 1, GL_RGBA, GL_UNSIGNED_BYTE);
+            ImageUtils::PixelWriter write(image.get());
+            for (int t = 0; t < 16; ++t)
+                for (int s = 0; s < 16; ++s)
+                    write(_color, s, t);
+            return GeoImage(image.get(), key.getExtent());
+        }
+
+    protected:
+        void init() override
+        {
+            ImageLayer::init();
+            _reads = 0u;
+            options().cachePolicy() = CachePolicy::NO_CACHE;
+        }
+
+    private:
+        osg::Vec4 _color;
+        mutable std::atomic<unsigned> _reads;
+    };
+}
+
+TEST_CASE("CompositeImageLayer skips layers hidden by an opaque layer")
+{
+    osg::ref_ptr<SolidImageLayer> bottom = new SolidImageLayer();
+    bottom->setColor(osg::Vec4(1, 0, 0, 1));
+
+    osg::ref_ptr<SolidImageLayer> middle = new SolidImageLayer();
+    middle->setColor(osg::Vec4(0, 0, 1, 1));
+
+    osg::ref_ptr<SolidImageLayer> top = new SolidImageLayer();
+    top->setColor(osg::Vec4(0, 1, 0, 0.5));
+
+    osg::ref_ptr<CompositeImageLayer> composite = new CompositeImageLayer();
+    composite->options().cachePolicy() = CachePolicy::NO_CACHE;
+    composite->addLayer(bottom.get());
+    composite->addLayer(middle.get());
+    composite->addLayer(top.get());
+    REQUIRE(composite->open().isOK());
+
+    TileKey key(1, 0, 0, composite->getProfile());
+
+    for (int pass = 1; pass <= 2; ++pass)
+    {
+        GeoImage result = composite->createImage(key);
+        REQUIRE(result.valid());
+        REQUIRE(top->getNumReads() == (unsigned)pass);
+        REQUIRE(middle->getNumReads() == (unsigned)pass);
+        REQUIRE(bottom->getNumReads() == 0u);
+
+        // half green over opaque blue
+        osg::Vec4 color;
+        ImageUtils::PixelReader read(result.getImage());
+        read(color, 8, 8);
+        REQUIRE(color.r() == Approx(0.0f).margin(0.01));
+        REQUIRE(color.g() == Approx(0.5f).margin(0.01));
+        REQUIRE(color.b() == Approx(0.5f).margin(0.01));
+        REQUIRE(color.a() == Approx(1.0f).margin(0.01));
+    }
+}
@@ -0,0 +1,141 @@
+/* -*-c++-*- */
+/* osgEarth - Geospatial SDK for OpenSceneGraph
+* Copyright 2018 Pelican Mapping
+* http://osgearth.org
+*
+* osgEarth is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#include <osgEarth/catch.hpp>
+
+#include <osgEarth/MVT>
+#include <osgEarth/Profile>
+
+using namespace osgEarth;
+
+#ifdef OSGEARTH_HAVE_MVT
+
+namespace
+{
+    // A hand-encoded tile with one layer, "roads" (extent 4096), holding:
+    //   1: LINESTRING (10,20) (20,20) (20,30)      name=Main St
+    //   2: POINT (100,100)                         name=Tower, other_tags="height"=>"12.5"
+    //   3: UNKNOWN (5,5) (10,10)                   name=Main St
+    //   4: POLYGON (10,10) (110,10) (110,110) (10,110), exterior ring   name=Park
+    const unsigned char knownTile[] = {
+        0x1a, 0xa1, 0x01, 0x78, 0x02, 0x0a, 0x05, 0x72, 0x6f, 0x61, 0x64, 0x73,
+        0x12, 0x12, 0x08, 0x01, 0x12, 0x02, 0x00, 0x00, 0x18, 0x02, 0x22, 0x08,
+        0x09, 0x14, 0x28, 0x12, 0x14, 0x00, 0x00, 0x14, 0x12, 0x11, 0x08, 0x02,
+        0x12, 0x04, 0x00, 0x01, 0x01, 0x02, 0x18, 0x01, 0x22, 0x05, 0x09, 0xc8,
+        0x01, 0xc8, 0x01, 0x12, 0x10, 0x08, 0x03, 0x12, 0x02, 0x00, 0x00, 0x18,
+        0x00, 0x22, 0x06, 0x09, 0x0a, 0x0a, 0x0a, 0x0a, 0x0a, 0x12, 0x18, 0x08,
+        0x04, 0x12, 0x02, 0x00, 0x03, 0x18, 0x03, 0x22, 0x0e, 0x09, 0x14, 0x14,
+        0x1a, 0xc8, 0x01, 0x00, 0x00, 0xc8, 0x01, 0xc7, 0x01, 0x00, 0x0f, 0x1a,
+        0x04, 0x6e, 0x61, 0x6d, 0x65, 0x1a, 0x0a, 0x6f, 0x74, 0x68, 0x65, 0x72,
+        0x5f, 0x74, 0x61, 0x67, 0x73, 0x22, 0x09, 0x0a, 0x07, 0x4d, 0x61, 0x69,
+        0x6e, 0x20, 0x53, 0x74, 0x22, 0x07, 0x0a, 0x05, 0x54, 0x6f, 0x77, 0x65,
+        0x72, 0x22, 0x12, 0x0a, 0x10, 0x22, 0x68, 0x65, 0x69, 0x67, 0x68, 0x74,
+        0x22, 0x3d, 0x3e, 0x22, 0x31, 0x32, 0x2e, 0x35, 0x22, 0x22, 0x06, 0x0a,
+        0x04, 0x50, 0x61, 0x72, 0x6b, 0x28, 0x80, 0x20
+    };
+}
+
+TEST_CASE("MVT decoder reads a known tile")
+{
+    osg::ref_ptr<const Profile> profile = Profile::create(Profile::SPHERICAL_MERCATOR);
+    TileKey key(1, 0, 0, profile.get());
+    const GeoExtent& extent = key.getExtent();
+
+    // tile grid to map coordinates
+    auto at = [&](double x, double y) {
+        return osg::Vec3d(
+            extent.xMin() + x * extent.width() / 4096.0,
+            extent.yMax() - y * extent.height() / 4096.0,
+            0.0);
+    };
+
+    const char* data = (const char*)knownTile;
+    FeatureList features;
+
+    SECTION("Everything")
+    {
+        REQUIRE(MVT::readTile(data, sizeof(knownTile), key, features));
+
+        // the UNKNOWN geometry is dropped
+        REQUIRE(features.size() == 3u);
+        auto i = features.begin();
+
+        Feature* line = i->get();
+        REQUIRE(line->getGeometry()->getType() == Geometry::TYPE_LINESTRING);
+        REQUIRE(line->getGeometry()->size() == 3u);
+        REQUIRE(line->getGeometry()->front() == at(10, 20));
+        REQUIRE(line->getGeometry()->back() == at(20, 30));
+        REQUIRE(line->getString("name") == "Main St");
+        REQUIRE(line->getString("mvt_layer") == "roads");
+
+        Feature* point = (++i)->get();
+        REQUIRE(point->getGeometry()->getType() == Geometry::TYPE_POINTSET);
+        REQUIRE(point->getGeometry()->size() == 1u);
+        REQUIRE(point->getGeometry()->front() == at(100, 100));
+        REQUIRE(point->getString("name") == "Tower");
+        REQUIRE(point->hasAttr("other_tags"));
+        REQUIRE(point->getDouble("height") == Approx(12.5));
+
+        Feature* park = (++i)->get();
+        REQUIRE(park->getGeometry()->getType() == Geometry::TYPE_POLYGON);
+        REQUIRE(park->getString("name") == "Park");
+        Bounds b = park->getGeometry()->getBounds();
+        REQUIRE(b.xMin() == Approx(at(10, 110).x()));
+        REQUIRE(b.yMin() == Approx(at(10, 110).y()));
+        REQUIRE(b.xMax() == Approx(at(110, 10).x()));
+        REQUIRE(b.yMax() == Approx(at(110, 10).y()));
+    }
+
+    SECTION("Selected attributes only")
+    {
+        MVT::DecodeOptions options;
+        options.attributes.push_back("height");
+        REQUIRE(MVT::readTile(data, sizeof(knownTile), key, features, &options));
+        REQUIRE(features.size() == 3u);
+
+        for (auto& feature : features)
+        {
+            REQUIRE_FALSE(feature->hasAttr("name"));
+            REQUIRE_FALSE(feature->hasAttr("mvt_layer"));
+            REQUIRE_FALSE(feature->hasAttr("other_tags"));
+        }
+
+        Feature* point = (++features.begin())->get();
+        REQUIRE(point->getDouble("height") == Approx(12.5));
+    }
+
+    SECTION("Unselected layers are skipped")
+    {
+        MVT::DecodeOptions options;
+        options.layers.push_back("water");
+        REQUIRE(MVT::readTile(data, sizeof(knownTile), key, features, &options));
+        REQUIRE(features.empty());
+    }
+
+    SECTION("A truncated tile is an error")
+    {
+        REQUIRE_FALSE(MVT::readTile(data, sizeof(knownTile) - 10u, key, features));
+        REQUIRE(features.empty());
+    }
+}
+
+#endif // OSGEARTH_HAVE_MVT
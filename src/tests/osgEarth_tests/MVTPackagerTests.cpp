@@ -0,0 +1,151 @@
+/* -*-c++-*- */
+/* osgEarth - Geospatial SDK for OpenSceneGraph
+* Copyright 2018 Pelican Mapping
+* http://osgearth.org
+*
+* osgEarth is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#include <osgEarth/catch.hpp>
+
+#include <osgEarth/MVT>
+#include <osgEarth/FeatureCursor>
+#include <osgEarth/FileUtils>
+#include <osgEarth/SpatialReference>
+#include <osgEarth/GeoData>
+#include <cstdio>
+
+using namespace osgEarth;
+
+#if defined(OSGEARTH_HAVE_MVT) && defined(OSGEARTH_HAVE_SQLITE3)
+
+namespace
+{
+    // Feature source over an in-memory list that honors the query bounds,
+    // like a real spatially-indexed source would.
+    class ListFeatureSource : public FeatureSource
+    {
+    public:
+        META_Layer(osgEarth, ListFeatureSource, Options, FeatureSource, listfeatures);
+
+        void add(Feature* feature) { _features.push_back(feature); }
+
+        Status openImplementation() override
+        {
+            Status parent = FeatureSource::openImplementation();
+            if (parent.isError())
+                return parent;
+
+            Bounds bounds;
+            for (auto& feature : _features)
+                bounds.expandBy(feature->getGeometry()->getBounds());
+
+            setFeatureProfile(new FeatureProfile(GeoExtent(SpatialReference::get("wgs84"), bounds)));
+            return Status::NoError;
+        }
+
+        FeatureCursor* createFeatureCursorImplementation(const Query& query, ProgressCallback* progress) override
+        {
+            // cursors run on several threads at once, so hand out copies
+            FeatureList output;
+            for (auto& feature : _features)
+            {
+                Bounds b = feature->getGeometry()->getBounds();
+                if (query.bounds().isSet() && (
+                    b.xMin() > query.bounds()->xMax() || b.xMax() < query.bounds()->xMin() ||
+                    b.yMin() > query.bounds()->yMax() || b.yMax() < query.bounds()->yMin()))
+                {
+                    continue;
+                }
+                output.push_back(new Feature(*feature, osg::CopyOp::DEEP_COPY_ALL));
+            }
+            return new FeatureListCursor(output);
+        }
+
+    private:
+        FeatureList _features;
+    };
+
+    void countTiles(const TileKey& key, const FeatureList& features, void* context)
+    {
+        ++(*static_cast<unsigned*>(context));
+    }
+
+    unsigned numTilesAt(MVTFeatureSource* mvt, int lod)
+    {
+        unsigned count = 0u;
+        mvt->iterateTiles(lod, 0, 0, GeoExtent::INVALID, countTiles, &count);
+        return count;
+    }
+}
+
+TEST_CASE("MVTPackager descends into tiles whose features encode to nothing")
+{
+    // A 20m square is well under one grid cell at the low zooms, so it
+    // encodes to nothing there; it must still show up once the grid is fine
+    // enough to hold it.
+    const double lon = 10.123, lat = 10.456, half = 0.0001;
+
+    osg::ref_ptr<Polygon> square = new Polygon();
+    square->push_back(osg::Vec3d(lon - half, lat - half, 0));
+    square->push_back(osg::Vec3d(lon + half, lat - half, 0));
+    square->push_back(osg::Vec3d(lon + half, lat + half, 0));
+    square->push_back(osg::Vec3d(lon - half, lat + half, 0));
+
+    osg::ref_ptr<ListFeatureSource> source = new ListFeatureSource();
+    source->add(new Feature(square.get(), SpatialReference::get("wgs84")));
+    REQUIRE(source->open().isOK());
+
+    std::string filename = getTempName("oe_mvtpackager_test", ".mbtiles");
+
+    MVTPackager packager;
+    packager.setFirstLevel(0u);
+    packager.setMaxLevel(16u);
+    packager.setNumThreads(2u);
+    REQUIRE(packager.package(source.get(), filename, "squares").isOK());
+
+    osg::ref_ptr<MVTFeatureSource> mvt = new MVTFeatureSource();
+    mvt->setURL(filename);
+    REQUIRE(mvt->open().isOK());
+
+    SECTION("Nothing is written where the square is smaller than a grid cell")
+    {
+        REQUIRE(numTilesAt(mvt.get(), 0) == 0u);
+        REQUIRE(numTilesAt(mvt.get(), 4) == 0u);
+    }
+
+    SECTION("The square appears once the grid can hold it")
+    {
+        REQUIRE(numTilesAt(mvt.get(), 16) == 1u);
+
+        const Profile* profile = mvt->getFeatureProfile()->getTilingProfile();
+        GeoPoint center = GeoPoint(SpatialReference::get("wgs84"), lon, lat).transform(profile->getSRS());
+        TileKey key = profile->createTileKey(center.x(), center.y(), 16u);
+        REQUIRE(key.valid());
+
+        osg::ref_ptr<FeatureCursor> cursor = mvt->createFeatureCursor(key, nullptr);
+        REQUIRE(cursor.valid());
+        FeatureList features;
+        cursor->fill(features);
+        REQUIRE(features.size() == 1u);
+    }
+
+    mvt = nullptr;
+    ::remove(filename.c_str());
+}
+
+#endif // OSGEARTH_HAVE_MVT && OSGEARTH_HAVE_SQLITE3
@@ -0,0 +1,121 @@
+/* -*-c++-*- */
+/* osgEarth - Geospatial SDK for OpenSceneGraph
+* Copyright 2018 Pelican Mapping
+* http://osgearth.org
+*
+* osgEarth is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#include <osgEarth/catch.hpp>
+
+#include <osgEarth/Map>
+#include <chrono>
+#include <thread>
+
+using namespace osgEarth;
+
+namespace
+{
+    // Layer that refers to another layer by name, the way feature and
+    // model layers do, and records whether that layer was already open
+    // by the time it opened itself.
+    class DependentLayer : public Layer
+    {
+    public:
+        DependentLayer(const std::string& name, Layer* source) :
+            _source(source), _sawSourceOpen(false)
+        {
+            setName(name);
+        }
+
+        Config getConfig() const override
+        {
+            Config conf = Layer::getConfig();
+            if (_source.valid())
+                conf.set("source", _source->getName());
+            return conf;
+        }
+
+        bool sawSourceOpen() const { return _sawSourceOpen; }
+
+    protected:
+        Status openImplementation() override
+        {
+            Status parent = Layer::openImplementation();
+            if (parent.isError())
+                return parent;
+
+            if (_source.valid())
+            {
+                _sawSourceOpen = _source->isOpen();
+            }
+            else
+            {
+                // give a dependent layer a chance to run ahead
+                std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            }
+            return Status::NoError;
+        }
+
+    private:
+        osg::observer_ptr<Layer> _source;
+        bool _sawSourceOpen;
+    };
+}
+
+TEST_CASE("Map layer opening")
+{
+    osg::ref_ptr<DependentLayer> source = new DependentLayer("source", nullptr);
+    osg::ref_ptr<DependentLayer> dependent = new DependentLayer("dependent", source.get());
+    osg::ref_ptr<DependentLayer> other = new DependentLayer("other", nullptr);
+
+    // the dependent layer comes first on purpose
+    LayerVector layers;
+    layers.push_back(dependent.get());
+    layers.push_back(source.get());
+    layers.push_back(other.get());
+
+    SECTION("Serial by default")
+    {
+        osg::ref_ptr<Map> map = new Map();
+        map->setParallelLayerOpen(false);
+        map->addLayers(layers);
+
+        REQUIRE(source->isOpen());
+        REQUIRE(dependent->isOpen());
+        REQUIRE(map->getNumLayers() == 3u);
+
+        // map order: the dependent layer opened before its source
+        REQUIRE(dependent->sawSourceOpen() == false);
+    }
+
+    SECTION("Parallel opening waits for named dependencies")
+    {
+        osg::ref_ptr<Map> map = new Map();
+        map->setParallelLayerOpen(true);
+        map->addLayers(layers);
+
+        REQUIRE(source->isOpen());
+        REQUIRE(dependent->isOpen());
+        REQUIRE(other->isOpen());
+        REQUIRE(dependent->sawSourceOpen() == true);
+
+        // layers keep their map order
+        REQUIRE(map->getLayerAt(0) == dependent.get());
+        REQUIRE(map->getLayerAt(1) == source.get());
+    }
+}
@@ -0,0 +1,150 @@
+/* -*-c++-*- */
+/* osgEarth - Geospatial SDK for OpenSceneGraph
+* Copyright 2018 Pelican Mapping
+* http://osgearth.org
+*
+* osgEarth is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#include <osgEarth/catch.hpp>
+
+#include <osgEarth/OGRFeatureSource>
+#include <osgEarth/FeatureCursor>
+#include <map>
+
+using namespace osgEarth;
+
+namespace
+{
+    osg::ref_ptr<OGRFeatureSource> openWorld(unsigned maxOpenHandles)
+    {
+        osg::ref_ptr<OGRFeatureSource> source = new OGRFeatureSource();
+        source->setURL("../data/world.shp");
+        source->options().maxOpenHandles() = maxOpenHandles;
+        return source;
+    }
+
+    Query where(const std::string& expr, const std::string& orderby = std::string())
+    {
+        Query query;
+        if (!expr.empty())
+            query.expression() = expr;
+        if (!orderby.empty())
+            query.orderby() = orderby;
+        return query;
+    }
+
+    FeatureList run(OGRFeatureSource* source, const Query& query)
+    {
+        FeatureList features;
+        osg::ref_ptr<FeatureCursor> cursor = source->createFeatureCursor(query, nullptr);
+        if (cursor.valid())
+            cursor->fill(features);
+        return features;
+    }
+}
+
+TEST_CASE("OGRFeatureSource pooled handles return the same results as fresh ones")
+{
+    // one idle handle, so every query below reuses the same one
+    osg::ref_ptr<OGRFeatureSource> pooled = openWorld(1u);
+    REQUIRE(pooled->open().isOK());
+
+    // no idle handles, so every query opens the data fresh
+    osg::ref_ptr<OGRFeatureSource> fresh = openWorld(0u);
+    REQUIRE(fresh->open().isOK());
+
+    Query bounded;
+    bounded.bounds() = Bounds(-10.0, 35.0, 30.0, 60.0);
+
+    std::vector<Query> queries = {
+        where("CODE = 'CA'"),
+        bounded,
+        where(""),
+        where("CODE = 'US'"),
+        where("CODE = 'US'", "NAME"),
+        where("CODE = 'CA'")
+    };
+
+    for (int round = 0; round < 3; ++round)
+    {
+        for (auto& query : queries)
+        {
+            REQUIRE(run(pooled.get(), query).size() == run(fresh.get(), query).size());
+        }
+    }
+}
+
+TEST_CASE("OGRFeatureSource re-applies a WHERE clause after an SQL query on the same handle")
+{
+    osg::ref_ptr<OGRFeatureSource> source = openWorld(1u);
+    REQUIRE(source->open().isOK());
+
+    std::size_t all = run(source.get(), where("")).size();
+    std::size_t canada = run(source.get(), where("CODE = 'CA'")).size();
+    REQUIRE(canada > 0u);
+    REQUIRE(canada < all);
+
+    // ORDER BY forces the SQL path, which clears the layer's filters
+    std::size_t us = run(source.get(), where("CODE = 'US'", "NAME")).size();
+    REQUIRE(us > 0u);
+    REQUIRE(us < all);
+
+    REQUIRE(run(source.get(), where("CODE = 'CA'")).size() == canada);
+
+    // a full SELECT takes the SQL path too
+    REQUIRE(run(source.get(), where("SELECT * FROM world WHERE CODE = 'US'")).size() == us);
+    REQUIRE(run(source.get(), where("CODE = 'CA'")).size() == canada);
+    REQUIRE(run(source.get(), where("")).size() == all);
+}
+
+TEST_CASE("OGRFeatureSource reads the same features directly and through SQL")
+{
+    // A plain WHERE clause reads the layer directly (through OGR's Arrow
+    // stream where GDAL supports it); adding ORDER BY reads an SQL result
+    // set one OGRFeature at a time. Both must yield the same features.
+    osg::ref_ptr<OGRFeatureSource> source = openWorld(1u);
+    REQUIRE(source->open().isOK());
+
+    FeatureList direct = run(source.get(), where("CODE = 'CA' OR CODE = 'US'"));
+    FeatureList sql = run(source.get(), where("CODE = 'CA' OR CODE = 'US'", "NAME"));
+    REQUIRE(!direct.empty());
+    REQUIRE(direct.size() == sql.size());
+
+    std::map<FeatureID, osg::ref_ptr<Feature>> byFID;
+    for (auto& feature : sql)
+        byFID[feature->getFID()] = feature;
+    REQUIRE(byFID.size() == sql.size());
+
+    for (auto& feature : direct)
+    {
+        auto i = byFID.find(feature->getFID());
+        REQUIRE(i != byFID.end());
+        const Feature* other = i->second.get();
+
+        REQUIRE(feature->getString("name") == other->getString("name"));
+        REQUIRE(feature->getString("curr_code") == other->getString("curr_code"));
+        REQUIRE(feature->getInt("pop") == other->getInt("pop"));
+
+        REQUIRE(feature->getGeometry() != nullptr);
+        REQUIRE(other->getGeometry() != nullptr);
+        REQUIRE(feature->getGeometry()->getType() == other->getGeometry()->getType());
+        REQUIRE(feature->getGeometry()->getTotalPointCount() == other->getGeometry()->getTotalPointCount());
+        REQUIRE(feature->getGeometry()->getBounds().xMin() == other->getGeometry()->getBounds().xMin());
+        REQUIRE(feature->getGeometry()->getBounds().yMax() == other->getGeometry()->getBounds().yMax());
+    }
+}
@@ -0,0 +1,91 @@
+/* -*-c++-*- */
+/* osgEarth - Geospatial SDK for OpenSceneGraph
+* Copyright 2018 Pelican Mapping
+* http://osgearth.org
+*
+* osgEarth is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#include <osgEarth/catch.hpp>
+
+#include <osgEarth/PackedFeatureSource>
+#include <osgEarth/StringUtils>
+#include <cstdio>
+#include <set>
+
+using namespace osgEarth;
+
+TEST_CASE( "Packed feature files round-trip and answer spatial queries" ) {
+    osg::ref_ptr<const SpatialReference> wgs84 = SpatialReference::get("wgs84");
+    REQUIRE(wgs84.valid());
+
+    FeatureSchema schema;
+    schema["name"] = ATTRTYPE_STRING;
+    schema["value"] = ATTRTYPE_INT;
+
+    const std::string filename = "packed_feature_test.packed";
+    {
+        PackedFeatures::Writer writer(filename, wgs84.get(), schema, Geometry::TYPE_POINT);
+        for (int i = 0; i < 100; ++i)
+        {
+            // a 10x10 grid of points, one degree apart
+            osg::ref_ptr<Feature> f = new Feature(new Point(), wgs84.get());
+            f->getGeometry()->push_back(osg::Vec3d(i % 10, i / 10, 0.0));
+            f->setFID(i);
+            f->set("name", Stringify() << "p" << i);
+            if (i % 2 == 0)
+                f->set("value", (long long)i);
+            REQUIRE(writer.add(f.get()));
+        }
+        REQUIRE(writer.finish().isOK());
+    }
+
+    PackedFeatures::Reader reader;
+    REQUIRE(reader.open(filename).isOK());
+    REQUIRE(reader.size() == 100u);
+    REQUIRE(reader.getSchema().size() == 2u);
+
+    SECTION("Features are found by FID") {
+        std::size_t index;
+        REQUIRE(reader.find(42, index));
+        osg::ref_ptr<Feature> f = reader.read(index);
+        REQUIRE(f->getFID() == 42);
+        REQUIRE(f->getString("name") == "p42");
+        REQUIRE(f->getInt("value") == 42);
+        REQUIRE(f->getGeometry()->front() == osg::Vec3d(2, 4, 0));
+        REQUIRE_FALSE(reader.find(100, index));
+    }
+
+    SECTION("Null attributes stay null") {
+        std::size_t index;
+        REQUIRE(reader.find(43, index));
+        osg::ref_ptr<Feature> f = reader.read(index);
+        REQUIRE_FALSE(f->isSet("value"));
+    }
+
+    SECTION("A bounds query returns exactly the features inside") {
+        std::vector<PackedFeatures::Range> ranges;
+        reader.search(Bounds(1.5, 1.5, 4.5, 3.5), ranges);
+        std::set<FeatureID> fids;
+        for (auto& range : ranges)
+            for (std::size_t i = range.begin; i < range.end; ++i)
+                fids.insert(osg::ref_ptr<Feature>(reader.read(i))->getFID());
+        REQUIRE(fids == std::set<FeatureID>({ 22, 23, 24, 32, 33, 34 }));
+    }
+
+    std::remove(filename.c_str());
+}
@@ -0,0 +1,197 @@
+/* -*-c++-*- */
+/* osgEarth - Geospatial SDK for OpenSceneGraph
+* Copyright 2018 Pelican Mapping
+* http://osgearth.org
+*
+* osgEarth is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#include <osgEarth/catch.hpp>
+
+#include <osgEarth/ProfileSampler>
+#include <osgEarth/Map>
+#include <osgEarth/ElevationLayer>
+#include <osgEarth/HeightFieldUtils>
+#include <osgEarth/GeoMath>
+#include <cmath>
+
+using namespace osgEarth;
+using namespace osgEarth::Util;
+
+namespace
+{
+    // Elevation layer whose height is 100m per degree of latitude,
+    // so any sample can be checked against its position.
+    class LatitudeElevationLayer : public ElevationLayer
+    {
+    public:
+        META_Layer(osgEarth, LatitudeElevationLayer, Options, ElevationLayer, latitudeelevation);
+
+        Status openImplementation() override
+        {
+            Status parent = ElevationLayer::openImplementation();
+            if (parent.isError())
+                return parent;
+
+            setProfile(Profile::create(Profile::GLOBAL_GEODETIC));
+            return Status::NoError;
+        }
+
+    protected:
+        void init() override
+        {
+            ElevationLayer::init();
+            options().cachePolicy() = CachePolicy::NO_CACHE;
+        }
+
+        GeoHeightField createHeightFieldImplementation(const TileKey& key, ProgressCallback* progress) const override
+        {
+            osg::ref_ptr<osg::HeightField> hf = HeightFieldUtils::createReferenceHeightField(
+                key.getExtent(), getTileSize(), getTileSize(), 0u, false);
+
+            for (unsigned row = 0; row < hf->getNumRows(); ++row)
+            {
+                double lat = hf->getOrigin().y() + hf->getYInterval() * (double)row;
+                for (unsigned col = 0; col < hf->getNumColumns(); ++col)
+                    hf->setHeight(col, row, (float)(100.0 * lat));
+            }
+            return GeoHeightField(hf.get(), key.getExtent());
+        }
+    };
+
+    // elevation of the test layer at a distance north of the equator
+    double heightAt(double metersNorth)
+    {
+        return 100.0 * osg::RadiansToDegrees(metersNorth / osg::WGS_84_RADIUS_EQUATOR);
+    }
+}
+
+TEST_CASE("ProfileSampler")
+{
+    osg::ref_ptr<Map> map = new Map();
+    osg::ref_ptr<LatitudeElevationLayer> layer = new LatitudeElevationLayer();
+    map->addLayer(layer.get());
+    REQUIRE(layer->isOpen());
+
+    const SpatialReference* wgs84 = SpatialReference::get("wgs84");
+    ProfileSampler sampler(map.get());
+
+    SECTION("Stations are evenly spaced along the great circle")
+    {
+        sampler.setResolution(Distance(10.0, Units::KILOMETERS));
+
+        std::vector<ProfileSampler::Profile> profiles(1);
+        ProfileSampler::Profile& profile = profiles[0];
+        profile.path = {
+            GeoPoint(wgs84, 0.0, 45.0, 0.0, ALTMODE_ABSOLUTE),
+            GeoPoint(wgs84, 90.0, 45.0, 0.0, ALTMODE_ABSOLUTE) };
+
+        REQUIRE(sampler.sample(profiles) == 1);
+
+        double total = GeoMath::distance(
+            osg::DegreesToRadians(45.0), 0.0,
+            osg::DegreesToRadians(45.0), osg::DegreesToRadians(90.0),
+            osg::WGS_84_RADIUS_EQUATOR);
+
+        const std::size_t stations = (std::size_t)std::ceil(total / 10000.0) + 1u;
+        REQUIRE(profile.distances.size() == stations);
+        REQUIRE(profile.elevations.size() == stations);
+        REQUIRE(profile.minimums.empty());
+        REQUIRE(profile.distances.front() == 0.0);
+        REQUIRE(profile.distances.back() == Approx(total));
+
+        const double step = total / (double)(stations - 1u);
+        REQUIRE(step <= 10000.0);
+        for (std::size_t k = 1; k < stations; ++k)
+            REQUIRE(profile.distances[k] - profile.distances[k - 1] == Approx(step));
+
+        // ends are at 45 degrees; a great circle bows north to its
+        // vertex at atan(tan(45)/cos(45)), a rhumb line would stay put
+        const double vertex = osg::RadiansToDegrees(
+            atan(tan(osg::DegreesToRadians(45.0)) / cos(osg::DegreesToRadians(45.0))));
+
+        REQUIRE(profile.elevations.front() == Approx(4500.0).margin(0.5));
+        REQUIRE(profile.elevations.back() == Approx(4500.0).margin(0.5));
+        REQUIRE(profile.elevations[stations / 2u] == Approx(100.0 * vertex).margin(0.5));
+        REQUIRE(profile.maxElevation == Approx(100.0 * vertex).margin(0.5));
+    }
+
+    SECTION("Corridor samples cross the path at every station")
+    {
+        sampler.setResolution(Distance(1.0, Units::KILOMETERS));
+
+        // east along the equator: the corridor runs north-south,
+        // spanning the heights 10km either side of zero
+        std::vector<ProfileSampler::Profile> profiles(1);
+        ProfileSampler::Profile& profile = profiles[0];
+        profile.path = {
+            GeoPoint(wgs84, 0.0, 0.0, 0.0, ALTMODE_ABSOLUTE),
+            GeoPoint(wgs84, 1.0, 0.0, 0.0, ALTMODE_ABSOLUTE) };
+        profile.corridorWidth = 20000.0;
+
+        REQUIRE(sampler.sample(profiles) == 1);
+
+        const std::size_t stations = profile.distances.size();
+        REQUIRE(stations > 2u);
+        REQUIRE(profile.minimums.size() == stations);
+        REQUIRE(profile.maximums.size() == stations);
+        REQUIRE(profile.means.size() == stations);
+
+        // includes the last station, whose heading comes from the
+        // segment behind it rather than a bearing to itself
+        const double edge = heightAt(10000.0);
+        for (std::size_t k = 0; k < stations; ++k)
+        {
+            REQUIRE(profile.elevations[k] == Approx(0.0).margin(0.05));
+            REQUIRE(profile.minimums[k] == Approx(-edge).margin(0.05));
+            REQUIRE(profile.maximums[k] == Approx(edge).margin(0.05));
+            REQUIRE(profile.means[k] == Approx(0.0).margin(0.05));
+        }
+        REQUIRE(profile.minElevation == Approx(-edge).margin(0.05));
+        REQUIRE(profile.maxElevation == Approx(edge).margin(0.05));
+    }
+
+    SECTION("Corridor samples match known elevations")
+    {
+        sampler.setResolution(Distance(1.0, Units::KILOMETERS));
+
+        // north along the prime meridian: the corridor runs east-west,
+        // so every sample across it sits at the station's latitude
+        std::vector<ProfileSampler::Profile> profiles(1);
+        ProfileSampler::Profile& profile = profiles[0];
+        profile.path = {
+            GeoPoint(wgs84, 0.0, 0.0, 0.0, ALTMODE_ABSOLUTE),
+            GeoPoint(wgs84, 0.0, 1.0, 0.0, ALTMODE_ABSOLUTE) };
+        profile.corridorWidth = 20000.0;
+
+        REQUIRE(sampler.sample(profiles) == 1);
+
+        const std::size_t stations = profile.distances.size();
+        REQUIRE(stations > 2u);
+        REQUIRE(profile.minimums.size() == stations);
+
+        for (std::size_t k = 0; k < stations; ++k)
+        {
+            double expected = heightAt(profile.distances[k]);
+            REQUIRE(profile.elevations[k] == Approx(expected).margin(0.05));
+            REQUIRE(profile.minimums[k] == Approx(expected).margin(0.05));
+            REQUIRE(profile.maximums[k] == Approx(expected).margin(0.05));
+            REQUIRE(profile.means[k] == Approx(expected).margin(0.05));
+        }
+        REQUIRE(profile.elevations.back() == Approx(100.0).margin(0.05));
+    }
+}
@@ -0,0 +1,108 @@
+/* -*-c++-*- */
+/* osgEarth - Geospatial SDK for OpenSceneGraph
+* Copyright 2020 Pelican Mapping
+* http://osgearth.org
+*
+* osgEarth is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#include <osgEarth/catch.hpp>
+
+#include <osgEarth/ResidencyManager>
+
+using namespace osgEarth;
+using namespace osgEarth::Util;
+
+TEST_CASE("ResidencyManager")
+{
+    osg::ref_ptr<ResidencyManager> rm = new ResidencyManager();
+    rm->setMaxBytes(1000u);
+    rm->setMinIdleFrames(2u);
+
+    unsigned tiles = rm->addSubsystem("tiles");
+    unsigned models = rm->addSubsystem("models");
+    REQUIRE(rm->addSubsystem("tiles") == tiles);
+
+    osg::ref_ptr<osg::Referenced> a = new osg::Referenced();
+    osg::ref_ptr<osg::Referenced> b = new osg::Referenced();
+    osg::ref_ptr<osg::Referenced> c = new osg::Referenced();
+    auto ha = rm->add(tiles, a.get(), 300u, 300u);
+    auto hb = rm->add(models, b.get(), 200u, 200u);
+    auto hc = rm->add(tiles, c.get(), 100u, 100u, 10.0f);
+    REQUIRE(rm->getTotalBytes() == 1200u);
+
+    rm->touch(ha, 1u);
+    rm->touch(hb, 5u);
+    rm->touch(hc, 1u);
+
+    SECTION("Evicts the least recently used unit across subsystems")
+    {
+        std::vector<osg::ref_ptr<osg::Referenced>> out;
+        rm->collect(models, 10u, 10u, out);
+        REQUIRE(out.empty());
+
+        rm->collect(tiles, 10u, 10u, out);
+        REQUIRE(out.size() == 1u);
+        REQUIRE(out[0] == a);
+
+        rm->remove(ha);
+        REQUIRE(rm->getTotalBytes() == 600u);
+
+        std::vector<ResidencyManager::Stats> stats;
+        rm->getStats(stats);
+        REQUIRE(stats[tiles]._units == 1u);
+        REQUIRE(stats[tiles]._evictions == 1u);
+        REQUIRE(stats[models]._cpuBytes == 200u);
+    }
+
+    SECTION("Recently touched units are not evicted")
+    {
+        rm->touch(ha, 10u);
+        rm->touch(hc, 10u);
+
+        std::vector<osg::ref_ptr<osg::Referenced>> out;
+        rm->collect(tiles, 10u, 10u, out);
+        REQUIRE(out.empty());
+        rm->collect(models, 10u, 10u, out);
+        REQUIRE(out.size() == 1u);
+        REQUIRE(out[0] == b);
+    }
+
+    SECTION("Units whose owner is gone are never handed back")
+    {
+        // the owner is destroyed before it gets to call remove()
+        a = nullptr;
+
+        std::vector<osg::ref_ptr<osg::Referenced>> out;
+        rm->collect(tiles, 10u, 10u, out);
+        REQUIRE(out.empty());
+
+        rm->remove(ha);
+        REQUIRE(rm->getTotalBytes() == 600u);
+    }
+
+    SECTION("No budget means disabled")
+    {
+        REQUIRE(rm->isEnabled());
+        rm->setMaxBytes(0u);
+        REQUIRE(!rm->isEnabled());
+
+        std::vector<osg::ref_ptr<osg::Referenced>> out;
+        rm->collect(tiles, 10u, 10u, out);
+        REQUIRE(out.empty());
+    }
+}
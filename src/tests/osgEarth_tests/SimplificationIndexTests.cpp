@@ -0,0 +1,149 @@
+/* -*-c++-*- */
+/* osgEarth - Geospatial SDK for OpenSceneGraph
+* Copyright 2018 Pelican Mapping
+* http://osgearth.org
+*
+* osgEarth is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#include <osgEarth/catch.hpp>
+
+#include <osgEarth/SimplificationIndex>
+#include <algorithm>
+#include <cmath>
+#include <set>
+
+using namespace osgEarth;
+
+TEST_CASE( "SimplificationIndex keeps shared boundaries seamless" ) {
+    osg::ref_ptr<const SpatialReference> srs = SpatialReference::get("spherical-mercator");
+    REQUIRE(srs.valid());
+
+    // a wavy boundary between two polygons, one above the other
+    std::vector<osg::Vec3d> boundary;
+    for (int i = 0; i <= 200; ++i)
+        boundary.push_back(osg::Vec3d(i * 5.0, 500.0 + 20.0 * sin(i * 0.37) + 3.0 * cos(i * 2.1), 0.0));
+
+    osg::ref_ptr<Polygon> below = new Polygon();
+    below->push_back(0.0, 0.0);
+    below->push_back(1000.0, 0.0);
+    for (int i = 200; i >= 0; --i)
+        below->push_back(boundary[i]);
+
+    osg::ref_ptr<Polygon> above = new Polygon();
+    for (int i = 0; i <= 200; ++i)
+        above->push_back(boundary[i]);
+    above->push_back(1000.0, 1000.0);
+    above->push_back(0.0, 1000.0);
+
+    FeatureList features;
+    features.push_back(new Feature(below.get(), srs.get()));
+    features.push_back(new Feature(above.get(), srs.get()));
+    features[0]->setFID(1);
+    features[1]->setFID(2);
+
+    osg::ref_ptr<SimplificationIndex> index = new SimplificationIndex();
+    index->build(features);
+    REQUIRE(index->size() == 2u);
+    REQUIRE(index->getRanks(1)->size() == below->size());
+
+    for (double minArea : { 1.0, 10.0, 100.0, 1000.0 })
+    {
+        osg::ref_ptr<Feature> a = new Feature(*features[0], osg::CopyOp::DEEP_COPY_ALL);
+        osg::ref_ptr<Feature> b = new Feature(*features[1], osg::CopyOp::DEEP_COPY_ALL);
+        REQUIRE(index->simplify(a.get(), minArea));
+        REQUIRE(index->simplify(b.get(), minArea));
+
+        const std::vector<osg::Vec3d>& va = a->getGeometry()->asVector();
+        const std::vector<osg::Vec3d>& vb = b->getGeometry()->asVector();
+        REQUIRE(va.size() >= 3u);
+        REQUIRE(vb.size() <= above->size());
+
+        // the shared run, in the order the upper polygon walks it
+        std::vector<osg::Vec3d> sharedA(va.begin() + 2, va.end());
+        std::reverse(sharedA.begin(), sharedA.end());
+        std::vector<osg::Vec3d> sharedB(vb.begin(), vb.end() - 2);
+        REQUIRE(sharedA == sharedB);
+    }
+
+    // geometry that changed since the build is left alone
+    osg::ref_ptr<Feature> changed = new Feature(*features[0], osg::CopyOp::DEEP_COPY_ALL);
+    changed->getGeometry()->push_back(osg::Vec3d(-1.0, -1.0, 0.0));
+    unsigned size = changed->getGeometry()->size();
+    REQUIRE(index->simplify(changed.get(), 100.0) == false);
+    REQUIRE(changed->getGeometry()->size() == size);
+}
+
+TEST_CASE( "SimplificationIndex pins rings the same way in every feature" ) {
+    osg::ref_ptr<const SpatialReference> srs = SpatialReference::get("spherical-mercator");
+    REQUIRE(srs.valid());
+
+    // an arch shared by a lens below it (closed by a single vertex just
+    // under the chord) and a polygon above it. Each ring meets the other
+    // at only two junctions, so each needs extra vertices to keep three.
+    std::vector<osg::Vec3d> arch;
+    for (int i = 0; i <= 200; ++i)
+        arch.push_back(osg::Vec3d(i * 5.0, 500.0 + 100.0 * sin(osg::PI * i / 200.0) + 3.0 * cos(i * 2.1), 0.0));
+
+    osg::ref_ptr<Polygon> lens = new Polygon();
+    for (auto& v : arch)
+        lens->push_back(v);
+    lens->push_back(500.0, 490.0);
+
+    osg::ref_ptr<Polygon> above = new Polygon();
+    for (auto& v : arch)
+        above->push_back(v);
+    above->push_back(1000.0, 1000.0);
+    above->push_back(0.0, 1000.0);
+
+    FeatureList features;
+    features.push_back(new Feature(lens.get(), srs.get()));
+    features.push_back(new Feature(above.get(), srs.get()));
+    features[0]->setFID(1);
+    features[1]->setFID(2);
+
+    osg::ref_ptr<SimplificationIndex> index = new SimplificationIndex();
+    index->build(features);
+    REQUIRE(index->size() == 2u);
+
+    std::set<std::pair<double, double>> shared;
+    for (auto& v : arch)
+        shared.emplace(v.x(), v.y());
+
+    auto sharedRun = [&](const Feature* f)
+    {
+        std::vector<osg::Vec3d> run;
+        for (auto& v : f->getGeometry()->asVector())
+            if (shared.count(std::make_pair(v.x(), v.y())))
+                run.push_back(v);
+        return run;
+    };
+
+    // the lens's own vertex goes first, so whatever the lens keeps to stay
+    // a ring is on the arch and the upper polygon must keep it too
+    for (double minArea : { 10.0, 1000.0, 10000.0, 60000.0, 1e6, 1e9 })
+    {
+        osg::ref_ptr<Feature> a = new Feature(*features[0], osg::CopyOp::DEEP_COPY_ALL);
+        osg::ref_ptr<Feature> b = new Feature(*features[1], osg::CopyOp::DEEP_COPY_ALL);
+        REQUIRE(index->simplify(a.get(), minArea));
+        REQUIRE(index->simplify(b.get(), minArea));
+
+        REQUIRE(a->getGeometry()->size() >= 3u);
+        REQUIRE(b->getGeometry()->size() >= 3u);
+        REQUIRE(sharedRun(a.get()) == sharedRun(b.get()));
+    }
+}
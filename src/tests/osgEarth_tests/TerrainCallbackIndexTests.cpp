@@ -0,0 +1,144 @@
+/* -*-c++-*- */
+/* osgEarth - Geospatial SDK for OpenSceneGraph
+* Copyright 2018 Pelican Mapping
+* http://osgearth.org
+*
+* osgEarth is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#include <osgEarth/catch.hpp>
+
+#include <osgEarth/Terrain>
+
+using namespace osgEarth;
+
+namespace
+{
+    struct NopCallback : public TerrainCallback { };
+
+    // whether a query for the tile returns the callback
+    bool hears(const TerrainCallbackIndex& index, const TileKey& key, const TerrainCallback* callback)
+    {
+        std::vector<const TerrainCallbackIndex::Entry*> entries;
+        index.query(key, entries);
+        for (auto entry : entries)
+            if (entry->_callback.get() == callback)
+                return true;
+        return false;
+    }
+}
+
+TEST_CASE("TerrainCallbackIndex")
+{
+    osg::ref_ptr<const Profile> profile = Profile::create(Profile::GLOBAL_GEODETIC);
+    const SpatialReference* srs = profile->getSRS();
+    TerrainCallbackIndex index(profile.get());
+
+    osg::ref_ptr<TerrainCallback> point = new NopCallback();
+    osg::ref_ptr<TerrainCallback> area = new NopCallback();
+    osg::ref_ptr<TerrainCallback> far = new NopCallback();
+
+    REQUIRE(index.insert(point.get(), GeoExtent(srs, 10.0, 10.0, 10.0, 10.0)));
+    REQUIRE(index.insert(area.get(), GeoExtent(srs, 1.0, 1.0, 20.0, 20.0)));
+    REQUIRE(index.insert(far.get(), GeoExtent(srs, -100.0, -40.0, -100.0, -40.0)));
+    REQUIRE(index.size() == 3u);
+
+    SECTION("Queries return the footprints a tile touches")
+    {
+        // tile above the cells
+        TileKey coarse = profile->createTileKey(10.0, 10.0, 1);
+        REQUIRE(hears(index, coarse, point.get()));
+        REQUIRE(hears(index, coarse, area.get()));
+        REQUIRE_FALSE(hears(index, coarse, far.get()));
+
+        // tile below the cells, found through the cells above it
+        TileKey fine = profile->createTileKey(10.0, 10.0, 20);
+        REQUIRE(hears(index, fine, point.get()));
+        REQUIRE(hears(index, fine, area.get()));
+        REQUIRE_FALSE(hears(index, fine, far.get()));
+
+        // its neighbor misses the point but not the area
+        TileKey next(20, fine.getTileX() + 1, fine.getTileY(), profile.get());
+        REQUIRE_FALSE(hears(index, next, point.get()));
+        REQUIRE(hears(index, next, area.get()));
+
+        // the other root tile
+        TileKey west(0, 0, 0, profile.get());
+        REQUIRE_FALSE(hears(index, west, point.get()));
+        REQUIRE_FALSE(hears(index, west, area.get()));
+        REQUIRE(hears(index, west, far.get()));
+
+        // no key means everything
+        std::vector<const TerrainCallbackIndex::Entry*> entries;
+        index.query(TileKey::INVALID, entries);
+        REQUIRE(entries.size() == 3u);
+    }
+
+    SECTION("Inserting again moves the footprint")
+    {
+        REQUIRE(index.insert(point.get(), GeoExtent(srs, -100.0, -40.0, -100.0, -40.0)));
+        REQUIRE(index.size() == 3u);
+        REQUIRE_FALSE(hears(index, profile->createTileKey(10.0, 10.0, 20), point.get()));
+        REQUIRE(hears(index, profile->createTileKey(-100.0, -40.0, 5), point.get()));
+        REQUIRE(hears(index, profile->createTileKey(-100.0, -40.0, 5), far.get()));
+
+        std::vector<const TerrainCallbackIndex::Entry*> entries;
+        index.query(TileKey::INVALID, entries);
+        REQUIRE(entries.size() == 3u);
+    }
+
+    SECTION("Removed callbacks are not returned")
+    {
+        REQUIRE(index.remove(point.get()));
+        REQUIRE_FALSE(index.remove(point.get()));
+        REQUIRE_FALSE(index.contains(point.get()));
+        REQUIRE(index.size() == 2u);
+        REQUIRE_FALSE(hears(index, profile->createTileKey(10.0, 10.0, 20), point.get()));
+        REQUIRE(hears(index, profile->createTileKey(10.0, 10.0, 20), area.get()));
+    }
+
+    SECTION("Footprints near the antimeridian")
+    {
+        osg::ref_ptr<TerrainCallback> edge = new NopCallback();
+
+        // just west of it is fine, and unknown to tiles across it
+        REQUIRE(index.insert(edge.get(), GeoExtent(srs, 179.5, 1.0, 179.9, 1.1)));
+        REQUIRE(hears(index, profile->createTileKey(179.7, 1.05, 12), edge.get()));
+        REQUIRE_FALSE(hears(index, profile->createTileKey(-179.7, 1.05, 12), edge.get()));
+
+        // crossing it fits no cell, so the move is refused and the
+        // old footprint stays
+        REQUIRE_FALSE(index.insert(edge.get(), GeoExtent(srs, 170.0, 0.0, -170.0, 10.0)));
+        REQUIRE(index.contains(edge.get()));
+        REQUIRE(hears(index, profile->createTileKey(179.7, 1.05, 12), edge.get()));
+    }
+
+    SECTION("Footprints no cell holds are refused")
+    {
+        osg::ref_ptr<TerrainCallback> other = new NopCallback();
+
+        // empty extents
+        REQUIRE_FALSE(index.insert(other.get(), GeoExtent(srs)));
+        REQUIRE_FALSE(index.insert(other.get(), GeoExtent::INVALID));
+
+        // spans both root tiles
+        REQUIRE_FALSE(index.insert(other.get(), GeoExtent(srs, -10.0, 0.0, 10.0, 10.0)));
+
+        REQUIRE_FALSE(index.contains(other.get()));
+        REQUIRE(index.size() == 3u);
+    }
+}
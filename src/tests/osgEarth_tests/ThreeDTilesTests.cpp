@@ -0,0 +1,217 @@
+/* -*-c++-*- */
+/* osgEarth - Geospatial SDK for OpenSceneGraph
+* Copyright 2020 Pelican Mapping
+* http://osgearth.org
+*
+* osgEarth is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#include <osgEarth/catch.hpp>
+
+#include <osgEarth/TDTiles>
+#include <osgEarth/StringUtils>
+#include <osgDB/FileUtils>
+#include <chrono>
+#include <fstream>
+#include <thread>
+
+using namespace osgEarth;
+using namespace osgEarth::Contrib::ThreeDTiles;
+
+namespace
+{
+    void writeFile(const std::string& path, const std::string& data)
+    {
+        osgDB::makeDirectoryForFile(path);
+        std::ofstream out(path.c_str(), std::ios::binary);
+        out.write(data.data(), data.size());
+    }
+
+    // Binary subtree: 24-byte header, JSON chunk, binary chunk.
+    std::string makeBinarySubtree(const std::string& json, const std::string& bin)
+    {
+        std::string paddedJSON = json;
+        while (paddedJSON.size() % 8 != 0) paddedJSON.push_back(' ');
+
+        std::string out("subt");
+        uint32_t version = 1;
+        uint64_t jsonLength = paddedJSON.size(), binLength = bin.size();
+        out.append((const char*)&version, 4);
+        out.append((const char*)&jsonLength, 8);
+        out.append((const char*)&binLength, 8);
+        return out + paddedJSON + bin;
+    }
+
+    // Synthetic quadtree: subtreeLevels=2, availableLevels=4.
+    // Level 1 has tiles (1,0,0) and (1,1,1); one child subtree at (2,0,0).
+    std::string makeImplicitTileset(const std::string& dir)
+    {
+        std::string tileset =
+            "{ \"asset\": { \"version\": \"1.1\" }, \"geometricError\": 1000,"
+            "  \"root\": {"
+            "    \"boundingVolume\": { \"region\": [0, 0, 1, 1, 0, 100] },"
+            "    \"geometricError\": 800, \"refine\": \"REPLACE\","
+            "    \"content\": { \"uri\": \"content/{level}/{x}/{y}.b3dm\" },"
+            "    \"implicitTiling\": {"
+            "      \"subdivisionScheme\": \"QUADTREE\", \"subtreeLevels\": 2, \"availableLevels\": 4,"
+            "      \"subtrees\": { \"uri\": \"subtrees/{level}/{x}/{y}.subtree\" } } } }";
+
+        // tile bits: root, level 1 mortons 0 and 3 => 0b00010011
+        // child subtree bits: morton 0 only
+        std::string bin;
+        bin.push_back((char)0x13);
+        bin.push_back((char)0x00);
+        bin.push_back((char)0x01);
+        bin.push_back((char)0x00);
+
+        std::string subtreeJSON =
+            "{ \"buffers\": [ { \"byteLength\": 4 } ],"
+            "  \"bufferViews\": [ { \"buffer\": 0, \"byteOffset\": 0, \"byteLength\": 1 },"
+            "                     { \"buffer\": 0, \"byteOffset\": 2, \"byteLength\": 2 } ],"
+            "  \"tileAvailability\": { \"bitstream\": 0 },"
+            "  \"contentAvailability\": [ { \"constant\": 1 } ],"
+            "  \"childSubtreeAvailability\": { \"bitstream\": 1 } }";
+
+        writeFile(dir + "/tileset.json", tileset);
+        writeFile(dir + "/subtrees/0/0/0.subtree", makeBinarySubtree(subtreeJSON, bin));
+
+        // JSON subtrees are legal too:
+        writeFile(dir + "/subtrees/2/0/0.subtree",
+            "{ \"tileAvailability\": { \"constant\": 1 },"
+            "  \"contentAvailability\": [ { \"constant\": 0 } ],"
+            "  \"childSubtreeAvailability\": { \"constant\": 0 } }");
+
+        return tileset;
+    }
+}
+
+TEST_CASE("3D Tiles")
+{
+    SECTION("Morton index")
+    {
+        REQUIRE(Subtree::morton(false, 1, 0, 0) == 1u);
+        REQUIRE(Subtree::morton(false, 0, 1, 0) == 2u);
+        REQUIRE(Subtree::morton(false, 3, 3, 0) == 15u);
+        REQUIRE(Subtree::morton(true, 1, 1, 1) == 7u);
+    }
+
+    SECTION("Explicit children are parsed on demand")
+    {
+        std::string json =
+            "{ \"asset\": { \"version\": \"1.0\" }, \"geometricError\": 100,"
+            "  \"root\": { \"boundingVolume\": { \"sphere\": [0,0,0,10] }, \"geometricError\": 50,"
+            "    \"children\": ["
+            "      { \"boundingVolume\": { \"sphere\": [1,0,0,5] }, \"geometricError\": 10 },"
+            "      { \"boundingVolume\": { \"sphere\": [-1,0,0,5] }, \"geometricError\": 10 } ] } }";
+
+        osg::ref_ptr<Tileset> tileset = Tileset::create(json, URIContext());
+        REQUIRE(tileset.valid());
+
+        Tile* root = tileset->root().get();
+        REQUIRE(root->children().empty());
+        REQUIRE(root->hasUnresolvedChildren());
+        REQUIRE(root->getJSON()["children"].size() == 2u);
+
+        root->resolveChildren(nullptr);
+        REQUIRE(!root->hasUnresolvedChildren());
+        REQUIRE(root->children().size() == 2u);
+        REQUIRE(root->children()[0]->geometricError().get() == 10.0);
+    }
+
+    SECTION("Implicit tiling with subtree files")
+    {
+        std::string dir = "3dtiles_implicit_test";
+        std::string json = makeImplicitTileset(dir);
+
+        osg::ref_ptr<Tileset> tileset = Tileset::create(json, URIContext(dir + "/tileset.json"));
+        REQUIRE(tileset.valid());
+
+        Tile* container = tileset->root().get();
+        REQUIRE(container->implicitTiling().isSet());
+        REQUIRE(!container->content().isSet());
+        REQUIRE(container->childrenRequireIO());
+
+        container->resolveChildren(nullptr);
+        REQUIRE(container->children().size() == 1u);
+
+        Tile* level0 = container->children()[0].get();
+        REQUIRE(level0->content().isSet());
+        REQUIRE(endsWith(level0->content()->uri()->full(), "content/0/0/0.b3dm"));
+        REQUIRE(!level0->childrenRequireIO());
+
+        level0->resolveChildren(nullptr);
+        REQUIRE(level0->children().size() == 2u);
+
+        Tile* t100 = level0->children()[0].get();
+        Tile* t111 = level0->children()[1].get();
+        REQUIRE(t100->geometricError().get() == 400.0);
+        REQUIRE(t100->boundingVolume()->region()->xMax() == 0.5);
+        REQUIRE(t111->boundingVolume()->region()->yMin() == 0.5);
+        REQUIRE(endsWith(t111->content()->uri()->full(), "content/1/1/1.b3dm"));
+
+        // last level of the root subtree: children come from child subtrees
+        REQUIRE(t100->childrenRequireIO());
+        t100->resolveChildren(nullptr);
+        REQUIRE(t100->children().size() == 1u);
+
+        Tile* t200 = t100->children()[0].get();
+        REQUIRE(!t200->content().isSet());
+
+        t111->resolveChildren(nullptr);
+        REQUIRE(t111->children().empty());
+
+        // level 3 is the last available level
+        t200->resolveChildren(nullptr);
+        REQUIRE(t200->children().size() == 4u);
+        REQUIRE(!t200->children()[0]->hasUnresolvedChildren());
+    }
+
+    SECTION("Implicit children load through the async path")
+    {
+        std::string dir = "3dtiles_implicit_async_test";
+        std::string json = makeImplicitTileset(dir);
+
+        osg::ref_ptr<Tileset> tileset = Tileset::create(json, URIContext(dir + "/tileset.json"));
+        REQUIRE(tileset.valid());
+
+        osg::ref_ptr<ThreeDTilesetNode> tilesetNode = new ThreeDTilesetNode(tileset.get(), "", nullptr, nullptr);
+        osg::ref_ptr<ThreeDTileNode> root = new ThreeDTileNode(tilesetNode.get(), tileset->root().get(), false, nullptr);
+
+        // the root's children need a subtree read, so the first request
+        // is dispatched to a job and reports not ready.
+        REQUIRE(root->getTile()->childrenRequireIO());
+        REQUIRE(root->requestChildren(false) == false);
+
+        bool ready = false;
+        for (int i = 0; i < 500 && !ready; ++i)
+        {
+            ready = root->requestChildren(false);
+            if (!ready)
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+
+        REQUIRE(ready);
+        REQUIRE(root->getTile()->children().size() == 1u);
+        REQUIRE(!root->getTile()->hasUnresolvedChildren());
+
+        // the child nodes live in a group under the root
+        REQUIRE(root->getNumChildren() == 1u);
+        osg::Group* children = root->getChild(0)->asGroup();
+        REQUIRE(children != nullptr);
+        REQUIRE(children->getNumChildren() == 1u);
+    }
+}
@@ -0,0 +1,95 @@
+/* -*-c++-*- */
+/* osgEarth - Geospatial SDK for OpenSceneGraph
+* Copyright 2020 Pelican Mapping
+* http://osgearth.org
+*
+* osgEarth is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#include <osgEarth/catch.hpp>
+
+#include "../../osgEarthDrivers/engine_rex/TileSelection"
+#include <osg/Node>
+
+using namespace osgEarth;
+using namespace osgEarth::REX;
+
+TEST_CASE("REX tile selection")
+{
+    // stands in for the terrain's tiles; the registry owns them
+    using Selection = TileSelectionT<osg::Node>;
+    osg::ref_ptr<Selection> selection = new Selection();
+
+    std::vector<osg::ref_ptr<osg::Node>> registry;
+    for (int i = 0; i < 4; ++i)
+        registry.push_back(new osg::Node());
+
+    // a sharing camera asks; the primary view records what it saw (0, 1)
+    // and what it would draw where it can't see (2, 3)
+    REQUIRE(selection->get(10u) == nullptr);
+    REQUIRE(selection->isWanted(10u));
+
+    Selection::Tiles* recording = selection->beginRecording();
+    REQUIRE(recording != nullptr);
+    REQUIRE(selection->beginRecording() == nullptr);
+    for (auto& tile : registry)
+        recording->push_back(tile.get());
+    selection->endRecording(10u);
+
+    std::shared_ptr<const Selection::Tiles> shared = selection->get(11u);
+    REQUIRE(shared != nullptr);
+    REQUIRE(shared->size() == 4u);
+
+    SECTION("Selected tiles are not kept from going dormant")
+    {
+        // nothing but the registry holds them
+        for (auto& tile : registry)
+            REQUIRE(tile->referenceCount() == 1);
+    }
+
+    SECTION("Unloaded tiles drop out of a selection still in use")
+    {
+        // the unloader collects the hidden tiles
+        registry[2] = nullptr;
+        registry[3] = nullptr;
+
+        unsigned alive = 0u;
+        osg::ref_ptr<osg::Node> tile;
+        for (auto& entry : *shared)
+            if (entry.lock(tile))
+                ++alive;
+        REQUIRE(alive == 2u);
+    }
+
+    SECTION("A held selection survives the next recording")
+    {
+        recording = selection->beginRecording();
+        REQUIRE(recording != nullptr);
+        recording->push_back(registry[0].get());
+        selection->endRecording(11u);
+
+        REQUIRE(shared->size() == 4u);
+        REQUIRE(selection->get(12u)->size() == 1u);
+    }
+
+    SECTION("Stale or unwanted selections are not used")
+    {
+        REQUIRE(selection->get(13u) == nullptr);
+        REQUIRE(selection->isWanted(14u));
+        REQUIRE_FALSE(selection->isWanted(15u));
+    }
+}
@@ -0,0 +1,147 @@
+/* -*-c++-*- */
+/* osgEarth - Geospatial SDK for OpenSceneGraph
+* Copyright 2020 Pelican Mapping
+* http://osgearth.org
+*
+* osgEarth is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+
+#include <osgEarth/catch.hpp>
+
+#include <osgEarth/VerticalDatum>
+#include <osgEarth/Geoid>
+#include <osgEarth/GeoData>
+#include <osgEarth/TileKey>
+#include <osgEarth/Profile>
+#include <osgEarth/SpatialReference>
+#include <cmath>
+
+using namespace osgEarth;
+
+namespace
+{
+    // A global 1-degree geoid that varies strongly with longitude, so
+    // a post sampled on the wrong side of the globe stands out.
+    Geoid* createTestGeoid()
+    {
+        osg::HeightField* hf = new osg::HeightField();
+        hf->allocate(361, 181);
+        hf->setOrigin(osg::Vec3(-180.0f, -90.0f, 0.0f));
+        hf->setXInterval(1.0f);
+        hf->setYInterval(1.0f);
+        for (unsigned r = 0; r < hf->getNumRows(); ++r)
+            for (unsigned c = 0; c < hf->getNumColumns(); ++c)
+                hf->setHeight(c, r,
+                    30.0f * cosf(osg::DegreesToRadians((float)c - 180.0f)) +
+                    10.0f * sinf(osg::DegreesToRadians((float)r - 90.0f)));
+
+        Geoid* geoid = new Geoid();
+        geoid->setName("test");
+        geoid->setHeightField(hf);
+        return geoid;
+    }
+
+    osg::HeightField* createGrid(unsigned size)
+    {
+        osg::HeightField* hf = new osg::HeightField();
+        hf->allocate(size, size);
+        for (unsigned r = 0; r < size; ++r)
+            for (unsigned c = 0; c < size; ++c)
+                hf->setHeight(c, r, 100.0f + (float)(r * size + c));
+        hf->setHeight(3, 5, NO_DATA_VALUE);
+        return hf;
+    }
+
+    // Checks a grid converted all at once against converting each
+    // post on its own with the scalar transform.
+    void compareWithScalar(
+        const VerticalDatum* from,
+        const VerticalDatum* to,
+        const GeoExtent& extent,
+        const osg::HeightField* input,
+        const osg::HeightField* output,
+        float tolerance)
+    {
+        const SpatialReference* geo = extent.getSRS()->getGeographicSRS();
+        unsigned cols = input->getNumColumns();
+        unsigned rows = input->getNumRows();
+
+        for (unsigned r = 0; r < rows; ++r)
+        {
+            for (unsigned c = 0; c < cols; ++c)
+            {
+                float z = input->getHeight(c, r);
+                if (z == NO_DATA_VALUE)
+                {
+                    REQUIRE(output->getHeight(c, r) == NO_DATA_VALUE);
+                    continue;
+                }
+
+                GeoPoint post(
+                    extent.getSRS(),
+                    extent.west() + extent.width() * double(c) / double(cols - 1),
+                    extent.south() + extent.height() * double(r) / double(rows - 1),
+                    0.0);
+                GeoPoint ll = post.transform(geo);
+                REQUIRE(ll.isValid());
+
+                VerticalDatum::transform(from, to, ll.y(), ll.x(), z);
+                REQUIRE(std::abs(output->getHeight(c, r) - z) <= tolerance);
+            }
+        }
+    }
+}
+
+TEST_CASE("VerticalDatum grid transforms match per-post transforms")
+{
+    osg::ref_ptr<VerticalDatum> egm = new VerticalDatum("test", "test", createTestGeoid());
+    osg::ref_ptr<VerticalDatum> feet = new VerticalDatum(Units::FEET);
+
+    SECTION("Geographic tile, through the patch cache")
+    {
+        osg::ref_ptr<const Profile> profile = Profile::create(Profile::GLOBAL_GEODETIC);
+        TileKey key(4, 3, 5, profile.get());
+
+        osg::ref_ptr<osg::HeightField> input = createGrid(17);
+        osg::ref_ptr<osg::HeightField> output = new osg::HeightField(*input, osg::CopyOp::DEEP_COPY_ALL);
+
+        REQUIRE(VerticalDatum::transform(egm.get(), feet.get(), key, output.get()));
+        compareWithScalar(egm.get(), feet.get(), key.getExtent(), input.get(), output.get(), 1e-3f);
+
+        // again, from the cached geoid offsets
+        output = new osg::HeightField(*input, osg::CopyOp::DEEP_COPY_ALL);
+        REQUIRE(VerticalDatum::transform(egm.get(), feet.get(), key, output.get()));
+        compareWithScalar(egm.get(), feet.get(), key.getExtent(), input.get(), output.get(), 1e-3f);
+    }
+
+    SECTION("Polar tile across the antimeridian")
+    {
+        // north polar stereographic; +y points along the 180th meridian
+        osg::ref_ptr<const SpatialReference> polar = SpatialReference::get(
+            "+proj=stere +lat_0=90 +lat_ts=70 +lon_0=0 +datum=WGS84 +units=m");
+        REQUIRE(polar.valid());
+        GeoExtent extent(polar.get(), -500000.0, 1000000.0, 500000.0, 2000000.0);
+
+        // more posts than the lattice, so most are interpolated
+        osg::ref_ptr<osg::HeightField> input = createGrid(33);
+        osg::ref_ptr<osg::HeightField> output = new osg::HeightField(*input, osg::CopyOp::DEEP_COPY_ALL);
+
+        REQUIRE(VerticalDatum::transform(nullptr, egm.get(), extent, output.get()));
+        compareWithScalar(nullptr, egm.get(), extent, input.get(), output.get(), 0.05f);
+    }
+}
@@ -0,0 +1,139 @@
+/* -*-c++-*- */
+/* osgEarth - Geospatial SDK for OpenSceneGraph
+* Copyright 2018 Pelican Mapping
+* http://osgearth.org
+*
+* osgEarth is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#include <osgEarth/catch.hpp>
+
+#include <osgEarth/Viewshed>
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+using namespace osgEarth;
+using namespace osgEarth::Util;
+
+namespace
+{
+    // Reference line of sight: march along the line from the observer
+    // to the cell and compare it with the bilinear terrain. Samples
+    // touching a no-data cell, and the cells next to either end, are
+    // ignored.
+    bool bruteForce(
+        int r, const std::vector<float>& elev, const std::vector<unsigned char>& valid,
+        double zObs, double targetHeight, int col, int row)
+    {
+        int n = 2 * r + 1;
+        double dx = col - r, dy = row - r;
+        double dist = std::sqrt(dx*dx + dy*dy);
+        double zTarget = elev[row*n + col] + targetHeight;
+        int steps = (int)std::ceil(dist * 8.0);
+
+        for (int k = 1; k < steps; ++k)
+        {
+            double t = (double)k / (double)steps;
+            if (t*dist < 1.0 || (1.0 - t)*dist < 1.0)
+                continue;
+
+            double x = r + dx*t, y = r + dy*t;
+            int x0 = (int)std::floor(x), y0 = (int)std::floor(y);
+            int x1 = std::min(x0 + 1, n - 1), y1 = std::min(y0 + 1, n - 1);
+            double fx = x - x0, fy = y - y0;
+
+            int c[4] = { y0*n + x0, y0*n + x1, y1*n + x0, y1*n + x1 };
+            if (!valid[c[0]] || !valid[c[1]] || !valid[c[2]] || !valid[c[3]])
+                continue;
+
+            double h =
+                (elev[c[0]] * (1 - fx) + elev[c[1]] * fx) * (1 - fy) +
+                (elev[c[2]] * (1 - fx) + elev[c[3]] * fx) * fy;
+
+            if (h > zObs + (zTarget - zObs)*t)
+                return false;
+        }
+        return true;
+    }
+}
+
+TEST_CASE("Viewshed sweep")
+{
+    const int r = 40, n = 2 * r + 1;
+    std::vector<float> elev(n*n, 0.0f);
+    std::vector<unsigned char> valid(n*n, 1);
+
+    // no data all around the observer, and scattered elsewhere
+    for (int row = r - 1; row <= r + 1; ++row)
+        for (int col = r - 1; col <= r + 1; ++col)
+            if (row != r || col != r)
+                valid[row*n + col] = 0;
+
+    std::mt19937 gen(3);
+    for (int i = 0; i < 100; ++i)
+        valid[gen() % (n*n)] = 0;
+
+    std::vector<unsigned char> visible;
+
+    SECTION("No-data cells never block the view")
+    {
+        // flat ground below the eye: everything is visible
+        Viewshed::computeVisibility(r, elev, valid, 10.0, 0.0, visible);
+        REQUIRE(visible.size() == elev.size());
+
+        int hidden = 0;
+        for (int i = 0; i < n*n; ++i)
+            if (valid[i] && !visible[i])
+                ++hidden;
+        REQUIRE(hidden == 0);
+    }
+
+    SECTION("Matches a brute force line of sight")
+    {
+        for (int row = 0; row < n; ++row)
+            for (int col = 0; col < n; ++col)
+                elev[row*n + col] = (float)(
+                    20.0 * std::sin(col*0.21) * std::cos(row*0.17) +
+                    10.0 * std::sin((col + row)*0.07));
+
+        const double zObs = 25.0, targetHeight = 2.0;
+        Viewshed::computeVisibility(r, elev, valid, zObs, targetHeight, visible);
+
+        // the sweep interpolates horizons, so allow a few edge cases
+        int agree = 0, total = 0, numVisible = 0, numHidden = 0;
+        for (int row = 0; row < n; ++row)
+        {
+            for (int col = 0; col < n; ++col)
+            {
+                int i = row*n + col;
+                if (!valid[i] || (row == r && col == r))
+                    continue;
+
+                bool expected = bruteForce(r, elev, valid, zObs, targetHeight, col, row);
+                expected ? ++numVisible : ++numHidden;
+                if (expected == (visible[i] != 0))
+                    ++agree;
+                ++total;
+            }
+        }
+
+        REQUIRE(numVisible > 0);
+        REQUIRE(numHidden > 0);
+        REQUIRE((double)agree / (double)total > 0.97);
+    }
+}
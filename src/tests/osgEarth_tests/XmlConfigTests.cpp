@@ -0,0 +1,76 @@
+/* -*-c++-*- */
+/* osgEarth - Geospatial SDK for OpenSceneGraph
+* Copyright 2018 Pelican Mapping
+* http://osgearth.org
+*
+* osgEarth is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#include <osgEarth/catch.hpp>
+
+#include <osgEarth/XmlUtils>
+#include <osgEarth/Config>
+#include <sstream>
+
+using namespace osgEarth;
+
+namespace
+{
+    const char* sample =
+        "<?xml version=\"1.0\"?>\n"
+        "<!-- comment -->\n"
+        "<Map Name=\"test\" type=geocentric>\n"
+        "  <image name=\"a &amp; b\" driver=\"gdal\">\n"
+        "    <url>  data/world.tif  </url>\n"
+        "  </image>\n"
+        "  <FeatureModel name=\"m\" features=\"f\">\n"
+        "    <styles><style type=\"text/css\"><![CDATA[\n"
+        "      s1 { fill: #ff0000; }\n"
+        "    ]]></style></styles>\n"
+        "  </FeatureModel>\n"
+        "  <empty/>\n"
+        "</Map>\n";
+}
+
+TEST_CASE( "XmlDocument::readConfig matches the DOM" ) {
+    URIContext context("/data/test.earth");
+
+    std::istringstream domIn(sample);
+    osg::ref_ptr<XmlDocument> doc = XmlDocument::load(domIn, context);
+    REQUIRE(doc.valid());
+    Config viaDOM = doc->getConfig();
+
+    std::istringstream in(sample);
+    Config direct;
+    REQUIRE(XmlDocument::readConfig(in, context, direct));
+
+    REQUIRE(direct.toJSON() == viaDOM.toJSON());
+
+    const Config* map = direct.child_ptr("map");
+    REQUIRE(map != nullptr);
+    REQUIRE(map->value("name") == "test");
+    REQUIRE(map->value("type") == "geocentric");
+    REQUIRE(map->child("image").value("name") == "a & b");
+    REQUIRE(map->child("image").value("url") == "data/world.tif");
+}
+
+TEST_CASE( "XmlDocument::readConfig rejects malformed input" ) {
+    std::istringstream in("<map><image></map>");
+    Config output("unchanged");
+    REQUIRE(XmlDocument::readConfig(in, URIContext(), output) == false);
+    REQUIRE(output.empty());
+}